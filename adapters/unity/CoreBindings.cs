@@ -46,6 +46,50 @@ namespace CADGameFusion.UnityAdapter {
         [DllImport(DLL, CallingConvention = CallingConvention.Cdecl)]
         public static extern int cadgf_document_set_unit_scale(IntPtr doc, double unit_scale);
 
+        // Bulk entity snapshot (v1). Layout mirrors cadgf_entity_record_v1.
+        public const uint CADGF_ENTITY_FLAG_VISIBLE = 1u << 0;
+        public const uint CADGF_ENTITY_FILTER_TYPE = 1u << 0;
+        public const uint CADGF_ENTITY_FILTER_LAYER = 1u << 1;
+        public const uint CADGF_ENTITY_FILTER_SPACE = 1u << 2;
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct EntityRecordV1 {
+            public UInt64 id;
+            public int type;
+            public int layer_id;
+            public uint color;
+            public int group_id;
+            public uint flags;
+            public int point_count;
+            public int space;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct EntityFilterV1 {
+            public uint fields;
+            public int type;
+            public int layer_id;
+            public int space;
+        }
+
+        [DllImport(DLL, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int cadgf_document_get_entities_v1(IntPtr doc, IntPtr out_records, int out_capacity, ref int out_required);
+
+        [DllImport(DLL, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int cadgf_document_get_entities_v1(IntPtr doc, [Out] EntityRecordV1[] out_records, int out_capacity, ref int out_required);
+
+        [DllImport(DLL, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int cadgf_document_query_entities_v1(IntPtr doc, ref EntityFilterV1 filter, ref int inout_cursor,
+                                                                  [Out] EntityRecordV1[] out_records, int out_capacity, ref int out_count);
+
+        public static EntityRecordV1[] GetEntities(IntPtr doc) {
+            int count = 0;
+            if (cadgf_document_get_entities_v1(doc, IntPtr.Zero, 0, ref count) == 0 || count <= 0) return Array.Empty<EntityRecordV1>();
+            var records = new EntityRecordV1[count];
+            if (cadgf_document_get_entities_v1(doc, records, count, ref count) == 0) return Array.Empty<EntityRecordV1>();
+            return records;
+        }
+
         // Convenience wrappers
         public static Document CreateDocument() => new Document { Ptr = cadgf_document_create() };
         public static void Destroy(Document d) { if (d.Ptr != IntPtr.Zero) cadgf_document_destroy(d.Ptr); }
@@ -127,6 +127,7 @@ foreach(_needle
     "\"primary_conflict_constraint_indices\": []"
     "\"primary_redundancy_basis_constraint_indices\": []"
     "\"primary_redundant_constraint_indices\": []"
+    "\"presolved_constraints\": []"
     "\"structural_groups\": ["
     "\"anchor_constraint_index\": 0"
     "\"basis_variable_keys\": ["
@@ -524,3 +525,68 @@ foreach(_needle
 endforeach()
 
 message(STATUS "solve_from_project JSON tradeoff groups validated")
+
+set(_manifest "${outdir}/batch_manifest.txt")
+file(WRITE "${_manifest}" "# projects for --batch\nrank_constraints_project.json\n\ngrouped_constraints_project.json\n${_tradeoff_input}\nbad_constraints_project.json\nmissing_project.json\n")
+
+execute_process(
+  COMMAND "${exe}" --batch "${_manifest}" --jobs 3
+  RESULT_VARIABLE rc_batch
+  OUTPUT_VARIABLE _stdout_batch
+  ERROR_VARIABLE _stderr_batch
+)
+
+if(NOT rc_batch EQUAL 1)
+  message(FATAL_ERROR "solve_from_project --batch expected rc=1 (failing projects), got ${rc_batch}: ${_stderr_batch}\n${_stdout_batch}")
+endif()
+
+string(REGEX MATCHALL "[^\n]+" _batch_lines "${_stdout_batch}")
+list(LENGTH _batch_lines _batch_count)
+if(NOT _batch_count EQUAL 5)
+  message(FATAL_ERROR "solve_from_project --batch expected 5 NDJSON records, got ${_batch_count}:\n${_stdout_batch}")
+endif()
+
+foreach(_needle
+    [=["index":0]=]
+    [=["index":4]=]
+    [=["project":"]=]
+    [=["ok":true]=]
+    [=["ok":false]=]
+    [=["message":"Constraint validation failed"]=]
+    [=["error":"Open failed: ]=]
+    [=["timing_ms":{"load":]=]
+    [=["solve":]=]
+    [=["total":]=])
+  string(FIND "${_stdout_batch}" "${_needle}" _idx)
+  if(_idx EQUAL -1)
+    message(FATAL_ERROR "${_needle} not found in solve_from_project --batch output:\n${_stdout_batch}")
+  endif()
+endforeach()
+string(FIND "${_stderr_batch}" "batch: 5 projects, 2 failed, 3 workers" _idx)
+if(_idx EQUAL -1)
+  message(FATAL_ERROR "batch summary not found in solve_from_project --batch stderr:\n${_stderr_batch}")
+endif()
+
+execute_process(
+  COMMAND "${exe}" --batch "${outdir}" --jobs 2 --json --diagnostics counts
+  RESULT_VARIABLE rc_batch_dir
+  OUTPUT_VARIABLE _stdout_batch_dir
+  ERROR_VARIABLE _stderr_batch_dir
+)
+
+string(REGEX MATCHALL "[^\n]+" _batch_dir_lines "${_stdout_batch_dir}")
+list(LENGTH _batch_dir_lines _batch_dir_count)
+if(NOT _batch_dir_count EQUAL 5)
+  message(FATAL_ERROR "solve_from_project --batch <dir> expected 5 NDJSON records, got ${_batch_dir_count}:\n${_stdout_batch_dir}")
+endif()
+foreach(_needle
+    [=["result":{]=]
+    [=["jacobian_rank":]=]
+    [=["structural_groups":[]]=])
+  string(FIND "${_stdout_batch_dir}" "${_needle}" _idx)
+  if(_idx EQUAL -1)
+    message(FATAL_ERROR "${_needle} not found in solve_from_project --batch <dir> output:\n${_stdout_batch_dir}")
+  endif()
+endforeach()
+
+message(STATUS "solve_from_project batch NDJSON validated")
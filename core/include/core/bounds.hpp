@@ -39,4 +39,9 @@ namespace core {
 bool contentBounds(const Document& doc,
                    double& minX, double& minY, double& maxX, double& maxY);
 
+// Bounds of one entity with the same per-type coverage, except that a Point
+// bounds to its own position (it is pickable even though it draws no ink).
+// Feeds Document::spatial_index(). Returns false for an empty payload.
+bool entityBounds(const Entity& e, Box2& out);
+
 }  // namespace core
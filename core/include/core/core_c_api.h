@@ -113,10 +113,84 @@ typedef struct core_entity_info_v2 {
     unsigned int color; // 0xRRGGBB, 0 = inherit from layer
 } core_entity_info_v2;
 
+// Bulk entity record (v1): one row of cadgf_document_get_entities_v1 / query_entities_v1.
+#define CORE_ENTITY_FLAG_VISIBLE (1u << 0)
+#define CADGF_ENTITY_FLAG_VISIBLE CORE_ENTITY_FLAG_VISIBLE
+typedef struct core_entity_record_v1 {
+    core_entity_id id;
+    int type;           // CORE_ENTITY_TYPE_*
+    int layer_id;
+    unsigned int color; // 0xRRGGBB, 0 = inherit from layer
+    int group_id;       // -1 = ungrouped
+    unsigned int flags; // CORE_ENTITY_FLAG_*
+    int point_count;    // polyline vertices / spline control points; 0 otherwise
+    int space;          // -1 = unknown, 0 = model, 1 = paper (dxf.entity.<id>.space)
+} core_entity_record_v1;
+
+// Filter for cursor enumeration. Only members selected in `fields` are tested.
+#define CORE_ENTITY_FILTER_TYPE  (1u << 0)
+#define CORE_ENTITY_FILTER_LAYER (1u << 1)
+#define CORE_ENTITY_FILTER_SPACE (1u << 2)
+#define CADGF_ENTITY_FILTER_TYPE  CORE_ENTITY_FILTER_TYPE
+#define CADGF_ENTITY_FILTER_LAYER CORE_ENTITY_FILTER_LAYER
+#define CADGF_ENTITY_FILTER_SPACE CORE_ENTITY_FILTER_SPACE
+typedef struct core_entity_filter_v1 {
+    unsigned int fields; // CORE_ENTITY_FILTER_* bits
+    int type;
+    int layer_id;
+    int space;
+} core_entity_filter_v1;
+
+// Typed per-entity attribute fields (dxf.entity.<id>.<field> provenance).
+// Built-in ids are stable; other field names get ids >= CORE_ENTITY_ATTR_BUILTIN_COUNT
+// per document via core_document_register_entity_attr_field.
+#define CORE_ENTITY_ATTR_COLOR_SOURCE      0
+#define CORE_ENTITY_ATTR_COLOR_ACI         1
+#define CORE_ENTITY_ATTR_SPACE             2
+#define CORE_ENTITY_ATTR_LAYOUT            3
+#define CORE_ENTITY_ATTR_TEXT_STYLE        4
+#define CORE_ENTITY_ATTR_SOURCE_TYPE       5
+#define CORE_ENTITY_ATTR_EDIT_MODE         6
+#define CORE_ENTITY_ATTR_PROXY_KIND        7
+#define CORE_ENTITY_ATTR_BLOCK_NAME        8
+#define CORE_ENTITY_ATTR_HATCH_PATTERN     9
+#define CORE_ENTITY_ATTR_HATCH_ID          10
+#define CORE_ENTITY_ATTR_SOURCE_BUNDLE_ID  11
+#define CORE_ENTITY_ATTR_TEXT_KIND         12
+#define CORE_ENTITY_ATTR_TEXT_ATTACHMENT   13
+#define CORE_ENTITY_ATTR_TEXT_HALIGN       14
+#define CORE_ENTITY_ATTR_TEXT_VALIGN       15
+#define CORE_ENTITY_ATTR_TEXT_FONT_FILE    16
+#define CORE_ENTITY_ATTR_TEXT_BIGFONT_FILE 17
+#define CORE_ENTITY_ATTR_ATTRIBUTE_TAG     18
+#define CORE_ENTITY_ATTR_BUILTIN_COUNT     19
+#define CADGF_ENTITY_ATTR_COLOR_SOURCE      CORE_ENTITY_ATTR_COLOR_SOURCE
+#define CADGF_ENTITY_ATTR_COLOR_ACI         CORE_ENTITY_ATTR_COLOR_ACI
+#define CADGF_ENTITY_ATTR_SPACE             CORE_ENTITY_ATTR_SPACE
+#define CADGF_ENTITY_ATTR_LAYOUT            CORE_ENTITY_ATTR_LAYOUT
+#define CADGF_ENTITY_ATTR_TEXT_STYLE        CORE_ENTITY_ATTR_TEXT_STYLE
+#define CADGF_ENTITY_ATTR_SOURCE_TYPE       CORE_ENTITY_ATTR_SOURCE_TYPE
+#define CADGF_ENTITY_ATTR_EDIT_MODE         CORE_ENTITY_ATTR_EDIT_MODE
+#define CADGF_ENTITY_ATTR_PROXY_KIND        CORE_ENTITY_ATTR_PROXY_KIND
+#define CADGF_ENTITY_ATTR_BLOCK_NAME        CORE_ENTITY_ATTR_BLOCK_NAME
+#define CADGF_ENTITY_ATTR_HATCH_PATTERN     CORE_ENTITY_ATTR_HATCH_PATTERN
+#define CADGF_ENTITY_ATTR_HATCH_ID          CORE_ENTITY_ATTR_HATCH_ID
+#define CADGF_ENTITY_ATTR_SOURCE_BUNDLE_ID  CORE_ENTITY_ATTR_SOURCE_BUNDLE_ID
+#define CADGF_ENTITY_ATTR_TEXT_KIND         CORE_ENTITY_ATTR_TEXT_KIND
+#define CADGF_ENTITY_ATTR_TEXT_ATTACHMENT   CORE_ENTITY_ATTR_TEXT_ATTACHMENT
+#define CADGF_ENTITY_ATTR_TEXT_HALIGN       CORE_ENTITY_ATTR_TEXT_HALIGN
+#define CADGF_ENTITY_ATTR_TEXT_VALIGN       CORE_ENTITY_ATTR_TEXT_VALIGN
+#define CADGF_ENTITY_ATTR_TEXT_FONT_FILE    CORE_ENTITY_ATTR_TEXT_FONT_FILE
+#define CADGF_ENTITY_ATTR_TEXT_BIGFONT_FILE CORE_ENTITY_ATTR_TEXT_BIGFONT_FILE
+#define CADGF_ENTITY_ATTR_ATTRIBUTE_TAG     CORE_ENTITY_ATTR_ATTRIBUTE_TAG
+#define CADGF_ENTITY_ATTR_BUILTIN_COUNT     CORE_ENTITY_ATTR_BUILTIN_COUNT
+
 typedef core_layer_info  cadgf_layer_info;
 typedef core_layer_info_v2 cadgf_layer_info_v2;
 typedef core_entity_info cadgf_entity_info;
 typedef core_entity_info_v2 cadgf_entity_info_v2;
+typedef core_entity_record_v1 cadgf_entity_record_v1;
+typedef core_entity_filter_v1 cadgf_entity_filter_v1;
 
 // Return convention
 // Most API functions return int: 1 on success, 0 on failure.
@@ -154,6 +228,14 @@ CORE_API core_entity_id core_document_add_polyline(core_document* doc, const cor
 // Adds a polyline with optional name and layer binding.
 CORE_API core_entity_id core_document_add_polyline_ex(core_document* doc, const core_vec2* pts, int n,
                                                       const char* name_utf8, int layer_id);
+// Bulk polyline insert. points holds all vertices back to back; point_counts[i]
+// (>= 2) is the vertex count of polyline i. layer_ids and names_utf8 may be NULL
+// (layer 0, empty name). Ids are contiguous starting at *out_first_id; the call
+// adds nothing and returns 0 if any count is invalid.
+CORE_API int core_document_add_polylines_v1(core_document* doc, const core_vec2* points,
+                                            const int* point_counts, int polyline_count,
+                                            const int* layer_ids, const char* const* names_utf8,
+                                            core_entity_id* out_first_id);
 CORE_API core_entity_id core_document_add_point(core_document* doc, const core_point* p,
                                                 const char* name_utf8, int layer_id);
 CORE_API core_entity_id core_document_add_line(core_document* doc, const core_line* l,
@@ -179,6 +261,10 @@ CADGF_API void cadgf_document_destroy(cadgf_document* doc);
 CADGF_API cadgf_entity_id cadgf_document_add_polyline(cadgf_document* doc, const cadgf_vec2* pts, int n);
 CADGF_API cadgf_entity_id cadgf_document_add_polyline_ex(cadgf_document* doc, const cadgf_vec2* pts, int n,
                                                          const char* name_utf8, int layer_id);
+CADGF_API int cadgf_document_add_polylines_v1(cadgf_document* doc, const cadgf_vec2* points,
+                                              const int* point_counts, int polyline_count,
+                                              const int* layer_ids, const char* const* names_utf8,
+                                              cadgf_entity_id* out_first_id);
 CADGF_API cadgf_entity_id cadgf_document_add_point(cadgf_document* doc, const cadgf_point* p,
                                                    const char* name_utf8, int layer_id);
 CADGF_API cadgf_entity_id cadgf_document_add_line(cadgf_document* doc, const cadgf_line* l,
@@ -226,6 +312,38 @@ CORE_API int core_document_get_entity_info_v2(const core_document* doc, core_ent
 CORE_API int core_document_get_entity_name(const core_document* doc, core_entity_id id,
                                            char* out_name_utf8, int out_name_capacity,
                                            int* out_required_bytes);
+// Bulk snapshot of all entities in document order (linear time).
+// Two-call pattern:
+//  1) Call with out_records=nullptr/out_capacity=0 to query the entity count
+//  2) Allocate out_records[count] and call again; returns 0 if capacity is too small
+CORE_API int core_document_get_entities_v1(const core_document* doc,
+                                           core_entity_record_v1* out_records, int out_capacity,
+                                           int* out_required);
+// Chunked, filtered enumeration. Start with *inout_cursor = 0; each call fills up to
+// out_capacity matching records, writes *out_count and advances the cursor.
+// Enumeration is complete when *out_count == 0. filter may be nullptr (match all).
+CORE_API int core_document_query_entities_v1(const core_document* doc,
+                                             const core_entity_filter_v1* filter,
+                                             int* inout_cursor,
+                                             core_entity_record_v1* out_records, int out_capacity,
+                                             int* out_count);
+// Spatial queries over entity bounding boxes (R-tree maintained by the document).
+// Results are box-level candidates; refine against exact geometry if needed.
+// Ids whose box intersects [min_x,max_x]x[min_y,max_y], ascending. Two-call pattern
+// like core_document_get_entities_v1.
+CORE_API int core_document_query_rect_v1(const core_document* doc,
+                                         double min_x, double min_y, double max_x, double max_y,
+                                         core_entity_id* out_ids, int out_capacity, int* out_required);
+// Up to k ids nearest to (x, y) by box distance (0 inside), closest first.
+// out_distances may be nullptr. *out_count receives the number written.
+CORE_API int core_document_query_nearest_v1(const core_document* doc, double x, double y, int k,
+                                            core_entity_id* out_ids, double* out_distances,
+                                            int* out_count);
+// Ids whose box the segment (x0,y0)-(x1,y1) touches, ordered from (x0,y0) onwards.
+// Two-call pattern.
+CORE_API int core_document_query_segment_v1(const core_document* doc,
+                                            double x0, double y0, double x1, double y1,
+                                            core_entity_id* out_ids, int out_capacity, int* out_required);
 // Two-call pattern for polyline points:
 //  1) Call with out_pts=nullptr/out_pts_capacity=0 to query point count
 //  2) Allocate out_pts[point_count] and call again
@@ -303,6 +421,29 @@ CORE_API int core_document_get_meta_value(const core_document* doc, const char*
 CORE_API int core_document_set_meta_value(core_document* doc, const char* key_utf8, const char* value_utf8);
 CORE_API int core_document_remove_meta_value(core_document* doc, const char* key_utf8);
 
+// Typed per-entity attributes (CORE_ENTITY_ATTR_*). The same values are visible
+// through the meta key/value functions above as "dxf.entity.<id>.<field>".
+CORE_API int core_document_get_entity_attr_field(const core_document* doc, const char* name_utf8, int* out_field);
+CORE_API int core_document_register_entity_attr_field(core_document* doc, const char* name_utf8, int* out_field);
+CORE_API int core_document_set_entity_attr_int(core_document* doc, core_entity_id id, int field, long long value);
+CORE_API int core_document_set_entity_attr_double(core_document* doc, core_entity_id id, int field, double value);
+CORE_API int core_document_set_entity_attr_string(core_document* doc, core_entity_id id, int field,
+                                                  const char* value_utf8);
+// Legacy text form (ints decimal, doubles "%.6f"); returns 0 when not present.
+CORE_API int core_document_get_entity_attr_text(const core_document* doc, core_entity_id id, int field,
+                                                char* out_utf8, int out_cap, int* out_required_bytes);
+// Bulk reads of one field for `count` ids. Absent entries get out_present[i] = 0
+// (ints) or out_string_ids[i] = -1 (strings); out_present may be NULL.
+CORE_API int core_document_get_entity_attr_ints_v1(const core_document* doc, int field,
+                                                   const core_entity_id* ids, int count,
+                                                   long long* out_values, unsigned char* out_present);
+CORE_API int core_document_get_entity_attr_string_ids_v1(const core_document* doc, int field,
+                                                         const core_entity_id* ids, int count,
+                                                         int* out_string_ids);
+// Resolve an interned attribute string id returned by get_entity_attr_string_ids_v1.
+CORE_API int core_document_get_attr_string(const core_document* doc, int string_id,
+                                           char* out_utf8, int out_cap, int* out_required_bytes);
+
 CADGF_API int cadgf_document_get_layer_count(const cadgf_document* doc, int* out_count);
 CADGF_API int cadgf_document_get_layer_id_at(const cadgf_document* doc, int index, int* out_layer_id);
 CADGF_API int cadgf_document_get_layer_info(const cadgf_document* doc, int layer_id, cadgf_layer_info* out_info);
@@ -325,6 +466,23 @@ CADGF_API int cadgf_document_get_entity_info_v2(const cadgf_document* doc, cadgf
 CADGF_API int cadgf_document_get_entity_name(const cadgf_document* doc, cadgf_entity_id id,
                                              char* out_name_utf8, int out_name_capacity,
                                              int* out_required_bytes);
+CADGF_API int cadgf_document_get_entities_v1(const cadgf_document* doc,
+                                             cadgf_entity_record_v1* out_records, int out_capacity,
+                                             int* out_required);
+CADGF_API int cadgf_document_query_entities_v1(const cadgf_document* doc,
+                                               const cadgf_entity_filter_v1* filter,
+                                               int* inout_cursor,
+                                               cadgf_entity_record_v1* out_records, int out_capacity,
+                                               int* out_count);
+CADGF_API int cadgf_document_query_rect_v1(const cadgf_document* doc,
+                                           double min_x, double min_y, double max_x, double max_y,
+                                           cadgf_entity_id* out_ids, int out_capacity, int* out_required);
+CADGF_API int cadgf_document_query_nearest_v1(const cadgf_document* doc, double x, double y, int k,
+                                              cadgf_entity_id* out_ids, double* out_distances,
+                                              int* out_count);
+CADGF_API int cadgf_document_query_segment_v1(const cadgf_document* doc,
+                                              double x0, double y0, double x1, double y1,
+                                              cadgf_entity_id* out_ids, int out_capacity, int* out_required);
 CADGF_API int cadgf_document_get_polyline_points(const cadgf_document* doc, cadgf_entity_id id,
                                                  cadgf_vec2* out_pts, int out_pts_capacity,
                                                  int* out_required_points);
@@ -396,6 +554,23 @@ CADGF_API int cadgf_document_get_meta_value(const cadgf_document* doc, const cha
 CADGF_API int cadgf_document_set_meta_value(cadgf_document* doc, const char* key_utf8, const char* value_utf8);
 CADGF_API int cadgf_document_remove_meta_value(cadgf_document* doc, const char* key_utf8);
 
+CADGF_API int cadgf_document_get_entity_attr_field(const cadgf_document* doc, const char* name_utf8, int* out_field);
+CADGF_API int cadgf_document_register_entity_attr_field(cadgf_document* doc, const char* name_utf8, int* out_field);
+CADGF_API int cadgf_document_set_entity_attr_int(cadgf_document* doc, cadgf_entity_id id, int field, long long value);
+CADGF_API int cadgf_document_set_entity_attr_double(cadgf_document* doc, cadgf_entity_id id, int field, double value);
+CADGF_API int cadgf_document_set_entity_attr_string(cadgf_document* doc, cadgf_entity_id id, int field,
+                                                    const char* value_utf8);
+CADGF_API int cadgf_document_get_entity_attr_text(const cadgf_document* doc, cadgf_entity_id id, int field,
+                                                  char* out_utf8, int out_cap, int* out_required_bytes);
+CADGF_API int cadgf_document_get_entity_attr_ints_v1(const cadgf_document* doc, int field,
+                                                     const cadgf_entity_id* ids, int count,
+                                                     long long* out_values, unsigned char* out_present);
+CADGF_API int cadgf_document_get_entity_attr_string_ids_v1(const cadgf_document* doc, int field,
+                                                           const cadgf_entity_id* ids, int count,
+                                                           int* out_string_ids);
+CADGF_API int cadgf_document_get_attr_string(const cadgf_document* doc, int string_id,
+                                             char* out_utf8, int out_cap, int* out_required_bytes);
+
 // Triangulation C API (stateless)
 // Two-call pattern:
 //  1) Call with indices=nullptr to query index_count (output)
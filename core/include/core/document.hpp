@@ -5,14 +5,21 @@
 #include <cstdint>
 #include <variant>
 #include <map>
+#include <memory>
+#include <deque>
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <optional>
 
 #include "core/geometry2d.hpp"
+#include "core/spatial_index.hpp"
 
 namespace core {
 
+class ISolver;
+struct SolveResult;
+
 using EntityId = uint64_t;
 
 enum class EntityType {
@@ -43,6 +50,33 @@ struct ElementRef {
     int index{-1}; // control point or vertex index when applicable
 };
 
+// Scalar a constraint variable binds to: a coordinate of the point an
+// ElementRef names, or a shape parameter of the referenced entity (role and
+// index do not apply to those).
+enum class ParamField : uint8_t {
+    X = 0,
+    Y,
+    Radius,     // Circle, Arc
+    StartAngle, // Arc
+    EndAngle    // Arc
+};
+
+struct ConstraintParam {
+    ElementRef ref;
+    ParamField field{ParamField::X};
+};
+
+using ConstraintId = uint64_t;
+
+// A constraint kept with the document. `type` and `value` are those of
+// core::ConstraintSpec (core/solver.hpp); params stand in for its variables.
+struct DocumentConstraint {
+    ConstraintId id{};
+    std::string type;
+    std::vector<ConstraintParam> params;
+    std::optional<double> value;
+};
+
 struct BlockDefinition {
     std::string name;
     std::vector<EntityId> memberIds; // entities belonging to this block
@@ -74,6 +108,31 @@ struct Entity {
     double line_type_scale{0.0};  // 0 = default
 };
 
+// Payload field a constraint param binds to, or nullptr when the entity has
+// no such point or field. Points by role: Point None/Start/Center; Line
+// Start/End; Arc, Circle and Ellipse Center; Polyline and Spline Start/End
+// and ControlPoint `index`; Text and BlockInstance None/Start. Derived
+// points such as a line's Mid are not bindable.
+double* constraint_param_field(Entity& e, const ConstraintParam& param);
+const double* constraint_param_field(const Entity& e, const ConstraintParam& param);
+// Solver variables of a param are VarRef{"<entity id>", key} with key
+// "<role>_<axis>" ("start_x", "cp2_y"; plain "x"/"y" for PointRole::None) or
+// the field name ("radius", "start_angle", "end_angle"), so diagnostics read
+// "12.start_x".
+std::string constraint_param_key(const ConstraintParam& param);
+
+// Payloads a constraint solve produced away from the document (see
+// DocumentSnapshot::solve_constraints), one per moved entity.
+struct ConstraintSolution {
+    uint64_t revision{0}; // revision of the snapshot that was solved
+    uint64_t constraintRevision{0}; // of its constraint table
+    std::vector<EntityId> ids;
+    std::vector<EntityPayload> payloads;
+    // Every entity the solve read, with the payload it started from.
+    std::vector<EntityId> readIds;
+    std::vector<EntityPayload> readPayloads;
+};
+
 struct Layer {
     int id{0};
     std::string name;
@@ -101,6 +160,44 @@ struct DocumentMetadata {
     std::map<std::string, std::string> meta;
 };
 
+// Typed per-entity attributes (importer provenance). Stored in an id-indexed
+// side table on Document instead of "dxf.entity.<id>.<field>" strings in
+// DocumentMetadata::meta; the string keys remain readable as a view.
+// Fields past Count are registered at runtime by name.
+enum class EntityAttrField : uint16_t {
+    ColorSource = 0,
+    ColorAci,
+    Space,
+    Layout,
+    TextStyle,
+    SourceType,
+    EditMode,
+    ProxyKind,
+    BlockName,
+    HatchPattern,
+    HatchId,
+    SourceBundleId,
+    TextKind,
+    TextAttachment,
+    TextHalign,
+    TextValign,
+    TextFontFile,
+    TextBigfontFile,
+    AttributeTag,
+    Count
+};
+
+struct EntityAttrValue {
+    enum class Kind : uint8_t { None = 0, Int, Double, String };
+    Kind kind{Kind::None};
+    union {
+        int64_t i;
+        double d;
+        uint32_t str; // index into the document's interned attribute strings
+    };
+    EntityAttrValue() : i(0) {}
+};
+
 class Document;
 
 enum class DocumentChangeType {
@@ -121,15 +218,46 @@ struct DocumentChangeEvent {
     int layerId{0};
 };
 
+// Net effect of a change batch, delivered once when the outermost batch ends.
+// Ids are listed in first-touched order; an entity added and removed within the
+// same batch appears in neither list, and added entities are not repeated in
+// geometryChanged/metaChanged.
+struct DocumentChangeSet {
+    std::vector<EntityId> added;
+    std::vector<EntityId> removed;
+    std::vector<EntityId> geometryChanged;
+    std::vector<EntityId> metaChanged;
+    std::vector<int> layersChanged;
+    bool documentMetaChanged{false};
+    bool settingsChanged{false};
+    // Document was cleared, or a change was not attributable to specific ids.
+    bool fullReload{false};
+
+    bool empty() const {
+        return added.empty() && removed.empty() && geometryChanged.empty() && metaChanged.empty() &&
+               layersChanged.empty() && !documentMetaChanged && !settingsChanged && !fullReload;
+    }
+};
+
 class DocumentObserver {
 public:
     virtual ~DocumentObserver() = default;
     virtual void on_before_document_changed(const Document& /*doc*/, const DocumentChangeEvent& /*event*/) {}
     virtual void on_document_changed(const Document& doc, const DocumentChangeEvent& event) = 0;
+    // Called once at the end of a change batch. The default forwards a single
+    // Reset event so observers without incremental handling rebuild as before.
+    virtual void on_document_batch_changed(const Document& doc, const DocumentChangeSet& /*changes*/) {
+        DocumentChangeEvent event;
+        event.type = DocumentChangeType::Reset;
+        on_document_changed(doc, event);
+    }
 };
 
 // Dependency graph for topological recompute (P3.2, FreeCAD-inspired).
 // Tracks directed edges: source → dependent. When source changes, dependents recompute in topo order.
+// Entities get dense node indices while they have edges. A topological
+// order of all nodes is kept up to date as edges are added, and traversals
+// run over a compact (CSR) copy of the adjacency rebuilt after edits.
 class DependencyGraph {
 public:
     // Add a dependency edge: `dependent` depends on `source`.
@@ -155,16 +283,48 @@ public:
 
     // Get all entities in the graph.
     std::vector<EntityId> allEntities() const;
-    bool empty() const { return forward_.empty(); }
-    size_t edgeCount() const;
+    bool empty() const { return edges_ == 0; }
+    size_t edgeCount() const { return edges_; }
+    // False while the edges form a cycle.
+    bool acyclic() const;
 
 private:
-    // forward_[source] = {dependents}
-    std::unordered_map<EntityId, std::unordered_set<EntityId>> forward_;
-    // reverse_[dependent] = {sources}
-    std::unordered_map<EntityId, std::unordered_set<EntityId>> reverse_;
+    friend class Document;
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    uint32_t node_of(EntityId id) const;
+    uint32_t intern(EntityId id);
+    void release_if_isolated(uint32_t node);
+    void unlink(uint32_t source, uint32_t dependent);
+    void reorder(uint32_t source, uint32_t dependent);
+    bool restore_order() const;
+    void build_csr() const;
+    // Nodes reachable from `roots` (roots included, once each) in
+    // topological order; nodes on a cycle are left out and flag `hasCycle`.
+    std::vector<uint32_t> ordered_downstream(const std::vector<uint32_t>& roots, bool* hasCycle) const;
+
+    std::unordered_map<EntityId, uint32_t> index_;
+    std::vector<EntityId> ids_;           // node -> entity
+    std::vector<uint32_t> free_;          // released node indices
+    // Editable adjacency, each list sorted: out_[source] = {dependents},
+    // in_[dependent] = {sources}.
+    std::vector<std::vector<uint32_t>> out_;
+    std::vector<std::vector<uint32_t>> in_;
+    size_t edges_{0};
+    // CSR copy of out_/in_ for traversals; rebuilt on first use after an edit.
+    mutable std::vector<uint32_t> out_offsets_, out_targets_;
+    mutable std::vector<uint32_t> in_offsets_, in_targets_;
+    mutable bool csr_stale_{false};
+    // ord_[node]: the node's position in a topological order of all nodes
+    // (gaps allowed), repaired per added edge (Pearce-Kelly). Invalid while
+    // the graph has a cycle; re-derived once the cycle is broken.
+    mutable std::vector<uint64_t> ord_;
+    mutable uint64_t next_ord_{0};
+    mutable bool order_valid_{true};
 };
 
+class DocumentSnapshot;
+
 class Document {
 public:
     Document();
@@ -214,6 +374,19 @@ public:
     bool set_text(EntityId id, const Text& t);
 
     EntityId add_polyline(const Polyline& pl, const std::string& name = "", int layerId = 0);
+    // Bulk insert: payloads are moved in, ids are assigned contiguously
+    // (returns the first, 0 when empty) and observers see one batched change.
+    // Entity::type is derived from the payload.
+    EntityId add_entities(std::vector<Entity>&& entities);
+    // Moves all entities, layers, block definitions, typed attributes and meta
+    // entries out of `src` (which is left cleared) in one step. Entities get
+    // contiguous new ids (returns the first, 0 when src has none). Source layers
+    // found in `layerRemap` land on the given layer; the rest are appended as new
+    // layers, except the default layer 0 which maps to 0. Group ids and keys
+    // naming entity/layer ids are remapped; existing meta keys are kept.
+    // Observers see one batched change. The applied layer map goes to outLayerMap.
+    using LayerRemap = std::unordered_map<int, int>;
+    EntityId splice_from(Document&& src, const LayerRemap& layerRemap = {}, LayerRemap* outLayerMap = nullptr);
     bool set_polyline_points(EntityId id, const Polyline& pl);
 
     // Block definition / instance management (P2.4)
@@ -240,10 +413,15 @@ public:
     void begin_change_batch();
     void end_change_batch();
 
+    // Entities in insertion order. A removed entity leaves a tombstone (id 0)
+    // that readers skip; storage is compacted once tombstones make up half of
+    // it, outside change batches.
     const std::vector<Entity>& entities() const { return entities_; }
+    // Live entities, i.e. entities() without the tombstones.
+    size_t entity_count() const { return entities_.size() - entity_tombstones_; }
     DocumentSettings& settings() { return settings_; }
     const DocumentSettings& settings() const { return settings_; }
-    DocumentMetadata& metadata() { return metadata_; }
+    DocumentMetadata& metadata() { meta_view_valid_ = false; return metadata_; }
     const DocumentMetadata& metadata() const { return metadata_; }
     bool set_label(const std::string& label);
     bool set_author(const std::string& author);
@@ -254,20 +432,103 @@ public:
     bool set_unit_name(const std::string& unit_name);
     bool set_meta_value(const std::string& key, const std::string& value);
     bool remove_meta_value(const std::string& key);
+    // Reads a meta key, including "dxf.entity.<id>.<field>" keys backed by the
+    // typed attribute table.
+    bool get_meta_value(const std::string& key, std::string* out) const;
+    // All meta keys (metadata().meta plus typed entity attributes rendered as
+    // legacy keys) in key order. Built on demand and cached until the next change.
+    const std::vector<std::pair<std::string, std::string>>& meta_entries() const;
     bool set_unit_scale(double unit_scale);
 
+    // Immutable copy of the entities, layers, settings and metadata, safe to
+    // read from another thread while this document keeps changing. Entities not
+    // edited since the previous snapshot (still alive somewhere) are shared with
+    // it, so an unchanged document returns the same snapshot and an edit costs a
+    // pointer copy per entity plus a copy of each edited entity. Typed entity
+    // attributes are not included.
+    std::shared_ptr<const DocumentSnapshot> snapshot() const;
+    // The setters record their changes. A write made directly through a
+    // mutable accessor (get_entity, the typed getters, get_layer, settings,
+    // metadata) must be reported here before the snapshot, spatial index and
+    // revision see it; `entityId` 0 stands for layers, settings and metadata.
+    void mark_modified(EntityId entityId = 0);
+    // Increases whenever the document may have changed.
+    uint64_t revision() const { return revision_; }
+    // R-tree over entity bounds (core/bounds.hpp entityBounds), built on first
+    // use and then updated incrementally for the entities changed since.
+    const SpatialIndex& spatial_index() const;
+
+    // Typed per-entity attributes. Setting never requires the entity to exist,
+    // matching the legacy string keys it replaces.
+    EntityAttrField entity_attr_field(const std::string& name);
+    bool find_entity_attr_field(const std::string& name, EntityAttrField* out) const;
+    const std::string& entity_attr_field_name(EntityAttrField field) const;
+    size_t entity_attr_field_count() const { return attr_field_names_.size(); }
+    bool set_entity_attr_int(EntityId id, EntityAttrField field, int64_t value);
+    bool set_entity_attr_double(EntityId id, EntityAttrField field, double value);
+    bool set_entity_attr_string(EntityId id, EntityAttrField field, const std::string& value);
+    bool remove_entity_attr(EntityId id, EntityAttrField field);
+    const EntityAttrValue* get_entity_attr(EntityId id, EntityAttrField field) const;
+    bool get_entity_attr_int(EntityId id, EntityAttrField field, int64_t* out) const;
+    const std::string& attr_string(uint32_t index) const;
+    size_t attr_string_count() const { return attr_strings_.size(); }
+    // Legacy text form of an attribute ("" when absent): ints in decimal,
+    // doubles as "%.6f", strings verbatim.
+    std::string entity_attr_text(EntityId id, EntityAttrField field) const;
+
     // Dependency graph + topological recompute (P3.2)
     DependencyGraph& dependency_graph() { return dep_graph_; }
     const DependencyGraph& dependency_graph() const { return dep_graph_; }
     using RecomputeCallback = std::function<void(Document& doc, EntityId id)>;
     void set_recompute_callback(RecomputeCallback cb) { recompute_cb_ = std::move(cb); }
+    // Two-phase form that lets independent entities recompute concurrently:
+    // `compute` runs on worker threads against the read-only document and
+    // returns the write to make (or nothing); writes run on the calling
+    // thread. Entities recompute level by level, and a level's writes land
+    // before the next level computes. Takes precedence over the serial
+    // callback when set.
+    // `compute` may call the const accessors: entities() (skipping id-0
+    // tombstones), get_entity and the typed getters,
+    // get_layer, layers, settings, metadata, get_meta_value, meta_entries,
+    // spatial_index, the entity attribute getters, constraints and the
+    // dependency_graph() queries; the lazily built ones are brought up to date
+    // before each level. It must not call snapshot(), which builds a new
+    // snapshot after every level's writes.
+    using RecomputeWrite = std::function<void(Document& doc)>;
+    using ParallelRecomputeCallback = std::function<RecomputeWrite(const Document& doc, EntityId id)>;
+    void set_parallel_recompute_callback(ParallelRecomputeCallback cb) { parallel_recompute_cb_ = std::move(cb); }
+    // Worker threads for the parallel callback (0 = hardware concurrency, 1 = serial).
+    void set_recompute_threads(int threads) { recompute_threads_ = threads; }
     // Recompute all entities downstream of `changedIds` in topological order.
-    // Calls the registered recompute callback for each dependent entity.
+    // Calls the registered recompute callback for each dependent entity,
+    // once however many of its sources changed.
     // Returns the number of entities recomputed.
     int recompute(const std::vector<EntityId>& changedIds);
     // Recompute everything in the graph.
     int recompute_all();
 
+    // Constraint table. Snapshots carry it, the undo history does not;
+    // constraints on an entity that is later removed stay, and report its
+    // params as unbound when solved.
+    ConstraintId add_constraint(const std::string& type, std::vector<ConstraintParam> params,
+                                std::optional<double> value = std::nullopt);
+    bool remove_constraint(ConstraintId id);
+    const DocumentConstraint* get_constraint(ConstraintId id) const;
+    const std::vector<DocumentConstraint>& constraints() const { return constraints_; }
+    // Solves the table through `solver`, reading and writing the entity
+    // payloads in place. Entities that moved are reported as one change
+    // batch and recorded in the active transaction. Diagnostic constraint
+    // indices follow constraints().
+    SolveResult solve_constraints(ISolver& solver);
+    // Writes back payloads solved on a snapshot in one change batch (recorded
+    // in the active transaction). Entities removed or turned into another
+    // kind since are skipped. Returns the number applied.
+    size_t apply_constraint_solution(const ConstraintSolution& solution);
+    // True while the constraint table and every entity the solve read are as
+    // they were in the solved snapshot. Other edits since leave the solution
+    // as good as a fresh one.
+    bool constraint_solution_current(const ConstraintSolution& solution) const;
+
     // Transaction-based undo/redo (P2.1)
     void begin_transaction(const std::string& label = "");
     void commit_transaction();
@@ -279,48 +540,188 @@ public:
     std::string undo_label() const;
     std::string redo_label() const;
     size_t undo_stack_size() const;
+    // Approximate memory held by undo + redo history. With a budget set (0 =
+    // unlimited, the default) the oldest undo steps are dropped first, then the
+    // farthest redo steps; the newest committed step is always kept.
+    void set_undo_byte_budget(size_t bytes);
+    size_t undo_byte_budget() const { return undo_byte_budget_; }
+    size_t undo_bytes() const { return undo_bytes_; }
 
 private:
     void notify_before(DocumentChangeType type, EntityId entityId = 0, int layerId = 0);
+    // Marks derived state (snapshot, spatial index) stale; a nonzero id names
+    // the entity that changed.
+    void mark_changed(EntityId entityId = 0);
     void notify(DocumentChangeType type, EntityId entityId = 0, int layerId = 0);
+    // Recomputes the graph nodes downstream of `roots`, the roots themselves
+    // only when `includeRoots`.
+    int recompute_from(const std::vector<uint32_t>& roots, bool includeRoots);
+    // Brings the spatial index, meta view and dependency graph order/CSR up
+    // to date so that concurrent const readers find nothing left to build.
+    void refresh_read_caches();
+
+    // Entity storage: slot vector + id index. Removal leaves a tombstone (id 0);
+    // compact_entities_if_sparse() squeezes them out once they are half the
+    // storage, so removal stays amortized O(1).
+    Entity& push_entity(Entity&& e);
+    void compact_entities();
+    void compact_entities_if_sparse();
+
+    // Typed attribute storage: one small field-sorted row per entity id.
+    struct EntityAttrSlot {
+        EntityAttrField field{EntityAttrField::Count};
+        EntityAttrValue value{};
+    };
+    bool store_entity_attr(EntityId id, EntityAttrField field, const EntityAttrValue& value);
+    uint32_t intern_attr_string(const std::string& value);
+    std::string format_entity_attr(const EntityAttrValue& value) const;
+    void reset_entity_attrs();
 
     DocumentSettings settings_{};
     DocumentMetadata metadata_{};
+    std::vector<std::vector<EntityAttrSlot>> entity_attrs_{};
+    std::vector<std::string> attr_field_names_{};
+    std::unordered_map<std::string, EntityAttrField> attr_field_ids_{};
+    std::vector<std::string> attr_strings_{};
+    std::unordered_map<std::string, uint32_t> attr_string_ids_{};
+    mutable std::vector<std::pair<std::string, std::string>> meta_view_{};
+    mutable bool meta_view_valid_{false};
+    mutable std::weak_ptr<const DocumentSnapshot> snapshot_{};
+    mutable std::unordered_set<EntityId> snapshot_dirty_{};
+    mutable bool snapshot_stale_{true};
+    mutable bool snapshot_ids_reset_{true};
+    uint64_t revision_{0};
+    mutable SpatialIndex spatial_index_{};
+    mutable std::unordered_set<EntityId> spatial_dirty_{};
+    mutable bool spatial_built_{false};
     std::vector<Entity> entities_{};
+    std::unordered_map<EntityId, size_t> entity_slots_{};
+    size_t entity_tombstones_{0};
     std::vector<Layer> layers_{};
     std::vector<BlockDefinition> block_definitions_{};
     DependencyGraph dep_graph_;
     RecomputeCallback recompute_cb_;
+    ParallelRecomputeCallback parallel_recompute_cb_;
+    int recompute_threads_{0};
+    std::vector<DocumentConstraint> constraints_{};
+    ConstraintId next_constraint_id_{1};
+    uint64_t constraint_revision_{0}; // increases with every table change
+    // Copy of constraints_ shared by snapshots until the table changes.
+    mutable std::shared_ptr<const std::vector<DocumentConstraint>> constraints_snapshot_{};
     EntityId next_id_{1};
     int next_layer_id_{1};
     int next_group_id_{1};
     std::vector<DocumentObserver*> observers_{};
     int change_batch_depth_{0};
-    bool pending_reset_{false};
-
-    // Undo/redo state
+    // Per-entity change bits accumulated while a batch is open.
+    enum : uint8_t {
+        kBatchAdded = 1u << 0,
+        kBatchRemoved = 1u << 1,
+        kBatchGeometry = 1u << 2,
+        kBatchMeta = 1u << 3,
+    };
+    void record_batch_change(DocumentChangeType type, EntityId entityId, int layerId);
+    std::unordered_map<EntityId, uint8_t> batch_entity_bits_{};
+    std::vector<EntityId> batch_entity_order_{};
+    DocumentChangeSet batch_changes_{};
+    bool batch_dirty_{false};
+
+    // Undo/redo state. Each diff holds the "other" state of one change and is
+    // applied by swapping it with the document, so the same diff serves undo,
+    // redo and rollback.
+    struct EntityProps {
+        bool visible{true};
+        int groupId{-1};
+        uint32_t color{0};
+        std::string line_type;
+        double line_weight{0.0};
+        double line_type_scale{0.0};
+    };
     struct PropertyDiff {
         DocumentChangeType type{DocumentChangeType::Reset};
         EntityId entityId{0};
         int layerId{0};
+        // Geometry: the other payload, or for polylines with an unchanged vertex
+        // count only the differing vertex range starting at pointsOffset.
         EntityPayload oldPayload{};
-        EntityPayload newPayload{};
+        bool pointsDelta{false};
+        size_t pointsOffset{0};
+        std::vector<Vec2> points{};
+        // Entity meta changes: editor properties only.
+        EntityProps oldProps{};
         // For layer changes
         Layer oldLayer{};
-        // For entity meta changes
-        Entity oldEntity{};
+        // Add/remove: the entity while it is absent from the document (null while
+        // present), and its storage slot when it was removed.
+        std::unique_ptr<Entity> entity{};
+        size_t slot{0};
+        uint64_t slotEpoch{0};
     };
     struct Transaction {
         std::string label;
         std::vector<PropertyDiff> diffs;
+        size_t bytes{0};
     };
-    std::vector<Transaction> undo_stack_;
-    std::vector<Transaction> redo_stack_;
+    void compress_geometry_diff(PropertyDiff& diff) const;
+    void apply_diff(PropertyDiff& diff);
+    void apply_transaction(Transaction& tx);
+    size_t transaction_bytes(const Transaction& tx) const;
+    void enforce_undo_budget();
+    void record_added(EntityId id);
+    void restore_entity(std::unique_ptr<Entity> entity, size_t slot, uint64_t slotEpoch);
+    std::deque<Transaction> undo_stack_;
+    std::deque<Transaction> redo_stack_;
     Transaction* active_transaction_{nullptr};
     Transaction active_tx_storage_;
+    size_t undo_byte_budget_{0};
+    size_t undo_bytes_{0};
+    // Bumped whenever compaction moves entities, invalidating recorded slots.
+    uint64_t entity_slot_epoch_{0};
     bool in_undo_redo_{false};
 };
 
+// Read-only document state produced by Document::snapshot(). Entities are held
+// by shared pointers; two snapshots that hold the same pointer for an id hold
+// the same, unmodified entity.
+class DocumentSnapshot {
+public:
+    uint64_t revision() const { return revision_; }
+    // Live entities in document order.
+    const std::vector<std::shared_ptr<const Entity>>& entities() const { return entities_; }
+    const Entity* get_entity(EntityId id) const;
+    const std::vector<Layer>& layers() const { return layers_; }
+    const Layer* get_layer(int id) const;
+    const DocumentSettings& settings() const { return settings_; }
+    const DocumentMetadata& metadata() const { return metadata_; }
+    const std::vector<DocumentConstraint>& constraints() const { return *constraints_; }
+
+    // Solves the constraint table on private copies of the entities it
+    // references, so it may run on any thread while the document changes.
+    // `solution` receives the payload of each entity that moved, for
+    // Document::apply_constraint_solution().
+    SolveResult solve_constraints(ISolver& solver, ConstraintSolution* solution) const;
+
+    // What changed from `older` to this snapshot: added/removed ids, entities
+    // whose payload differs (geometryChanged) or whose other fields differ
+    // (metaChanged), and changed layers, settings and metadata. Entities still
+    // shared between the two are skipped without being compared.
+    DocumentChangeSet diff(const DocumentSnapshot& older) const;
+
+private:
+    friend class Document;
+    size_t find_index(EntityId id) const;
+
+    uint64_t revision_{0};
+    std::vector<std::shared_ptr<const Entity>> entities_{};
+    bool sorted_{true}; // entities_ in ascending id order (the usual case)
+    std::unordered_map<EntityId, size_t> index_{}; // only when !sorted_
+    std::vector<Layer> layers_{};
+    DocumentSettings settings_{};
+    DocumentMetadata metadata_{};
+    std::shared_ptr<const std::vector<DocumentConstraint>> constraints_{};
+    uint64_t constraint_revision_{0};
+};
+
 class DocumentChangeGuard {
 public:
     explicit DocumentChangeGuard(Document& doc);
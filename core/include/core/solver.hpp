@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <string>
 #include <vector>
 #include <optional>
@@ -36,7 +37,30 @@ enum class ConstraintKind {
 enum class SolverAlgorithm {
     LM,
     DogLeg,
-    BFGS
+    BFGS,
+    Portfolio // LM, DogLeg and BFGS race on private copies; the first to converge wins
+};
+
+// Linear algebra used inside the solver iterations. Sparse assembles only the
+// Jacobian entries each constraint touches and factorizes with sparse
+// Cholesky/QR (BFGS switches to limited-memory updates). Auto picks sparse once
+// a system reaches the sparse threshold.
+enum class SolverLinearMode {
+    Auto,
+    Dense,
+    Sparse
+};
+
+constexpr int kDefaultSparseSolverThreshold = 256; // unknowns
+
+// How much structural analysis solveWithBindings() reports on top of
+// validation (which always runs). Interactive and batch callers that only
+// need positions can skip the analysis cost entirely.
+enum class SolverDiagnosticsLevel {
+    None,       // validation diagnostics only; analysis counts past validation stay zero
+    Counts,     // + Jacobian rank, DOF/redundancy estimates and structural state
+    Structural, // + structural/conflict groups and redundancy subsets
+    Full        // + selection explanations, summaries and action hints (default)
 };
 
 enum class ConstraintDiagnosticCode {
@@ -56,6 +80,14 @@ enum class ConstraintStructuralState {
     Mixed
 };
 
+// What presolve did with a constraint it took out of the nonlinear solve.
+enum class PresolveAction {
+    Aliased,     // equality merged its two variables into one unknown
+    Fixed,       // fixed_point pinned its variable to the value
+    Substituted, // linear in one remaining unknown, which was solved for directly
+    Satisfied    // no unknowns left and the residual is exactly zero
+};
+
 struct ConstraintSpec {
     std::string type;                 // "horizontal", "distance", ...
     std::vector<VarRef> vars;         // referenced variables (entity param bindings)
@@ -71,6 +103,12 @@ struct ConstraintDiagnostic {
     std::string detail;
 };
 
+struct PresolvedConstraint {
+    int constraintIndex{-1};
+    PresolveAction action{PresolveAction::Satisfied};
+    std::string variableKey; // the eliminated (or merged) variable; empty when Satisfied
+};
+
 struct ConstraintRedundancyGroup {
     int anchorConstraintIndex{-1};
     ConstraintKind kind{ConstraintKind::Unknown};
@@ -229,18 +267,50 @@ struct SolveResult {
     std::vector<int> smallestRedundancyBasisConstraintIndices;
     std::vector<int> smallestRedundantConstraintIndices;
     ConstraintAnalysis analysis;
+    bool sparseLinearAlgebra{false}; // iterations ran on the sparse path
+    int componentCount{0};   // independent blocks the unknowns split into
+    int componentsSolved{0}; // blocks that started out of tolerance
+    // Constraints presolve removed before the iterations, in removal order.
+    // A constraint that expands into x/y rows may be listed once per row.
+    std::vector<PresolvedConstraint> presolvedConstraints;
+    // Wall-clock split of solveWithBindings() past validation.
+    double analysisTimeMs{0.0};  // structural analysis
+    double presolveTimeMs{0.0};  // alias substitution and presolve
+    double iterationTimeMs{0.0}; // compiling and iterating the components
+    // Algorithm whose iterations produced the result (the winner for Portfolio).
+    SolverAlgorithm algorithm{SolverAlgorithm::LM};
 };
 
 ConstraintKind classifyConstraintKind(const std::string& type);
 const char* constraintKindName(ConstraintKind kind);
 const char* constraintDiagnosticCodeName(ConstraintDiagnosticCode code);
 const char* constraintStructuralStateName(ConstraintStructuralState state);
+const char* presolveActionName(PresolveAction action);
+const char* solverAlgorithmName(SolverAlgorithm algo);
 
 class ISolver {
 public:
     virtual ~ISolver() = default;
     virtual void setMaxIterations(int iters) = 0;
     virtual void setTolerance(double tol) = 0;
+    // Optional: dense/sparse selection (default Auto with kDefaultSparseSolverThreshold).
+    virtual void setLinearMode(SolverLinearMode /*mode*/) {}
+    virtual void setSparseThreshold(int /*unknowns*/) {}
+    // Optional: worker threads for independent components (0 = hardware concurrency, 1 = serial).
+    virtual void setThreadCount(int /*threads*/) {}
+    // Optional: depth of the structural analysis (default Full).
+    virtual void setDiagnosticsLevel(SolverDiagnosticsLevel /*level*/) {}
+    // Optional: eliminate fixed and trivially linear constraints before iterating (default on).
+    virtual void setPresolve(bool /*enabled*/) {}
+    // Optional: stop iterating once *flag turns true (checked once per
+    // iteration). The partial result is written back with message "Cancelled";
+    // the flag must outlive the solve. nullptr detaches it.
+    virtual void setCancellationFlag(const std::atomic<bool>* /*flag*/) {}
+    // Optional: called as independent components finish iterating, with the
+    // count done so far and the total. Calls are serialized but may come from
+    // component worker threads.
+    using ProgressCallback = std::function<void(int componentsDone, int componentCount)>;
+    virtual void setProgressCallback(ProgressCallback /*callback*/) {}
     // Legacy no-binding solve (kept for compatibility)
     virtual SolveResult solve(std::vector<ConstraintSpec>& constraints) = 0;
 
@@ -254,4 +324,37 @@ public:
 ISolver* createMinimalSolver();
 ISolver* createSolver(SolverAlgorithm algo = SolverAlgorithm::DogLeg);
 
+// A variable held at a value while a session steps (e.g. a dragged handle).
+struct FixedVar {
+    VarRef var;
+    double value{0.0};
+};
+
+// Stateful solving for interactive edits such as dragging a point.
+// prepare() validates and compiles the constraints once; then, per frame,
+// update() sets the held variables and step() re-solves from the previous
+// solution. Steps run LM only on the components that are out of tolerance
+// and reuse the compiled program, the damping and the sparse factorization's
+// symbolic analysis. The bindings passed to prepare() must outlive the
+// session's use of them; they are not re-read, so changes made through other
+// paths need a new prepare().
+class ISolverSession {
+public:
+    virtual ~ISolverSession() = default;
+    virtual void setMaxIterations(int iters) = 0; // per step
+    virtual void setTolerance(double tol) = 0;
+    virtual void setLinearMode(SolverLinearMode mode) = 0;
+    virtual void setSparseThreshold(int unknowns) = 0;
+    // Diagnostics and the starting error; no iterations run.
+    virtual SolveResult prepare(std::vector<ConstraintSpec>& constraints, const ISolver::GetVar& get, const ISolver::SetVar& set) = 0;
+    // Replaces the held set (an empty list releases everything). Returns
+    // false if some variable is not part of the prepared system; the others
+    // still apply.
+    virtual bool update(const std::vector<FixedVar>& fixedVars) = 0;
+    // Iterates and writes back the components the last update disturbed.
+    virtual SolveResult step() = 0;
+};
+
+ISolverSession* createSolverSession();
+
 } // namespace core
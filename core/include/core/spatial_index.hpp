@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/geometry2d.hpp"
+
+namespace core {
+
+using EntityId = uint64_t;
+
+// Axis-aligned box in world coordinates (min <= max on both axes).
+struct Box2 {
+    double minX{0.0}, minY{0.0}, maxX{0.0}, maxY{0.0};
+
+    bool intersects(const Box2& o) const {
+        return minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY;
+    }
+    bool contains(const Box2& o) const {
+        return minX <= o.minX && o.maxX <= maxX && minY <= o.minY && o.maxY <= maxY;
+    }
+};
+
+// R-tree over entity boxes. build() packs a whole set with Sort-Tile-Recursive
+// loading; insert()/remove() keep it current afterwards. Queries work on boxes
+// only, so callers refine candidates against exact geometry themselves.
+class SpatialIndex {
+public:
+    void clear();
+    // Replaces the contents with `items` (one box per id).
+    void build(std::vector<std::pair<EntityId, Box2>> items);
+    // Inserts or replaces the box of `id`.
+    void insert(EntityId id, const Box2& box);
+    bool remove(EntityId id);
+    bool contains(EntityId id) const { return item_of_.count(id) != 0; }
+    size_t size() const { return item_of_.size(); }
+    bool empty() const { return item_of_.empty(); }
+    // Union of all boxes; false when empty.
+    bool bounds(Box2* out) const;
+
+    // Ids whose box intersects `window`, in no particular order (appended).
+    void query(const Box2& window, std::vector<EntityId>& out) const;
+    // Up to k ids by increasing distance from `p` to their box (0 inside),
+    // ignoring boxes farther than maxDistance.
+    std::vector<std::pair<EntityId, double>> nearest(const Vec2& p, size_t k,
+        double maxDistance = std::numeric_limits<double>::infinity()) const;
+    // Ids whose box the segment a-b touches, ordered by where the segment
+    // enters the box (appended).
+    void query_segment(const Vec2& a, const Vec2& b, std::vector<EntityId>& out) const;
+
+private:
+    static constexpr size_t kMaxEntries = 16;
+
+    struct Node {
+        Box2 box{};
+        int parent{-1};
+        bool leaf{true};
+        std::vector<int> children; // node indices, or item indices in a leaf
+    };
+    struct Item {
+        EntityId id{0};
+        Box2 box{};
+        int leaf{-1};
+    };
+
+    int new_node(bool leaf);
+    void free_node(int node);
+    void refit_upwards(int node);
+    void recompute_box(int node);
+    int choose_leaf(const Box2& box) const;
+    void split(int node);
+    int pack_level(std::vector<int>& level, bool leaves);
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_nodes_;
+    std::vector<Item> items_;
+    std::vector<int> free_items_;
+    std::unordered_map<EntityId, int> item_of_;
+    int root_{-1};
+};
+
+}  // namespace core
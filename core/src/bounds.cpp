@@ -46,34 +46,38 @@ void addEllipse(Acc& a, const Ellipse& e) {
     a.add(e.center.x + hx, e.center.y + hy);
 }
 
+// Point and std::monostate add nothing (no rendered ink).
+void addEntity(Acc& a, const Entity& e) {
+    if (auto* pl = std::get_if<Polyline>(&e.payload)) {
+        for (const auto& p : pl->points) a.add(p.x, p.y);
+    } else if (auto* ln = std::get_if<Line>(&e.payload)) {
+        a.add(ln->a.x, ln->a.y);
+        a.add(ln->b.x, ln->b.y);
+    } else if (auto* ci = std::get_if<Circle>(&e.payload)) {
+        a.add(ci->center.x - ci->radius, ci->center.y - ci->radius);
+        a.add(ci->center.x + ci->radius, ci->center.y + ci->radius);
+    } else if (auto* ar = std::get_if<Arc>(&e.payload)) {
+        // Over-cover: an arc lies within its full circle.
+        a.add(ar->center.x - ar->radius, ar->center.y - ar->radius);
+        a.add(ar->center.x + ar->radius, ar->center.y + ar->radius);
+    } else if (auto* el = std::get_if<Ellipse>(&e.payload)) {
+        addEllipse(a, *el);
+    } else if (auto* sp = std::get_if<Spline>(&e.payload)) {
+        for (const auto& p : sp->control_points) a.add(p.x, p.y);
+    } else if (auto* tx = std::get_if<Text>(&e.payload)) {
+        addText(a, *tx);
+    } else if (auto* bi = std::get_if<BlockInstance>(&e.payload)) {
+        a.add(bi->insertionPoint.x, bi->insertionPoint.y);
+    }
+}
+
 }  // namespace
 
 bool contentBounds(const Document& doc,
                    double& minX, double& minY, double& maxX, double& maxY) {
     Acc a;
     for (const auto& e : doc.entities()) {
-        if (auto* pl = std::get_if<Polyline>(&e.payload)) {
-            for (const auto& p : pl->points) a.add(p.x, p.y);
-        } else if (auto* ln = std::get_if<Line>(&e.payload)) {
-            a.add(ln->a.x, ln->a.y);
-            a.add(ln->b.x, ln->b.y);
-        } else if (auto* ci = std::get_if<Circle>(&e.payload)) {
-            a.add(ci->center.x - ci->radius, ci->center.y - ci->radius);
-            a.add(ci->center.x + ci->radius, ci->center.y + ci->radius);
-        } else if (auto* ar = std::get_if<Arc>(&e.payload)) {
-            // Over-cover: an arc lies within its full circle.
-            a.add(ar->center.x - ar->radius, ar->center.y - ar->radius);
-            a.add(ar->center.x + ar->radius, ar->center.y + ar->radius);
-        } else if (auto* el = std::get_if<Ellipse>(&e.payload)) {
-            addEllipse(a, *el);
-        } else if (auto* sp = std::get_if<Spline>(&e.payload)) {
-            for (const auto& p : sp->control_points) a.add(p.x, p.y);
-        } else if (auto* tx = std::get_if<Text>(&e.payload)) {
-            addText(a, *tx);
-        } else if (auto* bi = std::get_if<BlockInstance>(&e.payload)) {
-            a.add(bi->insertionPoint.x, bi->insertionPoint.y);
-        }
-        // Point and std::monostate: intentionally not bounded (no rendered ink).
+        if (e.id != 0) addEntity(a, e);
     }
     if (!a.any) return false;
     minX = a.mnx;
@@ -83,4 +87,16 @@ bool contentBounds(const Document& doc,
     return true;
 }
 
+bool entityBounds(const Entity& e, Box2& out) {
+    Acc a;
+    if (auto* pt = std::get_if<Point>(&e.payload)) {
+        a.add(pt->p.x, pt->p.y);
+    } else {
+        addEntity(a, e);
+    }
+    if (!a.any) return false;
+    out = Box2{a.mnx, a.mny, a.mxx, a.mxy};
+    return true;
+}
+
 }  // namespace core
@@ -58,6 +58,35 @@ CORE_API core_entity_id core_document_add_polyline_ex(core_document* doc, const
     return doc->impl.add_polyline(pl, name_utf8 ? name_utf8 : "", layer_id);
 }
 
+CORE_API int core_document_add_polylines_v1(core_document* doc, const core_vec2* points,
+                                            const int* point_counts, int polyline_count,
+                                            const int* layer_ids, const char* const* names_utf8,
+                                            core_entity_id* out_first_id) {
+    if (!doc || polyline_count < 0) return 0;
+    if (polyline_count > 0 && (!points || !point_counts)) return 0;
+    for (int i = 0; i < polyline_count; ++i) {
+        if (point_counts[i] <= 1) return 0;
+    }
+    std::vector<Entity> batch(static_cast<size_t>(polyline_count));
+    const core_vec2* src = points;
+    for (int i = 0; i < polyline_count; ++i) {
+        Entity& e = batch[static_cast<size_t>(i)];
+        e.type = EntityType::Polyline;
+        e.layerId = layer_ids ? layer_ids[i] : 0;
+        if (names_utf8 && names_utf8[i]) e.name = names_utf8[i];
+        Polyline pl;
+        pl.points.resize(static_cast<size_t>(point_counts[i]));
+        for (auto& pt : pl.points) {
+            pt = Vec2{src->x, src->y};
+            ++src;
+        }
+        e.payload = std::move(pl);
+    }
+    const EntityId first = doc->impl.add_entities(std::move(batch));
+    if (out_first_id) *out_first_id = static_cast<core_entity_id>(first);
+    return 1;
+}
+
 CORE_API core_entity_id core_document_add_point(core_document* doc, const core_point* p,
                                                 const char* name_utf8, int layer_id) {
     if (!doc || !p) return 0;
@@ -244,24 +273,33 @@ CORE_API int core_document_set_layer_color(core_document* doc, int layer_id, uns
 
 CORE_API int core_document_get_entity_count(const core_document* doc, int* out_count) {
     if (!doc || !out_count) return 0;
-    *out_count = static_cast<int>(doc->impl.entities().size());
+    *out_count = static_cast<int>(doc->impl.entity_count());
     return 1;
 }
 
+// Indices count live entities only; with no tombstones in storage they are
+// storage indices.
 CORE_API int core_document_get_entity_id_at(const core_document* doc, int index, core_entity_id* out_entity_id) {
     if (!doc || !out_entity_id || index < 0) return 0;
     const auto& ents = doc->impl.entities();
-    if (static_cast<size_t>(index) >= ents.size()) return 0;
-    *out_entity_id = static_cast<core_entity_id>(ents[static_cast<size_t>(index)].id);
-    return 1;
+    auto n = static_cast<size_t>(index);
+    if (n >= doc->impl.entity_count()) return 0;
+    if (doc->impl.entity_count() == ents.size()) {
+        *out_entity_id = static_cast<core_entity_id>(ents[n].id);
+        return 1;
+    }
+    for (const auto& e : ents) {
+        if (e.id == 0) continue;
+        if (n-- == 0) {
+            *out_entity_id = static_cast<core_entity_id>(e.id);
+            return 1;
+        }
+    }
+    return 0;
 }
 
 static const Entity* find_entity(const Document& d, core_entity_id id) {
-    const auto& ents = d.entities();
-    for (const auto& e : ents) {
-        if (e.id == static_cast<EntityId>(id)) return &e;
-    }
-    return nullptr;
+    return d.get_entity(static_cast<EntityId>(id));
 }
 
 static int entity_type_to_c(EntityType type) {
@@ -540,37 +578,140 @@ CORE_API int core_document_get_entity_line_type_scale(const core_document* doc,
     return 1;
 }
 
-static std::string make_entity_meta_key(core_entity_id id, const char* suffix) {
-    std::string key = "dxf.entity.";
-    key += std::to_string(static_cast<unsigned long long>(id));
-    key += ".";
-    if (suffix) key += suffix;
-    return key;
-}
-
 CORE_API int core_document_get_entity_color_source(const core_document* doc, core_entity_id id,
                                                    char* out_utf8, int out_cap, int* out_required_bytes) {
     if (!doc) return 0;
-    const auto& meta = doc->impl.metadata().meta;
-    const std::string key = make_entity_meta_key(id, "color_source");
-    auto it = meta.find(key);
-    if (it == meta.end()) return 0;
-    return copy_utf8(it->second, out_utf8, out_cap, out_required_bytes) ? 1 : 0;
+    const auto* value = doc->impl.get_entity_attr(static_cast<EntityId>(id), EntityAttrField::ColorSource);
+    if (!value) return 0;
+    const std::string text = doc->impl.entity_attr_text(static_cast<EntityId>(id), EntityAttrField::ColorSource);
+    return copy_utf8(text, out_utf8, out_cap, out_required_bytes) ? 1 : 0;
 }
 
 CORE_API int core_document_get_entity_color_aci(const core_document* doc, core_entity_id id, int* out_aci) {
     if (!doc || !out_aci) return 0;
-    const auto& meta = doc->impl.metadata().meta;
-    const std::string key = make_entity_meta_key(id, "color_aci");
-    auto it = meta.find(key);
-    if (it == meta.end()) return 0;
-    char* end = nullptr;
-    const long value = std::strtol(it->second.c_str(), &end, 10);
-    if (!end || *end != '\0') return 0;
+    int64_t value = 0;
+    if (!doc->impl.get_entity_attr_int(static_cast<EntityId>(id), EntityAttrField::ColorAci, &value)) return 0;
     *out_aci = static_cast<int>(value);
     return 1;
 }
 
+static int entity_space_from_meta(const Document& d, EntityId id) {
+    const auto* attr = d.get_entity_attr(id, EntityAttrField::Space);
+    if (!attr) return -1;
+    long value = 0;
+    if (attr->kind == EntityAttrValue::Kind::Int) {
+        value = static_cast<long>(attr->i);
+    } else {
+        const std::string text = d.entity_attr_text(id, EntityAttrField::Space);
+        char* end = nullptr;
+        value = std::strtol(text.c_str(), &end, 10);
+        if (!end || end == text.c_str()) return -1;
+    }
+    return (value == 0 || value == 1) ? static_cast<int>(value) : -1;
+}
+
+static void fill_entity_record(const Document& d, const Entity& e, core_entity_record_v1* out) {
+    out->id = static_cast<core_entity_id>(e.id);
+    out->type = entity_type_to_c(e.type);
+    out->layer_id = e.layerId;
+    out->color = static_cast<unsigned int>(e.color);
+    out->group_id = e.groupId;
+    out->flags = e.visible ? CORE_ENTITY_FLAG_VISIBLE : 0u;
+    out->point_count = 0;
+    if (const auto* pl = std::get_if<Polyline>(&e.payload)) {
+        out->point_count = static_cast<int>(pl->points.size());
+    } else if (const auto* sp = std::get_if<Spline>(&e.payload)) {
+        out->point_count = static_cast<int>(sp->control_points.size());
+    }
+    out->space = entity_space_from_meta(d, e.id);
+}
+
+CORE_API int core_document_get_entities_v1(const core_document* doc,
+                                           core_entity_record_v1* out_records, int out_capacity,
+                                           int* out_required) {
+    if (!doc || !out_required) return 0;
+    const auto& ents = doc->impl.entities();
+    const int count = static_cast<int>(doc->impl.entity_count());
+    *out_required = count;
+    if (!out_records || out_capacity <= 0) return 1; // query only
+    if (out_capacity < count) return 0;
+    int written = 0;
+    for (const Entity& e : ents) {
+        if (e.id == 0) continue; // tombstone
+        fill_entity_record(doc->impl, e, &out_records[written++]);
+    }
+    return 1;
+}
+
+CORE_API int core_document_query_entities_v1(const core_document* doc,
+                                             const core_entity_filter_v1* filter,
+                                             int* inout_cursor,
+                                             core_entity_record_v1* out_records, int out_capacity,
+                                             int* out_count) {
+    if (!doc || !inout_cursor || !out_records || out_capacity <= 0 || !out_count) return 0;
+    if (*inout_cursor < 0) return 0;
+    const auto& ents = doc->impl.entities();
+    const unsigned int fields = filter ? filter->fields : 0u;
+    size_t i = static_cast<size_t>(*inout_cursor);
+    int written = 0;
+    for (; i < ents.size() && written < out_capacity; ++i) {
+        const Entity& e = ents[i];
+        if (e.id == 0) continue; // tombstone
+        if ((fields & CORE_ENTITY_FILTER_TYPE) && entity_type_to_c(e.type) != filter->type) continue;
+        if ((fields & CORE_ENTITY_FILTER_LAYER) && e.layerId != filter->layer_id) continue;
+        core_entity_record_v1 rec{};
+        fill_entity_record(doc->impl, e, &rec);
+        if ((fields & CORE_ENTITY_FILTER_SPACE) && rec.space != filter->space) continue;
+        out_records[written++] = rec;
+    }
+    *inout_cursor = static_cast<int>(std::min(i, ents.size()));
+    *out_count = written;
+    return 1;
+}
+
+static int copy_ids(const std::vector<EntityId>& ids, core_entity_id* out_ids, int out_capacity,
+                    int* out_required) {
+    const int count = static_cast<int>(ids.size());
+    *out_required = count;
+    if (!out_ids || out_capacity <= 0) return 1; // query only
+    if (out_capacity < count) return 0;
+    for (int i = 0; i < count; ++i) out_ids[i] = static_cast<core_entity_id>(ids[static_cast<size_t>(i)]);
+    return 1;
+}
+
+CORE_API int core_document_query_rect_v1(const core_document* doc,
+                                         double min_x, double min_y, double max_x, double max_y,
+                                         core_entity_id* out_ids, int out_capacity, int* out_required) {
+    if (!doc || !out_required) return 0;
+    Box2 window{std::min(min_x, max_x), std::min(min_y, max_y), std::max(min_x, max_x), std::max(min_y, max_y)};
+    std::vector<EntityId> ids;
+    doc->impl.spatial_index().query(window, ids);
+    std::sort(ids.begin(), ids.end());
+    return copy_ids(ids, out_ids, out_capacity, out_required);
+}
+
+CORE_API int core_document_query_nearest_v1(const core_document* doc, double x, double y, int k,
+                                            core_entity_id* out_ids, double* out_distances,
+                                            int* out_count) {
+    if (!doc || k < 0 || !out_count || (k > 0 && !out_ids)) return 0;
+    const auto hits = doc->impl.spatial_index().nearest(Vec2{x, y}, static_cast<size_t>(k));
+    for (size_t i = 0; i < hits.size(); ++i) {
+        out_ids[i] = static_cast<core_entity_id>(hits[i].first);
+        if (out_distances) out_distances[i] = hits[i].second;
+    }
+    *out_count = static_cast<int>(hits.size());
+    return 1;
+}
+
+CORE_API int core_document_query_segment_v1(const core_document* doc,
+                                            double x0, double y0, double x1, double y1,
+                                            core_entity_id* out_ids, int out_capacity, int* out_required) {
+    if (!doc || !out_required) return 0;
+    std::vector<EntityId> ids;
+    doc->impl.spatial_index().query_segment(Vec2{x0, y0}, Vec2{x1, y1}, ids);
+    return copy_ids(ids, out_ids, out_capacity, out_required);
+}
+
 CORE_API int core_document_alloc_group_id(core_document* doc) {
     if (!doc) return -1;
     return doc->impl.alloc_group_id();
@@ -658,7 +799,7 @@ CORE_API int core_document_set_unit_name(core_document* doc, const char* unit_na
 
 CORE_API int core_document_get_meta_count(const core_document* doc, int* out_count) {
     if (!doc || !out_count) return 0;
-    *out_count = static_cast<int>(doc->impl.metadata().meta.size());
+    *out_count = static_cast<int>(doc->impl.meta_entries().size());
     return 1;
 }
 
@@ -666,21 +807,19 @@ CORE_API int core_document_get_meta_key_at(const core_document* doc, int index,
                                            char* out_key_utf8, int out_key_capacity,
                                            int* out_required_bytes) {
     if (!doc || index < 0) return 0;
-    const auto& meta = doc->impl.metadata().meta;
-    if (static_cast<size_t>(index) >= meta.size()) return 0;
-    auto it = meta.begin();
-    std::advance(it, index);
-    return copy_utf8(it->first, out_key_utf8, out_key_capacity, out_required_bytes) ? 1 : 0;
+    const auto& entries = doc->impl.meta_entries();
+    if (static_cast<size_t>(index) >= entries.size()) return 0;
+    return copy_utf8(entries[static_cast<size_t>(index)].first, out_key_utf8, out_key_capacity,
+                     out_required_bytes) ? 1 : 0;
 }
 
 CORE_API int core_document_get_meta_value(const core_document* doc, const char* key_utf8,
                                           char* out_value_utf8, int out_value_capacity,
                                           int* out_required_bytes) {
     if (!doc || !key_utf8) return 0;
-    const auto& meta = doc->impl.metadata().meta;
-    auto it = meta.find(key_utf8);
-    if (it == meta.end()) return 0;
-    return copy_utf8(it->second, out_value_utf8, out_value_capacity, out_required_bytes) ? 1 : 0;
+    std::string value;
+    if (!doc->impl.get_meta_value(key_utf8, &value)) return 0;
+    return copy_utf8(value, out_value_utf8, out_value_capacity, out_required_bytes) ? 1 : 0;
 }
 
 CORE_API int core_document_set_meta_value(core_document* doc, const char* key_utf8, const char* value_utf8) {
@@ -693,6 +832,94 @@ CORE_API int core_document_remove_meta_value(core_document* doc, const char* key
     return doc->impl.remove_meta_value(key_utf8) ? 1 : 0;
 }
 
+static bool entity_attr_field_from_c(const Document& d, int field, EntityAttrField* out) {
+    if (field < 0 || static_cast<size_t>(field) >= d.entity_attr_field_count()) return false;
+    *out = static_cast<EntityAttrField>(field);
+    return true;
+}
+
+CORE_API int core_document_get_entity_attr_field(const core_document* doc, const char* name_utf8, int* out_field) {
+    if (!doc || !name_utf8 || !out_field) return 0;
+    EntityAttrField field{};
+    if (!doc->impl.find_entity_attr_field(name_utf8, &field)) return 0;
+    *out_field = static_cast<int>(field);
+    return 1;
+}
+
+CORE_API int core_document_register_entity_attr_field(core_document* doc, const char* name_utf8, int* out_field) {
+    if (!doc || !name_utf8 || name_utf8[0] == '\0' || !out_field) return 0;
+    *out_field = static_cast<int>(doc->impl.entity_attr_field(name_utf8));
+    return 1;
+}
+
+CORE_API int core_document_set_entity_attr_int(core_document* doc, core_entity_id id, int field, long long value) {
+    if (!doc) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    return doc->impl.set_entity_attr_int(static_cast<EntityId>(id), f, static_cast<int64_t>(value)) ? 1 : 0;
+}
+
+CORE_API int core_document_set_entity_attr_double(core_document* doc, core_entity_id id, int field, double value) {
+    if (!doc) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    return doc->impl.set_entity_attr_double(static_cast<EntityId>(id), f, value) ? 1 : 0;
+}
+
+CORE_API int core_document_set_entity_attr_string(core_document* doc, core_entity_id id, int field,
+                                                  const char* value_utf8) {
+    if (!doc) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    return doc->impl.set_entity_attr_string(static_cast<EntityId>(id), f, value_utf8 ? value_utf8 : "") ? 1 : 0;
+}
+
+CORE_API int core_document_get_entity_attr_text(const core_document* doc, core_entity_id id, int field,
+                                                char* out_utf8, int out_cap, int* out_required_bytes) {
+    if (!doc) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    if (!doc->impl.get_entity_attr(static_cast<EntityId>(id), f)) return 0;
+    return copy_utf8(doc->impl.entity_attr_text(static_cast<EntityId>(id), f), out_utf8, out_cap,
+                     out_required_bytes) ? 1 : 0;
+}
+
+CORE_API int core_document_get_entity_attr_ints_v1(const core_document* doc, int field,
+                                                   const core_entity_id* ids, int count,
+                                                   long long* out_values, unsigned char* out_present) {
+    if (!doc || count < 0 || (count > 0 && (!ids || !out_values))) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    for (int i = 0; i < count; ++i) {
+        int64_t value = 0;
+        const bool found = doc->impl.get_entity_attr_int(static_cast<EntityId>(ids[i]), f, &value);
+        out_values[i] = found ? static_cast<long long>(value) : 0;
+        if (out_present) out_present[i] = found ? 1 : 0;
+    }
+    return 1;
+}
+
+CORE_API int core_document_get_entity_attr_string_ids_v1(const core_document* doc, int field,
+                                                         const core_entity_id* ids, int count,
+                                                         int* out_string_ids) {
+    if (!doc || count < 0 || (count > 0 && (!ids || !out_string_ids))) return 0;
+    EntityAttrField f{};
+    if (!entity_attr_field_from_c(doc->impl, field, &f)) return 0;
+    for (int i = 0; i < count; ++i) {
+        const auto* value = doc->impl.get_entity_attr(static_cast<EntityId>(ids[i]), f);
+        out_string_ids[i] = (value && value->kind == EntityAttrValue::Kind::String)
+            ? static_cast<int>(value->str) : -1;
+    }
+    return 1;
+}
+
+CORE_API int core_document_get_attr_string(const core_document* doc, int string_id,
+                                           char* out_utf8, int out_cap, int* out_required_bytes) {
+    if (!doc || string_id < 0 || static_cast<size_t>(string_id) >= doc->impl.attr_string_count()) return 0;
+    return copy_utf8(doc->impl.attr_string(static_cast<uint32_t>(string_id)), out_utf8, out_cap,
+                     out_required_bytes) ? 1 : 0;
+}
+
 } // extern C
 
 extern "C" {
@@ -858,6 +1085,14 @@ CADGF_API cadgf_entity_id cadgf_document_add_polyline_ex(cadgf_document* doc, co
     return core_document_add_polyline_ex(doc, pts, n, name_utf8, layer_id);
 }
 
+CADGF_API int cadgf_document_add_polylines_v1(cadgf_document* doc, const cadgf_vec2* points,
+                                              const int* point_counts, int polyline_count,
+                                              const int* layer_ids, const char* const* names_utf8,
+                                              cadgf_entity_id* out_first_id) {
+    return core_document_add_polylines_v1(doc, points, point_counts, polyline_count, layer_ids, names_utf8,
+                                          out_first_id);
+}
+
 CADGF_API cadgf_entity_id cadgf_document_add_point(cadgf_document* doc, const cadgf_point* p,
                                                    const char* name_utf8, int layer_id) {
     return core_document_add_point(doc, p, name_utf8, layer_id);
@@ -973,6 +1208,38 @@ CADGF_API int cadgf_document_get_entity_name(const cadgf_document* doc, cadgf_en
     return core_document_get_entity_name(doc, id, out_name_utf8, out_name_capacity, out_required_bytes);
 }
 
+CADGF_API int cadgf_document_get_entities_v1(const cadgf_document* doc,
+                                             cadgf_entity_record_v1* out_records, int out_capacity,
+                                             int* out_required) {
+    return core_document_get_entities_v1(doc, out_records, out_capacity, out_required);
+}
+
+CADGF_API int cadgf_document_query_entities_v1(const cadgf_document* doc,
+                                               const cadgf_entity_filter_v1* filter,
+                                               int* inout_cursor,
+                                               cadgf_entity_record_v1* out_records, int out_capacity,
+                                               int* out_count) {
+    return core_document_query_entities_v1(doc, filter, inout_cursor, out_records, out_capacity, out_count);
+}
+
+CADGF_API int cadgf_document_query_rect_v1(const cadgf_document* doc,
+                                           double min_x, double min_y, double max_x, double max_y,
+                                           cadgf_entity_id* out_ids, int out_capacity, int* out_required) {
+    return core_document_query_rect_v1(doc, min_x, min_y, max_x, max_y, out_ids, out_capacity, out_required);
+}
+
+CADGF_API int cadgf_document_query_nearest_v1(const cadgf_document* doc, double x, double y, int k,
+                                              cadgf_entity_id* out_ids, double* out_distances,
+                                              int* out_count) {
+    return core_document_query_nearest_v1(doc, x, y, k, out_ids, out_distances, out_count);
+}
+
+CADGF_API int cadgf_document_query_segment_v1(const cadgf_document* doc,
+                                              double x0, double y0, double x1, double y1,
+                                              cadgf_entity_id* out_ids, int out_capacity, int* out_required) {
+    return core_document_query_segment_v1(doc, x0, y0, x1, y1, out_ids, out_capacity, out_required);
+}
+
 CADGF_API int cadgf_document_get_polyline_points(const cadgf_document* doc, cadgf_entity_id id,
                                                  cadgf_vec2* out_pts, int out_pts_capacity,
                                                  int* out_required_points) {
@@ -1180,6 +1447,49 @@ CADGF_API int cadgf_document_remove_meta_value(cadgf_document* doc, const char*
     return core_document_remove_meta_value(doc, key_utf8);
 }
 
+CADGF_API int cadgf_document_get_entity_attr_field(const cadgf_document* doc, const char* name_utf8, int* out_field) {
+    return core_document_get_entity_attr_field(doc, name_utf8, out_field);
+}
+
+CADGF_API int cadgf_document_register_entity_attr_field(cadgf_document* doc, const char* name_utf8, int* out_field) {
+    return core_document_register_entity_attr_field(doc, name_utf8, out_field);
+}
+
+CADGF_API int cadgf_document_set_entity_attr_int(cadgf_document* doc, cadgf_entity_id id, int field, long long value) {
+    return core_document_set_entity_attr_int(doc, id, field, value);
+}
+
+CADGF_API int cadgf_document_set_entity_attr_double(cadgf_document* doc, cadgf_entity_id id, int field, double value) {
+    return core_document_set_entity_attr_double(doc, id, field, value);
+}
+
+CADGF_API int cadgf_document_set_entity_attr_string(cadgf_document* doc, cadgf_entity_id id, int field,
+                                                    const char* value_utf8) {
+    return core_document_set_entity_attr_string(doc, id, field, value_utf8);
+}
+
+CADGF_API int cadgf_document_get_entity_attr_text(const cadgf_document* doc, cadgf_entity_id id, int field,
+                                                  char* out_utf8, int out_cap, int* out_required_bytes) {
+    return core_document_get_entity_attr_text(doc, id, field, out_utf8, out_cap, out_required_bytes);
+}
+
+CADGF_API int cadgf_document_get_entity_attr_ints_v1(const cadgf_document* doc, int field,
+                                                     const cadgf_entity_id* ids, int count,
+                                                     long long* out_values, unsigned char* out_present) {
+    return core_document_get_entity_attr_ints_v1(doc, field, ids, count, out_values, out_present);
+}
+
+CADGF_API int cadgf_document_get_entity_attr_string_ids_v1(const cadgf_document* doc, int field,
+                                                           const cadgf_entity_id* ids, int count,
+                                                           int* out_string_ids) {
+    return core_document_get_entity_attr_string_ids_v1(doc, field, ids, count, out_string_ids);
+}
+
+CADGF_API int cadgf_document_get_attr_string(const cadgf_document* doc, int string_id,
+                                             char* out_utf8, int out_cap, int* out_required_bytes) {
+    return core_document_get_attr_string(doc, string_id, out_utf8, out_cap, out_required_bytes);
+}
+
 CADGF_API int cadgf_triangulate_polygon(const cadgf_vec2* pts, int n,
                                         unsigned int* indices, int* index_count) {
     return core_triangulate_polygon(pts, n, indices, index_count);
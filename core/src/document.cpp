@@ -1,10 +1,158 @@
 #include "core/document.hpp"
 #include "core/geometry2d.hpp"
+#include "core/bounds.hpp"
+#include "core/solver.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace core {
 
+namespace {
+
+constexpr const char kEntityMetaPrefix[] = "dxf.entity.";
+constexpr size_t kEntityMetaPrefixLen = sizeof(kEntityMetaPrefix) - 1;
+// Keys naming ids far past the allocated range stay in the string map so a
+// stray key cannot grow the id-indexed attribute table without bound.
+constexpr EntityId kEntityAttrIdSlack = 1u << 20;
+constexpr const char kLayerMetaPrefix[] = "dxf.layer.";
+constexpr size_t kLayerMetaPrefixLen = sizeof(kLayerMetaPrefix) - 1;
+
+struct BuiltinAttrField {
+    const char* name;
+    EntityAttrValue::Kind kind;
+};
+
+const BuiltinAttrField kBuiltinAttrFields[] = {
+    {"color_source", EntityAttrValue::Kind::String},
+    {"color_aci", EntityAttrValue::Kind::Int},
+    {"space", EntityAttrValue::Kind::Int},
+    {"layout", EntityAttrValue::Kind::String},
+    {"text_style", EntityAttrValue::Kind::String},
+    {"source_type", EntityAttrValue::Kind::String},
+    {"edit_mode", EntityAttrValue::Kind::String},
+    {"proxy_kind", EntityAttrValue::Kind::String},
+    {"block_name", EntityAttrValue::Kind::String},
+    {"hatch_pattern", EntityAttrValue::Kind::String},
+    {"hatch_id", EntityAttrValue::Kind::Int},
+    {"source_bundle_id", EntityAttrValue::Kind::Int},
+    {"text_kind", EntityAttrValue::Kind::String},
+    {"text_attachment", EntityAttrValue::Kind::Int},
+    {"text_halign", EntityAttrValue::Kind::Int},
+    {"text_valign", EntityAttrValue::Kind::Int},
+    {"text_font_file", EntityAttrValue::Kind::String},
+    {"text_bigfont_file", EntityAttrValue::Kind::String},
+    {"attribute_tag", EntityAttrValue::Kind::String},
+};
+static_assert(sizeof(kBuiltinAttrFields) / sizeof(kBuiltinAttrFields[0]) ==
+                  static_cast<size_t>(EntityAttrField::Count),
+              "builtin attribute table out of sync with EntityAttrField");
+
+// Splits "dxf.entity.<id>.<field>". The id must be in canonical decimal form
+// so that the key rebuilt from the typed table is byte-identical.
+bool parse_entity_meta_key(const std::string& key, EntityId* out_id, std::string* out_field) {
+    if (key.size() <= kEntityMetaPrefixLen || key.compare(0, kEntityMetaPrefixLen, kEntityMetaPrefix) != 0) {
+        return false;
+    }
+    size_t pos = kEntityMetaPrefixLen;
+    if (key[pos] == '0') return false;
+    EntityId id = 0;
+    const size_t digits_begin = pos;
+    while (pos < key.size() && key[pos] >= '0' && key[pos] <= '9') {
+        if (pos - digits_begin >= 19) return false;
+        id = id * 10 + static_cast<EntityId>(key[pos] - '0');
+        ++pos;
+    }
+    if (pos == digits_begin || pos + 1 >= key.size() || key[pos] != '.') return false;
+    *out_id = id;
+    out_field->assign(key, pos + 1, std::string::npos);
+    return true;
+}
+
+// Splits "<prefix><id>.<rest>" and returns the offset of <rest>, or 0 when the
+// key does not have that shape.
+size_t split_id_meta_key(const std::string& key, const char* prefix, size_t prefix_len, uint64_t* out_id) {
+    if (key.size() <= prefix_len || key.compare(0, prefix_len, prefix) != 0) return 0;
+    size_t pos = prefix_len;
+    uint64_t id = 0;
+    while (pos < key.size() && key[pos] >= '0' && key[pos] <= '9') {
+        if (pos - prefix_len >= 19) return 0;
+        id = id * 10 + static_cast<uint64_t>(key[pos] - '0');
+        ++pos;
+    }
+    if (pos == prefix_len || pos + 1 >= key.size() || key[pos] != '.') return 0;
+    *out_id = id;
+    return pos + 1;
+}
+
+std::string make_entity_meta_key(EntityId id, const std::string& field) {
+    std::string key = kEntityMetaPrefix;
+    key += std::to_string(static_cast<unsigned long long>(id));
+    key += '.';
+    key += field;
+    return key;
+}
+
+bool parse_canonical_int(const std::string& text, int64_t* out) {
+    if (text.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    const long long value = std::strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || !end || *end != '\0') return false;
+    if (std::to_string(value) != text) return false;
+    *out = static_cast<int64_t>(value);
+    return true;
+}
+
+std::string format_attr_double(double value) {
+    char buf[64]{};
+    std::snprintf(buf, sizeof(buf), "%.6f", value);
+    return buf;
+}
+
+bool parse_canonical_double(const std::string& text, double* out) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (!end || *end != '\0') return false;
+    if (format_attr_double(value) != text) return false;
+    *out = value;
+    return true;
+}
+
+bool same_attr_value(const EntityAttrValue& a, const EntityAttrValue& b) {
+    if (a.kind != b.kind) return false;
+    switch (a.kind) {
+        case EntityAttrValue::Kind::Int: return a.i == b.i;
+        case EntityAttrValue::Kind::Double: return a.d == b.d;
+        case EntityAttrValue::Kind::String: return a.str == b.str;
+        default: return true;
+    }
+}
+
+EntityType entity_type_for_payload(const EntityPayload& payload, EntityType fallback) {
+    if (std::holds_alternative<Point>(payload)) return EntityType::Point;
+    if (std::holds_alternative<Line>(payload)) return EntityType::Line;
+    if (std::holds_alternative<Arc>(payload)) return EntityType::Arc;
+    if (std::holds_alternative<Circle>(payload)) return EntityType::Circle;
+    if (std::holds_alternative<Ellipse>(payload)) return EntityType::Ellipse;
+    if (std::holds_alternative<Spline>(payload)) return EntityType::Spline;
+    if (std::holds_alternative<Text>(payload)) return EntityType::Text;
+    if (std::holds_alternative<Polyline>(payload)) return EntityType::Polyline;
+    if (std::holds_alternative<BlockInstance>(payload)) return EntityType::BlockInstance;
+    return fallback;
+}
+
+} // namespace
+
 Document::Document() {
     clear();
 }
@@ -31,15 +179,81 @@ void Document::begin_change_batch() {
 void Document::end_change_batch() {
     if (change_batch_depth_ <= 0) return;
     --change_batch_depth_;
-    if (change_batch_depth_ == 0 && pending_reset_) {
-        pending_reset_ = false;
-        notify(DocumentChangeType::Reset);
+    if (change_batch_depth_ != 0) return;
+    compact_entities_if_sparse();
+    if (!batch_dirty_) return;
+
+    DocumentChangeSet changes = std::move(batch_changes_);
+    for (EntityId id : batch_entity_order_) {
+        const uint8_t bits = batch_entity_bits_.find(id)->second;
+        const bool added = (bits & kBatchAdded) != 0;
+        const bool removed = (bits & kBatchRemoved) != 0;
+        if (added && removed) continue;
+        if (removed) {
+            changes.removed.push_back(id);
+        } else if (added) {
+            changes.added.push_back(id);
+        } else {
+            if (bits & kBatchGeometry) changes.geometryChanged.push_back(id);
+            if (bits & kBatchMeta) changes.metaChanged.push_back(id);
+        }
+    }
+    batch_changes_ = DocumentChangeSet{};
+    batch_entity_bits_.clear();
+    batch_entity_order_.clear();
+    batch_dirty_ = false;
+    for (auto* observer : observers_) {
+        if (observer) observer->on_document_batch_changed(*this, changes);
+    }
+}
+
+void Document::record_batch_change(DocumentChangeType type, EntityId entityId, int layerId) {
+    batch_dirty_ = true;
+    uint8_t bit = 0;
+    switch (type) {
+        case DocumentChangeType::EntityAdded: bit = kBatchAdded; break;
+        case DocumentChangeType::EntityRemoved: bit = kBatchRemoved; break;
+        case DocumentChangeType::EntityGeometryChanged: bit = kBatchGeometry; break;
+        case DocumentChangeType::EntityMetaChanged: bit = kBatchMeta; break;
+        case DocumentChangeType::LayerChanged: {
+            auto& layers = batch_changes_.layersChanged;
+            if (std::find(layers.begin(), layers.end(), layerId) == layers.end()) layers.push_back(layerId);
+            return;
+        }
+        case DocumentChangeType::DocumentMetaChanged:
+            batch_changes_.documentMetaChanged = true;
+            return;
+        case DocumentChangeType::SettingsChanged:
+            batch_changes_.settingsChanged = true;
+            return;
+        case DocumentChangeType::Cleared:
+            // Everything recorded so far is superseded, and ids restart after a clear.
+            batch_entity_bits_.clear();
+            batch_entity_order_.clear();
+            batch_changes_ = DocumentChangeSet{};
+            batch_changes_.fullReload = true;
+            return;
+        case DocumentChangeType::Reset:
+            batch_changes_.fullReload = true;
+            return;
+    }
+    if (entityId == 0) {
+        batch_changes_.fullReload = true;
+        return;
     }
+    auto it = batch_entity_bits_.emplace(entityId, 0).first;
+    if (it->second == 0) batch_entity_order_.push_back(entityId);
+    it->second |= bit;
 }
 
 void Document::notify_before(DocumentChangeType type, EntityId entityId, int layerId) {
-    // Capture property diff for transaction undo
-    if (active_transaction_ && !in_undo_redo_) {
+    // Capture property diff for transaction undo (document meta, settings and
+    // clears are not undoable, so nothing is kept for them).
+    const bool undoable = type == DocumentChangeType::EntityGeometryChanged ||
+                          type == DocumentChangeType::EntityMetaChanged ||
+                          type == DocumentChangeType::LayerChanged ||
+                          type == DocumentChangeType::EntityRemoved;
+    if (active_transaction_ && !in_undo_redo_ && undoable) {
         PropertyDiff diff;
         diff.type = type;
         diff.entityId = entityId;
@@ -49,12 +263,26 @@ void Document::notify_before(DocumentChangeType type, EntityId entityId, int lay
             if (ent) diff.oldPayload = ent->payload;
         } else if (type == DocumentChangeType::EntityMetaChanged) {
             const auto* ent = get_entity(entityId);
-            if (ent) diff.oldEntity = *ent;
+            if (ent) {
+                diff.oldProps.visible = ent->visible;
+                diff.oldProps.groupId = ent->groupId;
+                diff.oldProps.color = ent->color;
+                diff.oldProps.line_type = ent->line_type;
+                diff.oldProps.line_weight = ent->line_weight;
+                diff.oldProps.line_type_scale = ent->line_type_scale;
+            }
         } else if (type == DocumentChangeType::LayerChanged) {
             const auto* layer = get_layer(layerId);
             if (layer) diff.oldLayer = *layer;
+        } else if (type == DocumentChangeType::EntityRemoved) {
+            auto it = entity_slots_.find(entityId);
+            if (it != entity_slots_.end()) {
+                diff.entity = std::make_unique<Entity>(entities_[it->second]);
+                diff.slot = it->second;
+                diff.slotEpoch = entity_slot_epoch_;
+            }
         }
-        active_transaction_->diffs.push_back(diff);
+        active_transaction_->diffs.push_back(std::move(diff));
     }
 
     if (change_batch_depth_ > 0) return;
@@ -68,8 +296,38 @@ void Document::notify_before(DocumentChangeType type, EntityId entityId, int lay
 }
 
 void Document::notify(DocumentChangeType type, EntityId entityId, int layerId) {
+    switch (type) {
+        case DocumentChangeType::EntityAdded:
+        case DocumentChangeType::EntityRemoved:
+        case DocumentChangeType::EntityGeometryChanged:
+        case DocumentChangeType::EntityMetaChanged:
+            mark_changed(entityId);
+            break;
+        case DocumentChangeType::Cleared:
+            // Ids restart, so nothing can be shared with the previous snapshot.
+            snapshot_ids_reset_ = true;
+            spatial_built_ = false;
+            spatial_dirty_.clear();
+            mark_changed();
+            break;
+        default:
+            mark_changed();
+            break;
+    }
+    if (active_transaction_ && !in_undo_redo_) {
+        if (type == DocumentChangeType::EntityAdded) {
+            record_added(entityId);
+        } else if (type == DocumentChangeType::EntityGeometryChanged && !active_transaction_->diffs.empty()) {
+            auto& diffs = active_transaction_->diffs;
+            if (diffs.back().type == type && diffs.back().entityId == entityId) {
+                compress_geometry_diff(diffs.back());
+                // An edit that restored identical points needs no undo step.
+                if (diffs.back().pointsDelta && diffs.back().points.empty()) diffs.pop_back();
+            }
+        }
+    }
     if (change_batch_depth_ > 0) {
-        pending_reset_ = true;
+        record_batch_change(type, entityId, layerId);
         return;
     }
     DocumentChangeEvent event;
@@ -172,9 +430,9 @@ EntityId Document::add_point(const Vec2& p, const std::string& name, int layerId
     e.name = name;
     e.layerId = layerId;
     e.payload = Point{p};
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_line(const Line& l, const std::string& name, int layerId) {
@@ -184,9 +442,9 @@ EntityId Document::add_line(const Line& l, const std::string& name, int layerId)
     e.name = name;
     e.layerId = layerId;
     e.payload = l;
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_arc(const Arc& a, const std::string& name, int layerId) {
@@ -196,9 +454,9 @@ EntityId Document::add_arc(const Arc& a, const std::string& name, int layerId) {
     e.name = name;
     e.layerId = layerId;
     e.payload = a;
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_circle(const Circle& c, const std::string& name, int layerId) {
@@ -208,9 +466,9 @@ EntityId Document::add_circle(const Circle& c, const std::string& name, int laye
     e.name = name;
     e.layerId = layerId;
     e.payload = c;
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_ellipse(const Ellipse& e, const std::string& name, int layerId) {
@@ -220,9 +478,9 @@ EntityId Document::add_ellipse(const Ellipse& e, const std::string& name, int la
     ent.name = name;
     ent.layerId = layerId;
     ent.payload = e;
-    entities_.push_back(ent);
-    notify(DocumentChangeType::EntityAdded, ent.id);
-    return ent.id;
+    const EntityId id = push_entity(std::move(ent)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_spline(const Spline& s, const std::string& name, int layerId) {
@@ -232,9 +490,9 @@ EntityId Document::add_spline(const Spline& s, const std::string& name, int laye
     ent.name = name;
     ent.layerId = layerId;
     ent.payload = s;
-    entities_.push_back(ent);
-    notify(DocumentChangeType::EntityAdded, ent.id);
-    return ent.id;
+    const EntityId id = push_entity(std::move(ent)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 EntityId Document::add_text(const Text& t, const std::string& name, int layerId) {
@@ -244,9 +502,9 @@ EntityId Document::add_text(const Text& t, const std::string& name, int layerId)
     ent.name = name;
     ent.layerId = layerId;
     ent.payload = t;
-    entities_.push_back(ent);
-    notify(DocumentChangeType::EntityAdded, ent.id);
-    return ent.id;
+    const EntityId id = push_entity(std::move(ent)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 Point* Document::get_point(EntityId id) {
@@ -444,9 +702,196 @@ EntityId Document::add_polyline(const Polyline& pl, const std::string& name, int
     e.name = name;
     e.layerId = layerId;
     e.payload = pl;
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
+}
+
+EntityId Document::add_entities(std::vector<Entity>&& entities) {
+    if (entities.empty()) return 0;
+    mark_changed();
+    entities_.reserve(entities_.size() + entities.size());
+    entity_slots_.reserve(entity_slots_.size() + entities.size());
+    const EntityId first = next_id_;
+    // Outside an enclosing batch the change set is known up front, so skip the
+    // per-id batch bookkeeping.
+    const bool nested = change_batch_depth_ > 0;
+    DocumentChangeSet changes;
+    if (!nested && !observers_.empty()) changes.added.reserve(entities.size());
+    for (auto& e : entities) {
+        e.id = next_id_++;
+        e.type = entity_type_for_payload(e.payload, e.type);
+        const EntityId id = push_entity(std::move(e)).id;
+        if (nested) {
+            notify(DocumentChangeType::EntityAdded, id);
+        } else {
+            record_added(id);
+            if (spatial_built_) spatial_dirty_.insert(id);
+            if (!observers_.empty()) changes.added.push_back(id);
+        }
+    }
+    entities.clear();
+    if (!nested) {
+        for (auto* observer : observers_) {
+            if (observer) observer->on_document_batch_changed(*this, changes);
+        }
+    }
+    return first;
+}
+
+EntityId Document::splice_from(Document&& src, const LayerRemap& layerRemap, LayerRemap* outLayerMap) {
+    if (&src == this) return 0;
+    mark_changed();
+    const bool nested = change_batch_depth_ > 0;
+    DocumentChangeSet changes;
+
+    // Layers first so entities can be retargeted.
+    LayerRemap layerMap;
+    layerMap.reserve(src.layers_.size());
+    for (auto& layer : src.layers_) {
+        auto it = layerRemap.find(layer.id);
+        if (it != layerRemap.end() && get_layer(it->second)) {
+            layerMap.emplace(layer.id, it->second);
+        } else if (layer.id == 0) {
+            layerMap.emplace(0, 0);
+        } else {
+            const int srcLayerId = layer.id;
+            layer.id = next_layer_id_++;
+            layerMap.emplace(srcLayerId, layer.id);
+            layers_.push_back(std::move(layer));
+            if (nested) {
+                notify(DocumentChangeType::LayerChanged, 0, layers_.back().id);
+            } else {
+                changes.layersChanged.push_back(layers_.back().id);
+            }
+        }
+    }
+
+    // Tombstones in src are skipped.
+    const size_t srcCount = src.entity_count();
+    const EntityId first = srcCount == 0 ? 0 : next_id_;
+    std::unordered_map<EntityId, EntityId> idMap;
+    idMap.reserve(srcCount);
+    std::unordered_map<int, int> groupMap;
+    entities_.reserve(entities_.size() + srcCount);
+    entity_slots_.reserve(entity_slots_.size() + srcCount);
+    if (!nested && !observers_.empty()) changes.added.reserve(srcCount);
+    for (auto& e : src.entities_) {
+        if (e.id == 0) continue;
+        const EntityId srcId = e.id;
+        e.id = next_id_++;
+        idMap.emplace(srcId, e.id);
+        auto layerIt = layerMap.find(e.layerId);
+        e.layerId = layerIt != layerMap.end() ? layerIt->second : 0;
+        if (e.groupId >= 0) {
+            auto groupIt = groupMap.find(e.groupId);
+            if (groupIt == groupMap.end()) groupIt = groupMap.emplace(e.groupId, alloc_group_id()).first;
+            e.groupId = groupIt->second;
+        }
+        const EntityId id = push_entity(std::move(e)).id;
+        if (nested) {
+            notify(DocumentChangeType::EntityAdded, id);
+        } else {
+            record_added(id);
+            if (spatial_built_) spatial_dirty_.insert(id);
+            if (!observers_.empty()) changes.added.push_back(id);
+        }
+    }
+
+    for (auto& def : src.block_definitions_) {
+        std::vector<EntityId> members;
+        members.reserve(def.memberIds.size());
+        for (EntityId member : def.memberIds) {
+            auto it = idMap.find(member);
+            if (it != idMap.end()) members.push_back(it->second);
+        }
+        def.memberIds = std::move(members);
+        block_definitions_.push_back(std::move(def));
+    }
+
+    for (EntityId source : src.dep_graph_.allEntities()) {
+        auto sourceIt = idMap.find(source);
+        if (sourceIt == idMap.end()) continue;
+        for (EntityId dependent : src.dep_graph_.dependentsOf(source)) {
+            auto dependentIt = idMap.find(dependent);
+            if (dependentIt != idMap.end()) dep_graph_.addDependency(sourceIt->second, dependentIt->second);
+        }
+    }
+
+    // Typed attributes: field and string ids are per document, so translate.
+    bool metaChanged = false;
+    std::vector<int64_t> fieldMap(src.attr_field_names_.size(), -1);
+    std::vector<int64_t> stringMap(src.attr_strings_.size(), -1);
+    for (size_t row = 0; row < src.entity_attrs_.size(); ++row) {
+        auto& slots = src.entity_attrs_[row];
+        if (slots.empty()) continue;
+        auto idIt = idMap.find(static_cast<EntityId>(row));
+        if (idIt == idMap.end()) continue;
+        const auto dstRow = static_cast<size_t>(idIt->second);
+        if (dstRow >= entity_attrs_.size()) entity_attrs_.resize(dstRow + 1);
+        auto& dst = entity_attrs_[dstRow];
+        for (const auto& slot : slots) {
+            const auto srcField = static_cast<size_t>(slot.field);
+            if (fieldMap[srcField] < 0) {
+                fieldMap[srcField] = static_cast<int64_t>(entity_attr_field(src.attr_field_names_[srcField]));
+            }
+            EntityAttrSlot out;
+            out.field = static_cast<EntityAttrField>(fieldMap[srcField]);
+            out.value = slot.value;
+            if (out.value.kind == EntityAttrValue::Kind::String) {
+                if (stringMap[slot.value.str] < 0) {
+                    stringMap[slot.value.str] = intern_attr_string(src.attr_strings_[slot.value.str]);
+                }
+                out.value.str = static_cast<uint32_t>(stringMap[slot.value.str]);
+            }
+            auto it = std::lower_bound(dst.begin(), dst.end(), out.field,
+                                       [](const EntityAttrSlot& a, EntityAttrField f) { return a.field < f; });
+            if (it != dst.end() && it->field == out.field) {
+                it->value = out.value;
+            } else {
+                dst.insert(it, out);
+            }
+        }
+        metaChanged = true;
+    }
+
+    // Plain meta keys: entity/layer ids are rewritten, keys the destination
+    // already has win, and keys about entities that did not move are dropped.
+    for (auto& kv : src.metadata_.meta) {
+        uint64_t keyId = 0;
+        std::string key;
+        if (size_t rest = split_id_meta_key(kv.first, kEntityMetaPrefix, kEntityMetaPrefixLen, &keyId)) {
+            auto it = idMap.find(static_cast<EntityId>(keyId));
+            if (it == idMap.end()) continue;
+            key = kEntityMetaPrefix + std::to_string(static_cast<unsigned long long>(it->second)) + "." +
+                  kv.first.substr(rest);
+        } else if (size_t rest = split_id_meta_key(kv.first, kLayerMetaPrefix, kLayerMetaPrefixLen, &keyId)) {
+            auto it = keyId <= static_cast<uint64_t>(INT32_MAX) ? layerMap.find(static_cast<int>(keyId))
+                                                                 : layerMap.end();
+            if (it == layerMap.end()) continue;
+            key = kLayerMetaPrefix + std::to_string(it->second) + "." + kv.first.substr(rest);
+        } else {
+            key = kv.first;
+        }
+        if (metadata_.meta.emplace(std::move(key), std::move(kv.second)).second) metaChanged = true;
+    }
+    if (metaChanged) {
+        meta_view_valid_ = false;
+        if (nested) {
+            notify(DocumentChangeType::DocumentMetaChanged);
+        } else {
+            changes.documentMetaChanged = true;
+        }
+    }
+
+    src.clear();
+    if (outLayerMap) *outLayerMap = std::move(layerMap);
+    if (!nested && !changes.empty()) {
+        for (auto* observer : observers_) {
+            if (observer) observer->on_document_batch_changed(*this, changes);
+        }
+    }
+    return first;
 }
 
 bool Document::set_polyline_points(EntityId id, const Polyline& pl) {
@@ -472,25 +917,61 @@ bool Document::set_polyline_points(EntityId id, const Polyline& pl) {
 }
 
 bool Document::remove_entity(EntityId id) {
-    for (auto it = entities_.begin(); it != entities_.end(); ++it) {
-        if (it->id == id) {
-            notify_before(DocumentChangeType::EntityRemoved, id);
-            entities_.erase(it);
-            notify(DocumentChangeType::EntityRemoved, id);
-            return true;
+    auto it = entity_slots_.find(id);
+    if (it == entity_slots_.end()) return false;
+    notify_before(DocumentChangeType::EntityRemoved, id);
+    // notify_before may have run observer code; re-resolve the slot.
+    it = entity_slots_.find(id);
+    if (it == entity_slots_.end()) return false;
+    entities_[it->second] = Entity{}; // tombstone (id 0)
+    entity_slots_.erase(it);
+    ++entity_tombstones_;
+    compact_entities_if_sparse();
+    notify(DocumentChangeType::EntityRemoved, id);
+    return true;
+}
+
+Entity& Document::push_entity(Entity&& e) {
+    entity_slots_[e.id] = entities_.size();
+    entities_.push_back(std::move(e));
+    return entities_.back();
+}
+
+void Document::compact_entities() {
+    if (entity_tombstones_ == 0) return;
+    size_t out = 0;
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        if (entities_[i].id == 0) continue;
+        if (out != i) {
+            entities_[out] = std::move(entities_[i]);
+            entity_slots_[entities_[out].id] = out;
         }
+        ++out;
     }
-    return false;
+    entities_.resize(out);
+    entity_tombstones_ = 0;
+    ++entity_slot_epoch_;
+}
+
+void Document::compact_entities_if_sparse() {
+    if (change_batch_depth_ == 0 && entity_tombstones_ * 2 > entities_.size()) compact_entities();
 }
 
 void Document::clear() {
     notify_before(DocumentChangeType::Cleared);
     settings_ = DocumentSettings{};
     metadata_ = DocumentMetadata{};
+    reset_entity_attrs();
     entities_.clear();
+    entity_slots_.clear();
+    entity_tombstones_ = 0;
     layers_.clear();
     block_definitions_.clear();
     dep_graph_.clear();
+    constraints_.clear();
+    constraints_snapshot_.reset();
+    ++constraint_revision_;
+    next_constraint_id_ = 1;
     next_id_ = 1;
     next_layer_id_ = 1;
     next_group_id_ = 1;
@@ -509,17 +990,15 @@ void Document::clear() {
 }
 
 Entity* Document::get_entity(EntityId id) {
-    for (auto& e : entities_) {
-        if (e.id == id) return &e;
-    }
-    return nullptr;
+    auto it = entity_slots_.find(id);
+    if (it == entity_slots_.end()) return nullptr;
+    return &entities_[it->second];
 }
 
 const Entity* Document::get_entity(EntityId id) const {
-    for (const auto& e : entities_) {
-        if (e.id == id) return &e;
-    }
-    return nullptr;
+    auto it = entity_slots_.find(id);
+    if (it == entity_slots_.end()) return nullptr;
+    return &entities_[it->second];
 }
 
 bool Document::set_entity_visible(EntityId id, bool visible) {
@@ -648,23 +1127,455 @@ bool Document::set_unit_name(const std::string& unit_name) {
 
 bool Document::set_meta_value(const std::string& key, const std::string& value) {
     if (key.empty()) return false;
+    EntityId id = 0;
+    std::string name;
+    if (parse_entity_meta_key(key, &id, &name)) {
+        // Route per-entity keys into the typed table, keeping the value kind
+        // that reproduces the original text exactly.
+        const EntityAttrField field = entity_attr_field(name);
+        const auto index = static_cast<size_t>(field);
+        const auto kind = index < static_cast<size_t>(EntityAttrField::Count)
+            ? kBuiltinAttrFields[index].kind : EntityAttrValue::Kind::None;
+        int64_t int_value = 0;
+        double double_value = 0.0;
+        bool stored = false;
+        if (kind != EntityAttrValue::Kind::String && parse_canonical_int(value, &int_value)) {
+            stored = set_entity_attr_int(id, field, int_value);
+        } else if (kind == EntityAttrValue::Kind::None && parse_canonical_double(value, &double_value)) {
+            stored = set_entity_attr_double(id, field, double_value);
+        } else {
+            stored = set_entity_attr_string(id, field, value);
+        }
+        if (stored) {
+            metadata_.meta.erase(key);
+            return true;
+        }
+    }
     auto it = metadata_.meta.find(key);
     if (it != metadata_.meta.end() && it->second == value) return true;
     notify_before(DocumentChangeType::DocumentMetaChanged);
     metadata_.meta[key] = value;
+    meta_view_valid_ = false;
     notify(DocumentChangeType::DocumentMetaChanged);
     return true;
 }
 
 bool Document::remove_meta_value(const std::string& key) {
     if (key.empty()) return false;
+    EntityId id = 0;
+    std::string name;
+    EntityAttrField field{};
+    if (parse_entity_meta_key(key, &id, &name) && find_entity_attr_field(name, &field) &&
+        remove_entity_attr(id, field)) {
+        metadata_.meta.erase(key);
+        return true;
+    }
     auto it = metadata_.meta.find(key);
     if (it == metadata_.meta.end()) return false;
     metadata_.meta.erase(it);
+    meta_view_valid_ = false;
+    notify(DocumentChangeType::DocumentMetaChanged);
+    return true;
+}
+
+bool Document::get_meta_value(const std::string& key, std::string* out) const {
+    if (key.empty() || !out) return false;
+    EntityId id = 0;
+    std::string name;
+    EntityAttrField field{};
+    if (parse_entity_meta_key(key, &id, &name) && find_entity_attr_field(name, &field)) {
+        if (const auto* value = get_entity_attr(id, field)) {
+            *out = format_entity_attr(*value);
+            return true;
+        }
+    }
+    auto it = metadata_.meta.find(key);
+    if (it == metadata_.meta.end()) return false;
+    *out = it->second;
+    return true;
+}
+
+const std::vector<std::pair<std::string, std::string>>& Document::meta_entries() const {
+    if (meta_view_valid_) return meta_view_;
+    meta_view_.clear();
+    EntityId id = 0;
+    std::string name;
+    EntityAttrField field{};
+    for (const auto& kv : metadata_.meta) {
+        // A typed attribute shadows a stale string entry for the same key.
+        if (parse_entity_meta_key(kv.first, &id, &name) && find_entity_attr_field(name, &field) &&
+            get_entity_attr(id, field)) {
+            continue;
+        }
+        meta_view_.emplace_back(kv.first, kv.second);
+    }
+    for (size_t row = 0; row < entity_attrs_.size(); ++row) {
+        for (const auto& slot : entity_attrs_[row]) {
+            meta_view_.emplace_back(make_entity_meta_key(static_cast<EntityId>(row),
+                                                         entity_attr_field_name(slot.field)),
+                                    format_entity_attr(slot.value));
+        }
+    }
+    std::sort(meta_view_.begin(), meta_view_.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    meta_view_valid_ = true;
+    return meta_view_;
+}
+
+// --- Snapshots ---
+
+void Document::mark_changed(EntityId entityId) {
+    ++revision_;
+    snapshot_stale_ = true;
+    if (entityId == 0) return;
+    if (!snapshot_ids_reset_ && !snapshot_.expired()) snapshot_dirty_.insert(entityId);
+    if (spatial_built_) spatial_dirty_.insert(entityId);
+}
+
+void Document::mark_modified(EntityId entityId) {
+    if (entityId == 0) meta_view_valid_ = false;
+    mark_changed(entityId);
+}
+
+const SpatialIndex& Document::spatial_index() const {
+    // Rebuilding with STR packing beats many single inserts once a large share
+    // of the document changed (bulk imports, wide edits).
+    if (!spatial_built_ || spatial_dirty_.size() > spatial_index_.size() / 2 + 64) {
+        std::vector<std::pair<EntityId, Box2>> items;
+        const auto& live = entities();
+        items.reserve(live.size());
+        Box2 box;
+        for (const auto& e : live) {
+            if (e.id != 0 && entityBounds(e, box)) items.emplace_back(e.id, box);
+        }
+        spatial_index_.build(std::move(items));
+        spatial_dirty_.clear();
+        spatial_built_ = true;
+        return spatial_index_;
+    }
+    if (spatial_dirty_.empty()) return spatial_index_;
+    Box2 box;
+    for (EntityId id : spatial_dirty_) {
+        const Entity* e = get_entity(id);
+        if (e && entityBounds(*e, box)) {
+            spatial_index_.insert(id, box);
+        } else {
+            spatial_index_.remove(id);
+        }
+    }
+    spatial_dirty_.clear();
+    return spatial_index_;
+}
+
+std::shared_ptr<const DocumentSnapshot> Document::snapshot() const {
+    std::shared_ptr<const DocumentSnapshot> prev = snapshot_.lock();
+    if (prev && !snapshot_stale_) return prev;
+    if (snapshot_ids_reset_) prev.reset();
+
+    std::shared_ptr<DocumentSnapshot> snap(new DocumentSnapshot());
+    snap->revision_ = revision_;
+    const auto& live = entities();
+    snap->entities_.reserve(live.size());
+    size_t hint = 0;
+    EntityId last = 0;
+    for (const auto& e : live) {
+        if (e.id == 0) continue; // removed inside an open change batch
+        if (e.id <= last) snap->sorted_ = false;
+        last = e.id;
+        std::shared_ptr<const Entity> shared;
+        if (prev && snapshot_dirty_.find(e.id) == snapshot_dirty_.end()) {
+            // Both are normally in the same order, so try the next slot first.
+            const auto& old = prev->entities_;
+            const size_t index = (hint < old.size() && old[hint]->id == e.id) ? hint : prev->find_index(e.id);
+            if (index < old.size()) {
+                shared = old[index];
+                hint = index + 1;
+            }
+        }
+        if (!shared) shared = std::make_shared<const Entity>(e);
+        snap->entities_.push_back(std::move(shared));
+    }
+    if (!snap->sorted_) {
+        snap->index_.reserve(snap->entities_.size());
+        for (size_t i = 0; i < snap->entities_.size(); ++i) snap->index_.emplace(snap->entities_[i]->id, i);
+    }
+    snap->layers_ = layers_;
+    snap->settings_ = settings_;
+    snap->metadata_ = metadata_;
+    if (!constraints_snapshot_) {
+        constraints_snapshot_ = std::make_shared<const std::vector<DocumentConstraint>>(constraints_);
+    }
+    snap->constraints_ = constraints_snapshot_;
+    snap->constraint_revision_ = constraint_revision_;
+
+    snapshot_dirty_.clear();
+    snapshot_stale_ = false;
+    snapshot_ids_reset_ = false;
+    snapshot_ = snap;
+    return snap;
+}
+
+size_t DocumentSnapshot::find_index(EntityId id) const {
+    if (sorted_) {
+        auto it = std::lower_bound(entities_.begin(), entities_.end(), id,
+                                   [](const std::shared_ptr<const Entity>& e, EntityId value) { return e->id < value; });
+        return (it != entities_.end() && (*it)->id == id) ? static_cast<size_t>(it - entities_.begin())
+                                                          : entities_.size();
+    }
+    auto it = index_.find(id);
+    return it != index_.end() ? it->second : entities_.size();
+}
+
+const Entity* DocumentSnapshot::get_entity(EntityId id) const {
+    const size_t index = find_index(id);
+    return index < entities_.size() ? entities_[index].get() : nullptr;
+}
+
+const Layer* DocumentSnapshot::get_layer(int id) const {
+    for (const auto& l : layers_) {
+        if (l.id == id) return &l;
+    }
+    return nullptr;
+}
+
+namespace {
+
+bool same_vec2(const Vec2& a, const Vec2& b) { return a.x == b.x && a.y == b.y; }
+
+bool same_points(const std::vector<Vec2>& a, const std::vector<Vec2>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), same_vec2);
+}
+
+bool same_payload(const EntityPayload& a, const EntityPayload& b) {
+    if (a.index() != b.index()) return false;
+    if (const auto* p = std::get_if<Point>(&a)) return same_vec2(p->p, std::get<Point>(b).p);
+    if (const auto* l = std::get_if<Line>(&a)) {
+        const auto& o = std::get<Line>(b);
+        return same_vec2(l->a, o.a) && same_vec2(l->b, o.b);
+    }
+    if (const auto* arc = std::get_if<Arc>(&a)) {
+        const auto& o = std::get<Arc>(b);
+        return same_vec2(arc->center, o.center) && arc->radius == o.radius && arc->start_angle == o.start_angle &&
+               arc->end_angle == o.end_angle && arc->clockwise == o.clockwise;
+    }
+    if (const auto* c = std::get_if<Circle>(&a)) {
+        const auto& o = std::get<Circle>(b);
+        return same_vec2(c->center, o.center) && c->radius == o.radius;
+    }
+    if (const auto* el = std::get_if<Ellipse>(&a)) {
+        const auto& o = std::get<Ellipse>(b);
+        return same_vec2(el->center, o.center) && el->rx == o.rx && el->ry == o.ry && el->rotation == o.rotation &&
+               el->start_angle == o.start_angle && el->end_angle == o.end_angle;
+    }
+    if (const auto* sp = std::get_if<Spline>(&a)) {
+        const auto& o = std::get<Spline>(b);
+        return sp->degree == o.degree && same_points(sp->control_points, o.control_points) && sp->knots == o.knots;
+    }
+    if (const auto* t = std::get_if<Text>(&a)) {
+        const auto& o = std::get<Text>(b);
+        return same_vec2(t->pos, o.pos) && t->height == o.height && t->rotation == o.rotation && t->text == o.text;
+    }
+    if (const auto* pl = std::get_if<Polyline>(&a)) return same_points(pl->points, std::get<Polyline>(b).points);
+    if (const auto* bi = std::get_if<BlockInstance>(&a)) {
+        const auto& o = std::get<BlockInstance>(b);
+        return bi->blockName == o.blockName && same_vec2(bi->insertionPoint, o.insertionPoint) &&
+               bi->rotation == o.rotation && bi->scaleX == o.scaleX && bi->scaleY == o.scaleY;
+    }
+    return true;
+}
+
+bool same_entity_meta(const Entity& a, const Entity& b) {
+    return a.type == b.type && a.name == b.name && a.layerId == b.layerId && a.visible == b.visible &&
+           a.groupId == b.groupId && a.color == b.color && a.line_type == b.line_type &&
+           a.line_weight == b.line_weight && a.line_type_scale == b.line_type_scale;
+}
+
+bool same_layer(const Layer& a, const Layer& b) {
+    return a.name == b.name && a.color == b.color && a.line_weight == b.line_weight && a.visible == b.visible &&
+           a.locked == b.locked && a.printable == b.printable && a.frozen == b.frozen &&
+           a.construction == b.construction;
+}
+
+bool same_metadata(const DocumentMetadata& a, const DocumentMetadata& b) {
+    return a.label == b.label && a.author == b.author && a.company == b.company && a.comment == b.comment &&
+           a.created_at == b.created_at && a.modified_at == b.modified_at && a.unit_name == b.unit_name &&
+           a.meta == b.meta;
+}
+
+} // namespace
+
+DocumentChangeSet DocumentSnapshot::diff(const DocumentSnapshot& older) const {
+    DocumentChangeSet changes;
+    for (const auto& e : entities_) {
+        const size_t index = older.find_index(e->id);
+        if (index >= older.entities_.size()) {
+            changes.added.push_back(e->id);
+            continue;
+        }
+        const auto& before = older.entities_[index];
+        if (before == e) continue;
+        if (!same_payload(before->payload, e->payload)) changes.geometryChanged.push_back(e->id);
+        if (!same_entity_meta(*before, *e)) changes.metaChanged.push_back(e->id);
+    }
+    for (const auto& e : older.entities_) {
+        if (find_index(e->id) >= entities_.size()) changes.removed.push_back(e->id);
+    }
+    for (const auto& layer : layers_) {
+        const Layer* before = older.get_layer(layer.id);
+        if (!before || !same_layer(*before, layer)) changes.layersChanged.push_back(layer.id);
+    }
+    for (const auto& layer : older.layers_) {
+        if (!get_layer(layer.id)) changes.layersChanged.push_back(layer.id);
+    }
+    changes.settingsChanged = settings_.unit_scale != older.settings_.unit_scale;
+    changes.documentMetaChanged = !same_metadata(metadata_, older.metadata_);
+    return changes;
+}
+
+// --- Typed entity attributes ---
+
+void Document::reset_entity_attrs() {
+    entity_attrs_.clear();
+    attr_strings_.clear();
+    attr_string_ids_.clear();
+    attr_field_names_.clear();
+    attr_field_ids_.clear();
+    for (const auto& builtin : kBuiltinAttrFields) {
+        attr_field_ids_.emplace(builtin.name, static_cast<EntityAttrField>(attr_field_names_.size()));
+        attr_field_names_.emplace_back(builtin.name);
+    }
+    meta_view_valid_ = false;
+}
+
+EntityAttrField Document::entity_attr_field(const std::string& name) {
+    auto it = attr_field_ids_.find(name);
+    if (it != attr_field_ids_.end()) return it->second;
+    const auto field = static_cast<EntityAttrField>(attr_field_names_.size());
+    attr_field_ids_.emplace(name, field);
+    attr_field_names_.push_back(name);
+    return field;
+}
+
+bool Document::find_entity_attr_field(const std::string& name, EntityAttrField* out) const {
+    auto it = attr_field_ids_.find(name);
+    if (it == attr_field_ids_.end()) return false;
+    if (out) *out = it->second;
+    return true;
+}
+
+const std::string& Document::entity_attr_field_name(EntityAttrField field) const {
+    static const std::string kEmpty;
+    const auto index = static_cast<size_t>(field);
+    return index < attr_field_names_.size() ? attr_field_names_[index] : kEmpty;
+}
+
+uint32_t Document::intern_attr_string(const std::string& value) {
+    auto it = attr_string_ids_.find(value);
+    if (it != attr_string_ids_.end()) return it->second;
+    const auto index = static_cast<uint32_t>(attr_strings_.size());
+    attr_strings_.push_back(value);
+    attr_string_ids_.emplace(value, index);
+    return index;
+}
+
+const std::string& Document::attr_string(uint32_t index) const {
+    static const std::string kEmpty;
+    return index < attr_strings_.size() ? attr_strings_[index] : kEmpty;
+}
+
+bool Document::store_entity_attr(EntityId id, EntityAttrField field, const EntityAttrValue& value) {
+    if (id == 0 || static_cast<size_t>(field) >= attr_field_names_.size()) return false;
+    const EntityId limit = std::max<EntityId>(next_id_, entity_attrs_.size()) + kEntityAttrIdSlack;
+    if (id >= limit) return false;
+    if (id >= entity_attrs_.size()) entity_attrs_.resize(static_cast<size_t>(id) + 1);
+    auto& row = entity_attrs_[static_cast<size_t>(id)];
+    auto it = std::lower_bound(row.begin(), row.end(), field,
+                               [](const EntityAttrSlot& s, EntityAttrField f) { return s.field < f; });
+    if (it != row.end() && it->field == field && same_attr_value(it->value, value)) return true;
+    notify_before(DocumentChangeType::DocumentMetaChanged);
+    if (it != row.end() && it->field == field) {
+        it->value = value;
+    } else {
+        EntityAttrSlot slot;
+        slot.field = field;
+        slot.value = value;
+        row.insert(it, slot);
+    }
+    meta_view_valid_ = false;
     notify(DocumentChangeType::DocumentMetaChanged);
     return true;
 }
 
+bool Document::set_entity_attr_int(EntityId id, EntityAttrField field, int64_t value) {
+    EntityAttrValue v;
+    v.kind = EntityAttrValue::Kind::Int;
+    v.i = value;
+    return store_entity_attr(id, field, v);
+}
+
+bool Document::set_entity_attr_double(EntityId id, EntityAttrField field, double value) {
+    EntityAttrValue v;
+    v.kind = EntityAttrValue::Kind::Double;
+    v.d = value;
+    return store_entity_attr(id, field, v);
+}
+
+bool Document::set_entity_attr_string(EntityId id, EntityAttrField field, const std::string& value) {
+    if (id == 0) return false;
+    EntityAttrValue v;
+    v.kind = EntityAttrValue::Kind::String;
+    v.str = intern_attr_string(value);
+    return store_entity_attr(id, field, v);
+}
+
+bool Document::remove_entity_attr(EntityId id, EntityAttrField field) {
+    if (id == 0 || id >= entity_attrs_.size()) return false;
+    auto& row = entity_attrs_[static_cast<size_t>(id)];
+    auto it = std::lower_bound(row.begin(), row.end(), field,
+                               [](const EntityAttrSlot& s, EntityAttrField f) { return s.field < f; });
+    if (it == row.end() || it->field != field) return false;
+    row.erase(it);
+    meta_view_valid_ = false;
+    notify(DocumentChangeType::DocumentMetaChanged);
+    return true;
+}
+
+const EntityAttrValue* Document::get_entity_attr(EntityId id, EntityAttrField field) const {
+    if (id == 0 || id >= entity_attrs_.size()) return nullptr;
+    const auto& row = entity_attrs_[static_cast<size_t>(id)];
+    auto it = std::lower_bound(row.begin(), row.end(), field,
+                               [](const EntityAttrSlot& s, EntityAttrField f) { return s.field < f; });
+    if (it == row.end() || it->field != field) return nullptr;
+    return &it->value;
+}
+
+bool Document::get_entity_attr_int(EntityId id, EntityAttrField field, int64_t* out) const {
+    const auto* value = get_entity_attr(id, field);
+    if (!value || !out) return false;
+    if (value->kind == EntityAttrValue::Kind::Int) {
+        *out = value->i;
+        return true;
+    }
+    if (value->kind == EntityAttrValue::Kind::String) {
+        return parse_canonical_int(attr_string(value->str), out);
+    }
+    return false;
+}
+
+std::string Document::format_entity_attr(const EntityAttrValue& value) const {
+    switch (value.kind) {
+        case EntityAttrValue::Kind::Int: return std::to_string(static_cast<long long>(value.i));
+        case EntityAttrValue::Kind::Double: return format_attr_double(value.d);
+        case EntityAttrValue::Kind::String: return attr_string(value.str);
+        default: return {};
+    }
+}
+
+std::string Document::entity_attr_text(EntityId id, EntityAttrField field) const {
+    const auto* value = get_entity_attr(id, field);
+    return value ? format_entity_attr(*value) : std::string{};
+}
+
 bool Document::set_unit_scale(double unit_scale) {
     if (settings_.unit_scale == unit_scale) return true;
     settings_.unit_scale = unit_scale;
@@ -694,195 +1605,821 @@ EntityId Document::add_block_instance(const BlockInstance& inst, const std::stri
     e.name = name;
     e.layerId = layerId;
     e.payload = inst;
-    entities_.push_back(e);
-    notify(DocumentChangeType::EntityAdded, e.id);
-    return e.id;
+    const EntityId id = push_entity(std::move(e)).id;
+    notify(DocumentChangeType::EntityAdded, id);
+    return id;
 }
 
 // --- DependencyGraph (P3.2) ---
 
+namespace {
+
+bool insert_sorted(std::vector<uint32_t>& list, uint32_t value) {
+    auto it = std::lower_bound(list.begin(), list.end(), value);
+    if (it != list.end() && *it == value) return false;
+    list.insert(it, value);
+    return true;
+}
+
+bool erase_sorted(std::vector<uint32_t>& list, uint32_t value) {
+    auto it = std::lower_bound(list.begin(), list.end(), value);
+    if (it == list.end() || *it != value) return false;
+    list.erase(it);
+    return true;
+}
+
+void build_csr_half(const std::vector<std::vector<uint32_t>>& lists,
+                    std::vector<uint32_t>& offsets, std::vector<uint32_t>& targets) {
+    offsets.assign(lists.size() + 1, 0);
+    size_t total = 0;
+    for (size_t n = 0; n < lists.size(); ++n) {
+        offsets[n] = static_cast<uint32_t>(total);
+        total += lists[n].size();
+    }
+    offsets[lists.size()] = static_cast<uint32_t>(total);
+    targets.clear();
+    targets.reserve(total);
+    for (const auto& list : lists) targets.insert(targets.end(), list.begin(), list.end());
+}
+
+} // namespace
+
+uint32_t DependencyGraph::node_of(EntityId id) const {
+    auto it = index_.find(id);
+    return it == index_.end() ? kNoNode : it->second;
+}
+
+uint32_t DependencyGraph::intern(EntityId id) {
+    auto it = index_.find(id);
+    if (it != index_.end()) return it->second;
+    uint32_t node;
+    if (!free_.empty()) {
+        node = free_.back();
+        free_.pop_back();
+        ids_[node] = id;
+    } else {
+        node = static_cast<uint32_t>(ids_.size());
+        ids_.push_back(id);
+        out_.emplace_back();
+        in_.emplace_back();
+        ord_.push_back(0);
+    }
+    // No edges yet, so the end of the order is a valid place.
+    ord_[node] = next_ord_++;
+    index_.emplace(id, node);
+    csr_stale_ = true;
+    return node;
+}
+
+void DependencyGraph::release_if_isolated(uint32_t node) {
+    if (!out_[node].empty() || !in_[node].empty()) return;
+    index_.erase(ids_[node]);
+    free_.push_back(node);
+}
+
+void DependencyGraph::unlink(uint32_t source, uint32_t dependent) {
+    if (!erase_sorted(out_[source], dependent)) return;
+    erase_sorted(in_[dependent], source);
+    --edges_;
+    csr_stale_ = true;
+}
+
+// Pearce-Kelly: the new edge source→dependent points backwards in the order.
+// Only nodes ordered between the two can be out of place: those reachable
+// from `dependent` move after those reaching `source`, reusing their slots.
+void DependencyGraph::reorder(uint32_t source, uint32_t dependent) {
+    const uint64_t lower = ord_[dependent];
+    const uint64_t upper = ord_[source];
+    std::unordered_set<uint32_t> seen{dependent};
+    std::vector<uint32_t> forward{dependent};
+    for (size_t i = 0; i < forward.size(); ++i) {
+        for (uint32_t next : out_[forward[i]]) {
+            if (next == source) {
+                order_valid_ = false; // the edge closed a cycle
+                return;
+            }
+            if (ord_[next] < upper && seen.insert(next).second) forward.push_back(next);
+        }
+    }
+    seen = {source};
+    std::vector<uint32_t> backward{source};
+    for (size_t i = 0; i < backward.size(); ++i) {
+        for (uint32_t prev : in_[backward[i]]) {
+            if (ord_[prev] > lower && seen.insert(prev).second) backward.push_back(prev);
+        }
+    }
+    auto by_ord = [this](uint32_t a, uint32_t b) { return ord_[a] < ord_[b]; };
+    std::sort(forward.begin(), forward.end(), by_ord);
+    std::sort(backward.begin(), backward.end(), by_ord);
+    std::vector<uint64_t> slots;
+    slots.reserve(forward.size() + backward.size());
+    for (uint32_t n : backward) slots.push_back(ord_[n]);
+    for (uint32_t n : forward) slots.push_back(ord_[n]);
+    std::sort(slots.begin(), slots.end());
+    size_t k = 0;
+    for (uint32_t n : backward) ord_[n] = slots[k++];
+    for (uint32_t n : forward) ord_[n] = slots[k++];
+}
+
+// Full Kahn pass over the live nodes, used once a cycle has been broken.
+bool DependencyGraph::restore_order() const {
+    std::vector<uint32_t> in_degree(ids_.size(), 0);
+    std::vector<uint32_t> queue;
+    for (const auto& [id, node] : index_) {
+        in_degree[node] = static_cast<uint32_t>(in_[node].size());
+        if (in_degree[node] == 0) queue.push_back(node);
+    }
+    std::sort(queue.begin(), queue.end());
+    std::vector<uint64_t> ord(ord_.size(), 0);
+    uint64_t next = 0;
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const uint32_t node = queue[i];
+        ord[node] = next++;
+        for (uint32_t dep : out_[node]) {
+            if (--in_degree[dep] == 0) queue.push_back(dep);
+        }
+    }
+    if (queue.size() < index_.size()) return false;
+    ord_ = std::move(ord);
+    next_ord_ = next;
+    order_valid_ = true;
+    return true;
+}
+
+void DependencyGraph::build_csr() const {
+    if (!csr_stale_) return;
+    build_csr_half(out_, out_offsets_, out_targets_);
+    build_csr_half(in_, in_offsets_, in_targets_);
+    csr_stale_ = false;
+}
+
 void DependencyGraph::addDependency(EntityId source, EntityId dependent) {
     if (source == dependent) return;
-    forward_[source].insert(dependent);
-    reverse_[dependent].insert(source);
+    const uint32_t s = intern(source);
+    const uint32_t d = intern(dependent);
+    if (!insert_sorted(out_[s], d)) return;
+    insert_sorted(in_[d], s);
+    ++edges_;
+    csr_stale_ = true;
+    if (order_valid_ && ord_[s] > ord_[d]) reorder(s, d);
 }
 
 void DependencyGraph::removeDependency(EntityId source, EntityId dependent) {
-    auto fit = forward_.find(source);
-    if (fit != forward_.end()) {
-        fit->second.erase(dependent);
-        if (fit->second.empty()) forward_.erase(fit);
-    }
-    auto rit = reverse_.find(dependent);
-    if (rit != reverse_.end()) {
-        rit->second.erase(source);
-        if (rit->second.empty()) reverse_.erase(rit);
-    }
+    const uint32_t s = node_of(source);
+    const uint32_t d = node_of(dependent);
+    if (s == kNoNode || d == kNoNode) return;
+    unlink(s, d);
+    release_if_isolated(s);
+    release_if_isolated(d);
 }
 
 void DependencyGraph::removeEntity(EntityId id) {
-    // Remove all forward edges from id
-    auto fit = forward_.find(id);
-    if (fit != forward_.end()) {
-        for (EntityId dep : fit->second) {
-            auto rit = reverse_.find(dep);
-            if (rit != reverse_.end()) {
-                rit->second.erase(id);
-                if (rit->second.empty()) reverse_.erase(rit);
-            }
-        }
-        forward_.erase(fit);
-    }
-    // Remove all reverse edges to id
-    auto rit = reverse_.find(id);
-    if (rit != reverse_.end()) {
-        for (EntityId src : rit->second) {
-            auto fit2 = forward_.find(src);
-            if (fit2 != forward_.end()) {
-                fit2->second.erase(id);
-                if (fit2->second.empty()) forward_.erase(fit2);
-            }
-        }
-        reverse_.erase(rit);
+    const uint32_t node = node_of(id);
+    if (node == kNoNode) return;
+    const std::vector<uint32_t> dependents = out_[node];
+    const std::vector<uint32_t> sources = in_[node];
+    for (uint32_t dep : dependents) {
+        unlink(node, dep);
+        release_if_isolated(dep);
     }
+    for (uint32_t src : sources) {
+        unlink(src, node);
+        release_if_isolated(src);
+    }
+    release_if_isolated(node);
 }
 
 void DependencyGraph::clear() {
-    forward_.clear();
-    reverse_.clear();
+    *this = DependencyGraph{};
 }
 
 std::vector<EntityId> DependencyGraph::dependentsOf(EntityId source) const {
-    auto it = forward_.find(source);
-    if (it == forward_.end()) return {};
-    return {it->second.begin(), it->second.end()};
+    const uint32_t node = node_of(source);
+    if (node == kNoNode) return {};
+    std::vector<EntityId> out;
+    out.reserve(out_[node].size());
+    for (uint32_t dep : out_[node]) out.push_back(ids_[dep]);
+    return out;
 }
 
 std::vector<EntityId> DependencyGraph::sourcesOf(EntityId dependent) const {
-    auto it = reverse_.find(dependent);
-    if (it == reverse_.end()) return {};
-    return {it->second.begin(), it->second.end()};
+    const uint32_t node = node_of(dependent);
+    if (node == kNoNode) return {};
+    std::vector<EntityId> out;
+    out.reserve(in_[node].size());
+    for (uint32_t src : in_[node]) out.push_back(ids_[src]);
+    return out;
 }
 
 bool DependencyGraph::wouldCycle(EntityId source, EntityId dependent) const {
     if (source == dependent) return true;
-    // BFS from dependent through forward edges; if we reach source, it's a cycle
-    std::unordered_set<EntityId> visited;
-    std::vector<EntityId> queue = {dependent};
-    while (!queue.empty()) {
-        EntityId curr = queue.back();
-        queue.pop_back();
-        if (curr == source) return true;
-        if (!visited.insert(curr).second) continue;
-        auto it = forward_.find(curr);
-        if (it != forward_.end()) {
-            for (EntityId next : it->second) queue.push_back(next);
+    const uint32_t s = node_of(source);
+    const uint32_t d = node_of(dependent);
+    if (s == kNoNode || d == kNoNode) return false;
+    // Paths only climb the order, so nothing ordered past `source` can
+    // reach it. (Reads the edit lists, not the CSR copy, so that concurrent
+    // const callers never rebuild shared state.)
+    if (order_valid_ && ord_[d] > ord_[s]) return false;
+    std::unordered_set<uint32_t> visited{d};
+    std::vector<uint32_t> stack{d};
+    while (!stack.empty()) {
+        const uint32_t curr = stack.back();
+        stack.pop_back();
+        if (curr == s) return true;
+        for (uint32_t next : out_[curr]) {
+            if (order_valid_ && ord_[next] > ord_[s]) continue;
+            if (visited.insert(next).second) stack.push_back(next);
         }
     }
     return false;
 }
 
-std::vector<EntityId> DependencyGraph::topologicalOrder(const std::vector<EntityId>& roots, bool* hasCycle) const {
+std::vector<uint32_t> DependencyGraph::ordered_downstream(const std::vector<uint32_t>& roots, bool* hasCycle) const {
     if (hasCycle) *hasCycle = false;
-
-    // BFS to collect all reachable entities from roots (downstream)
-    std::unordered_set<EntityId> reachable;
-    {
-        std::vector<EntityId> queue = roots;
-        while (!queue.empty()) {
-            EntityId curr = queue.back();
-            queue.pop_back();
-            if (!reachable.insert(curr).second) continue;
-            auto it = forward_.find(curr);
-            if (it != forward_.end()) {
-                for (EntityId next : it->second) queue.push_back(next);
+    build_csr();
+    const bool ordered = order_valid_ || restore_order();
+
+    std::vector<uint8_t> reached(ids_.size(), 0);
+    std::vector<uint32_t> nodes;
+    for (uint32_t root : roots) {
+        if (reached[root]) continue;
+        reached[root] = 1;
+        nodes.push_back(root);
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const uint32_t curr = nodes[i];
+        for (uint32_t e = out_offsets_[curr]; e < out_offsets_[curr + 1]; ++e) {
+            const uint32_t next = out_targets_[e];
+            if (!reached[next]) {
+                reached[next] = 1;
+                nodes.push_back(next);
             }
         }
     }
+    if (ordered) {
+        std::sort(nodes.begin(), nodes.end(), [this](uint32_t a, uint32_t b) { return ord_[a] < ord_[b]; });
+        return nodes;
+    }
 
     // Kahn's algorithm on the reachable subgraph
-    std::unordered_map<EntityId, int> in_degree;
-    for (EntityId id : reachable) in_degree[id] = 0;
-    for (EntityId id : reachable) {
-        auto it = forward_.find(id);
-        if (it == forward_.end()) continue;
-        for (EntityId dep : it->second) {
-            if (reachable.count(dep)) in_degree[dep]++;
-        }
+    std::vector<uint32_t> in_degree(ids_.size(), 0);
+    for (uint32_t node : nodes) {
+        for (uint32_t e = out_offsets_[node]; e < out_offsets_[node + 1]; ++e) ++in_degree[out_targets_[e]];
     }
-
-    std::vector<EntityId> queue;
-    for (auto& [id, deg] : in_degree) {
-        if (deg == 0) queue.push_back(id);
+    std::vector<uint32_t> order;
+    order.reserve(nodes.size());
+    for (uint32_t node : nodes) {
+        if (in_degree[node] == 0) order.push_back(node);
     }
-
-    std::vector<EntityId> order;
-    order.reserve(reachable.size());
-    while (!queue.empty()) {
-        EntityId curr = queue.back();
-        queue.pop_back();
-        order.push_back(curr);
-        auto it = forward_.find(curr);
-        if (it == forward_.end()) continue;
-        for (EntityId dep : it->second) {
-            if (!reachable.count(dep)) continue;
-            if (--in_degree[dep] == 0) queue.push_back(dep);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const uint32_t curr = order[i];
+        for (uint32_t e = out_offsets_[curr]; e < out_offsets_[curr + 1]; ++e) {
+            if (--in_degree[out_targets_[e]] == 0) order.push_back(out_targets_[e]);
         }
     }
+    if (order.size() < nodes.size() && hasCycle) *hasCycle = true;
+    return order;
+}
 
-    if (order.size() < reachable.size() && hasCycle) {
-        *hasCycle = true;
+std::vector<EntityId> DependencyGraph::topologicalOrder(const std::vector<EntityId>& roots, bool* hasCycle) const {
+    // Roots outside the graph have no edges; they lead the order.
+    std::vector<EntityId> order;
+    std::vector<uint32_t> nodes;
+    std::unordered_set<EntityId> loose;
+    for (EntityId id : roots) {
+        const uint32_t node = node_of(id);
+        if (node != kNoNode) {
+            nodes.push_back(node);
+        } else if (loose.insert(id).second) {
+            order.push_back(id);
+        }
     }
+    for (uint32_t node : ordered_downstream(nodes, hasCycle)) order.push_back(ids_[node]);
     return order;
 }
 
 std::vector<EntityId> DependencyGraph::allEntities() const {
-    std::unordered_set<EntityId> ids;
-    for (auto& [k, v] : forward_) {
-        ids.insert(k);
-        for (EntityId d : v) ids.insert(d);
+    std::vector<EntityId> ids;
+    ids.reserve(index_.size());
+    for (uint32_t n = 0; n < ids_.size(); ++n) {
+        if (!out_[n].empty() || !in_[n].empty()) ids.push_back(ids_[n]);
     }
-    return {ids.begin(), ids.end()};
+    return ids;
 }
 
-size_t DependencyGraph::edgeCount() const {
-    size_t count = 0;
-    for (auto& [k, v] : forward_) count += v.size();
-    return count;
+bool DependencyGraph::acyclic() const {
+    return order_valid_ || restore_order();
 }
 
-int Document::recompute(const std::vector<EntityId>& changedIds) {
-    if (!recompute_cb_ || dep_graph_.empty()) return 0;
-    bool hasCycle = false;
-    auto order = dep_graph_.topologicalOrder(changedIds, &hasCycle);
+namespace {
+
+// Threads kept for the length of one recompute; the caller drains each round
+// too and returns once every thread has finished it.
+class RecomputeWorkers {
+public:
+    explicit RecomputeWorkers(size_t threads) {
+        threads_.reserve(threads);
+        for (size_t t = 0; t < threads; ++t) threads_.emplace_back([this] { loop(); });
+    }
+    ~RecomputeWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+    RecomputeWorkers(const RecomputeWorkers&) = delete;
+    RecomputeWorkers& operator=(const RecomputeWorkers&) = delete;
+
+    void run(size_t count, const std::function<void(size_t)>& work) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_ = &work;
+            count_ = count;
+            next_.store(0);
+            busy_ = threads_.size();
+            ++round_;
+        }
+        wake_.notify_all();
+        drain();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        work_ = nullptr;
+        if (error_) {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void loop() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [&] { return stopping_ || round_ != seen; });
+            if (stopping_) return;
+            seen = round_;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+
+    void drain() {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) {
+            try {
+                (*work_)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) error_ = std::current_exception();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* work_{nullptr};
+    size_t count_{0};
+    std::atomic<size_t> next_{0};
+    size_t busy_{0};
+    uint64_t round_{0};
+    bool stopping_{false};
+    std::exception_ptr error_{};
+};
+
+} // namespace
+
+void Document::refresh_read_caches() {
+    spatial_index();
+    meta_entries();
+    dep_graph_.build_csr();
+    dep_graph_.acyclic();
+}
+
+int Document::recompute_from(const std::vector<uint32_t>& roots, bool includeRoots) {
+    const DependencyGraph& graph = dep_graph_;
+    // Every reachable node appears once, so an entity with several changed
+    // sources still recomputes once.
+    const std::vector<uint32_t> order = graph.ordered_downstream(roots, nullptr);
+    std::vector<uint8_t> skip(graph.ids_.size(), 0);
+    if (!includeRoots) {
+        for (uint32_t root : roots) skip[root] = 1;
+    }
+
+    // Ids are copied out first: callbacks may edit the graph.
+    if (!parallel_recompute_cb_) {
+        std::vector<EntityId> ids;
+        ids.reserve(order.size());
+        for (uint32_t node : order) {
+            if (!skip[node]) ids.push_back(graph.ids_[node]);
+        }
+        for (EntityId id : ids) recompute_cb_(*this, id);
+        return static_cast<int>(ids.size());
+    }
+
+    // Level = longest path from a root within the affected set; a level only
+    // reads entities written by earlier levels.
+    std::vector<uint8_t> affected(graph.ids_.size(), 0);
+    for (uint32_t node : order) affected[node] = 1;
+    std::vector<uint32_t> level(graph.ids_.size(), 0);
+    std::vector<std::vector<EntityId>> levels;
+    for (uint32_t node : order) {
+        uint32_t l = 0;
+        for (uint32_t e = graph.in_offsets_[node]; e < graph.in_offsets_[node + 1]; ++e) {
+            const uint32_t src = graph.in_targets_[e];
+            if (affected[src]) l = std::max(l, level[src] + 1);
+        }
+        level[node] = l;
+        if (skip[node]) continue;
+        if (levels.size() <= l) levels.resize(l + 1);
+        levels[l].push_back(graph.ids_[node]);
+    }
+
+    size_t widest = 0;
+    for (const auto& ids : levels) widest = std::max(widest, ids.size());
+    size_t threads = recompute_threads_ > 0 ? static_cast<size_t>(recompute_threads_)
+                                            : std::thread::hardware_concurrency();
+    threads = std::min(std::max<size_t>(threads, 1), std::max<size_t>(widest, 1));
+    std::unique_ptr<RecomputeWorkers> workers;
+    if (threads > 1) workers = std::make_unique<RecomputeWorkers>(threads - 1);
+
+    const Document& reader = *this;
+    std::vector<RecomputeWrite> writes;
     int count = 0;
-    // Skip the root entities themselves (they already changed); recompute dependents only
-    std::unordered_set<EntityId> roots(changedIds.begin(), changedIds.end());
-    for (EntityId id : order) {
-        if (roots.count(id)) continue;
-        recompute_cb_(*this, id);
-        count++;
+    for (const auto& ids : levels) {
+        if (ids.empty()) continue;
+        writes.assign(ids.size(), RecomputeWrite{});
+        const std::function<void(size_t)> compute = [&](size_t i) {
+            writes[i] = parallel_recompute_cb_(reader, ids[i]);
+        };
+        if (workers && ids.size() > 1) {
+            // The previous level's writes may have left caches to rebuild.
+            refresh_read_caches();
+            workers->run(ids.size(), compute);
+        } else {
+            for (size_t i = 0; i < ids.size(); ++i) compute(i);
+        }
+        for (auto& write : writes) {
+            if (write) write(*this);
+        }
+        count += static_cast<int>(ids.size());
     }
     return count;
 }
 
+int Document::recompute(const std::vector<EntityId>& changedIds) {
+    if ((!recompute_cb_ && !parallel_recompute_cb_) || dep_graph_.empty()) return 0;
+    std::vector<uint32_t> roots;
+    roots.reserve(changedIds.size());
+    for (EntityId id : changedIds) {
+        const uint32_t node = dep_graph_.node_of(id);
+        if (node != DependencyGraph::kNoNode) roots.push_back(node);
+    }
+    if (roots.empty()) return 0;
+    // Skip the root entities themselves (they already changed); recompute dependents only
+    return recompute_from(roots, false);
+}
+
 int Document::recompute_all() {
-    if (!recompute_cb_ || dep_graph_.empty()) return 0;
-    auto all = dep_graph_.allEntities();
+    if ((!recompute_cb_ && !parallel_recompute_cb_) || dep_graph_.empty()) return 0;
     // Find root entities (no sources)
-    std::vector<EntityId> roots;
-    for (EntityId id : all) {
-        if (dep_graph_.sourcesOf(id).empty()) roots.push_back(id);
+    std::vector<uint32_t> roots;
+    for (const auto& [id, node] : dep_graph_.index_) {
+        if (dep_graph_.in_[node].empty()) roots.push_back(node);
     }
     if (roots.empty()) return 0;
-    bool hasCycle = false;
-    auto order = dep_graph_.topologicalOrder(roots, &hasCycle);
-    int count = 0;
-    for (EntityId id : order) {
-        recompute_cb_(*this, id);
-        count++;
+    std::sort(roots.begin(), roots.end());
+    return recompute_from(roots, true);
+}
+
+// --- Constraint table ---
+
+namespace {
+
+const Vec2* list_point(const std::vector<Vec2>& points, const ElementRef& ref) {
+    if (points.empty()) return nullptr;
+    switch (ref.role) {
+        case PointRole::Start: return &points.front();
+        case PointRole::End: return &points.back();
+        case PointRole::ControlPoint:
+            if (ref.index < 0 || static_cast<size_t>(ref.index) >= points.size()) return nullptr;
+            return &points[static_cast<size_t>(ref.index)];
+        default: return nullptr;
     }
-    return count;
+}
+
+const Vec2* role_point(const Entity& e, const ElementRef& ref) {
+    const PointRole role = ref.role;
+    if (const auto* pt = std::get_if<Point>(&e.payload)) {
+        const bool on = role == PointRole::None || role == PointRole::Start || role == PointRole::Center;
+        return on ? &pt->p : nullptr;
+    }
+    if (const auto* ln = std::get_if<Line>(&e.payload)) {
+        if (role == PointRole::Start) return &ln->a;
+        if (role == PointRole::End) return &ln->b;
+        return nullptr;
+    }
+    if (const auto* arc = std::get_if<Arc>(&e.payload)) return role == PointRole::Center ? &arc->center : nullptr;
+    if (const auto* circle = std::get_if<Circle>(&e.payload)) return role == PointRole::Center ? &circle->center : nullptr;
+    if (const auto* ellipse = std::get_if<Ellipse>(&e.payload)) return role == PointRole::Center ? &ellipse->center : nullptr;
+    if (const auto* pl = std::get_if<Polyline>(&e.payload)) return list_point(pl->points, ref);
+    if (const auto* spline = std::get_if<Spline>(&e.payload)) return list_point(spline->control_points, ref);
+    const bool anchor = role == PointRole::None || role == PointRole::Start;
+    if (const auto* text = std::get_if<Text>(&e.payload)) return anchor ? &text->pos : nullptr;
+    if (const auto* inst = std::get_if<BlockInstance>(&e.payload)) return anchor ? &inst->insertionPoint : nullptr;
+    return nullptr;
+}
+
+const char* point_role_prefix(PointRole role) {
+    switch (role) {
+        case PointRole::Start: return "start_";
+        case PointRole::End: return "end_";
+        case PointRole::Mid: return "mid_";
+        case PointRole::Center: return "center_";
+        case PointRole::ControlPoint: return "cp";
+        case PointRole::None:
+        default: return "";
+    }
+}
+
+// Inverse of the "<entity id>" / constraint_param_key() pair.
+bool parse_constraint_var(const std::string& id, const std::string& key, ConstraintParam* out) {
+    if (id.empty() || id[0] < '1' || id[0] > '9') return false;
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(id.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+    ConstraintParam param;
+    param.ref.id = static_cast<EntityId>(value);
+    if (key == "radius" || key == "start_angle" || key == "end_angle") {
+        param.field = key == "radius" ? ParamField::Radius
+                    : key == "start_angle" ? ParamField::StartAngle : ParamField::EndAngle;
+        *out = param;
+        return true;
+    }
+    if (key.empty() || (key.back() != 'x' && key.back() != 'y')) return false;
+    param.field = key.back() == 'x' ? ParamField::X : ParamField::Y;
+    const std::string prefix = key.substr(0, key.size() - 1);
+    const PointRole roles[] = {PointRole::None, PointRole::Start, PointRole::End, PointRole::Mid, PointRole::Center};
+    bool matched = false;
+    for (PointRole role : roles) {
+        if (prefix == point_role_prefix(role)) {
+            param.ref.role = role;
+            matched = true;
+            break;
+        }
+    }
+    if (!matched) {
+        // "cp<index>_"
+        if (prefix.size() < 4 || prefix.compare(0, 2, "cp") != 0 || prefix.back() != '_') return false;
+        const std::string digits = prefix.substr(2, prefix.size() - 3);
+        if (digits.empty() || digits.size() > 9 ||
+            digits.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        param.ref.role = PointRole::ControlPoint;
+        param.ref.index = std::atoi(digits.c_str());
+    }
+    *out = param;
+    return true;
+}
+
+std::vector<ConstraintSpec> constraint_specs(const std::vector<DocumentConstraint>& constraints) {
+    std::vector<ConstraintSpec> specs;
+    specs.reserve(constraints.size());
+    for (const auto& c : constraints) {
+        ConstraintSpec spec;
+        spec.type = c.type;
+        spec.value = c.value;
+        spec.vars.reserve(c.params.size());
+        for (const auto& param : c.params) {
+            spec.vars.push_back(VarRef{std::to_string(param.ref.id), constraint_param_key(param)});
+        }
+        specs.push_back(std::move(spec));
+    }
+    return specs;
+}
+
+// First write to each payload field during a solve, with its value before.
+struct FieldWrite {
+    EntityId entity;
+    double* slot;
+    double original;
+};
+
+// Solves `constraints` with their params bound to the entities
+// `entity_of(id)` returns (nullptr when missing); writes go straight into
+// those entities and are logged in `written`.
+template <typename EntityOf>
+SolveResult solve_bound_constraints(const std::vector<DocumentConstraint>& constraints, ISolver& solver,
+                                    EntityOf entity_of, std::vector<FieldWrite>& written) {
+    std::vector<ConstraintSpec> specs = constraint_specs(constraints);
+    auto field = [&](const VarRef& v, EntityId* entity) -> double* {
+        ConstraintParam param;
+        if (!parse_constraint_var(v.id, v.key, &param)) return nullptr;
+        Entity* e = entity_of(param.ref.id);
+        if (!e) return nullptr;
+        if (entity) *entity = param.ref.id;
+        return constraint_param_field(*e, param);
+    };
+    std::unordered_set<const double*> seen;
+    auto get = [&](const VarRef& v, bool& ok) -> double {
+        const double* slot = field(v, nullptr);
+        ok = slot != nullptr;
+        return ok ? *slot : 0.0;
+    };
+    auto set = [&](const VarRef& v, double value) {
+        EntityId entity = 0;
+        double* slot = field(v, &entity);
+        if (!slot) return;
+        if (seen.insert(slot).second) written.push_back(FieldWrite{entity, slot, *slot});
+        *slot = value;
+    };
+    return solver.solveWithBindings(specs, get, set);
+}
+
+// Entities whose fields ended up different, in first-write order, each with
+// its indices into `written`.
+std::vector<std::pair<EntityId, std::vector<size_t>>> moved_entities(const std::vector<FieldWrite>& written) {
+    std::vector<std::pair<EntityId, std::vector<size_t>>> moved;
+    std::unordered_map<EntityId, size_t> index;
+    for (size_t i = 0; i < written.size(); ++i) {
+        auto it = index.emplace(written[i].entity, moved.size()).first;
+        if (it->second == moved.size()) moved.emplace_back(written[i].entity, std::vector<size_t>{});
+        moved[it->second].second.push_back(i);
+    }
+    moved.erase(std::remove_if(moved.begin(), moved.end(), [&](const auto& entry) {
+        for (size_t i : entry.second) {
+            if (*written[i].slot != written[i].original) return false;
+        }
+        return true;
+    }), moved.end());
+    return moved;
+}
+
+} // namespace
+
+const double* constraint_param_field(const Entity& e, const ConstraintParam& param) {
+    switch (param.field) {
+        case ParamField::X:
+        case ParamField::Y: {
+            const Vec2* p = role_point(e, param.ref);
+            if (!p) return nullptr;
+            return param.field == ParamField::X ? &p->x : &p->y;
+        }
+        case ParamField::Radius:
+            if (const auto* circle = std::get_if<Circle>(&e.payload)) return &circle->radius;
+            if (const auto* arc = std::get_if<Arc>(&e.payload)) return &arc->radius;
+            return nullptr;
+        case ParamField::StartAngle:
+        case ParamField::EndAngle: {
+            const auto* arc = std::get_if<Arc>(&e.payload);
+            if (!arc) return nullptr;
+            return param.field == ParamField::StartAngle ? &arc->start_angle : &arc->end_angle;
+        }
+    }
+    return nullptr;
+}
+
+double* constraint_param_field(Entity& e, const ConstraintParam& param) {
+    return const_cast<double*>(constraint_param_field(static_cast<const Entity&>(e), param));
+}
+
+std::string constraint_param_key(const ConstraintParam& param) {
+    switch (param.field) {
+        case ParamField::Radius: return "radius";
+        case ParamField::StartAngle: return "start_angle";
+        case ParamField::EndAngle: return "end_angle";
+        case ParamField::X:
+        case ParamField::Y:
+            break;
+    }
+    std::string key = point_role_prefix(param.ref.role);
+    if (param.ref.role == PointRole::ControlPoint) key += std::to_string(param.ref.index) + "_";
+    key += param.field == ParamField::X ? "x" : "y";
+    return key;
+}
+
+ConstraintId Document::add_constraint(const std::string& type, std::vector<ConstraintParam> params,
+                                      std::optional<double> value) {
+    DocumentConstraint c;
+    c.id = next_constraint_id_++;
+    c.type = type;
+    c.params = std::move(params);
+    c.value = value;
+    constraints_.push_back(std::move(c));
+    constraints_snapshot_.reset();
+    ++constraint_revision_;
+    mark_changed();
+    return constraints_.back().id;
+}
+
+bool Document::remove_constraint(ConstraintId id) {
+    auto it = std::find_if(constraints_.begin(), constraints_.end(),
+                           [id](const DocumentConstraint& c) { return c.id == id; });
+    if (it == constraints_.end()) return false;
+    constraints_.erase(it);
+    constraints_snapshot_.reset();
+    ++constraint_revision_;
+    mark_changed();
+    return true;
+}
+
+const DocumentConstraint* Document::get_constraint(ConstraintId id) const {
+    for (const auto& c : constraints_) {
+        if (c.id == id) return &c;
+    }
+    return nullptr;
+}
+
+SolveResult Document::solve_constraints(ISolver& solver) {
+    // The slot lookup bypasses get_entity() so that reading alone marks
+    // nothing changed.
+    std::vector<FieldWrite> written;
+    SolveResult result = solve_bound_constraints(constraints_, solver, [this](EntityId id) -> Entity* {
+        const auto it = entity_slots_.find(id);
+        return it == entity_slots_.end() ? nullptr : &entities_[it->second];
+    }, written);
+
+    // One batch for every entity that ended up somewhere else. The original
+    // values go back in briefly so the transaction records them.
+    DocumentChangeGuard batch(*this);
+    std::vector<double> solved;
+    for (const auto& [id, fields] : moved_entities(written)) {
+        solved.clear();
+        for (size_t i : fields) {
+            solved.push_back(*written[i].slot);
+            *written[i].slot = written[i].original;
+        }
+        notify_before(DocumentChangeType::EntityGeometryChanged, id);
+        for (size_t k = 0; k < fields.size(); ++k) *written[fields[k]].slot = solved[k];
+        notify(DocumentChangeType::EntityGeometryChanged, id);
+    }
+    return result;
+}
+
+size_t Document::apply_constraint_solution(const ConstraintSolution& solution) {
+    DocumentChangeGuard batch(*this);
+    size_t applied = 0;
+    for (size_t i = 0; i < solution.ids.size() && i < solution.payloads.size(); ++i) {
+        const EntityId id = solution.ids[i];
+        const auto it = entity_slots_.find(id);
+        if (it == entity_slots_.end()) continue;
+        Entity& e = entities_[it->second];
+        if (e.payload.index() != solution.payloads[i].index()) continue;
+        notify_before(DocumentChangeType::EntityGeometryChanged, id);
+        e.payload = solution.payloads[i];
+        notify(DocumentChangeType::EntityGeometryChanged, id);
+        ++applied;
+    }
+    return applied;
+}
+
+bool Document::constraint_solution_current(const ConstraintSolution& solution) const {
+    if (solution.constraintRevision != constraint_revision_) return false;
+    for (size_t i = 0; i < solution.readIds.size() && i < solution.readPayloads.size(); ++i) {
+        const Entity* e = get_entity(solution.readIds[i]);
+        if (!e || !same_payload(e->payload, solution.readPayloads[i])) return false;
+    }
+    return true;
+}
+
+SolveResult DocumentSnapshot::solve_constraints(ISolver& solver, ConstraintSolution* solution) const {
+    // Entities are copied on first use; map nodes keep their addresses.
+    std::unordered_map<EntityId, Entity> copies;
+    std::vector<const Entity*> read;
+    std::vector<FieldWrite> written;
+    SolveResult result = solve_bound_constraints(constraints(), solver, [&](EntityId id) -> Entity* {
+        auto it = copies.find(id);
+        if (it == copies.end()) {
+            const Entity* e = get_entity(id);
+            if (!e) return nullptr;
+            it = copies.emplace(id, *e).first;
+            read.push_back(e);
+        }
+        return &it->second;
+    }, written);
+    if (solution) {
+        *solution = ConstraintSolution{};
+        solution->revision = revision_;
+        solution->constraintRevision = constraint_revision_;
+        solution->readIds.reserve(read.size());
+        solution->readPayloads.reserve(read.size());
+        for (const Entity* e : read) {
+            solution->readIds.push_back(e->id);
+            solution->readPayloads.push_back(e->payload);
+        }
+        for (const auto& entry : moved_entities(written)) {
+            solution->ids.push_back(entry.first);
+            solution->payloads.push_back(copies.at(entry.first).payload);
+        }
+    }
+    return result;
 }
 
 DocumentChangeGuard::DocumentChangeGuard(Document& doc) : doc_(&doc) {
@@ -896,152 +2433,230 @@ DocumentChangeGuard::~DocumentChangeGuard() {
 // --- Transaction-based undo/redo (P2.1) ---
 
 void Document::begin_transaction(const std::string& label) {
-    active_tx_storage_ = Transaction{label, {}};
+    active_tx_storage_ = Transaction{label, {}, 0};
     active_transaction_ = &active_tx_storage_;
 }
 
 void Document::commit_transaction() {
     if (!active_transaction_) return;
     if (!active_transaction_->diffs.empty()) {
+        active_tx_storage_.bytes = transaction_bytes(active_tx_storage_);
+        undo_bytes_ += active_tx_storage_.bytes;
         undo_stack_.push_back(std::move(active_tx_storage_));
+        for (const auto& tx : redo_stack_) undo_bytes_ -= tx.bytes;
         redo_stack_.clear(); // new transaction invalidates redo
+        enforce_undo_budget();
     }
+    active_tx_storage_ = Transaction{};
     active_transaction_ = nullptr;
 }
 
 void Document::rollback_transaction() {
     if (!active_transaction_) return;
-    // Apply diffs in reverse to restore original state
-    for (auto it = active_transaction_->diffs.rbegin(); it != active_transaction_->diffs.rend(); ++it) {
-        const auto& diff = *it;
-        if (diff.type == DocumentChangeType::EntityGeometryChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    ent.payload = diff.oldPayload;
-                    break;
-                }
-            }
-        } else if (diff.type == DocumentChangeType::EntityMetaChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    ent.visible = diff.oldEntity.visible;
-                    ent.color = diff.oldEntity.color;
-                    ent.groupId = diff.oldEntity.groupId;
-                    ent.line_type = diff.oldEntity.line_type;
-                    ent.line_weight = diff.oldEntity.line_weight;
-                    ent.line_type_scale = diff.oldEntity.line_type_scale;
-                    break;
-                }
-            }
-        } else if (diff.type == DocumentChangeType::LayerChanged) {
-            for (auto& layer : layers_) {
-                if (layer.id == diff.layerId) {
-                    layer = diff.oldLayer;
-                    break;
-                }
-            }
-        }
-    }
+    Transaction tx = std::move(active_tx_storage_);
+    active_tx_storage_ = Transaction{};
     active_transaction_ = nullptr;
+    // Restore the original state, including entities added or removed.
+    in_undo_redo_ = true;
+    apply_transaction(tx);
+    in_undo_redo_ = false;
 }
 
 bool Document::undo() {
     if (undo_stack_.empty()) return false;
-    in_undo_redo_ = true;
     Transaction tx = std::move(undo_stack_.back());
     undo_stack_.pop_back();
-    Transaction redo_tx{tx.label, {}};
-    // Apply diffs in reverse
-    for (auto it = tx.diffs.rbegin(); it != tx.diffs.rend(); ++it) {
-        const auto& diff = *it;
-        PropertyDiff redo_diff = diff;
-        if (diff.type == DocumentChangeType::EntityGeometryChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    redo_diff.oldPayload = ent.payload;
-                    ent.payload = diff.oldPayload;
-                    notify(DocumentChangeType::EntityGeometryChanged, ent.id);
-                    break;
-                }
-            }
-        } else if (diff.type == DocumentChangeType::EntityMetaChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    redo_diff.oldEntity = ent;
-                    ent.visible = diff.oldEntity.visible;
-                    ent.color = diff.oldEntity.color;
-                    ent.groupId = diff.oldEntity.groupId;
-                    ent.line_type = diff.oldEntity.line_type;
-                    ent.line_weight = diff.oldEntity.line_weight;
-                    ent.line_type_scale = diff.oldEntity.line_type_scale;
-                    notify(DocumentChangeType::EntityMetaChanged, ent.id);
-                    break;
-                }
-            }
-        } else if (diff.type == DocumentChangeType::LayerChanged) {
-            for (auto& layer : layers_) {
-                if (layer.id == diff.layerId) {
-                    redo_diff.oldLayer = layer;
-                    layer = diff.oldLayer;
-                    notify(DocumentChangeType::LayerChanged, 0, layer.id);
-                    break;
-                }
-            }
-        }
-        redo_tx.diffs.push_back(redo_diff);
-    }
-    redo_stack_.push_back(std::move(redo_tx));
+    undo_bytes_ -= tx.bytes;
+    in_undo_redo_ = true;
+    apply_transaction(tx);
     in_undo_redo_ = false;
+    tx.bytes = transaction_bytes(tx);
+    undo_bytes_ += tx.bytes;
+    redo_stack_.push_back(std::move(tx));
+    enforce_undo_budget();
     return true;
 }
 
 bool Document::redo() {
     if (redo_stack_.empty()) return false;
-    in_undo_redo_ = true;
     Transaction tx = std::move(redo_stack_.back());
     redo_stack_.pop_back();
-    Transaction undo_tx{tx.label, {}};
-    for (auto it = tx.diffs.rbegin(); it != tx.diffs.rend(); ++it) {
-        const auto& diff = *it;
-        PropertyDiff undo_diff = diff;
-        if (diff.type == DocumentChangeType::EntityGeometryChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    undo_diff.oldPayload = ent.payload;
-                    ent.payload = diff.oldPayload;
-                    notify(DocumentChangeType::EntityGeometryChanged, ent.id);
-                    break;
-                }
-            }
-        } else if (diff.type == DocumentChangeType::EntityMetaChanged) {
-            for (auto& ent : entities_) {
-                if (ent.id == diff.entityId) {
-                    undo_diff.oldEntity = ent;
-                    ent.visible = diff.oldEntity.visible;
-                    ent.color = diff.oldEntity.color;
-                    ent.groupId = diff.oldEntity.groupId;
-                    ent.line_type = diff.oldEntity.line_type;
-                    ent.line_weight = diff.oldEntity.line_weight;
-                    ent.line_type_scale = diff.oldEntity.line_type_scale;
-                    notify(DocumentChangeType::EntityMetaChanged, ent.id);
-                    break;
-                }
+    undo_bytes_ -= tx.bytes;
+    in_undo_redo_ = true;
+    apply_transaction(tx);
+    in_undo_redo_ = false;
+    tx.bytes = transaction_bytes(tx);
+    undo_bytes_ += tx.bytes;
+    undo_stack_.push_back(std::move(tx));
+    enforce_undo_budget();
+    return true;
+}
+
+void Document::set_undo_byte_budget(size_t bytes) {
+    undo_byte_budget_ = bytes;
+    enforce_undo_budget();
+}
+
+// Applies the diffs last-to-first and reverses their order, so applying the
+// result again walks them back the other way.
+void Document::apply_transaction(Transaction& tx) {
+    std::reverse(tx.diffs.begin(), tx.diffs.end());
+    for (auto& diff : tx.diffs) apply_diff(diff);
+}
+
+void Document::apply_diff(PropertyDiff& diff) {
+    switch (diff.type) {
+        case DocumentChangeType::EntityGeometryChanged: {
+            auto* ent = get_entity(diff.entityId);
+            if (!ent) return;
+            if (diff.pointsDelta) {
+                auto* pl = std::get_if<Polyline>(&ent->payload);
+                if (!pl || diff.pointsOffset + diff.points.size() > pl->points.size()) return;
+                std::swap_ranges(diff.points.begin(), diff.points.end(),
+                                 pl->points.begin() + static_cast<std::ptrdiff_t>(diff.pointsOffset));
+            } else {
+                std::swap(ent->payload, diff.oldPayload);
+                ent->type = entity_type_for_payload(ent->payload, ent->type);
             }
-        } else if (diff.type == DocumentChangeType::LayerChanged) {
-            for (auto& layer : layers_) {
-                if (layer.id == diff.layerId) {
-                    undo_diff.oldLayer = layer;
-                    layer = diff.oldLayer;
-                    notify(DocumentChangeType::LayerChanged, 0, layer.id);
-                    break;
-                }
+            notify(DocumentChangeType::EntityGeometryChanged, ent->id);
+            return;
+        }
+        case DocumentChangeType::EntityMetaChanged: {
+            auto* ent = get_entity(diff.entityId);
+            if (!ent) return;
+            auto& props = diff.oldProps;
+            std::swap(ent->visible, props.visible);
+            std::swap(ent->groupId, props.groupId);
+            std::swap(ent->color, props.color);
+            std::swap(ent->line_type, props.line_type);
+            std::swap(ent->line_weight, props.line_weight);
+            std::swap(ent->line_type_scale, props.line_type_scale);
+            notify(DocumentChangeType::EntityMetaChanged, ent->id);
+            return;
+        }
+        case DocumentChangeType::LayerChanged: {
+            auto* layer = get_layer(diff.layerId);
+            if (!layer) return;
+            std::swap(*layer, diff.oldLayer);
+            notify(DocumentChangeType::LayerChanged, 0, layer->id);
+            return;
+        }
+        case DocumentChangeType::EntityAdded:
+        case DocumentChangeType::EntityRemoved: {
+            if (diff.entity) {
+                restore_entity(std::move(diff.entity), diff.slot, diff.slotEpoch);
+                notify(DocumentChangeType::EntityAdded, diff.entityId);
+                return;
             }
+            auto it = entity_slots_.find(diff.entityId);
+            if (it == entity_slots_.end()) return;
+            diff.slot = it->second;
+            diff.slotEpoch = entity_slot_epoch_;
+            diff.entity = std::make_unique<Entity>(std::move(entities_[it->second]));
+            entities_[it->second] = Entity{};
+            entity_slots_.erase(it);
+            ++entity_tombstones_;
+            compact_entities_if_sparse();
+            notify(DocumentChangeType::EntityRemoved, diff.entityId);
+            return;
         }
-        undo_tx.diffs.push_back(undo_diff);
+        default:
+            return;
+    }
+}
+
+// Puts a removed entity back where it was: into its old tombstone when storage
+// has not been compacted since, otherwise at its id-ordered position.
+void Document::restore_entity(std::unique_ptr<Entity> entity, size_t slot, uint64_t slotEpoch) {
+    const EntityId id = entity->id;
+    if (slotEpoch == entity_slot_epoch_ && slot < entities_.size() && entities_[slot].id == 0) {
+        entities_[slot] = std::move(*entity);
+        entity_slots_[id] = slot;
+        --entity_tombstones_;
+        return;
+    }
+    compact_entities();
+    if (entities_.empty() || entities_.back().id < id) {
+        push_entity(std::move(*entity));
+        return;
+    }
+    auto pos = std::lower_bound(entities_.begin(), entities_.end(), id,
+                                [](const Entity& e, EntityId value) { return e.id < value; });
+    const auto index = static_cast<size_t>(pos - entities_.begin());
+    entities_.insert(pos, std::move(*entity));
+    for (size_t i = index; i < entities_.size(); ++i) entity_slots_[entities_[i].id] = i;
+    ++entity_slot_epoch_;
+}
+
+void Document::record_added(EntityId id) {
+    if (!active_transaction_ || in_undo_redo_ || id == 0) return;
+    PropertyDiff diff;
+    diff.type = DocumentChangeType::EntityAdded;
+    diff.entityId = id;
+    active_transaction_->diffs.push_back(std::move(diff));
+}
+
+// Reduces a polyline geometry diff to the vertex range that actually changed.
+void Document::compress_geometry_diff(PropertyDiff& diff) const {
+    if (diff.pointsDelta) return;
+    const auto* before = std::get_if<Polyline>(&diff.oldPayload);
+    const auto* ent = get_entity(diff.entityId);
+    const auto* after = ent ? std::get_if<Polyline>(&ent->payload) : nullptr;
+    if (!before || !after || before->points.size() != after->points.size()) return;
+    const auto& a = before->points;
+    const auto& b = after->points;
+    auto same = [](const Vec2& p, const Vec2& q) { return p.x == q.x && p.y == q.y; };
+    size_t first = 0;
+    while (first < a.size() && same(a[first], b[first])) ++first;
+    size_t last = a.size();
+    while (last > first && same(a[last - 1], b[last - 1])) --last;
+    diff.pointsDelta = true;
+    diff.pointsOffset = first;
+    diff.points.assign(a.begin() + static_cast<std::ptrdiff_t>(first), a.begin() + static_cast<std::ptrdiff_t>(last));
+    diff.oldPayload = std::monostate{};
+}
+
+namespace {
+
+size_t payload_heap_bytes(const EntityPayload& payload) {
+    if (const auto* pl = std::get_if<Polyline>(&payload)) return pl->points.capacity() * sizeof(Vec2);
+    if (const auto* sp = std::get_if<Spline>(&payload)) {
+        return sp->control_points.capacity() * sizeof(Vec2) + sp->knots.capacity() * sizeof(double);
+    }
+    if (const auto* t = std::get_if<Text>(&payload)) return t->text.capacity();
+    if (const auto* bi = std::get_if<BlockInstance>(&payload)) return bi->blockName.capacity();
+    return 0;
+}
+
+} // namespace
+
+size_t Document::transaction_bytes(const Transaction& tx) const {
+    size_t bytes = sizeof(Transaction) + tx.label.capacity() + tx.diffs.capacity() * sizeof(PropertyDiff);
+    for (const auto& diff : tx.diffs) {
+        bytes += payload_heap_bytes(diff.oldPayload);
+        bytes += diff.points.capacity() * sizeof(Vec2);
+        bytes += diff.oldProps.line_type.capacity() + diff.oldLayer.name.capacity();
+        if (diff.entity) {
+            bytes += sizeof(Entity) + payload_heap_bytes(diff.entity->payload) + diff.entity->name.capacity() +
+                     diff.entity->line_type.capacity();
+        }
+    }
+    return bytes;
+}
+
+void Document::enforce_undo_budget() {
+    if (undo_byte_budget_ == 0) return;
+    // Oldest undo steps go first, keeping the most recent one.
+    while (undo_bytes_ > undo_byte_budget_ && undo_stack_.size() > 1) {
+        undo_bytes_ -= undo_stack_.front().bytes;
+        undo_stack_.pop_front();
+    }
+    // Then the redo steps farthest from the current state.
+    while (undo_bytes_ > undo_byte_budget_ && !redo_stack_.empty() &&
+           undo_stack_.size() + redo_stack_.size() > 1) {
+        undo_bytes_ -= redo_stack_.front().bytes;
+        redo_stack_.pop_front();
     }
-    undo_stack_.push_back(std::move(undo_tx));
-    in_undo_redo_ = false;
-    return true;
 }
 
 bool Document::can_undo() const { return !undo_stack_.empty(); }
@@ -1,12 +1,21 @@
 #include "core/solver.hpp"
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <sstream>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <unordered_set>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 namespace core {
 
@@ -84,6 +93,26 @@ const char* constraintStructuralStateName(ConstraintStructuralState state) {
     }
 }
 
+const char* presolveActionName(PresolveAction action) {
+    switch (action) {
+        case PresolveAction::Aliased: return "aliased";
+        case PresolveAction::Fixed: return "fixed";
+        case PresolveAction::Substituted: return "substituted";
+        case PresolveAction::Satisfied:
+        default: return "satisfied";
+    }
+}
+
+const char* solverAlgorithmName(SolverAlgorithm algo) {
+    switch (algo) {
+        case SolverAlgorithm::LM: return "lm";
+        case SolverAlgorithm::DogLeg: return "dogleg";
+        case SolverAlgorithm::BFGS: return "bfgs";
+        case SolverAlgorithm::Portfolio:
+        default: return "portfolio";
+    }
+}
+
 namespace {
 
 struct ConstraintValidationReport {
@@ -520,6 +549,29 @@ bool needs_xy_expansion(const std::string& type) {
         || type == "coincident" || type == "concentric";
 }
 
+// Expands each 2D constraint into its x (value 0) and y (value 1) rows.
+// `origin`, when given, receives the input index of each output row.
+std::vector<ConstraintSpec> expand_xy_constraints(const std::vector<ConstraintSpec>& constraints,
+                                                  std::vector<int>* origin = nullptr) {
+    std::vector<ConstraintSpec> expanded;
+    expanded.reserve(constraints.size());
+    if (origin) origin->clear();
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        const ConstraintSpec& c = constraints[i];
+        if (needs_xy_expansion(c.type)) {
+            ConstraintSpec cx = c; cx.value = 0.0; // x-component
+            ConstraintSpec cy = c; cy.value = 1.0; // y-component
+            expanded.push_back(cx);
+            expanded.push_back(cy);
+            if (origin) origin->insert(origin->end(), 2, static_cast<int>(i));
+        } else {
+            expanded.push_back(c);
+            if (origin) origin->push_back(static_cast<int>(i));
+        }
+    }
+    return expanded;
+}
+
 bool has_numeric_residual_implementation(ConstraintKind kind) {
     switch (kind) {
         case ConstraintKind::Horizontal:
@@ -573,15 +625,12 @@ VarRef parse_var_ref(const std::string& key) {
     return VarRef{key.substr(0, split), key.substr(split + 1)};
 }
 
+// Unique refs in first-use order.
 std::vector<VarRef> collect_unique_vars(const std::vector<ConstraintSpec>& constraints) {
     std::vector<VarRef> vars;
+    std::unordered_set<std::string> seen;
     auto add_unique = [&](const VarRef& v) {
-        for (const auto& existing : vars) {
-            if (existing.id == v.id && existing.key == v.key) {
-                return;
-            }
-        }
-        vars.push_back(v);
+        if (seen.insert(format_var_ref(v)).second) vars.push_back(v);
     };
     for (const auto& constraint : constraints) {
         for (const auto& var : constraint.vars) {
@@ -594,6 +643,8 @@ std::vector<VarRef> collect_unique_vars(const std::vector<ConstraintSpec>& const
 struct SubstitutionResult {
     std::vector<ConstraintSpec> reduced;
     std::unordered_map<std::string, std::string> redirect;
+    std::vector<int> reducedRows; // input index of each reduced constraint
+    std::vector<int> aliasedRows; // input indices merged away as aliases
 };
 
 class VarUnionFind {
@@ -666,6 +717,7 @@ SubstitutionResult build_substitutions(const std::vector<ConstraintSpec>& constr
         if (!try_extract_alias_pair(constraints[i], &lhs, &rhs)) continue;
         uf.unite(lhs, rhs);
         consumed[i] = 1;
+        result.aliasedRows.push_back(static_cast<int>(i));
     }
 
     std::vector<std::string> keys;
@@ -682,9 +734,11 @@ SubstitutionResult build_substitutions(const std::vector<ConstraintSpec>& constr
     }
 
     result.reduced.reserve(constraints.size());
+    result.reducedRows.reserve(constraints.size());
     for (size_t i = 0; i < constraints.size(); ++i) {
         if (consumed[i]) continue;
         result.reduced.push_back(apply_redirects(constraints[i], result.redirect));
+        result.reducedRows.push_back(static_cast<int>(i));
     }
     return result;
 }
@@ -838,12 +892,115 @@ ConstraintValidationReport validate_constraints(const std::vector<ConstraintSpec
     return report;
 }
 
-template <typename ResidualFn>
+using AnalysisJacobian = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+using SparseVector = std::vector<std::pair<int, double>>;
+
+// Exact Jacobian of `rows` over `vars`; defined with ConstraintProgram below.
+AnalysisJacobian analysis_jacobian(const std::vector<ConstraintSpec>& constraints,
+                                   const std::vector<int>& rows,
+                                   const std::vector<VarRef>& vars,
+                                   const ISolver::GetVar& get,
+                                   const ISolver::SetVar& set);
+
+// Greedy basis of sparse vectors in insertion order: add() reduces a vector
+// against the accepted ones (sparse row echelon form) and accepts it when a
+// pivot well above rounding is left. One pass yields the rank and the same
+// basis as re-factorizing every growing candidate set. Among numerically
+// acceptable pivots it takes the coordinate the fewest of the `upcoming`
+// vectors still use (Markowitz-style): pivoting on a coordinate later vectors
+// share drags every free coordinate seen so far into them, which is quadratic
+// fill on long underconstrained chains.
+class IncrementalEchelon {
+public:
+    IncrementalEchelon(int dim, const std::vector<SparseVector>& upcoming)
+        : pivotOf_(dim, -1), remaining_(dim, 0), work_(dim, 0.0), touched_(dim, 0) {
+        for (const SparseVector& v : upcoming) {
+            for (const auto& entry : v) ++remaining_[entry.first];
+        }
+    }
+
+    int rank() const { return static_cast<int>(pivots_.size()); }
+
+    bool add(const SparseVector& v) {
+        constexpr double kRelativeTolerance = 1e-10;
+        constexpr double kPivotThreshold = 0.1; // of the largest candidate
+        std::vector<int> nonzeros;
+        std::priority_queue<int, std::vector<int>, std::greater<int>> queue;
+        double scale = 0.0;
+        auto touch = [&](int col) {
+            if (touched_[col]) return;
+            touched_[col] = 1;
+            nonzeros.push_back(col);
+            const int pivot = pivotOf_[col];
+            if (pivot >= 0) queue.push(pivot);
+        };
+        for (const auto& entry : v) {
+            touch(entry.first);
+            work_[entry.first] += entry.second;
+            scale = std::max(scale, std::abs(entry.second));
+            --remaining_[entry.first];
+        }
+        // Pivot k's row is zero in the columns of pivots < k, so eliminating
+        // in increasing pivot order never revisits a column (each pivot is
+        // queued once, when its column is first touched).
+        while (!queue.empty()) {
+            const int k = queue.top();
+            queue.pop();
+            const Pivot& pivot = pivots_[static_cast<size_t>(k)];
+            const double factor = work_[pivot.col];
+            if (factor == 0.0) continue;
+            for (const auto& entry : pivot.row) {
+                touch(entry.first);
+                work_[entry.first] -= factor * entry.second;
+            }
+            work_[pivot.col] = 0.0;
+        }
+        double largest = 0.0;
+        for (int col : nonzeros) {
+            if (pivotOf_[col] < 0) largest = std::max(largest, std::abs(work_[col]));
+        }
+        int best = -1;
+        for (int col : nonzeros) {
+            if (pivotOf_[col] >= 0 || std::abs(work_[col]) < kPivotThreshold * largest) continue;
+            if (best < 0 || remaining_[col] < remaining_[best]
+                || (remaining_[col] == remaining_[best] && std::abs(work_[col]) > std::abs(work_[best]))) {
+                best = col;
+            }
+        }
+        const bool independent = best >= 0 && largest > kRelativeTolerance * scale;
+        if (independent) {
+            Pivot pivot;
+            pivot.col = best;
+            const double inv = 1.0 / work_[best];
+            for (int col : nonzeros) {
+                if (work_[col] != 0.0 && pivotOf_[col] < 0) pivot.row.emplace_back(col, work_[col] * inv);
+            }
+            pivotOf_[best] = static_cast<int>(pivots_.size());
+            pivots_.push_back(std::move(pivot));
+        }
+        for (int col : nonzeros) {
+            work_[col] = 0.0;
+            touched_[col] = 0;
+        }
+        return independent;
+    }
+
+private:
+    struct Pivot {
+        int col{-1};
+        SparseVector row; // scaled to 1 at `col`
+    };
+    std::vector<Pivot> pivots_;
+    std::vector<int> pivotOf_;
+    std::vector<int> remaining_; // uses by vectors not added yet
+    std::vector<double> work_;
+    std::vector<char> touched_;
+};
+
 void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
                                 const std::vector<VarRef>& vars,
+                                const ISolver::GetVar& get,
                                 const ISolver::SetVar& set,
-                                const Eigen::VectorXd& x,
-                                const ResidualFn& residual,
                                 ConstraintAnalysis& analysis,
                                 std::vector<ConstraintStructuralGroup>* structural_groups,
                                 std::vector<ConstraintRedundancySubset>* redundancy_subsets) {
@@ -862,34 +1019,8 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
         return;
     }
 
-    const double eps = 1e-6;
-    Eigen::VectorXd rvec(evaluable.size());
-    Eigen::MatrixXd J(evaluable.size(), vars.size());
-    for (size_t row = 0; row < evaluable.size(); ++row) {
-        bool okc = false;
-        rvec[row] = residual(constraints[evaluable[row]], okc);
-    }
-    for (size_t j = 0; j < vars.size(); ++j) {
-        const double xj = x[j];
-        set(vars[j], xj + eps);
-        for (size_t row = 0; row < evaluable.size(); ++row) {
-            bool okc = false;
-            const double r2 = residual(constraints[evaluable[row]], okc);
-            J(row, j) = (r2 - rvec[row]) / eps;
-        }
-        set(vars[j], xj);
-    }
-
-    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(J);
-    analysis.jacobianRank = static_cast<int>(qr.rank());
-    analysis.dofEstimate = std::max(0, analysis.jacobianColumnCount - analysis.jacobianRank);
-    analysis.redundantConstraintEstimate = std::max(0, analysis.jacobianRowCount - analysis.jacobianRank);
-    analysis.structuralState = classify_structural_state(
-        analysis.dofEstimate,
-        analysis.redundantConstraintEstimate,
-        !evaluable.empty());
-
-    if (!structural_groups && !redundancy_subsets) return;
+    const std::vector<int> rows(evaluable.begin(), evaluable.end());
+    const AnalysisJacobian J = analysis_jacobian(constraints, rows, vars, get, set);
 
     std::unordered_map<std::string, int> var_to_col;
     var_to_col.reserve(vars.size());
@@ -913,6 +1044,10 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
         }
     }
 
+    // The Jacobian is block diagonal over the connected components of its
+    // row/column graph, so the rank is the sum of the blocks' ranks.
+    int total_rank = 0;
+    std::vector<int> local_col_of(vars.size(), -1);
     std::vector<bool> visited_rows(evaluable.size(), false);
     std::vector<bool> visited_cols(vars.size(), false);
     for (size_t start_row = 0; start_row < evaluable.size(); ++start_row) {
@@ -950,19 +1085,35 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
         if (component_rows.empty()) continue;
         std::sort(component_rows.begin(), component_rows.end());
         std::sort(component_cols.begin(), component_cols.end());
+        for (size_t local_col = 0; local_col < component_cols.size(); ++local_col) {
+            local_col_of[static_cast<size_t>(component_cols[local_col])] = static_cast<int>(local_col);
+        }
 
-        Eigen::MatrixXd local_j(component_rows.size(), component_cols.size());
+        // Rows of the block in local column numbering, and its columns.
+        std::vector<SparseVector> local_rows(component_rows.size());
+        std::vector<SparseVector> local_cols(component_cols.size());
         for (size_t local_row = 0; local_row < component_rows.size(); ++local_row) {
-            for (size_t local_col = 0; local_col < component_cols.size(); ++local_col) {
-                local_j(local_row, local_col) = J(component_rows[local_row], component_cols[local_col]);
+            for (AnalysisJacobian::InnerIterator it(J, component_rows[local_row]); it; ++it) {
+                if (it.value() == 0.0) continue;
+                const int local_col = local_col_of[static_cast<size_t>(it.col())];
+                local_rows[local_row].emplace_back(local_col, it.value());
+                local_cols[static_cast<size_t>(local_col)].emplace_back(static_cast<int>(local_row), it.value());
             }
         }
 
-        Eigen::FullPivLU<Eigen::MatrixXd> local_lu(local_j);
+        // Greedy row basis in constraint order: its size is the block rank.
+        IncrementalEchelon row_basis(static_cast<int>(component_cols.size()), local_rows);
+        std::vector<char> row_independent(component_rows.size(), 0);
+        for (size_t local_row = 0; local_row < component_rows.size(); ++local_row) {
+            row_independent[local_row] = row_basis.add(local_rows[local_row]) ? 1 : 0;
+        }
+        total_rank += row_basis.rank();
+        if (!structural_groups && !redundancy_subsets) continue;
+
         ConstraintStructuralGroup group;
         group.jacobianRowCount = static_cast<int>(component_rows.size());
         group.jacobianColumnCount = static_cast<int>(component_cols.size());
-        group.jacobianRank = static_cast<int>(local_lu.rank());
+        group.jacobianRank = row_basis.rank();
         group.dofEstimate = std::max(0, group.jacobianColumnCount - group.jacobianRank);
         group.redundantConstraintEstimate = std::max(0, group.jacobianRowCount - group.jacobianRank);
         group.structuralState = classify_structural_state(
@@ -978,21 +1129,11 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
         for (int col : component_cols) {
             group.variableKeys.push_back(format_var_ref(vars[static_cast<size_t>(col)]));
         }
-        std::vector<int> basis_local_cols;
-        int current_col_rank = 0;
+        // Greedy column basis in variable order; the rest are free.
+        IncrementalEchelon col_basis(static_cast<int>(component_rows.size()), local_cols);
         for (size_t local_col = 0; local_col < component_cols.size(); ++local_col) {
-            Eigen::MatrixXd candidate(static_cast<int>(component_rows.size()),
-                                      static_cast<int>(basis_local_cols.size()) + 1);
-            for (size_t basis_index = 0; basis_index < basis_local_cols.size(); ++basis_index) {
-                candidate.col(static_cast<int>(basis_index)) = local_j.col(basis_local_cols[basis_index]);
-            }
-            candidate.col(static_cast<int>(basis_local_cols.size())) = local_j.col(static_cast<int>(local_col));
-            Eigen::FullPivLU<Eigen::MatrixXd> candidate_lu(candidate);
-            const int candidate_rank = static_cast<int>(candidate_lu.rank());
             const std::string variable_key = format_var_ref(vars[static_cast<size_t>(component_cols[local_col])]);
-            if (candidate_rank > current_col_rank) {
-                basis_local_cols.push_back(static_cast<int>(local_col));
-                current_col_rank = candidate_rank;
+            if (col_basis.add(local_cols[local_col])) {
                 group.basisVariableKeys.push_back(variable_key);
             } else {
                 group.freeVariableKeys.push_back(variable_key);
@@ -1010,22 +1151,9 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
             subset.variableKeys = group.variableKeys;
             subset.jacobianRank = group.jacobianRank;
             subset.structuralState = group.structuralState;
-
-            std::vector<int> basis_local_rows;
-            int current_rank = 0;
             for (size_t local_row = 0; local_row < component_rows.size(); ++local_row) {
-                Eigen::MatrixXd candidate(static_cast<int>(basis_local_rows.size()) + 1,
-                                          static_cast<int>(component_cols.size()));
-                for (size_t basis_index = 0; basis_index < basis_local_rows.size(); ++basis_index) {
-                    candidate.row(static_cast<int>(basis_index)) = local_j.row(basis_local_rows[basis_index]);
-                }
-                candidate.row(static_cast<int>(basis_local_rows.size())) = local_j.row(static_cast<int>(local_row));
-                Eigen::FullPivLU<Eigen::MatrixXd> candidate_lu(candidate);
-                const int candidate_rank = static_cast<int>(candidate_lu.rank());
                 const int constraint_index = static_cast<int>(evaluable[static_cast<size_t>(component_rows[local_row])]);
-                if (candidate_rank > current_rank) {
-                    basis_local_rows.push_back(static_cast<int>(local_row));
-                    current_rank = candidate_rank;
+                if (row_independent[local_row]) {
                     subset.basisConstraintIndices.push_back(constraint_index);
                 } else {
                     subset.redundantConstraintIndices.push_back(constraint_index);
@@ -1041,6 +1169,14 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
         }
     }
 
+    analysis.jacobianRank = total_rank;
+    analysis.dofEstimate = std::max(0, analysis.jacobianColumnCount - analysis.jacobianRank);
+    analysis.redundantConstraintEstimate = std::max(0, analysis.jacobianRowCount - analysis.jacobianRank);
+    analysis.structuralState = classify_structural_state(
+        analysis.dofEstimate,
+        analysis.redundantConstraintEstimate,
+        !evaluable.empty());
+
     if (structural_groups) {
         std::sort(structural_groups->begin(), structural_groups->end(),
                   [](const ConstraintStructuralGroup& a, const ConstraintStructuralGroup& b) {
@@ -1137,785 +1273,1351 @@ void populate_jacobian_analysis(const std::vector<ConstraintSpec>& constraints,
     }
 }
 
-// Shared residual evaluation for all solver implementations
-double residual_for_constraint(const ConstraintSpec& c, const ISolver::GetVar& get, bool& ok) {
-    ok = true;
-    if (c.type == "horizontal" && c.vars.size() >= 2) {
-        bool ok0=false, ok1=false;
-        double y0 = get(c.vars[0], ok0); double y1 = get(c.vars[1], ok1);
-        ok = ok0 && ok1; return ok ? (y1 - y0) : 0.0;
-    }
-    if (c.type == "vertical" && c.vars.size() >= 2) {
-        bool ok0=false, ok1=false;
-        double x0 = get(c.vars[0], ok0); double x1 = get(c.vars[1], ok1);
-        ok = ok0 && ok1; return ok ? (x1 - x0) : 0.0;
-    }
-    if (c.type == "distance" && c.vars.size() >= 4 && c.value.has_value()) {
-        bool ok0=false, ok1=false, ok2=false, ok3=false;
-        double x0 = get(c.vars[0], ok0), y0 = get(c.vars[1], ok1);
-        double x1 = get(c.vars[2], ok2), y1 = get(c.vars[3], ok3);
-        if (!(ok0&&ok1&&ok2&&ok3)) { ok=false; return 0.0; }
-        return std::sqrt((x1-x0)*(x1-x0) + (y1-y0)*(y1-y0)) - *c.value;
-    }
-    if (c.type == "parallel" && c.vars.size() >= 8) {
-        bool okv[8]; for (int i=0;i<8;++i) okv[i]=false;
-        double x0=get(c.vars[0],okv[0]),y0=get(c.vars[1],okv[1]),x1=get(c.vars[2],okv[2]),y1=get(c.vars[3],okv[3]);
-        double x2=get(c.vars[4],okv[4]),y2=get(c.vars[5],okv[5]),x3=get(c.vars[6],okv[6]),y3=get(c.vars[7],okv[7]);
-        for (int i=0;i<8;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double v1x=x1-x0,v1y=y1-y0,v2x=x3-x2,v2y=y3-y2;
-        double n1=std::sqrt(v1x*v1x+v1y*v1y),n2=std::sqrt(v2x*v2x+v2y*v2y);
-        if (n1==0||n2==0) return 0.0;
-        return (v1x*v2y-v1y*v2x)/(n1*n2);
-    }
-    if (c.type == "perpendicular" && c.vars.size() >= 8) {
-        bool okv[8]; for (int i=0;i<8;++i) okv[i]=false;
-        double x0=get(c.vars[0],okv[0]),y0=get(c.vars[1],okv[1]),x1=get(c.vars[2],okv[2]),y1=get(c.vars[3],okv[3]);
-        double x2=get(c.vars[4],okv[4]),y2=get(c.vars[5],okv[5]),x3=get(c.vars[6],okv[6]),y3=get(c.vars[7],okv[7]);
-        for (int i=0;i<8;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double v1x=x1-x0,v1y=y1-y0,v2x=x3-x2,v2y=y3-y2;
-        double n1=std::sqrt(v1x*v1x+v1y*v1y),n2=std::sqrt(v2x*v2x+v2y*v2y);
-        if (n1==0||n2==0) return 0.0;
-        return (v1x*v2x+v1y*v2y)/(n1*n2);
-    }
-    if (c.type == "equal" && c.vars.size() >= 2) {
-        bool ok0=false,ok1=false;
-        double a=get(c.vars[0],ok0),b=get(c.vars[1],ok1);
-        ok=ok0&&ok1; return ok?(a-b):0.0;
-    }
-    if (c.type == "coincident" && c.vars.size() >= 4) {
-        bool ok0=false,ok1=false,ok2=false,ok3=false;
-        double x0=get(c.vars[0],ok0),y0=get(c.vars[1],ok1),x1=get(c.vars[2],ok2),y1=get(c.vars[3],ok3);
-        if (!(ok0&&ok1&&ok2&&ok3)) { ok=false; return 0.0; }
-        return (c.value.has_value() && *c.value > 0.5) ? (y1-y0) : (x1-x0);
-    }
-    if (c.type == "concentric" && c.vars.size() >= 4) {
-        bool ok0=false,ok1=false,ok2=false,ok3=false;
-        double cx0=get(c.vars[0],ok0),cy0=get(c.vars[1],ok1),cx1=get(c.vars[2],ok2),cy1=get(c.vars[3],ok3);
-        if (!(ok0&&ok1&&ok2&&ok3)) { ok=false; return 0.0; }
-        return (c.value.has_value() && *c.value > 0.5) ? (cy1-cy0) : (cx1-cx0);
-    }
-    if (c.type == "angle" && c.vars.size() >= 8 && c.value.has_value()) {
-        bool okv[8]; for (int i=0;i<8;++i) okv[i]=false;
-        double x0=get(c.vars[0],okv[0]),y0=get(c.vars[1],okv[1]),x1=get(c.vars[2],okv[2]),y1=get(c.vars[3],okv[3]);
-        double x2=get(c.vars[4],okv[4]),y2=get(c.vars[5],okv[5]),x3=get(c.vars[6],okv[6]),y3=get(c.vars[7],okv[7]);
-        for (int i=0;i<8;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double v1x=x1-x0,v1y=y1-y0,v2x=x3-x2,v2y=y3-y2;
-        double n1=std::sqrt(v1x*v1x+v1y*v1y),n2=std::sqrt(v2x*v2x+v2y*v2y);
-        if (n1==0||n2==0) return 0.0;
-        double cosA=std::max(-1.0,std::min(1.0,(v1x*v2x+v1y*v2y)/(n1*n2)));
-        return std::acos(cosA)-*c.value;
-    }
-    if (c.type == "tangent" && c.vars.size() >= 6 && c.value.has_value()) {
-        bool okv[6]; for (int i=0;i<6;++i) okv[i]=false;
-        double p0x=get(c.vars[0],okv[0]),p0y=get(c.vars[1],okv[1]),p1x=get(c.vars[2],okv[2]),p1y=get(c.vars[3],okv[3]);
-        double cx=get(c.vars[4],okv[4]),cy=get(c.vars[5],okv[5]);
-        for (int i=0;i<6;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double dx=p1x-p0x,dy=p1y-p0y,len=std::sqrt(dx*dx+dy*dy);
-        if (len<1e-15) return 0.0;
-        return std::abs((cx-p0x)*dy-(cy-p0y)*dx)/len - *c.value;
-    }
-    if (c.type == "point_on_line" && c.vars.size() >= 6) {
-        bool okv[6]; for (int i=0;i<6;++i) okv[i]=false;
-        double px=get(c.vars[0],okv[0]),py=get(c.vars[1],okv[1]),ax=get(c.vars[2],okv[2]),ay=get(c.vars[3],okv[3]);
-        double bx=get(c.vars[4],okv[4]),by=get(c.vars[5],okv[5]);
-        for (int i=0;i<6;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double dx=bx-ax,dy=by-ay,len=std::sqrt(dx*dx+dy*dy);
-        if (len<1e-15) return 0.0;
-        return ((px-ax)*dy-(py-ay)*dx)/len;
-    }
-    if (c.type == "symmetric" && c.vars.size() >= 6) {
-        bool okv[6]; for (int i=0;i<6;++i) okv[i]=false;
-        double p1x=get(c.vars[0],okv[0]),p1y=get(c.vars[1],okv[1]),p2x=get(c.vars[2],okv[2]),p2y=get(c.vars[3],okv[3]);
-        double cx=get(c.vars[4],okv[4]),cy=get(c.vars[5],okv[5]);
-        for (int i=0;i<6;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double mx=(p1x+p2x)*0.5-cx, my=(p1y+p2y)*0.5-cy;
-        return (c.value.has_value() && *c.value > 0.5) ? my : mx;
-    }
-    if (c.type == "midpoint" && c.vars.size() >= 6) {
-        bool okv[6]; for (int i=0;i<6;++i) okv[i]=false;
-        double px=get(c.vars[0],okv[0]),py=get(c.vars[1],okv[1]),ax=get(c.vars[2],okv[2]),ay=get(c.vars[3],okv[3]);
-        double bx=get(c.vars[4],okv[4]),by=get(c.vars[5],okv[5]);
-        for (int i=0;i<6;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double dx=px-(ax+bx)*0.5, dy=py-(ay+by)*0.5;
-        return (c.value.has_value() && *c.value > 0.5) ? dy : dx;
-    }
-    if (c.type == "fixed_point" && c.vars.size() >= 2 && c.value.has_value()) {
-        bool ok0=false,ok1=false;
-        double val=get(c.vars[0],ok0); (void)get(c.vars[1],ok1);
-        ok=ok0&&ok1; if (!ok) return 0.0;
-        return val - *c.value;
-    }
-    // ─── Extended constraint types ───
-    if (c.type == "equal_length" && c.vars.size() >= 8) {
-        bool okv[8]; for (int i=0;i<8;++i) okv[i]=false;
-        double ax0=get(c.vars[0],okv[0]),ay0=get(c.vars[1],okv[1]),ax1=get(c.vars[2],okv[2]),ay1=get(c.vars[3],okv[3]);
-        double bx0=get(c.vars[4],okv[4]),by0=get(c.vars[5],okv[5]),bx1=get(c.vars[6],okv[6]),by1=get(c.vars[7],okv[7]);
-        for (int i=0;i<8;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double la=std::sqrt((ax1-ax0)*(ax1-ax0)+(ay1-ay0)*(ay1-ay0));
-        double lb=std::sqrt((bx1-bx0)*(bx1-bx0)+(by1-by0)*(by1-by0));
-        return la - lb;
-    }
-    if (c.type == "equal_radius" && c.vars.size() >= 2) {
-        bool ok0=false,ok1=false;
-        double r1=get(c.vars[0],ok0),r2=get(c.vars[1],ok1);
-        ok=ok0&&ok1; return ok?(r1-r2):0.0;
-    }
-    if (c.type == "point_on_circle" && c.vars.size() >= 5) {
-        bool okv[5]; for (int i=0;i<5;++i) okv[i]=false;
-        double px=get(c.vars[0],okv[0]),py=get(c.vars[1],okv[1]),cx=get(c.vars[2],okv[2]),cy=get(c.vars[3],okv[3]),r=get(c.vars[4],okv[4]);
-        for (int i=0;i<5;++i) if (!okv[i]) { ok=false; return 0.0; }
-        return std::sqrt((px-cx)*(px-cx)+(py-cy)*(py-cy)) - r;
-    }
-    if (c.type == "p2l_distance" && c.vars.size() >= 6 && c.value.has_value()) {
-        bool okv[6]; for (int i=0;i<6;++i) okv[i]=false;
-        double px=get(c.vars[0],okv[0]),py=get(c.vars[1],okv[1]),ax=get(c.vars[2],okv[2]),ay=get(c.vars[3],okv[3]);
-        double bx=get(c.vars[4],okv[4]),by=get(c.vars[5],okv[5]);
-        for (int i=0;i<6;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double dx=bx-ax,dy=by-ay,len=std::sqrt(dx*dx+dy*dy);
-        if (len<1e-15) return 0.0;
-        return ((px-ax)*dy-(py-ay)*dx)/len - *c.value;
-    }
-    if (c.type == "arc_angle" && c.vars.size() >= 2 && c.value.has_value()) {
-        bool ok0=false,ok1=false;
-        double startA=get(c.vars[0],ok0),endA=get(c.vars[1],ok1);
-        ok=ok0&&ok1; if (!ok) return 0.0;
-        return (endA - startA) - *c.value;
-    }
-    if (c.type == "length_ratio" && c.vars.size() >= 8 && c.value.has_value()) {
-        bool okv[8]; for (int i=0;i<8;++i) okv[i]=false;
-        double ax0=get(c.vars[0],okv[0]),ay0=get(c.vars[1],okv[1]),ax1=get(c.vars[2],okv[2]),ay1=get(c.vars[3],okv[3]);
-        double bx0=get(c.vars[4],okv[4]),by0=get(c.vars[5],okv[5]),bx1=get(c.vars[6],okv[6]),by1=get(c.vars[7],okv[7]);
-        for (int i=0;i<8;++i) if (!okv[i]) { ok=false; return 0.0; }
-        double la=std::sqrt((ax1-ax0)*(ax1-ax0)+(ay1-ay0)*(ay1-ay0));
-        double lb=std::sqrt((bx1-bx0)*(bx1-bx0)+(by1-by0)*(by1-by0));
-        if (lb < 1e-15) return 0.0;
-        return la/lb - *c.value;
-    }
-    ok = true; return 0.0;
-}
-
 // ---------------------------------------------------------------------------
-// Analytical Jacobian helpers – Batch A (8 linear/simple constraint types)
+// Residual kernels
 // ---------------------------------------------------------------------------
 
-// Returns true for the 8 constraint types that have analytical gradient support.
-bool has_analytical_gradient(const ConstraintSpec& c) {
-    const auto kind = classifyConstraintKind(c.type);
-    switch (kind) {
-        case ConstraintKind::Horizontal:
-        case ConstraintKind::Vertical:
-        case ConstraintKind::Equal:
-        case ConstraintKind::Coincident:
-        case ConstraintKind::Concentric:
-        case ConstraintKind::FixedPoint:
-        case ConstraintKind::Midpoint:
-        case ConstraintKind::Symmetric:
-            return true;
-        default:
-            return false;
-    }
+constexpr int kMaxOperands = 8; // largest expected_arity()
+
+// True when the spec carries everything its residual reads; anything else
+// (unknown type, short variable list, missing value) has a zero residual.
+bool has_residual_operands(const ConstraintSpec& c, ConstraintKind kind) {
+    const int arity = expected_arity(kind);
+    if (arity < 0 || static_cast<int>(c.vars.size()) < arity) return false;
+    return !requires_numeric_value(kind) || c.value.has_value();
+}
+
+// Expanded 2D rows (coincident, concentric, symmetric, midpoint) select the
+// y component with value > 0.5.
+bool is_y_component(const ConstraintSpec& c) {
+    return c.value.has_value() && *c.value > 0.5;
+}
+
+// Forward-mode dual number: a value and its partials with respect to the
+// operands of one row (slot k = d/dv[k]). Residuals are written once, as a
+// template, and evaluated on doubles or on duals for exact Jacobian entries.
+struct Dual {
+    double v{0.0};
+    double d[kMaxOperands] = {};
+
+    Dual() = default;
+    Dual(double value) : v(value) {} // constants mix in implicitly
+};
+
+inline Dual operator+(const Dual& a, const Dual& b) {
+    Dual r(a.v + b.v);
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = a.d[k] + b.d[k];
+    return r;
+}
+
+inline Dual operator-(const Dual& a, const Dual& b) {
+    Dual r(a.v - b.v);
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = a.d[k] - b.d[k];
+    return r;
+}
+
+inline Dual operator-(const Dual& a) {
+    Dual r(-a.v);
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = -a.d[k];
+    return r;
+}
+
+inline Dual operator*(const Dual& a, const Dual& b) {
+    Dual r(a.v * b.v);
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+    return r;
+}
+
+inline Dual operator/(const Dual& a, const Dual& b) {
+    Dual r(a.v / b.v);
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = (a.d[k] - r.v * b.d[k]) / b.v;
+    return r;
+}
+
+// sqrt is not differentiable at 0 (coincident endpoints); use 0 there.
+inline Dual sqrt(const Dual& a) {
+    Dual r(std::sqrt(a.v));
+    const double f = r.v > 0.0 ? 0.5 / r.v : 0.0;
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = f * a.d[k];
+    return r;
 }
 
-// Compute the analytical partial derivative d(residual)/d(vars[var_index])
-// for supported constraint types.  Sets ok=false and returns NaN for
-// unsupported types or when var_index is not active.
-double analytical_gradient(const ConstraintSpec& c, int var_index,
-                           const ISolver::GetVar& /*get*/, bool& ok) {
-    ok = true;
-    const auto kind = classifyConstraintKind(c.type);
+// acos has infinite slope at +-1 (parallel arms); the slope is capped so an
+// angle target still pulls the arms apart.
+inline Dual acos(const Dual& a) {
+    Dual r(std::acos(a.v));
+    const double f = -1.0 / std::sqrt(std::max(1.0 - a.v * a.v, 1e-12));
+    for (int k = 0; k < kMaxOperands; ++k) r.d[k] = f * a.d[k];
+    return r;
+}
+
+inline Dual abs(const Dual& a) { return a.v < 0.0 ? -a : a; }
+
+inline double value_of(double a) { return a; }
+inline double value_of(const Dual& a) { return a.v; }
+
+template <typename T>
+T clamp_unit(const T& a) {
+    if (value_of(a) > 1.0) return T(1.0);
+    if (value_of(a) < -1.0) return T(-1.0);
+    return a;
+}
 
+// Residual of one constraint from its operand values v[0, expected_arity).
+// The single definition shared by the string-keyed path and ConstraintProgram
+// (on duals, for the Jacobian).
+template <typename T>
+T constraint_residual(ConstraintKind kind, const T* v, double value, bool y_component) {
+    using std::abs;
+    using std::acos;
+    using std::sqrt;
     switch (kind) {
-        // horizontal: residual = y1 - y0
-        // d/dy0 = -1, d/dy1 = 1
         case ConstraintKind::Horizontal:
-            if (var_index == 0) return -1.0;
-            if (var_index == 1) return  1.0;
-            ok = false; return std::numeric_limits<double>::quiet_NaN();
-
-        // vertical: residual = x1 - x0
-        // d/dx0 = -1, d/dx1 = 1
         case ConstraintKind::Vertical:
-            if (var_index == 0) return -1.0;
-            if (var_index == 1) return  1.0;
-            ok = false; return std::numeric_limits<double>::quiet_NaN();
-
-        // equal: residual = a - b
-        // d/da = 1, d/db = -1
+            return v[1] - v[0];
         case ConstraintKind::Equal:
-            if (var_index == 0) return  1.0;
-            if (var_index == 1) return -1.0;
-            ok = false; return std::numeric_limits<double>::quiet_NaN();
-
-        // coincident (expanded): residual = (x1-x0) or (y1-y0) depending on value
-        // For x-component (value <= 0.5): vars[0]=x0, vars[2]=x1 => d/dx0=-1, d/dx1=1
-        // For y-component (value > 0.5):  vars[1]=y0, vars[3]=y1 => d/dy0=-1, d/dy1=1
-        case ConstraintKind::Coincident: {
-            bool yComp = c.value.has_value() && *c.value > 0.5;
-            if (yComp) {
-                if (var_index == 1) return -1.0; // y0
-                if (var_index == 3) return  1.0; // y1
-            } else {
-                if (var_index == 0) return -1.0; // x0
-                if (var_index == 2) return  1.0; // x1
-            }
-            // Variable not active for this component => gradient is 0
-            return 0.0;
+        case ConstraintKind::EqualRadius:
+            return v[0] - v[1];
+        case ConstraintKind::Distance: {
+            const T x0 = v[0], y0 = v[1], x1 = v[2], y1 = v[3];
+            return sqrt((x1-x0)*(x1-x0) + (y1-y0)*(y1-y0)) - value;
         }
-
-        // concentric (expanded): same structure as coincident
-        case ConstraintKind::Concentric: {
-            bool yComp = c.value.has_value() && *c.value > 0.5;
-            if (yComp) {
-                if (var_index == 1) return -1.0; // cy0
-                if (var_index == 3) return  1.0; // cy1
-            } else {
-                if (var_index == 0) return -1.0; // cx0
-                if (var_index == 2) return  1.0; // cx1
-            }
-            return 0.0;
+        case ConstraintKind::Parallel:
+        case ConstraintKind::Perpendicular:
+        case ConstraintKind::Angle: {
+            T v1x=v[2]-v[0],v1y=v[3]-v[1],v2x=v[6]-v[4],v2y=v[7]-v[5];
+            T n1=sqrt(v1x*v1x+v1y*v1y),n2=sqrt(v2x*v2x+v2y*v2y);
+            if (value_of(n1)==0||value_of(n2)==0) return T(0.0);
+            if (kind == ConstraintKind::Parallel) return (v1x*v2y-v1y*v2x)/(n1*n2);
+            if (kind == ConstraintKind::Perpendicular) return (v1x*v2x+v1y*v2y)/(n1*n2);
+            T cosA=clamp_unit((v1x*v2x+v1y*v2y)/(n1*n2));
+            return acos(cosA)-value;
         }
-
-        // fixed_point: residual = vars[0] - value
-        // d/d(vars[0]) = 1, d/d(vars[1]) = 0
-        case ConstraintKind::FixedPoint:
-            if (var_index == 0) return 1.0;
-            if (var_index == 1) return 0.0;
-            ok = false; return std::numeric_limits<double>::quiet_NaN();
-
-        // midpoint (expanded): residual = p - (a+b)*0.5 per component
-        // x-component: dx = px - (ax+bx)*0.5
-        //   d/dpx = 1, d/dax = -0.5, d/dbx = -0.5
-        //   vars: [0]=px, [1]=py, [2]=ax, [3]=ay, [4]=bx, [5]=by
-        // y-component: dy = py - (ay+by)*0.5
-        //   d/dpy = 1, d/day = -0.5, d/dby = -0.5
-        case ConstraintKind::Midpoint: {
-            bool yComp = c.value.has_value() && *c.value > 0.5;
-            if (yComp) {
-                if (var_index == 1) return  1.0;  // py
-                if (var_index == 3) return -0.5;  // ay
-                if (var_index == 5) return -0.5;  // by
-                return 0.0;
-            } else {
-                if (var_index == 0) return  1.0;  // px
-                if (var_index == 2) return -0.5;  // ax
-                if (var_index == 4) return -0.5;  // bx
-                return 0.0;
-            }
+        case ConstraintKind::Coincident:
+        case ConstraintKind::Concentric:
+            return y_component ? (v[3]-v[1]) : (v[2]-v[0]);
+        case ConstraintKind::Tangent: {
+            T p0x=v[0],p0y=v[1],p1x=v[2],p1y=v[3],cx=v[4],cy=v[5];
+            T dx=p1x-p0x,dy=p1y-p0y,len=sqrt(dx*dx+dy*dy);
+            if (value_of(len)<1e-15) return T(0.0);
+            return abs((cx-p0x)*dy-(cy-p0y)*dx)/len - value;
+        }
+        case ConstraintKind::PointOnLine:
+        case ConstraintKind::P2LDistance: {
+            T px=v[0],py=v[1],ax=v[2],ay=v[3],bx=v[4],by=v[5];
+            T dx=bx-ax,dy=by-ay,len=sqrt(dx*dx+dy*dy);
+            if (value_of(len)<1e-15) return T(0.0);
+            const T signed_dist = ((px-ax)*dy-(py-ay)*dx)/len;
+            return kind == ConstraintKind::P2LDistance ? signed_dist - value : signed_dist;
         }
-
-        // symmetric (expanded): residual = (p1+p2)*0.5 - c per component
-        // x-component: mx = (p1x+p2x)*0.5 - cx
-        //   d/dp1x = 0.5, d/dp2x = 0.5, d/dcx = -1.0
-        //   vars: [0]=p1x, [1]=p1y, [2]=p2x, [3]=p2y, [4]=cx, [5]=cy
-        // y-component: my = (p1y+p2y)*0.5 - cy
-        //   d/dp1y = 0.5, d/dp2y = 0.5, d/dcy = -1.0
         case ConstraintKind::Symmetric: {
-            bool yComp = c.value.has_value() && *c.value > 0.5;
-            if (yComp) {
-                if (var_index == 1) return  0.5;  // p1y
-                if (var_index == 3) return  0.5;  // p2y
-                if (var_index == 5) return -1.0;  // cy
-                return 0.0;
-            } else {
-                if (var_index == 0) return  0.5;  // p1x
-                if (var_index == 2) return  0.5;  // p2x
-                if (var_index == 4) return -1.0;  // cx
-                return 0.0;
-            }
+            T mx=(v[0]+v[2])*0.5-v[4], my=(v[1]+v[3])*0.5-v[5];
+            return y_component ? my : mx;
         }
-
+        case ConstraintKind::Midpoint: {
+            T dx=v[0]-(v[2]+v[4])*0.5, dy=v[1]-(v[3]+v[5])*0.5;
+            return y_component ? dy : dx;
+        }
+        case ConstraintKind::FixedPoint:
+            return v[0] - value;
+        case ConstraintKind::EqualLength:
+        case ConstraintKind::LengthRatio: {
+            T la=sqrt((v[2]-v[0])*(v[2]-v[0])+(v[3]-v[1])*(v[3]-v[1]));
+            T lb=sqrt((v[6]-v[4])*(v[6]-v[4])+(v[7]-v[5])*(v[7]-v[5]));
+            if (kind == ConstraintKind::EqualLength) return la - lb;
+            if (value_of(lb) < 1e-15) return T(0.0);
+            return la/lb - value;
+        }
+        case ConstraintKind::PointOnCircle: {
+            T px=v[0],py=v[1],cx=v[2],cy=v[3],r=v[4];
+            return sqrt((px-cx)*(px-cx)+(py-cy)*(py-cy)) - r;
+        }
+        case ConstraintKind::ArcAngle:
+            return (v[1] - v[0]) - value;
+        case ConstraintKind::Unknown:
         default:
-            break;
+            return T(0.0);
     }
-    ok = false;
-    return std::numeric_limits<double>::quiet_NaN();
 }
 
-#ifndef NDEBUG
-// Debug verification: compare analytical gradient with numerical finite
-// difference for each constraint-variable pair that has an analytical formula.
-// Logs a warning to stderr if relative error exceeds the given tolerance.
-void verify_analytical_gradient(const ConstraintSpec& c, int var_index,
-                                double analytical_val,
-                                const ISolver::GetVar& get,
-                                const ISolver::SetVar& set,
-                                const std::vector<VarRef>& vars,
-                                int global_var_idx,
-                                const std::function<double(const ConstraintSpec&, bool&)>& residual) {
-    // Compute numerical gradient for this constraint-variable pair
-    bool okr = false;
-    double r0 = residual(c, okr);
-    if (!okr) return;
-
-    const double eps = 1e-7;
-    bool okv = false;
-    double xj = get(vars[global_var_idx], okv);
-    if (!okv) return;
-
-    set(vars[global_var_idx], xj + eps);
-    bool okr2 = false;
-    double r1 = residual(c, okr2);
-    set(vars[global_var_idx], xj); // restore
-
-    if (!okr2) return;
-    double numerical_val = (r1 - r0) / eps;
-
-    // Relative error check
-    double denom = std::max(std::abs(analytical_val), std::abs(numerical_val));
-    if (denom < 1e-15) return; // both ~zero, skip
-    double rel_err = std::abs(analytical_val - numerical_val) / denom;
-    if (rel_err > 1e-4) {
-        std::cerr << "[WARN] analytical/numerical gradient mismatch: type="
-                  << c.type << " var_index=" << var_index
-                  << " analytical=" << analytical_val
-                  << " numerical=" << numerical_val
-                  << " rel_err=" << rel_err << "\n";
-    }
-}
-#endif // NDEBUG
-
-// Helper: compute gradient of objective F(x) = 0.5 * sum(r_i^2)
-// using analytical Jacobian entries where available, falling back to
-// numerical finite differences for unsupported constraint types.
-// Returns grad_j = sum_i( r_i * dri/dxj ) for each variable j.
-Eigen::VectorXd compute_objective_gradient(
-    const std::vector<ConstraintSpec>& constraints,
-    const std::vector<VarRef>& vars,
-    const Eigen::VectorXd& x,
-    double /*fx*/,
-    const ISolver::GetVar& get,
-    const ISolver::SetVar& set,
-    const std::function<double(const ConstraintSpec&, bool&)>& residual) {
-
-    const int n = static_cast<int>(vars.size());
-    const int m = static_cast<int>(constraints.size());
-    Eigen::VectorXd grad = Eigen::VectorXd::Zero(n);
-
-    // Build var key -> global index map
-    std::unordered_map<std::string, int> var_key_to_global;
-    for (int j = 0; j < n; ++j) {
-        var_key_to_global[vars[j].id + "." + vars[j].key] = j;
-    }
-
-    // Check if any constraint has analytical gradient
-    bool any_analytical = false;
-    for (const auto& c : constraints) {
-        if (has_analytical_gradient(c)) { any_analytical = true; break; }
-    }
-
-    if (any_analytical) {
-        // Mixed approach: compute per-constraint contributions analytically where
-        // possible, and use numerical finite difference for the rest.
-        // For analytical: grad_j += r_i * d(r_i)/d(x_j)
-        // For numerical: use full-objective finite difference for those variables
-        // that appear only in numerical constraints (or use per-entry fallback).
-
-        // Pre-compute all residuals
-        Eigen::VectorXd rvec(m);
-        for (int i = 0; i < m; ++i) {
-            bool okc = false;
-            rvec[i] = residual(constraints[i], okc);
-        }
-
-        // For each variable, accumulate gradient contributions
-        for (int j = 0; j < n; ++j) {
-            double gj = 0.0;
-            bool all_analytical_for_this_var = true;
-
-            for (int i = 0; i < m; ++i) {
-                // Find var_index for this constraint
-                int vi = -1;
-                for (int k = 0; k < static_cast<int>(constraints[i].vars.size()); ++k) {
-                    const auto& vr = constraints[i].vars[k];
-                    if (vr.id == vars[j].id && vr.key == vars[j].key) {
-                        vi = k;
-                        break;
-                    }
-                }
-                if (vi < 0) continue; // variable not in this constraint
-
-                if (has_analytical_gradient(constraints[i])) {
-                    bool ok = false;
-                    double dri = analytical_gradient(constraints[i], vi, get, ok);
-                    if (ok && std::isfinite(dri)) {
-#ifndef NDEBUG
-                        verify_analytical_gradient(constraints[i], vi, dri, get, set,
-                                                   vars, j, residual);
-#endif
-                        gj += rvec[i] * dri;
+// --- Compiled constraint program ---
+// Built once per solve: resolves each row's kind, value and operands to
+// integer slots (columns of x, or constants read at compile time) and lists
+// its structural nonzeros. Evaluation then touches only a contiguous vector,
+// with no string compares, std::function calls or allocation per iteration.
+using SparseJacobian = Eigen::SparseMatrix<double>;
+
+// Flags (indexed like `vars`) for bindings that ignore writes, such as
+// read-only reference geometry. Evaluating through get/set gave them a zero
+// derivative; the program keeps them constant instead.
+std::vector<char> read_only_vars(const std::vector<VarRef>& vars,
+                                 const ISolver::GetVar& get,
+                                 const ISolver::SetVar& set) {
+    std::vector<char> read_only(vars.size(), 0);
+    for (size_t j = 0; j < vars.size(); ++j) {
+        bool ok = false;
+        const double current = get(vars[j], ok);
+        if (!ok || !std::isfinite(current)) continue;
+        set(vars[j], current + 1.0 + std::abs(current));
+        bool ok_probe = false;
+        read_only[j] = get(vars[j], ok_probe) == current ? 1 : 0;
+        set(vars[j], current);
+    }
+    return read_only;
+}
+
+class ConstraintProgram {
+public:
+    // `rows` index into `constraints`, `cols` into `vars`; the program's
+    // columns follow `cols`. Operands outside `cols` or flagged in
+    // `read_only` (indexed like `vars`) are constants at their current value.
+    // Rows with an unbound operand evaluate to zero.
+    ConstraintProgram(const std::vector<ConstraintSpec>& constraints,
+                      const std::vector<int>& rows,
+                      const std::vector<VarRef>& vars,
+                      const std::vector<int>& cols,
+                      const std::vector<char>& read_only,
+                      const ISolver::GetVar& get) {
+        std::unordered_map<std::string, int> col_of;
+        col_of.reserve(cols.size());
+        for (size_t j = 0; j < cols.size(); ++j) {
+            const size_t var = static_cast<size_t>(cols[j]);
+            if (read_only[var]) continue;
+            col_of.emplace(format_var_ref(vars[var]), static_cast<int>(j));
+        }
+        cols_ = static_cast<int>(cols.size());
+        rows_.reserve(rows.size());
+        for (int index : rows) {
+            const ConstraintSpec& c = constraints[static_cast<size_t>(index)];
+            Row row;
+            row.kind = classifyConstraintKind(c.type);
+            row.value = c.value.value_or(0.0);
+            row.yComponent = is_y_component(c);
+            row.operandBegin = static_cast<int>(operands_.size());
+            row.entryBegin = static_cast<int>(entryCol_.size());
+            row.active = has_residual_operands(c, row.kind);
+            if (row.active) {
+                row.arity = expected_arity(row.kind);
+                for (int k = 0; k < row.arity; ++k) {
+                    const VarRef& var = c.vars[static_cast<size_t>(k)];
+                    bool okv = false;
+                    const double current = get(var, okv);
+                    row.active = row.active && okv;
+                    const auto it = col_of.find(format_var_ref(var));
+                    if (it == col_of.end()) {
+                        operands_.push_back(~static_cast<int>(constants_.size()));
+                        operandEntry_.push_back(-1);
+                        constants_.push_back(current);
                         continue;
                     }
-                }
-                // This constraint needs numerical diff for this variable
-                all_analytical_for_this_var = false;
-            }
-
-            if (!all_analytical_for_this_var) {
-                // Fall back to full numerical finite difference for this variable's
-                // contribution from non-analytical constraints
-                const double eps = 1e-7;
-                bool okv = false;
-                double xj = get(vars[j], okv);
-                set(vars[j], xj + eps);
-                double fp = 0.0;
-                for (int i = 0; i < m; ++i) {
-                    if (has_analytical_gradient(constraints[i])) {
-                        // Already handled analytically above - need to subtract
-                        // analytical contribution to avoid double-counting, then
-                        // add back the numerical version. But it's simpler to just
-                        // use numerical for everything on this variable.
+                    int entry = row.entryBegin;
+                    while (entry < static_cast<int>(entryCol_.size()) && entryCol_[static_cast<size_t>(entry)] != it->second) {
+                        ++entry;
                     }
-                    bool okc = false;
-                    double ri = residual(constraints[i], okc);
-                    fp += ri * ri;
-                }
-                fp *= 0.5;
-                set(vars[j], xj); // restore
-                double f0 = 0.0;
-                for (int i = 0; i < m; ++i) {
-                    bool okc = false;
-                    double ri = residual(constraints[i], okc);
-                    f0 += ri * ri;
+                    if (entry == static_cast<int>(entryCol_.size())) entryCol_.push_back(it->second);
+                    operands_.push_back(it->second);
+                    operandEntry_.push_back(entry);
                 }
-                f0 *= 0.5;
-                grad[j] = (fp - f0) / eps;
-            } else {
-                grad[j] = gj;
             }
-        }
-    } else {
-        // All numerical: use forward difference on the full objective
-        const double eps = 1e-7;
-        double f0 = 0.0;
-        for (int i = 0; i < m; ++i) {
-            bool okc = false;
-            double ri = residual(constraints[i], okc);
-            f0 += ri * ri;
-        }
-        f0 *= 0.5;
-
-        for (int j = 0; j < n; ++j) {
-            bool okv = false;
-            double xj = get(vars[j], okv);
-            set(vars[j], xj + eps);
-            double fp = 0.0;
-            for (int i = 0; i < m; ++i) {
-                bool okc = false;
-                double ri = residual(constraints[i], okc);
-                fp += ri * ri;
+            if (!row.active) {
+                // Keep the operands for indexing but drop the nonzeros.
+                entryCol_.resize(static_cast<size_t>(row.entryBegin));
             }
-            fp *= 0.5;
-            set(vars[j], xj); // restore
-            grad[j] = (fp - f0) / eps;
+            row.entryEnd = static_cast<int>(entryCol_.size());
+            rows_.push_back(row);
         }
     }
 
-    return grad;
-}
-
-} // namespace
+    int rowCount() const { return static_cast<int>(rows_.size()); }
+    int colCount() const { return cols_; }
 
-class MinimalSolver : public ISolver {
-    int maxIters_ = 50;
-    double tol_ = 1e-6;
-public:
-    void setMaxIterations(int iters) override { maxIters_ = iters; }
-    void setTolerance(double tol) override { tol_ = tol; }
+    double residual(int row_index, const Eigen::VectorXd& x) const {
+        const Row& row = rows_[static_cast<size_t>(row_index)];
+        if (!row.active) return 0.0;
+        double v[kMaxOperands];
+        for (int k = 0; k < row.arity; ++k) {
+            const int op = operands_[static_cast<size_t>(row.operandBegin + k)];
+            v[k] = op >= 0 ? x[op] : constants_[static_cast<size_t>(~op)];
+        }
+        return constraint_residual(row.kind, v, row.value, row.yComponent);
+    }
 
-    // NOTE: This is a stub that only evaluates residuals without modifying vars.
-    SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
-        // Legacy stub
-        SolveResult r;
-        const auto report = validate_constraints(constraints, nullptr);
-        r.diagnostics = report.diagnostics;
-        r.redundancyGroups = report.redundancyGroups;
-        r.analysis = report.analysis;
-        r.ok = r.diagnostics.empty();
-        r.iterations = 0;
-        r.finalError = 0.0;
-        r.message = r.ok ? "Converged (no-op stub)" : "Constraint validation failed";
-        return r;
+    void residuals(const Eigen::VectorXd& x, Eigen::VectorXd& out) const {
+        out.resize(rowCount());
+        for (int r = 0; r < rowCount(); ++r) out[r] = residual(r, x);
     }
 
-    SolveResult solveWithBindings(std::vector<ConstraintSpec>& constraints, const GetVar& get, const SetVar& set) override {
-        SolveResult out;
-        const auto report = validate_constraints(constraints, &get);
-        out.diagnostics = report.diagnostics;
-        out.redundancyGroups = report.redundancyGroups;
-        out.analysis = report.analysis;
-        if (!out.diagnostics.empty()) {
-            out.ok = false;
-            out.iterations = 0;
-            out.finalError = 0.0;
-            out.message = "Constraint validation failed";
-            return out;
+    double squaredNorm(const Eigen::VectorXd& x) const {
+        double s = 0.0;
+        for (int r = 0; r < rowCount(); ++r) {
+            const double rr = residual(r, x);
+            s += rr * rr;
         }
-
-        // Expand 2D constraints (symmetric, midpoint) into x/y sub-constraint pairs
-        std::vector<ConstraintSpec> expanded;
-        for (const auto& c : constraints) {
-            if (needs_xy_expansion(c.type)) {
-                ConstraintSpec cx = c; cx.value = 0.0; // x-component
-                ConstraintSpec cy = c; cy.value = 1.0; // y-component
-                expanded.push_back(cx);
-                expanded.push_back(cy);
-            } else {
-                expanded.push_back(c);
+        return s;
+    }
+
+    double norm(const Eigen::VectorXd& x) const { return std::sqrt(squaredNorm(x)); }
+
+    // Pinned columns (indexed like the program's columns; empty = none) get a
+    // zero partial, so steps leave them at their value in x.
+    void setPinnedColumns(const std::vector<char>& pinned) { pinned_ = pinned; }
+
+    // Exact Jacobian at x, from one dual evaluation per row.
+    void jacobian(const Eigen::VectorXd& x, Eigen::MatrixXd& J) const {
+        J.setZero(rowCount(), cols_);
+        for_each_entry(x, [&](int row, int col, double value) { J(row, col) = value; });
+    }
+
+    // Every structural nonzero is stored, even when it evaluates to zero, so
+    // the sparsity pattern depends on the program alone and factorizations
+    // can reuse their symbolic analysis.
+    void jacobian(const Eigen::VectorXd& x, SparseJacobian& J) {
+        triplets_.clear();
+        for_each_entry(x, [&](int row, int col, double value) {
+            triplets_.emplace_back(row, col, value);
+        });
+        J.resize(rowCount(), cols_);
+        J.setFromTriplets(triplets_.begin(), triplets_.end());
+    }
+
+    // Normal equations at x given r = residuals(x): the lower triangle of
+    // J^T J into a fixed pattern (built on first use, with every diagonal
+    // entry present for the damping), and g = J^T r. Accumulated row by row,
+    // so J itself is never assembled.
+    void normalEquations(const Eigen::VectorXd& x, const Eigen::VectorXd& r,
+                         SparseJacobian& JtJ, Eigen::VectorXd& g) {
+        if (normalPattern_.cols() != cols_ || normalSlot_.empty()) build_normal_pattern();
+        if (JtJ.nonZeros() != normalPattern_.nonZeros()) JtJ = normalPattern_;
+        std::fill(JtJ.valuePtr(), JtJ.valuePtr() + JtJ.nonZeros(), 0.0);
+        g.setZero(cols_);
+        entryValues_.resize(entryCol_.size());
+        size_t next = 0;
+        for_each_entry(x, [&](int row, int col, double value) {
+            entryValues_[next++] = value;
+            g[col] += value * r[row];
+        });
+        double* values = JtJ.valuePtr();
+        size_t slot = 0;
+        for (const Row& row : rows_) {
+            for (int e1 = row.entryBegin; e1 < row.entryEnd; ++e1) {
+                const double v1 = entryValues_[static_cast<size_t>(e1)];
+                for (int e2 = row.entryBegin; e2 <= e1; ++e2) {
+                    values[normalSlot_[slot++]] += v1 * entryValues_[static_cast<size_t>(e2)];
+                }
             }
         }
+    }
 
-        const std::vector<ConstraintSpec> analysis_constraints = expanded;
-        const std::vector<VarRef> analysis_vars = collect_unique_vars(analysis_constraints);
-        auto analysis_residual = [&](const ConstraintSpec& c, bool& ok)->double {
-            return residual_for_constraint(c, get, ok);
-        };
-        Eigen::VectorXd analysis_x(analysis_vars.size());
-        for (size_t j = 0; j < analysis_vars.size(); ++j) {
-            bool okv = false;
-            analysis_x[static_cast<Eigen::Index>(j)] = get(analysis_vars[j], okv);
-        }
-        populate_jacobian_analysis(
-            analysis_constraints,
-            analysis_vars,
-            set,
-            analysis_x,
-            analysis_residual,
-            out.analysis,
-            &out.structuralGroups,
-            &out.redundancySubsets);
-        collect_conflict_groups(out.structuralGroups, out);
-        collect_problematic_constraint_indices(out.structuralGroups, out);
-        out.primaryRedundancyBasisConstraintIndices.clear();
-        out.primaryRedundantConstraintIndices.clear();
-        out.smallestRedundancyBasisConstraintIndices.clear();
-        out.smallestRedundantConstraintIndices.clear();
-        out.analysis.primaryRedundancyVariableKeys.clear();
-        out.analysis.smallestRedundancyVariableKeys.clear();
-        if (!out.redundancySubsets.empty()) {
-            out.primaryRedundancyBasisConstraintIndices = out.redundancySubsets.front().basisConstraintIndices;
-            out.primaryRedundantConstraintIndices = out.redundancySubsets.front().redundantConstraintIndices;
-            out.analysis.primaryRedundancyVariableKeys = out.redundancySubsets.front().variableKeys;
-            const auto smallest_it = std::find_if(
-                out.redundancySubsets.begin(), out.redundancySubsets.end(),
-                [&](const ConstraintRedundancySubset& subset) {
-                    return subset.anchorConstraintIndex == out.analysis.smallestRedundancySubsetAnchorConstraintIndex;
-                });
-            if (smallest_it != out.redundancySubsets.end()) {
-                out.smallestRedundancyBasisConstraintIndices = smallest_it->basisConstraintIndices;
-                out.smallestRedundantConstraintIndices = smallest_it->redundantConstraintIndices;
-                out.analysis.smallestRedundancyVariableKeys = smallest_it->variableKeys;
-            }
-        }
+private:
+    struct Row {
+        ConstraintKind kind{ConstraintKind::Unknown};
+        bool active{false};
+        bool yComponent{false};
+        double value{0.0};
+        int operandBegin{0};
+        int arity{0};
+        int entryBegin{0};
+        int entryEnd{0};
+    };
 
-        const SubstitutionResult substitutions = build_substitutions(expanded);
-        expanded = substitutions.reduced;
-        auto redirected_get = [&](const VarRef& v, bool& ok) -> double {
-            const auto it = substitutions.redirect.find(format_var_ref(v));
-            if (it == substitutions.redirect.end()) {
-                return get(v, ok);
+    // Partials of each row from one dual evaluation, seeding slot k on
+    // operand k. An operand repeated in one row contributes each of its
+    // partials to the same entry.
+    template <typename Emit>
+    void for_each_entry(const Eigen::VectorXd& x, Emit emit) const {
+        for (int ri = 0; ri < rowCount(); ++ri) {
+            const Row& row = rows_[static_cast<size_t>(ri)];
+            if (row.entryBegin == row.entryEnd) continue;
+            Dual v[kMaxOperands];
+            for (int k = 0; k < row.arity; ++k) {
+                const int op = operands_[static_cast<size_t>(row.operandBegin + k)];
+                if (op < 0) {
+                    v[k] = Dual(constants_[static_cast<size_t>(~op)]);
+                    continue;
+                }
+                v[k] = Dual(x[op]);
+                v[k].d[k] = 1.0;
+            }
+            const Dual res = constraint_residual(row.kind, v, row.value, row.yComponent);
+            double sum[kMaxOperands] = {};
+            for (int k = 0; k < row.arity; ++k) {
+                const int entry = operandEntry_[static_cast<size_t>(row.operandBegin + k)];
+                if (entry >= 0) sum[entry - row.entryBegin] += res.d[k];
+            }
+            for (int e = row.entryBegin; e < row.entryEnd; ++e) {
+                const int col = entryCol_[static_cast<size_t>(e)];
+                emit(ri, col, pinned(col) ? 0.0 : sum[e - row.entryBegin]);
             }
-            return get(parse_var_ref(it->second), ok);
-        };
-        auto residual = [&](const ConstraintSpec& c, bool& ok)->double {
-            return residual_for_constraint(c, redirected_get, ok);
-        };
-        std::vector<VarRef> vars = collect_unique_vars(expanded);
-        const size_t n = vars.size();
-        const size_t m = expanded.size();
-        if (n == 0 || m == 0) {
-             sync_redirected_aliases(substitutions.redirect, get, set);
-             out.ok = true;
-             out.iterations = 0;
-             out.finalError = 0.0;
-             return out;
-        }
-
-        Eigen::VectorXd x(n);
-        for (size_t j = 0; j < n; ++j) {
-            bool okv = false;
-            x[static_cast<Eigen::Index>(j)] = redirected_get(vars[j], okv);
         }
+    }
 
-        auto write_x = [&](const Eigen::VectorXd& currX){
-            for (size_t j = 0; j < n; ++j) {
-                set(vars[j], currX[static_cast<Eigen::Index>(j)]);
-            }
-        };
+    bool pinned(int col) const {
+        return !pinned_.empty() && pinned_[static_cast<size_t>(col)] != 0;
+    }
 
-        // Error norm function
-        auto eval_norm = [&](){ double s=0.0; for (const auto& c: expanded){ bool okc=false; double rr=residual(c, okc); s += rr*rr; } return std::sqrt(s); };
-
-        // --- Partitioned solving: extract connected components via variable sharing ---
-        // Build constraint-variable adjacency and BFS to find components
-        std::unordered_map<std::string, int> var_index_map;
-        for (size_t j = 0; j < n; ++j) var_index_map[vars[j].id + "." + vars[j].key] = static_cast<int>(j);
-
-        std::vector<std::vector<int>> constraint_vars_idx(m);
-        std::vector<std::vector<int>> var_constraints(n);
-        for (size_t i = 0; i < m; ++i) {
-            for (const auto& v : expanded[i].vars) {
-                auto it = var_index_map.find(v.id + "." + v.key);
-                if (it != var_index_map.end()) {
-                    constraint_vars_idx[i].push_back(it->second);
-                    var_constraints[static_cast<size_t>(it->second)].push_back(static_cast<int>(i));
+    // Lower-triangle pattern of J^T J plus the diagonal, and for each entry
+    // pair of each row (in normalEquations' order) its slot in the values.
+    void build_normal_pattern() {
+        std::vector<Eigen::Triplet<double>> pattern;
+        for (int c = 0; c < cols_; ++c) pattern.emplace_back(c, c, 0.0);
+        for (const Row& row : rows_) {
+            for (int e1 = row.entryBegin; e1 < row.entryEnd; ++e1) {
+                for (int e2 = row.entryBegin; e2 <= e1; ++e2) {
+                    const int a = entryCol_[static_cast<size_t>(e1)];
+                    const int b = entryCol_[static_cast<size_t>(e2)];
+                    pattern.emplace_back(std::max(a, b), std::min(a, b), 0.0);
                 }
             }
         }
+        normalPattern_.resize(cols_, cols_);
+        normalPattern_.setFromTriplets(pattern.begin(), pattern.end());
+        normalPattern_.makeCompressed();
+        const int* outer = normalPattern_.outerIndexPtr();
+        const int* inner = normalPattern_.innerIndexPtr();
+        normalSlot_.clear();
+        for (size_t i = static_cast<size_t>(cols_); i < pattern.size(); ++i) {
+            const int c = static_cast<int>(pattern[i].col());
+            const int* hit = std::lower_bound(inner + outer[c], inner + outer[c + 1], static_cast<int>(pattern[i].row()));
+            normalSlot_.push_back(static_cast<int>(hit - inner));
+        }
+    }
 
-        // BFS to find connected components
-        struct Component { std::vector<int> constraint_indices; std::vector<int> var_indices; };
-        std::vector<Component> components;
-        std::vector<bool> visited_c(m, false), visited_v(n, false);
-        for (size_t start = 0; start < m; ++start) {
-            if (visited_c[start]) continue;
-            Component comp;
-            std::vector<int> pending_c{static_cast<int>(start)}, pending_v;
-            while (!pending_c.empty() || !pending_v.empty()) {
-                while (!pending_c.empty()) {
-                    int ci = pending_c.back(); pending_c.pop_back();
-                    if (ci < 0 || visited_c[static_cast<size_t>(ci)]) continue;
-                    visited_c[static_cast<size_t>(ci)] = true;
-                    comp.constraint_indices.push_back(ci);
-                    for (int vi : constraint_vars_idx[static_cast<size_t>(ci)]) pending_v.push_back(vi);
-                }
-                while (!pending_v.empty()) {
-                    int vi = pending_v.back(); pending_v.pop_back();
-                    if (vi < 0 || visited_v[static_cast<size_t>(vi)]) continue;
-                    visited_v[static_cast<size_t>(vi)] = true;
-                    comp.var_indices.push_back(vi);
-                    for (int ci : var_constraints[static_cast<size_t>(vi)]) pending_c.push_back(ci);
-                }
-            }
-            if (!comp.constraint_indices.empty()) components.push_back(std::move(comp));
-        }
-
-        write_x(x);
-        int total_iters = 0;
-        bool all_ok = true;
-
-        // Solve each component independently
-        for (const auto& comp : components) {
-            const size_t cm = comp.constraint_indices.size();
-            const size_t cn = comp.var_indices.size();
-            if (cm == 0 || cn == 0) continue;
-
-            // Map from component-local to global indices
-            std::vector<int> ci = comp.constraint_indices;
-            std::vector<int> vi = comp.var_indices;
-
-            auto comp_eval_norm = [&]() {
-                double s = 0.0;
-                for (int idx : ci) { bool okc=false; double rr=residual(expanded[static_cast<size_t>(idx)], okc); s += rr*rr; }
-                return std::sqrt(s);
-            };
-
-            double prev = comp_eval_norm();
-            double lambda = 1e-3;
-
-            for (int it = 0; it < maxIters_; ++it) {
-                total_iters++;
-                // Residual
-                Eigen::VectorXd rvec(cm);
-                for (size_t r = 0; r < cm; ++r) { bool okc=false; rvec[r] = residual(expanded[static_cast<size_t>(ci[r])], okc); }
-
-                // Jacobian (cm x cn) — analytical where supported, numerical fallback
-                Eigen::MatrixXd J(cm, cn);
-                const double eps = 1e-6;
-                for (size_t j = 0; j < cn; ++j) {
-                    int gj = vi[j];
-                    bool need_numerical = false;
-                    std::vector<char> needs_numerical_row(cm, 0);
-                    for (size_t r = 0; r < cm; ++r) {
-                        const auto& ec = expanded[static_cast<size_t>(ci[r])];
-                        if (has_analytical_gradient(ec)) {
-                            // Find var_index for this variable in the constraint
-                            int vidx = -1;
-                            for (int k = 0; k < static_cast<int>(ec.vars.size()); ++k) {
-                                if (ec.vars[k].id == vars[static_cast<size_t>(gj)].id &&
-                                    ec.vars[k].key == vars[static_cast<size_t>(gj)].key) {
-                                    vidx = k; break;
-                                }
-                            }
-                            bool ok = false;
-                            double grad = (vidx >= 0) ? analytical_gradient(ec, vidx, get, ok) : 0.0;
-                            if (vidx >= 0 && ok && std::isfinite(grad)) {
-#ifndef NDEBUG
-                                verify_analytical_gradient(ec, vidx, grad, get, set,
-                                    vars, gj, residual);
-#endif
-                                J(r, j) = grad;
-                            } else if (vidx < 0) {
-                                J(r, j) = 0.0; // variable not in this constraint
-                            } else {
-                                need_numerical = true;
-                                needs_numerical_row[r] = 1;
-                            }
-                        } else {
-                            need_numerical = true;
-                            needs_numerical_row[r] = 1;
-                        }
-                    }
-                    if (need_numerical) {
-                        double xj = x[gj];
-                        set(vars[static_cast<size_t>(gj)], xj + eps);
-                        for (size_t r = 0; r < cm; ++r) {
-                            if (needs_numerical_row[r]) {
-                                const auto& ec = expanded[static_cast<size_t>(ci[r])];
-                                bool okc=false;
-                                J(r, j) = (residual(ec, okc) - rvec[r]) / eps;
-                            }
-                        }
-                        set(vars[static_cast<size_t>(gj)], xj);
-                    }
-                }
 
-                Eigen::MatrixXd A = J.transpose() * J;
-                A.diagonal().array() += lambda;
-                Eigen::VectorXd delta = A.ldlt().solve(-J.transpose() * rvec);
+    int cols_{0};
+    std::vector<Row> rows_;
+    std::vector<int> operands_;     // >= 0: column of x; < 0: ~index into constants_
+    std::vector<int> operandEntry_; // nonzero an operand feeds, -1 for constants
+    std::vector<double> constants_;
+    std::vector<int> entryCol_;     // structural nonzeros, grouped by row
+    std::vector<char> pinned_;
+    std::vector<Eigen::Triplet<double>> triplets_;
+    SparseJacobian normalPattern_;
+    std::vector<int> normalSlot_;
+    std::vector<double> entryValues_;
+};
 
-                // Apply delta to global x
-                Eigen::VectorXd newX = x;
-                for (size_t j = 0; j < cn; ++j) newX[vi[j]] += delta[j];
-                write_x(newX);
-                double newNorm = comp_eval_norm();
+// --- Sparse linear algebra path ---
+// Each constraint references a handful of variables, so the Jacobian is
+// almost entirely zeros. Past a few hundred unknowns the dense factorizations
+// dominate a solve; the sparse path stores only the structural nonzeros and
+// factorizes with sparse Cholesky/QR.
+bool use_sparse_linear_algebra(SolverLinearMode mode, size_t unknowns, int threshold) {
+    if (mode == SolverLinearMode::Dense) return false;
+    if (mode == SolverLinearMode::Sparse) return true;
+    return static_cast<int>(unknowns) >= threshold;
+}
 
-                if (newNorm < prev) {
-                    x = newX; prev = newNorm;
-                    lambda = std::max(1e-10, lambda * 0.1);
-                } else {
-                    write_x(x);
-                    lambda *= 10.0;
-                }
-                if (prev <= tol_) break;
-            }
-            if (prev > tol_) all_ok = false;
-        }
+// Flags the iterations poll once per step: the caller's cancellation flag
+// and, inside a portfolio race, the flag the winner raises.
+struct StopFlags {
+    const std::atomic<bool>* caller{nullptr};
+    const std::atomic<bool>* race{nullptr};
 
-        write_x(x);
-        sync_redirected_aliases(substitutions.redirect, get, set);
-        double finalErr = eval_norm();
-        out.ok = all_ok && (finalErr <= tol_);
-        out.iterations = total_iters;
-        out.finalError = finalErr;
-        out.message = (out.ok ? "Converged (partitioned LM)" : "Stopped (max iters or stagnation)");
-        return out;
+    bool raised() const {
+        return (caller && caller->load(std::memory_order_relaxed)) ||
+               (race && race->load(std::memory_order_relaxed));
     }
 };
 
-class DogLegSolver : public ISolver {
-    int maxIters_ = 80;
-    double tol_ = 1e-6;
-public:
-    void setMaxIterations(int iters) override { maxIters_ = iters; }
-    void setTolerance(double tol) override { tol_ = tol; }
+// Sparse LDL^T kept across LM steps of one program. The pattern of
+// J^T J + lambda I does not change between steps, so the symbolic analysis
+// (fill-reducing ordering, elimination tree) runs once and later steps only
+// refactorize numerically.
+struct SparseLmFactorization {
+    Eigen::SimplicialLDLT<SparseJacobian> ldlt;
+    SparseJacobian damped;
+    bool analyzed{false};
+};
 
-    SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
-        SolveResult r;
-        const auto report = validate_constraints(constraints, nullptr);
-        r.diagnostics = report.diagnostics;
-        r.redundancyGroups = report.redundancyGroups;
-        r.analysis = report.analysis;
-        r.ok = r.diagnostics.empty();
+// Levenberg-Marquardt step: (J^T J + lambda I) delta = -g by sparse LDL^T,
+// from the lower triangle of J^T J as built by normalEquations (the
+// diagonal leads each column).
+Eigen::VectorXd sparse_lm_step(const SparseJacobian& JtJ, const Eigen::VectorXd& g, double lambda,
+                               SparseLmFactorization& f) {
+    f.damped = JtJ;
+    const int* outer = f.damped.outerIndexPtr();
+    for (Eigen::Index c = 0; c < f.damped.cols(); ++c) f.damped.valuePtr()[outer[c]] += lambda;
+    if (!f.analyzed) {
+        f.ldlt.analyzePattern(f.damped);
+        f.analyzed = true;
+    }
+    f.ldlt.factorize(f.damped);
+    if (f.ldlt.info() != Eigen::Success) return Eigen::VectorXd::Zero(JtJ.cols());
+    return f.ldlt.solve(-g);
+}
+
+// Sparse QR kept across dogleg steps of one program; like the LM
+// factorization, the column ordering is computed once. The numeric
+// factorization is the longest part of a step, so the stop flags are checked
+// on either side of it and a raised flag skips the solve.
+struct SparseGnFactorization {
+    Eigen::SparseQR<SparseJacobian, Eigen::COLAMDOrdering<int>> qr;
+    bool analyzed{false};
+};
+
+// Gauss-Newton step: least-squares J delta = -r by sparse QR, which yields a
+// basic solution when J is rank deficient (under-constrained sketches).
+// Returns an empty vector when stopped.
+Eigen::VectorXd sparse_gauss_newton_step(const SparseJacobian& J, const Eigen::VectorXd& rvec,
+                                         SparseGnFactorization& f, const StopFlags* stop) {
+    if (stop && stop->raised()) return {};
+    if (!f.analyzed) {
+        f.qr.analyzePattern(J);
+        f.analyzed = true;
+    }
+    f.qr.factorize(J);
+    if (stop && stop->raised()) return {};
+    if (f.qr.info() != Eigen::Success) return Eigen::VectorXd::Zero(J.cols());
+    return f.qr.solve(-rvec);
+}
+
+std::vector<int> iota_indices(size_t count) {
+    std::vector<int> out(count);
+    for (size_t i = 0; i < count; ++i) out[i] = static_cast<int>(i);
+    return out;
+}
+
+AnalysisJacobian analysis_jacobian(const std::vector<ConstraintSpec>& constraints,
+                                   const std::vector<int>& rows,
+                                   const std::vector<VarRef>& vars,
+                                   const ISolver::GetVar& get,
+                                   const ISolver::SetVar& set) {
+    ConstraintProgram program(constraints, rows, vars, iota_indices(vars.size()),
+                              read_only_vars(vars, get, set), get);
+    Eigen::VectorXd x(static_cast<Eigen::Index>(vars.size()));
+    for (size_t j = 0; j < vars.size(); ++j) {
+        bool okv = false;
+        x[static_cast<Eigen::Index>(j)] = get(vars[j], okv);
+    }
+    SparseJacobian J;
+    program.jacobian(x, J);
+    return AnalysisJacobian(J);
+}
+
+// Limited-memory inverse Hessian (two-loop recursion); replaces the dense
+// n x n BFGS matrix on large systems.
+class LbfgsHistory {
+public:
+    explicit LbfgsHistory(size_t capacity) : capacity_(capacity) {}
+
+    void push(const Eigen::VectorXd& s, const Eigen::VectorXd& y, double ys) {
+        if (s_.size() == capacity_) {
+            s_.erase(s_.begin());
+            y_.erase(y_.begin());
+            rho_.erase(rho_.begin());
+        }
+        s_.push_back(s);
+        y_.push_back(y);
+        rho_.push_back(1.0 / ys);
+    }
+
+    Eigen::VectorXd direction(const Eigen::VectorXd& grad) const {
+        Eigen::VectorXd q = grad;
+        std::vector<double> alpha(s_.size());
+        for (size_t i = s_.size(); i-- > 0;) {
+            alpha[i] = rho_[i] * s_[i].dot(q);
+            q -= alpha[i] * y_[i];
+        }
+        if (!s_.empty()) {
+            q *= s_.back().dot(y_.back()) / y_.back().squaredNorm();
+        }
+        for (size_t i = 0; i < s_.size(); ++i) {
+            const double beta = rho_[i] * y_[i].dot(q);
+            q += s_[i] * (alpha[i] - beta);
+        }
+        return -q;
+    }
+
+private:
+    size_t capacity_;
+    std::vector<Eigen::VectorXd> s_;
+    std::vector<Eigen::VectorXd> y_;
+    std::vector<double> rho_;
+};
+
+// --- Component solving ---
+// Constraints that share no unknowns form independent blocks. Each block is
+// compiled and iterated on its own: an edit only re-solves the block it
+// touched (the others start within tolerance and are skipped), and large
+// assemblies spread their blocks across worker threads.
+
+// Below this many rows in total, thread start-up costs more than it saves.
+constexpr size_t kParallelComponentMinRows = 64;
+
+// Union-find over variable indices; the index counterpart of VarUnionFind.
+class IndexUnionFind {
+public:
+    explicit IndexUnionFind(size_t count) : parent_(iota_indices(count)) {}
+
+    int find(int i) {
+        while (parent_[static_cast<size_t>(i)] != i) {
+            int& p = parent_[static_cast<size_t>(i)];
+            p = parent_[static_cast<size_t>(p)];
+            i = p;
+        }
+        return i;
+    }
+
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (b < a) std::swap(a, b);
+        parent_[static_cast<size_t>(b)] = a;
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+struct SolveComponent {
+    std::vector<int> rows; // into the working constraints
+    std::vector<int> cols; // into vars
+};
+
+// Blocks in order of their first constraint; rows and columns ascending.
+// Constraints without a known variable belong to no block.
+std::vector<SolveComponent> partition_components(const std::vector<ConstraintSpec>& constraints,
+                                                 const std::vector<VarRef>& vars) {
+    std::unordered_map<std::string, int> var_index;
+    var_index.reserve(vars.size());
+    for (size_t j = 0; j < vars.size(); ++j) var_index.emplace(format_var_ref(vars[j]), static_cast<int>(j));
+
+    IndexUnionFind uf(vars.size());
+    std::vector<int> first_var(constraints.size(), -1);
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        for (const auto& v : constraints[i].vars) {
+            const auto it = var_index.find(format_var_ref(v));
+            if (it == var_index.end()) continue;
+            if (first_var[i] < 0) first_var[i] = it->second;
+            else uf.unite(first_var[i], it->second);
+        }
+    }
+
+    std::vector<SolveComponent> components;
+    std::vector<int> component_of_root(vars.size(), -1);
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        if (first_var[i] < 0) continue;
+        int& slot = component_of_root[static_cast<size_t>(uf.find(first_var[i]))];
+        if (slot < 0) {
+            slot = static_cast<int>(components.size());
+            components.emplace_back();
+        }
+        components[static_cast<size_t>(slot)].rows.push_back(static_cast<int>(i));
+    }
+    for (size_t j = 0; j < vars.size(); ++j) {
+        const int slot = component_of_root[static_cast<size_t>(uf.find(static_cast<int>(j)))];
+        if (slot >= 0) components[static_cast<size_t>(slot)].cols.push_back(static_cast<int>(j));
+    }
+    return components;
+}
+
+// Runs work(0) .. work(count - 1) on up to `threads` threads (0 = hardware
+// concurrency), the calling thread included; items are claimed in order.
+template <typename Work>
+void run_parallel(size_t count, int threads, Work work) {
+    size_t workers = threads > 0 ? static_cast<size_t>(threads) : std::thread::hardware_concurrency();
+    workers = std::min(std::max<size_t>(workers, 1), count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) work(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    auto drain = [&] {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) work(i);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t t = 1; t < workers; ++t) pool.emplace_back(drain);
+    drain();
+    for (auto& t : pool) t.join();
+}
+
+struct ComponentOutcome {
+    int iterations{0};
+    double norm{0.0};
+};
+
+struct ComponentSolveOptions {
+    double tolerance{1e-6};
+    SolverLinearMode linearMode{SolverLinearMode::Auto};
+    int sparseThreshold{kDefaultSparseSolverThreshold};
+    int threads{0};
+    const ISolver::ProgressCallback* progress{nullptr}; // per finished component
+};
+
+// Blocks compiled against one snapshot of the bindings, each with its
+// unknowns in a local vector.
+struct CompiledComponents {
+    std::vector<SolveComponent> components;
+    std::vector<ConstraintProgram> programs;
+    std::vector<Eigen::VectorXd> xs;
+    size_t totalRows{0};
+};
+
+// Compiles every block; reads the bindings, so it runs on the calling thread.
+CompiledComponents compile_components(const std::vector<ConstraintSpec>& constraints,
+                                      const std::vector<VarRef>& vars,
+                                      const ISolver::GetVar& get,
+                                      const ISolver::SetVar& set) {
+    CompiledComponents compiled;
+    compiled.components = partition_components(constraints, vars);
+    const std::vector<char> read_only = read_only_vars(vars, get, set);
+    const size_t count = compiled.components.size();
+    compiled.programs.reserve(count);
+    compiled.xs.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        const SolveComponent& comp = compiled.components[k];
+        compiled.programs.emplace_back(constraints, comp.rows, vars, comp.cols, read_only, get);
+        Eigen::VectorXd& x = compiled.xs[k];
+        x.resize(static_cast<Eigen::Index>(comp.cols.size()));
+        for (size_t j = 0; j < comp.cols.size(); ++j) {
+            bool okv = false;
+            x[static_cast<Eigen::Index>(j)] = get(vars[static_cast<size_t>(comp.cols[j])], okv);
+        }
+        compiled.totalRows += comp.rows.size();
+    }
+    return compiled;
+}
+
+// Runs `iterate(k, program, x, sparse, tol)` on the blocks that are out of
+// tolerance (bindings need not be thread safe, so workers only touch the
+// compiled blocks) and writes those back through `set`. Each block gets a
+// share of the tolerance in proportion to its rows, so converged blocks keep
+// the combined norm within it. Blocks flagged in `changed` (optional) are
+// written back even when they need no iterations. Fills the iteration and
+// component counts of `out` and returns the norm of all residuals.
+template <typename Iterate>
+double iterate_components(CompiledComponents& compiled,
+                          const std::vector<VarRef>& vars,
+                          const ISolver::SetVar& set,
+                          const ComponentSolveOptions& options,
+                          SolveResult& out,
+                          Iterate iterate,
+                          const std::vector<char>* changed = nullptr) {
+    const std::vector<SolveComponent>& components = compiled.components;
+    const size_t count = components.size();
+
+    // Largest blocks first so one big block does not finish last on its own.
+    std::vector<size_t> order(count);
+    for (size_t k = 0; k < count; ++k) order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return components[a].rows.size() > components[b].rows.size();
+    });
+
+    std::vector<ComponentOutcome> outcomes(count);
+    std::vector<char> iterated(count, 0);
+    std::vector<char> sparse(count, 0);
+    std::mutex progress_mutex;
+    int done = 0;
+    auto report = [&] {
+        if (!options.progress || !*options.progress) return;
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        (*options.progress)(++done, static_cast<int>(count));
+    };
+    const bool parallel = compiled.totalRows >= kParallelComponentMinRows;
+    run_parallel(count, parallel ? options.threads : 1, [&](size_t i) {
+        const size_t k = order[i];
+        const double tol = options.tolerance *
+            std::sqrt(static_cast<double>(components[k].rows.size()) / static_cast<double>(compiled.totalRows));
+        outcomes[k].norm = compiled.programs[k].norm(compiled.xs[k]);
+        if (outcomes[k].norm > tol) {
+            sparse[k] = use_sparse_linear_algebra(options.linearMode, components[k].cols.size(),
+                                                  options.sparseThreshold);
+            outcomes[k] = iterate(k, compiled.programs[k], compiled.xs[k], sparse[k] != 0, tol);
+            iterated[k] = 1;
+        }
+        report();
+    });
+
+    double squared = 0.0;
+    out.componentCount = static_cast<int>(count);
+    out.componentsSolved = 0;
+    for (size_t k = 0; k < count; ++k) {
+        squared += outcomes[k].norm * outcomes[k].norm;
+        out.iterations += outcomes[k].iterations;
+        if (sparse[k]) out.sparseLinearAlgebra = true;
+        if (iterated[k]) ++out.componentsSolved;
+        if (!iterated[k] && !(changed && (*changed)[k])) continue;
+        const std::vector<int>& cols = components[k].cols;
+        for (size_t j = 0; j < cols.size(); ++j) {
+            set(vars[static_cast<size_t>(cols[j])], compiled.xs[k][static_cast<Eigen::Index>(j)]);
+        }
+    }
+    return std::sqrt(squared);
+}
+
+// One-shot solve: compile, iterate with `iterate(program, x, sparse, tol)`
+// and write back.
+template <typename Iterate>
+double solve_components(const std::vector<ConstraintSpec>& constraints,
+                        const std::vector<VarRef>& vars,
+                        const ISolver::GetVar& get,
+                        const ISolver::SetVar& set,
+                        const ComponentSolveOptions& options,
+                        SolveResult& out,
+                        Iterate iterate) {
+    CompiledComponents compiled = compile_components(constraints, vars, get, set);
+    return iterate_components(compiled, vars, set, options, out,
+        [&](size_t, ConstraintProgram& program, Eigen::VectorXd& x, bool sparse, double tol) {
+            return iterate(program, x, sparse, tol);
+        });
+}
+
+// LM state carried from one call to the next on the same block: the damping
+// reached last time and the sparse factorization's symbolic analysis.
+struct LmWarmStart {
+    double lambda{1e-3};
+    SparseLmFactorization factorization;
+};
+
+// Levenberg-Marquardt on one block.
+ComponentOutcome lm_iterations(ConstraintProgram& program, Eigen::VectorXd& x, bool sparse,
+                               int max_iters, double tol, LmWarmStart* warm = nullptr,
+                               const StopFlags* stop = nullptr) {
+    ComponentOutcome outcome;
+    double prev = program.norm(x);
+    LmWarmStart local;
+    LmWarmStart& state = warm ? *warm : local;
+    double lambda = state.lambda;
+    Eigen::VectorXd rvec;
+    Eigen::VectorXd g;
+    Eigen::MatrixXd J;
+    Eigen::MatrixXd JtJ;
+    SparseJacobian sparseJtJ;
+    bool stale = true; // x moved since the normal equations were formed
+
+    for (int it = 0; it < max_iters; ++it) {
+        if (stop && stop->raised()) break;
+        outcome.iterations++;
+        // Exact Jacobian (dual numbers). A rejected step leaves x
+        // unchanged, so only the damping changes.
+        if (stale) {
+            program.residuals(x, rvec);
+            if (sparse) {
+                program.normalEquations(x, rvec, sparseJtJ, g);
+            } else {
+                program.jacobian(x, J);
+                JtJ = J.transpose() * J;
+                g = J.transpose() * rvec;
+            }
+            stale = false;
+        }
+
+        Eigen::VectorXd delta;
+        if (sparse) {
+            delta = sparse_lm_step(sparseJtJ, g, lambda, state.factorization);
+        } else {
+            Eigen::MatrixXd A = JtJ;
+            A.diagonal().array() += lambda;
+            delta = A.ldlt().solve(-g);
+        }
+
+        Eigen::VectorXd newX = x + delta;
+        double newNorm = program.norm(newX);
+
+        if (newNorm < prev) {
+            x = newX; prev = newNorm;
+            lambda = std::max(1e-10, lambda * 0.1);
+            stale = true;
+        } else {
+            lambda *= 10.0;
+        }
+        if (prev <= tol) break;
+    }
+    state.lambda = lambda;
+    outcome.norm = prev;
+    return outcome;
+}
+
+// Powell's dogleg trust region on one block, finishing with LM when it stalls.
+ComponentOutcome dogleg_iterations(ConstraintProgram& program, Eigen::VectorXd& x, bool sparse,
+                                   int max_iters, double tol, const StopFlags* stop = nullptr) {
+    Eigen::VectorXd rvec;
+    Eigen::MatrixXd J;
+    SparseJacobian sparseJ;
+    SparseGnFactorization factorization;
+
+    double trustRadius = 1.0;
+    const double trustMax = 100.0;
+    const double trustMin = 1e-12;
+    int it = 0;
+
+    for (; it < max_iters; ++it) {
+        if (stop && stop->raised()) break;
+        double currentNorm = program.norm(x);
+        if (currentNorm <= tol) break;
+
+        // Residual vector
+        program.residuals(x, rvec);
+
+        // Exact Jacobian (dual numbers), gradient g = J^T r and the
+        // Gauss-Newton step
+        Eigen::VectorXd g;
+        Eigen::VectorXd delta_gn;
+        Eigen::VectorXd Jg;
+        if (sparse) {
+            program.jacobian(x, sparseJ);
+            g = sparseJ.transpose() * rvec;
+            delta_gn = sparse_gauss_newton_step(sparseJ, rvec, factorization, stop);
+            if (delta_gn.size() == 0) break; // stopped mid-step
+            Jg = sparseJ * g;
+        } else {
+            program.jacobian(x, J);
+            g = J.transpose() * rvec;
+            // Gauss-Newton step: solve J^T J delta_gn = -J^T r
+            Eigen::MatrixXd JtJ = J.transpose() * J;
+            delta_gn = JtJ.colPivHouseholderQr().solve(-g);
+            Jg = J * g;
+        }
+
+        // Steepest descent step: delta_sd = -alpha * g where alpha = ||g||^2 / ||J*g||^2
+        double g_norm2 = g.squaredNorm();
+        double Jg_norm2 = Jg.squaredNorm();
+        double alpha = (Jg_norm2 > 1e-30) ? (g_norm2 / Jg_norm2) : 1.0;
+        Eigen::VectorXd delta_sd = -alpha * g;
+
+        // DogLeg interpolation
+        Eigen::VectorXd delta;
+        double gn_norm = delta_gn.norm();
+        double sd_norm = delta_sd.norm();
+
+        if (gn_norm <= trustRadius) {
+            // Gauss-Newton step is within trust region
+            delta = delta_gn;
+        } else if (sd_norm >= trustRadius) {
+            // Steepest descent step is outside trust region; scale it
+            delta = (trustRadius / sd_norm) * delta_sd;
+        } else {
+            // Interpolate between steepest descent and Gauss-Newton
+            Eigen::VectorXd diff = delta_gn - delta_sd;
+            double a_coeff = diff.squaredNorm();
+            double b_coeff = 2.0 * delta_sd.dot(diff);
+            double c_coeff = delta_sd.squaredNorm() - trustRadius * trustRadius;
+            double discriminant = b_coeff * b_coeff - 4.0 * a_coeff * c_coeff;
+            double beta = (-b_coeff + std::sqrt(std::max(0.0, discriminant))) / (2.0 * a_coeff);
+            beta = std::max(0.0, std::min(1.0, beta));
+            delta = delta_sd + beta * diff;
+        }
+
+        // Trial step
+        Eigen::VectorXd newX = x + delta;
+        double newNorm = program.norm(newX);
+
+        // Predicted reduction
+        Eigen::VectorXd predicted_r = rvec;
+        if (sparse) {
+            predicted_r += sparseJ * delta;
+        } else {
+            predicted_r += J * delta;
+        }
+        double predicted_norm = predicted_r.norm();
+        double actual_reduction = currentNorm * currentNorm - newNorm * newNorm;
+        double predicted_reduction = currentNorm * currentNorm - predicted_norm * predicted_norm;
+
+        double rho = (predicted_reduction > 1e-30) ? (actual_reduction / predicted_reduction) : 0.0;
+
+        if (rho > 0.0 && newNorm < currentNorm) {
+            // Accept step
+            x = newX;
+        }
+
+        // Update trust radius
+        if (rho < 0.25) {
+            trustRadius = std::max(trustMin, trustRadius * 0.25);
+        } else if (rho > 0.75) {
+            trustRadius = std::min(trustMax, trustRadius * 2.0);
+        }
+
+        if (newNorm <= tol) break;
+    }
+
+    ComponentOutcome outcome;
+    outcome.norm = program.norm(x);
+    if (outcome.norm > tol && !(stop && stop->raised())) {
+        // If DogLeg didn't converge, fall back to LM from the current x
+        outcome = lm_iterations(program, x, sparse, max_iters, tol, nullptr, stop);
+        outcome.norm = program.norm(x);
+    }
+    outcome.iterations += it;
+    return outcome;
+}
+
+// BFGS on one block: minimizes F(x) = 0.5 * ||r(x)||^2 with the exact
+// gradient J^T r. On the sparse path J stays sparse, and the dense inverse
+// Hessian gives way to L-BFGS.
+ComponentOutcome bfgs_iterations(ConstraintProgram& program, Eigen::VectorXd& x, bool sparse,
+                                 int max_iters, double tol, const StopFlags* stop = nullptr) {
+    const Eigen::Index n = x.size();
+    auto eval_F = [&](const Eigen::VectorXd& xv) -> double {
+        return 0.5 * program.squaredNorm(xv);
+    };
+    Eigen::VectorXd rvec;
+    Eigen::MatrixXd J;
+    SparseJacobian sparseJ;
+    auto eval_grad = [&](const Eigen::VectorXd& xv) -> Eigen::VectorXd {
+        program.residuals(xv, rvec);
+        if (sparse) {
+            program.jacobian(xv, sparseJ);
+            return sparseJ.transpose() * rvec;
+        }
+        program.jacobian(xv, J);
+        return J.transpose() * rvec;
+    };
+
+    // Initialize inverse Hessian approximation as identity
+    Eigen::MatrixXd H = sparse ? Eigen::MatrixXd() : Eigen::MatrixXd::Identity(n, n);
+    LbfgsHistory history(8);
+    double fx = eval_F(x);
+    Eigen::VectorXd grad = eval_grad(x);
+    int it = 0;
+
+    for (; it < max_iters; ++it) {
+        if (stop && stop->raised()) break;
+        if (std::sqrt(2.0 * fx) <= tol) break;
+
+        // Search direction
+        Eigen::VectorXd p = sparse ? history.direction(grad) : Eigen::VectorXd(-H * grad);
+
+        // Backtracking line search (Armijo condition)
+        double alpha = 1.0;
+        const double c1 = 1e-4;
+        double gp = grad.dot(p);
+        for (int ls = 0; ls < 20; ++ls) {
+            Eigen::VectorXd x_new = x + alpha * p;
+            double fx_new = eval_F(x_new);
+            if (fx_new <= fx + c1 * alpha * gp) break;
+            alpha *= 0.5;
+        }
+
+        Eigen::VectorXd x_new = x + alpha * p;
+        double fx_new = eval_F(x_new);
+        Eigen::VectorXd grad_new = eval_grad(x_new);
+
+        // BFGS update
+        Eigen::VectorXd s = x_new - x;
+        Eigen::VectorXd y = grad_new - grad;
+        double ys = y.dot(s);
+
+        if (ys > 1e-10 && sparse) {
+            history.push(s, y, ys);
+        } else if (ys > 1e-10) {
+            // Sherman-Morrison-Woodbury formula for H update
+            Eigen::MatrixXd I = Eigen::MatrixXd::Identity(n, n);
+            Eigen::MatrixXd rho_sy = (s * y.transpose()) / ys;
+            H = (I - rho_sy) * H * (I - rho_sy.transpose()) + (s * s.transpose()) / ys;
+        }
+
+        x = x_new;
+        fx = fx_new;
+        grad = grad_new;
+    }
+
+    ComponentOutcome outcome;
+    outcome.iterations = it;
+    outcome.norm = std::sqrt(2.0 * fx);
+    return outcome;
+}
+
+// Drops the human-facing selection text (explanations, tags, summaries,
+// action labels/hints and policies), keeping indices, keys and scores.
+void clear_selection_text(ConstraintAnalysis& analysis) {
+    analysis.primaryConflictSelectionExplanation.clear();
+    analysis.primaryRedundancySelectionExplanation.clear();
+    analysis.smallestConflictSelectionExplanation.clear();
+    analysis.smallestRedundancySelectionExplanation.clear();
+    analysis.primaryConflictSelectionTag.clear();
+    analysis.primaryRedundancySelectionTag.clear();
+    analysis.smallestConflictSelectionTag.clear();
+    analysis.smallestRedundancySelectionTag.clear();
+    analysis.primaryConflictSelectionSummary.clear();
+    analysis.primaryRedundancySelectionSummary.clear();
+    analysis.smallestConflictSelectionSummary.clear();
+    analysis.smallestRedundancySelectionSummary.clear();
+    analysis.primaryConflictActionLabel.clear();
+    analysis.primaryRedundancyActionLabel.clear();
+    analysis.smallestConflictActionLabel.clear();
+    analysis.smallestRedundancyActionLabel.clear();
+    analysis.primaryConflictActionHint.clear();
+    analysis.primaryRedundancyActionHint.clear();
+    analysis.smallestConflictActionHint.clear();
+    analysis.smallestRedundancyActionHint.clear();
+    analysis.primaryConflictSelectionPolicy.clear();
+    analysis.primaryRedundancySelectionPolicy.clear();
+    analysis.smallestConflictSelectionPolicy.clear();
+    analysis.smallestRedundancySelectionPolicy.clear();
+}
+
+// Structural analysis of the (validated) constraints, as deep as `level`
+// asks for. Runs before substitution so reports index the caller's
+// constraints and keys.
+void analyze_structure(const std::vector<ConstraintSpec>& constraints,
+                       const ISolver::GetVar& get,
+                       const ISolver::SetVar& set,
+                       SolverDiagnosticsLevel level,
+                       SolveResult& out) {
+    if (level == SolverDiagnosticsLevel::None) return;
+    const std::vector<VarRef> analysis_vars = collect_unique_vars(constraints);
+    if (level == SolverDiagnosticsLevel::Counts) {
+        populate_jacobian_analysis(constraints, analysis_vars, get, set, out.analysis, nullptr, nullptr);
+        return;
+    }
+    populate_jacobian_analysis(constraints, analysis_vars, get, set,
+        out.analysis, &out.structuralGroups, &out.redundancySubsets);
+    collect_conflict_groups(out.structuralGroups, out);
+    collect_problematic_constraint_indices(out.structuralGroups, out);
+    out.primaryRedundancyBasisConstraintIndices.clear();
+    out.primaryRedundantConstraintIndices.clear();
+    out.smallestRedundancyBasisConstraintIndices.clear();
+    out.smallestRedundantConstraintIndices.clear();
+    out.analysis.primaryRedundancyVariableKeys.clear();
+    out.analysis.smallestRedundancyVariableKeys.clear();
+    if (!out.redundancySubsets.empty()) {
+        out.primaryRedundancyBasisConstraintIndices = out.redundancySubsets.front().basisConstraintIndices;
+        out.primaryRedundantConstraintIndices = out.redundancySubsets.front().redundantConstraintIndices;
+        out.analysis.primaryRedundancyVariableKeys = out.redundancySubsets.front().variableKeys;
+        const auto smallest_it = std::find_if(
+            out.redundancySubsets.begin(), out.redundancySubsets.end(),
+            [&](const ConstraintRedundancySubset& subset) {
+                return subset.anchorConstraintIndex == out.analysis.smallestRedundancySubsetAnchorConstraintIndex;
+            });
+        if (smallest_it != out.redundancySubsets.end()) {
+            out.smallestRedundancyBasisConstraintIndices = smallest_it->basisConstraintIndices;
+            out.smallestRedundantConstraintIndices = smallest_it->redundantConstraintIndices;
+            out.analysis.smallestRedundancyVariableKeys = smallest_it->variableKeys;
+        }
+    }
+    if (level == SolverDiagnosticsLevel::Structural) clear_selection_text(out.analysis);
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --- Presolve ---
+// Residuals presolve treats as zero, and pivots it refuses to divide by.
+constexpr double kPresolveZero = 1e-12;
+
+// Kinds whose residual is affine in its operands, so a row with one unknown
+// left is solved exactly by a single Newton step. 2D kinds qualify only as
+// expanded x/y rows.
+bool presolve_linear(ConstraintKind kind, const ConstraintSpec& spec) {
+    switch (kind) {
+        case ConstraintKind::Horizontal:
+        case ConstraintKind::Vertical:
+        case ConstraintKind::Equal:
+        case ConstraintKind::EqualRadius:
+        case ConstraintKind::FixedPoint:
+        case ConstraintKind::ArcAngle:
+            return true;
+        case ConstraintKind::Coincident:
+        case ConstraintKind::Concentric:
+        case ConstraintKind::Symmetric:
+        case ConstraintKind::Midpoint:
+            return spec.value.has_value();
+        default:
+            return false;
+    }
+}
+
+Dual presolve_residual(const ConstraintSpec& spec, ConstraintKind kind,
+                       const std::vector<int>& operands, const std::vector<double>& values) {
+    Dual v[kMaxOperands];
+    for (size_t k = 0; k < operands.size(); ++k) {
+        v[k] = Dual(values[static_cast<size_t>(operands[k])]);
+        v[k].d[k] = 1.0;
+    }
+    return constraint_residual(kind, v, spec.value.value_or(0.0), is_y_component(spec));
+}
+
+// What the iterations run on once aliases are merged and presolve took out
+// what it could. Rows presolve left without unknowns cannot be iterated but
+// still count toward the final error through `constantResidualSq`.
+struct ReducedSystem {
+    std::vector<ConstraintSpec> constraints;
+    std::vector<VarRef> vars;
+    double constantResidualSq{0.0};
+};
+
+// Repeatedly takes a linear row with one unknown left, solves it for that
+// unknown and writes the value (which may leave further rows with one
+// unknown), then drops every row left without unknowns. Unknowns are the
+// writable variables a row actually depends on: a fixed_point row does not
+// wait for the coordinate it only names. `origin` maps `constraints` to the
+// caller's indices for the report.
+ReducedSystem presolve_constraints(const std::vector<ConstraintSpec>& constraints,
+                                   const std::vector<int>& origin,
+                                   const ISolver::GetVar& get,
+                                   const ISolver::SetVar& set,
+                                   SolveResult& out) {
+    const std::vector<VarRef> vars = collect_unique_vars(constraints);
+    std::unordered_map<std::string, int> var_index;
+    var_index.reserve(vars.size());
+    for (size_t j = 0; j < vars.size(); ++j) var_index.emplace(format_var_ref(vars[j]), static_cast<int>(j));
+    std::vector<char> known = read_only_vars(vars, get, set);
+    std::vector<double> values(vars.size(), 0.0);
+    for (size_t j = 0; j < vars.size(); ++j) {
+        bool ok = false;
+        values[j] = get(vars[j], ok);
+        if (!ok || !std::isfinite(values[j])) known[j] = 1;
+    }
+
+    const size_t m = constraints.size();
+    std::vector<ConstraintKind> kinds(m, ConstraintKind::Unknown);
+    std::vector<std::vector<int>> refs(m);     // every var the row names, as indices
+    std::vector<std::vector<int>> operands(m); // the ones its residual reads
+    std::vector<std::vector<int>> relevant(m); // distinct vars the residual depends on
+    std::vector<int> unknowns(m, -1);          // -1: row is left to the iterations as is
+    std::vector<std::vector<int>> rows_of(vars.size());
+    std::vector<int> queue;
+    for (size_t i = 0; i < m; ++i) {
+        const ConstraintSpec& spec = constraints[i];
+        refs[i].reserve(spec.vars.size());
+        for (const VarRef& var : spec.vars) refs[i].push_back(var_index.at(format_var_ref(var)));
+        kinds[i] = classifyConstraintKind(spec.type);
+        if (!has_residual_operands(spec, kinds[i])) continue;
+        const int arity = expected_arity(kinds[i]);
+        operands[i].assign(refs[i].begin(), refs[i].begin() + arity);
+        const Dual r = presolve_residual(spec, kinds[i], operands[i], values);
+        const bool linear = presolve_linear(kinds[i], spec);
+        for (int k = 0; k < arity; ++k) {
+            const int var = operands[i][static_cast<size_t>(k)];
+            if (std::find(relevant[i].begin(), relevant[i].end(), var) != relevant[i].end()) continue;
+            double coefficient = 0.0;
+            for (int l = 0; l < arity; ++l) {
+                if (operands[i][static_cast<size_t>(l)] == var) coefficient += r.d[l];
+            }
+            if (linear && std::abs(coefficient) <= kPresolveZero) continue;
+            relevant[i].push_back(var);
+        }
+        unknowns[i] = 0;
+        for (int var : relevant[i]) {
+            if (known[static_cast<size_t>(var)]) continue;
+            ++unknowns[i];
+            rows_of[static_cast<size_t>(var)].push_back(static_cast<int>(i));
+        }
+        if (unknowns[i] <= 1) queue.push_back(static_cast<int>(i));
+    }
+
+    std::vector<char> removed(m, 0);
+    std::vector<char> eliminated(vars.size(), 0);
+    ReducedSystem reduced;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const size_t i = static_cast<size_t>(queue[head]);
+        if (removed[i]) continue;
+        const ConstraintSpec& spec = constraints[i];
+        if (unknowns[i] == 0) {
+            removed[i] = 1;
+            const double r = presolve_residual(spec, kinds[i], operands[i], values).v;
+            if (std::abs(r) <= kPresolveZero) {
+                out.presolvedConstraints.push_back(
+                    PresolvedConstraint{origin[i], PresolveAction::Satisfied, std::string()});
+            } else {
+                reduced.constantResidualSq += r * r;
+            }
+            continue;
+        }
+        if (unknowns[i] != 1 || !presolve_linear(kinds[i], spec)) continue;
+        int var = -1;
+        for (int candidate : relevant[i]) {
+            if (!known[static_cast<size_t>(candidate)]) var = candidate;
+        }
+        const Dual r = presolve_residual(spec, kinds[i], operands[i], values);
+        double coefficient = 0.0;
+        for (size_t k = 0; k < operands[i].size(); ++k) {
+            if (operands[i][k] == var) coefficient += r.d[k];
+        }
+        const size_t j = static_cast<size_t>(var);
+        values[j] -= r.v / coefficient;
+        set(vars[j], values[j]);
+        known[j] = 1;
+        eliminated[j] = 1;
+        removed[i] = 1;
+        out.presolvedConstraints.push_back(PresolvedConstraint{origin[i],
+            kinds[i] == ConstraintKind::FixedPoint ? PresolveAction::Fixed : PresolveAction::Substituted,
+            format_var_ref(vars[j])});
+        for (int row : rows_of[j]) {
+            if (removed[static_cast<size_t>(row)]) continue;
+            if (--unknowns[static_cast<size_t>(row)] <= 1) queue.push_back(row);
+        }
+    }
+
+    // Same first-use order as collect_unique_vars over the kept rows.
+    std::vector<char> listed(eliminated);
+    reduced.constraints.reserve(m);
+    for (size_t i = 0; i < m; ++i) {
+        if (removed[i]) continue;
+        reduced.constraints.push_back(constraints[i]);
+        for (int var : refs[i]) {
+            if (listed[static_cast<size_t>(var)]) continue;
+            listed[static_cast<size_t>(var)] = 1;
+            reduced.vars.push_back(vars[static_cast<size_t>(var)]);
+        }
+    }
+    return reduced;
+}
+
+// Reports the rows substitution merged away, then presolves the rest (when
+// enabled). `expanded` and `origin` are the rows substitution ran on and
+// their indices among the caller's constraints.
+ReducedSystem reduce_system(const std::vector<ConstraintSpec>& expanded,
+                            const std::vector<int>& origin,
+                            const SubstitutionResult& substitutions,
+                            const ISolver::GetVar& redirected_get,
+                            const ISolver::SetVar& set,
+                            bool presolve,
+                            SolveResult& out) {
+    for (int row : substitutions.aliasedRows) {
+        std::string lhs;
+        std::string rhs;
+        try_extract_alias_pair(expanded[static_cast<size_t>(row)], &lhs, &rhs);
+        const std::string& merged = substitutions.redirect.count(rhs) ? rhs : lhs;
+        out.presolvedConstraints.push_back(
+            PresolvedConstraint{origin[static_cast<size_t>(row)], PresolveAction::Aliased, merged});
+    }
+    if (!presolve) {
+        return ReducedSystem{substitutions.reduced, collect_unique_vars(substitutions.reduced), 0.0};
+    }
+    std::vector<int> reduced_origin;
+    reduced_origin.reserve(substitutions.reducedRows.size());
+    for (int row : substitutions.reducedRows) reduced_origin.push_back(origin[static_cast<size_t>(row)]);
+    return presolve_constraints(substitutions.reduced, reduced_origin, redirected_get, set, out);
+}
+
+} // namespace
+
+class MinimalSolver : public ISolver {
+    int maxIters_ = 50;
+    double tol_ = 1e-6;
+    SolverLinearMode linearMode_ = SolverLinearMode::Auto;
+    int sparseThreshold_ = kDefaultSparseSolverThreshold;
+    int threadCount_ = 0;
+    SolverDiagnosticsLevel diagnosticsLevel_ = SolverDiagnosticsLevel::Full;
+    bool presolve_ = true;
+    StopFlags stop_;
+    ProgressCallback progress_;
+public:
+    void setMaxIterations(int iters) override { maxIters_ = iters; }
+    void setTolerance(double tol) override { tol_ = tol; }
+    void setLinearMode(SolverLinearMode mode) override { linearMode_ = mode; }
+    void setSparseThreshold(int unknowns) override { sparseThreshold_ = unknowns; }
+    void setThreadCount(int threads) override { threadCount_ = threads; }
+    void setDiagnosticsLevel(SolverDiagnosticsLevel level) override { diagnosticsLevel_ = level; }
+    void setPresolve(bool enabled) override { presolve_ = enabled; }
+    void setCancellationFlag(const std::atomic<bool>* flag) override { stop_.caller = flag; }
+    void setProgressCallback(ProgressCallback callback) override { progress_ = std::move(callback); }
+    // Portfolio races share one flag that the winner raises.
+    void setRaceFlag(const std::atomic<bool>* flag) { stop_.race = flag; }
+
+    // NOTE: This is a stub that only evaluates residuals without modifying vars.
+    SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
+        // Legacy stub
+        SolveResult r;
+        const auto report = validate_constraints(constraints, nullptr);
+        r.diagnostics = report.diagnostics;
+        r.redundancyGroups = report.redundancyGroups;
+        r.analysis = report.analysis;
+        r.ok = r.diagnostics.empty();
         r.iterations = 0;
         r.finalError = 0.0;
         r.message = r.ok ? "Converged (no-op stub)" : "Constraint validation failed";
@@ -1923,7 +2625,6 @@ public:
     }
 
     SolveResult solveWithBindings(std::vector<ConstraintSpec>& constraints, const GetVar& get, const SetVar& set) override {
-        // Reuse MinimalSolver's validation and residual setup
         SolveResult out;
         const auto report = validate_constraints(constraints, &get);
         out.diagnostics = report.diagnostics;
@@ -1937,44 +2638,16 @@ public:
             return out;
         }
 
-        const std::vector<ConstraintSpec> analysis_constraints = constraints;
-        const std::vector<VarRef> analysis_vars = collect_unique_vars(analysis_constraints);
-        auto analysis_residual = [&](const ConstraintSpec& c, bool& ok)->double {
-            return residual_for_constraint(c, get, ok);
-        };
-        Eigen::VectorXd analysis_x(analysis_vars.size());
-        for (size_t j = 0; j < analysis_vars.size(); ++j) {
-            bool okv = false;
-            analysis_x[static_cast<Eigen::Index>(j)] = get(analysis_vars[j], okv);
-        }
-        populate_jacobian_analysis(analysis_constraints, analysis_vars, set, analysis_x, analysis_residual,
-            out.analysis, &out.structuralGroups, &out.redundancySubsets);
-        collect_conflict_groups(out.structuralGroups, out);
-        collect_problematic_constraint_indices(out.structuralGroups, out);
-        out.primaryRedundancyBasisConstraintIndices.clear();
-        out.primaryRedundantConstraintIndices.clear();
-        out.smallestRedundancyBasisConstraintIndices.clear();
-        out.smallestRedundantConstraintIndices.clear();
-        out.analysis.primaryRedundancyVariableKeys.clear();
-        out.analysis.smallestRedundancyVariableKeys.clear();
-        if (!out.redundancySubsets.empty()) {
-            out.primaryRedundancyBasisConstraintIndices = out.redundancySubsets.front().basisConstraintIndices;
-            out.primaryRedundantConstraintIndices = out.redundancySubsets.front().redundantConstraintIndices;
-            out.analysis.primaryRedundancyVariableKeys = out.redundancySubsets.front().variableKeys;
-            const auto smallest_it = std::find_if(
-                out.redundancySubsets.begin(), out.redundancySubsets.end(),
-                [&](const ConstraintRedundancySubset& subset) {
-                    return subset.anchorConstraintIndex == out.analysis.smallestRedundancySubsetAnchorConstraintIndex;
-                });
-            if (smallest_it != out.redundancySubsets.end()) {
-                out.smallestRedundancyBasisConstraintIndices = smallest_it->basisConstraintIndices;
-                out.smallestRedundantConstraintIndices = smallest_it->redundantConstraintIndices;
-                out.analysis.smallestRedundancyVariableKeys = smallest_it->variableKeys;
-            }
-        }
+        // Expand 2D constraints (symmetric, midpoint) into x/y sub-constraint pairs
+        std::vector<int> origin;
+        const std::vector<ConstraintSpec> expanded = expand_xy_constraints(constraints, &origin);
 
-        const SubstitutionResult substitutions = build_substitutions(constraints);
-        const std::vector<ConstraintSpec>& working_constraints = substitutions.reduced;
+        auto phase_start = std::chrono::steady_clock::now();
+        analyze_structure(expanded, get, set, diagnosticsLevel_, out);
+        out.analysisTimeMs = elapsed_ms(phase_start);
+
+        phase_start = std::chrono::steady_clock::now();
+        const SubstitutionResult substitutions = build_substitutions(expanded);
         auto redirected_get = [&](const VarRef& v, bool& ok) -> double {
             const auto it = substitutions.redirect.find(format_var_ref(v));
             if (it == substitutions.redirect.end()) {
@@ -1982,250 +2655,135 @@ public:
             }
             return get(parse_var_ref(it->second), ok);
         };
-        auto residual = [&](const ConstraintSpec& c, bool& ok)->double {
-            return residual_for_constraint(c, redirected_get, ok);
-        };
-
-        const std::vector<VarRef> vars = collect_unique_vars(working_constraints);
-        const size_t n = vars.size();
-        const size_t m = working_constraints.size();
+        const ReducedSystem reduced = reduce_system(expanded, origin, substitutions, redirected_get, set,
+                                                    presolve_, out);
+        out.presolveTimeMs = elapsed_ms(phase_start);
+        const size_t n = reduced.vars.size();
+        const size_t m = reduced.constraints.size();
         if (n == 0 || m == 0) {
-            sync_redirected_aliases(substitutions.redirect, get, set);
-            out.ok = true; out.iterations = 0; out.finalError = 0.0;
-            return out;
-        }
-
-        Eigen::VectorXd x(n);
-        for (size_t j = 0; j < n; ++j) {
-            bool okv = false;
-            x[static_cast<Eigen::Index>(j)] = redirected_get(vars[j], okv);
+             sync_redirected_aliases(substitutions.redirect, get, set);
+             out.iterations = 0;
+             out.finalError = std::sqrt(reduced.constantResidualSq);
+             out.ok = (out.finalError <= tol_);
+             if (!out.ok) out.message = "Stopped (inconsistent presolved constraints)";
+             return out;
         }
 
-        auto write_x = [&](const Eigen::VectorXd& currX){
-            for (size_t j = 0; j < n; ++j) {
-                set(vars[j], currX[static_cast<Eigen::Index>(j)]);
-            }
-        };
-
-        auto eval_residuals = [&](Eigen::VectorXd& rvec) {
-            for (size_t i=0; i<m; ++i) { bool okc=false; rvec[static_cast<Eigen::Index>(i)] = residual(working_constraints[i], okc); }
-        };
-        auto eval_norm = [&]() {
-            double s=0.0;
-            for (const auto& c: working_constraints){ bool okc=false; double rr=residual(c, okc); s += rr*rr; }
-            return std::sqrt(s);
-        };
-
-        write_x(x);
-        double trustRadius = 1.0;
-        const double trustMax = 100.0;
-        const double trustMin = 1e-12;
-        int it = 0;
-
-        for (; it < maxIters_; ++it) {
-            write_x(x);
-            double currentNorm = eval_norm();
-            if (currentNorm <= tol_) break;
-
-            // Residual vector
-            Eigen::VectorXd rvec(m);
-            eval_residuals(rvec);
-
-            // Jacobian — analytical where supported, numerical fallback
-            Eigen::MatrixXd J(m, n);
-            const double eps = 1e-7;
-            for (size_t j=0; j<n; ++j) {
-                bool need_numerical = false;
-                std::vector<char> needs_numerical_row(m, 0);
-                for (size_t i=0; i<m; ++i) {
-                    const auto& cc = working_constraints[i];
-                    if (has_analytical_gradient(cc)) {
-                        int vidx = -1;
-                        for (int k = 0; k < static_cast<int>(cc.vars.size()); ++k) {
-                            if (cc.vars[k].id == vars[j].id && cc.vars[k].key == vars[j].key) {
-                                vidx = k; break;
-                            }
-                        }
-                        bool ok = false;
-                        double grad = (vidx >= 0) ? analytical_gradient(cc, vidx, get, ok) : 0.0;
-                        if (vidx >= 0 && ok && std::isfinite(grad)) {
-#ifndef NDEBUG
-                            verify_analytical_gradient(cc, vidx, grad, get, set,
-                                vars, static_cast<int>(j), residual);
-#endif
-                            J(i, j) = grad;
-                        } else if (vidx < 0) {
-                            J(i, j) = 0.0;
-                        } else {
-                            need_numerical = true;
-                            needs_numerical_row[i] = 1;
-                        }
-                    } else {
-                        need_numerical = true;
-                        needs_numerical_row[i] = 1;
-                    }
-                }
-                if (need_numerical) {
-                    double xj = x[j];
-                    set(vars[j], xj + eps);
-                    for (size_t i=0; i<m; ++i) {
-                        if (needs_numerical_row[i]) {
-                            bool okc=false;
-                            J(i, j) = (residual(working_constraints[i], okc) - rvec[i]) / eps;
-                        }
-                    }
-                    set(vars[j], xj);
-                }
-            }
-
-            // Gradient g = J^T * r
-            Eigen::VectorXd g = J.transpose() * rvec;
+        // Partitioned solving: each connected component runs its own LM.
+        const ComponentSolveOptions options{tol_, linearMode_, sparseThreshold_, threadCount_, &progress_};
+        phase_start = std::chrono::steady_clock::now();
+        double finalErr = solve_components(reduced.constraints, reduced.vars, redirected_get, set, options, out,
+            [&](ConstraintProgram& program, Eigen::VectorXd& x, bool sparse, double tol) {
+                return lm_iterations(program, x, sparse, maxIters_, tol, nullptr, &stop_);
+            });
+        out.iterationTimeMs = elapsed_ms(phase_start);
+        finalErr = std::sqrt(finalErr * finalErr + reduced.constantResidualSq);
+        sync_redirected_aliases(substitutions.redirect, get, set);
+        out.ok = (finalErr <= tol_);
+        out.finalError = finalErr;
+        out.message = (out.ok ? "Converged (partitioned LM)" : "Stopped (max iters or stagnation)");
+        if (!out.ok && stop_.raised()) out.message = "Cancelled";
+        return out;
+    }
+};
 
-            // Gauss-Newton step: solve J^T J delta_gn = -J^T r
-            Eigen::MatrixXd JtJ = J.transpose() * J;
-            Eigen::VectorXd delta_gn = JtJ.colPivHouseholderQr().solve(-g);
-
-            // Steepest descent step: delta_sd = -alpha * g where alpha = ||g||^2 / ||J*g||^2
-            Eigen::VectorXd Jg = J * g;
-            double g_norm2 = g.squaredNorm();
-            double Jg_norm2 = Jg.squaredNorm();
-            double alpha = (Jg_norm2 > 1e-30) ? (g_norm2 / Jg_norm2) : 1.0;
-            Eigen::VectorXd delta_sd = -alpha * g;
-
-            // DogLeg interpolation
-            Eigen::VectorXd delta;
-            double gn_norm = delta_gn.norm();
-            double sd_norm = delta_sd.norm();
-
-            if (gn_norm <= trustRadius) {
-                // Gauss-Newton step is within trust region
-                delta = delta_gn;
-            } else if (sd_norm >= trustRadius) {
-                // Steepest descent step is outside trust region; scale it
-                delta = (trustRadius / sd_norm) * delta_sd;
-            } else {
-                // Interpolate between steepest descent and Gauss-Newton
-                Eigen::VectorXd diff = delta_gn - delta_sd;
-                double a_coeff = diff.squaredNorm();
-                double b_coeff = 2.0 * delta_sd.dot(diff);
-                double c_coeff = delta_sd.squaredNorm() - trustRadius * trustRadius;
-                double discriminant = b_coeff * b_coeff - 4.0 * a_coeff * c_coeff;
-                double beta = (-b_coeff + std::sqrt(std::max(0.0, discriminant))) / (2.0 * a_coeff);
-                beta = std::max(0.0, std::min(1.0, beta));
-                delta = delta_sd + beta * diff;
-            }
+class DogLegSolver : public ISolver {
+    int maxIters_ = 80;
+    double tol_ = 1e-6;
+    SolverLinearMode linearMode_ = SolverLinearMode::Auto;
+    int sparseThreshold_ = kDefaultSparseSolverThreshold;
+    int threadCount_ = 0;
+    SolverDiagnosticsLevel diagnosticsLevel_ = SolverDiagnosticsLevel::Full;
+    bool presolve_ = true;
+    StopFlags stop_;
+    ProgressCallback progress_;
+public:
+    void setMaxIterations(int iters) override { maxIters_ = iters; }
+    void setTolerance(double tol) override { tol_ = tol; }
+    void setLinearMode(SolverLinearMode mode) override { linearMode_ = mode; }
+    void setSparseThreshold(int unknowns) override { sparseThreshold_ = unknowns; }
+    void setThreadCount(int threads) override { threadCount_ = threads; }
+    void setDiagnosticsLevel(SolverDiagnosticsLevel level) override { diagnosticsLevel_ = level; }
+    void setPresolve(bool enabled) override { presolve_ = enabled; }
+    void setCancellationFlag(const std::atomic<bool>* flag) override { stop_.caller = flag; }
+    void setProgressCallback(ProgressCallback callback) override { progress_ = std::move(callback); }
+    // Portfolio races share one flag that the winner raises.
+    void setRaceFlag(const std::atomic<bool>* flag) { stop_.race = flag; }
 
-            // Trial step
-            Eigen::VectorXd newX = x + delta;
-            write_x(newX);
-            double newNorm = eval_norm();
+    SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
+        SolveResult r;
+        const auto report = validate_constraints(constraints, nullptr);
+        r.diagnostics = report.diagnostics;
+        r.redundancyGroups = report.redundancyGroups;
+        r.analysis = report.analysis;
+        r.ok = r.diagnostics.empty();
+        r.iterations = 0;
+        r.finalError = 0.0;
+        r.message = r.ok ? "Converged (no-op stub)" : "Constraint validation failed";
+        return r;
+    }
 
-            // Predicted reduction
-            Eigen::VectorXd predicted_r = rvec + J * delta;
-            double predicted_norm = predicted_r.norm();
-            double actual_reduction = currentNorm * currentNorm - newNorm * newNorm;
-            double predicted_reduction = currentNorm * currentNorm - predicted_norm * predicted_norm;
+    SolveResult solveWithBindings(std::vector<ConstraintSpec>& constraints, const GetVar& get, const SetVar& set) override {
+        // Reuse MinimalSolver's validation and residual setup
+        SolveResult out;
+        out.algorithm = SolverAlgorithm::DogLeg;
+        const auto report = validate_constraints(constraints, &get);
+        out.diagnostics = report.diagnostics;
+        out.redundancyGroups = report.redundancyGroups;
+        out.analysis = report.analysis;
+        if (!out.diagnostics.empty()) {
+            out.ok = false;
+            out.iterations = 0;
+            out.finalError = 0.0;
+            out.message = "Constraint validation failed";
+            return out;
+        }
 
-            double rho = (predicted_reduction > 1e-30) ? (actual_reduction / predicted_reduction) : 0.0;
+        // Expand 2D constraints into x/y sub-constraint pairs, as LM and BFGS do
+        std::vector<int> origin;
+        const std::vector<ConstraintSpec> expanded = expand_xy_constraints(constraints, &origin);
 
-            if (rho > 0.0 && newNorm < currentNorm) {
-                // Accept step
-                x = newX;
-            } else {
-                // Reject step
-                write_x(x);
-            }
+        auto phase_start = std::chrono::steady_clock::now();
+        analyze_structure(expanded, get, set, diagnosticsLevel_, out);
+        out.analysisTimeMs = elapsed_ms(phase_start);
 
-            // Update trust radius
-            if (rho < 0.25) {
-                trustRadius = std::max(trustMin, trustRadius * 0.25);
-            } else if (rho > 0.75) {
-                trustRadius = std::min(trustMax, trustRadius * 2.0);
+        phase_start = std::chrono::steady_clock::now();
+        const SubstitutionResult substitutions = build_substitutions(expanded);
+        auto redirected_get = [&](const VarRef& v, bool& ok) -> double {
+            const auto it = substitutions.redirect.find(format_var_ref(v));
+            if (it == substitutions.redirect.end()) {
+                return get(v, ok);
             }
+            return get(parse_var_ref(it->second), ok);
+        };
+        const ReducedSystem reduced = reduce_system(expanded, origin, substitutions, redirected_get, set,
+                                                    presolve_, out);
+        out.presolveTimeMs = elapsed_ms(phase_start);
 
-            if (newNorm <= tol_) break;
+        const size_t n = reduced.vars.size();
+        const size_t m = reduced.constraints.size();
+        if (n == 0 || m == 0) {
+            sync_redirected_aliases(substitutions.redirect, get, set);
+            out.iterations = 0;
+            out.finalError = std::sqrt(reduced.constantResidualSq);
+            out.ok = (out.finalError <= tol_);
+            if (!out.ok) out.message = "Stopped (inconsistent presolved constraints)";
+            return out;
         }
 
-        write_x(x);
-        double finalErr = eval_norm();
+        // Each connected component runs its own trust region (and LM fallback).
+        const ComponentSolveOptions options{tol_, linearMode_, sparseThreshold_, threadCount_, &progress_};
+        phase_start = std::chrono::steady_clock::now();
+        double finalErr = solve_components(reduced.constraints, reduced.vars, redirected_get, set, options, out,
+            [&](ConstraintProgram& program, Eigen::VectorXd& x, bool sparse, double tol) {
+                return dogleg_iterations(program, x, sparse, maxIters_, tol, &stop_);
+            });
+        out.iterationTimeMs = elapsed_ms(phase_start);
+        finalErr = std::sqrt(finalErr * finalErr + reduced.constantResidualSq);
         out.ok = (finalErr <= tol_);
-        out.iterations = it;
         out.finalError = finalErr;
-
-        // If DogLeg didn't converge, fallback to LM
-        if (!out.ok) {
-            // Reset to current x and try LM
-            double lambda = 1e-3;
-            double prev = finalErr;
-            for (int lmIt = 0; lmIt < maxIters_; ++lmIt) {
-                Eigen::VectorXd rvec(m);
-                eval_residuals(rvec);
-                Eigen::MatrixXd J(m, n);
-                const double eps2 = 1e-6;
-                for (size_t j=0; j<n; ++j) {
-                    bool need_numerical = false;
-                    std::vector<char> needs_numerical_row(m, 0);
-                    for (size_t i=0; i<m; ++i) {
-                        const auto& cc = working_constraints[i];
-                        if (has_analytical_gradient(cc)) {
-                            int vidx = -1;
-                            for (int k = 0; k < static_cast<int>(cc.vars.size()); ++k) {
-                                if (cc.vars[k].id == vars[j].id && cc.vars[k].key == vars[j].key) {
-                                    vidx = k; break;
-                                }
-                            }
-                            bool ok = false;
-                            double grad = (vidx >= 0) ? analytical_gradient(cc, vidx, get, ok) : 0.0;
-                            if (vidx >= 0 && ok && std::isfinite(grad)) {
-                                J(i, j) = grad;
-                            } else if (vidx < 0) {
-                                J(i, j) = 0.0;
-                            } else {
-                                need_numerical = true;
-                                needs_numerical_row[i] = 1;
-                            }
-                        } else {
-                            need_numerical = true;
-                            needs_numerical_row[i] = 1;
-                        }
-                    }
-                    if (need_numerical) {
-                        double xj = x[j];
-                        set(vars[j], xj + eps2);
-                        for (size_t i=0; i<m; ++i) {
-                            if (needs_numerical_row[i]) {
-                                bool okc=false;
-                                J(i, j) = (residual(working_constraints[i], okc) - rvec[i]) / eps2;
-                            }
-                        }
-                        set(vars[j], xj);
-                    }
-                }
-                Eigen::MatrixXd A = J.transpose() * J;
-                A.diagonal().array() += lambda;
-                Eigen::VectorXd b = -J.transpose() * rvec;
-                Eigen::VectorXd delta2 = A.ldlt().solve(b);
-                Eigen::VectorXd newX2 = x + delta2;
-                write_x(newX2);
-                double newNorm2 = eval_norm();
-                if (newNorm2 < prev) {
-                    x = newX2; prev = newNorm2;
-                    lambda = std::max(1e-10, lambda * 0.1);
-                } else {
-                    write_x(x);
-                    lambda *= 10.0;
-                }
-                it++;
-                if (prev <= tol_) break;
-            }
-            write_x(x);
-            finalErr = eval_norm();
-            out.ok = (finalErr <= tol_);
-            out.iterations = it;
-            out.finalError = finalErr;
-        }
-
         out.message = out.ok ? "Converged (DogLeg+LM)" : "Stopped (max iters)";
+        if (!out.ok && stop_.raised()) out.message = "Cancelled";
         sync_redirected_aliases(substitutions.redirect, get, set);
         return out;
     }
@@ -2233,13 +2791,29 @@ public:
 
 // BFGS quasi-Newton solver (P3.1)
 // Minimizes F(x) = 0.5 * ||r(x)||^2 using L-BFGS-style updates.
-// Does not require explicit Jacobian — uses gradient (J^T r) via finite differences.
+// Needs only the gradient J^T r, not a factorization of J.
 class BFGSSolver : public ISolver {
     int maxIters_ = 100;
     double tol_ = 1e-6;
+    SolverLinearMode linearMode_ = SolverLinearMode::Auto;
+    int sparseThreshold_ = kDefaultSparseSolverThreshold;
+    int threadCount_ = 0;
+    SolverDiagnosticsLevel diagnosticsLevel_ = SolverDiagnosticsLevel::Full;
+    bool presolve_ = true;
+    StopFlags stop_;
+    ProgressCallback progress_;
 public:
     void setMaxIterations(int iters) override { maxIters_ = iters; }
     void setTolerance(double tol) override { tol_ = tol; }
+    void setLinearMode(SolverLinearMode mode) override { linearMode_ = mode; }
+    void setSparseThreshold(int unknowns) override { sparseThreshold_ = unknowns; }
+    void setThreadCount(int threads) override { threadCount_ = threads; }
+    void setDiagnosticsLevel(SolverDiagnosticsLevel level) override { diagnosticsLevel_ = level; }
+    void setPresolve(bool enabled) override { presolve_ = enabled; }
+    void setCancellationFlag(const std::atomic<bool>* flag) override { stop_.caller = flag; }
+    void setProgressCallback(ProgressCallback callback) override { progress_ = std::move(callback); }
+    // Portfolio races share one flag that the winner raises.
+    void setRaceFlag(const std::atomic<bool>* flag) { stop_.race = flag; }
 
     SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
         SolveResult r;
@@ -2254,6 +2828,7 @@ public:
 
     SolveResult solveWithBindings(std::vector<ConstraintSpec>& constraints, const GetVar& get, const SetVar& set) override {
         SolveResult out;
+        out.algorithm = SolverAlgorithm::BFGS;
         const auto report = validate_constraints(constraints, &get);
         out.diagnostics = report.diagnostics;
         out.redundancyGroups = report.redundancyGroups;
@@ -2263,55 +2838,15 @@ public:
         }
 
         // Expand 2D constraints
-        std::vector<ConstraintSpec> expanded;
-        for (const auto& c : constraints) {
-            if (needs_xy_expansion(c.type)) {
-                ConstraintSpec cx = c; cx.value = 0.0;
-                ConstraintSpec cy = c; cy.value = 1.0;
-                expanded.push_back(cx); expanded.push_back(cy);
-            } else {
-                expanded.push_back(c);
-            }
-        }
+        std::vector<int> origin;
+        const std::vector<ConstraintSpec> expanded = expand_xy_constraints(constraints, &origin);
 
-        const std::vector<ConstraintSpec> analysis_constraints = expanded;
-        const std::vector<VarRef> analysis_vars = collect_unique_vars(analysis_constraints);
-        auto analysis_residual = [&](const ConstraintSpec& c, bool& ok) -> double {
-            return residual_for_constraint(c, get, ok);
-        };
-        Eigen::VectorXd analysis_x(analysis_vars.size());
-        for (size_t j = 0; j < analysis_vars.size(); ++j) {
-            bool okv = false;
-            analysis_x[static_cast<Eigen::Index>(j)] = get(analysis_vars[j], okv);
-        }
-        populate_jacobian_analysis(analysis_constraints, analysis_vars, set, analysis_x, analysis_residual,
-            out.analysis, &out.structuralGroups, &out.redundancySubsets);
-        collect_conflict_groups(out.structuralGroups, out);
-        collect_problematic_constraint_indices(out.structuralGroups, out);
-        out.primaryRedundancyBasisConstraintIndices.clear();
-        out.primaryRedundantConstraintIndices.clear();
-        out.smallestRedundancyBasisConstraintIndices.clear();
-        out.smallestRedundantConstraintIndices.clear();
-        out.analysis.primaryRedundancyVariableKeys.clear();
-        out.analysis.smallestRedundancyVariableKeys.clear();
-        if (!out.redundancySubsets.empty()) {
-            out.primaryRedundancyBasisConstraintIndices = out.redundancySubsets.front().basisConstraintIndices;
-            out.primaryRedundantConstraintIndices = out.redundancySubsets.front().redundantConstraintIndices;
-            out.analysis.primaryRedundancyVariableKeys = out.redundancySubsets.front().variableKeys;
-            const auto smallest_it = std::find_if(
-                out.redundancySubsets.begin(), out.redundancySubsets.end(),
-                [&](const ConstraintRedundancySubset& subset) {
-                    return subset.anchorConstraintIndex == out.analysis.smallestRedundancySubsetAnchorConstraintIndex;
-                });
-            if (smallest_it != out.redundancySubsets.end()) {
-                out.smallestRedundancyBasisConstraintIndices = smallest_it->basisConstraintIndices;
-                out.smallestRedundantConstraintIndices = smallest_it->redundantConstraintIndices;
-                out.analysis.smallestRedundancyVariableKeys = smallest_it->variableKeys;
-            }
-        }
+        auto phase_start = std::chrono::steady_clock::now();
+        analyze_structure(expanded, get, set, diagnosticsLevel_, out);
+        out.analysisTimeMs = elapsed_ms(phase_start);
 
+        phase_start = std::chrono::steady_clock::now();
         const SubstitutionResult substitutions = build_substitutions(expanded);
-        expanded = substitutions.reduced;
         auto redirected_get = [&](const VarRef& v, bool& ok) -> double {
             const auto it = substitutions.redirect.find(format_var_ref(v));
             if (it == substitutions.redirect.end()) {
@@ -2319,109 +2854,373 @@ public:
             }
             return get(parse_var_ref(it->second), ok);
         };
-        auto residual = [&](const ConstraintSpec& c, bool& ok) -> double {
-            return residual_for_constraint(c, redirected_get, ok);
-        };
+        const ReducedSystem reduced = reduce_system(expanded, origin, substitutions, redirected_get, set,
+                                                    presolve_, out);
+        out.presolveTimeMs = elapsed_ms(phase_start);
 
-        std::vector<VarRef> vars = collect_unique_vars(expanded);
-        const int n = static_cast<int>(vars.size());
-        const int m = static_cast<int>(expanded.size());
+        const int n = static_cast<int>(reduced.vars.size());
+        const int m = static_cast<int>(reduced.constraints.size());
         if (n == 0 || m == 0) {
             sync_redirected_aliases(substitutions.redirect, get, set);
-            out.ok = true;
             out.iterations = 0;
-            out.finalError = 0.0;
-            out.message = "Converged (BFGS)";
+            out.finalError = std::sqrt(reduced.constantResidualSq);
+            out.ok = (out.finalError <= tol_);
+            out.message = out.ok ? "Converged (BFGS)" : "Stopped (inconsistent presolved constraints)";
             return out;
         }
 
-        Eigen::VectorXd x(n);
-        for (int j = 0; j < n; ++j) {
-            bool okv = false;
-            x[j] = redirected_get(vars[static_cast<size_t>(j)], okv);
-        }
-        auto write_x = [&](const Eigen::VectorXd& v) {
-            for (int j = 0; j < n; ++j) {
-                set(vars[static_cast<size_t>(j)], v[j]);
-            }
-        };
+        // Each connected component is minimized on its own.
+        const ComponentSolveOptions options{tol_, linearMode_, sparseThreshold_, threadCount_, &progress_};
+        phase_start = std::chrono::steady_clock::now();
+        double finalErr = solve_components(reduced.constraints, reduced.vars, redirected_get, set, options, out,
+            [&](ConstraintProgram& program, Eigen::VectorXd& x, bool sparse, double tol) {
+                return bfgs_iterations(program, x, sparse, maxIters_, tol, &stop_);
+            });
+        out.iterationTimeMs = elapsed_ms(phase_start);
+        finalErr = std::sqrt(finalErr * finalErr + reduced.constantResidualSq);
+        sync_redirected_aliases(substitutions.redirect, get, set);
+        out.ok = (finalErr <= tol_);
+        out.finalError = finalErr;
+        out.message = out.ok ? "Converged (BFGS)" : "Stopped (BFGS max iters)";
+        if (!out.ok && stop_.raised()) out.message = "Cancelled";
+        return out;
+    }
+};
 
-        // Objective: F(x) = 0.5 * sum(r_i^2)
-        auto eval_F = [&](const Eigen::VectorXd& xv) -> double {
-            write_x(xv);
-            double f = 0.0;
-            for (const auto& c : expanded) { bool okc = false; double r = residual(c, okc); f += r * r; }
-            return 0.5 * f;
-        };
+// State shared by the portfolio and its racers for one solve.
+struct PortfolioRace {
+    static constexpr int kRacers = 3;
+
+    std::vector<ConstraintSpec> constraints;
+    std::unordered_set<std::string> readOnly; // keys racers must not write
+    MinimalSolver lm;
+    DogLegSolver dogleg;
+    BFGSSolver bfgs;
+    std::vector<std::unordered_map<std::string, double>> values; // per racer
+    std::vector<SolveResult> results;                            // per racer
+    std::atomic<bool> stop{false};
+
+    std::mutex mutex;
+    std::condition_variable finishedChanged;
+    int finished{0};
+    int winner{-1};
+
+    ISolver& racer(int r) {
+        if (r == 0) return lm;
+        if (r == 1) return dogleg;
+        return bfgs;
+    }
+};
 
-        // Gradient: analytical J^T*r where supported, numerical fallback otherwise
-        auto eval_grad = [&](const Eigen::VectorXd& xv, double fx) -> Eigen::VectorXd {
-            write_x(xv);
-            return compute_objective_gradient(expanded, vars, xv, fx, redirected_get, set, residual);
+// Races LM, DogLeg and BFGS, one thread each, on private copies of the bound
+// variables while the structural analysis runs on the calling thread. The
+// first racer to converge raises the race flag and its values are written
+// back; the others stop at their next check of the flag and every racer is
+// joined before the call returns. When none converges, the one with the
+// smallest final error is kept.
+class PortfolioSolver : public ISolver {
+    int maxIters_ = 0; // 0 = each algorithm's own default
+    double tol_ = 1e-6;
+    SolverLinearMode linearMode_ = SolverLinearMode::Auto;
+    int sparseThreshold_ = kDefaultSparseSolverThreshold;
+    int threadCount_ = 1; // per racer; the racers already use a thread each
+    SolverDiagnosticsLevel diagnosticsLevel_ = SolverDiagnosticsLevel::Full;
+    bool presolve_ = true;
+    const std::atomic<bool>* cancel_ = nullptr;
+
+    template <typename Racer>
+    void configure(Racer& racer, const std::atomic<bool>* race) const {
+        if (maxIters_ > 0) racer.setMaxIterations(maxIters_);
+        racer.setTolerance(tol_);
+        racer.setLinearMode(linearMode_);
+        racer.setSparseThreshold(sparseThreshold_);
+        racer.setThreadCount(threadCount_);
+        racer.setDiagnosticsLevel(SolverDiagnosticsLevel::None);
+        racer.setPresolve(presolve_);
+        racer.setCancellationFlag(cancel_);
+        racer.setRaceFlag(race);
+    }
+
+    bool cancelled() const { return cancel_ && cancel_->load(std::memory_order_relaxed); }
+
+    static void run_racer(PortfolioRace& race, int r) {
+        std::unordered_map<std::string, double>& mine = race.values[static_cast<size_t>(r)];
+        auto racer_get = [&](const VarRef& v, bool& ok) {
+            const auto it = mine.find(format_var_ref(v));
+            ok = it != mine.end();
+            return ok ? it->second : 0.0;
         };
+        auto racer_set = [&](const VarRef& v, double value) {
+            const std::string key = format_var_ref(v);
+            if (race.readOnly.count(key)) return;
+            const auto it = mine.find(key);
+            if (it != mine.end()) it->second = value;
+        };
+        std::vector<ConstraintSpec> constraints = race.constraints;
+        SolveResult result = race.racer(r).solveWithBindings(constraints, racer_get, racer_set);
+        {
+            std::lock_guard<std::mutex> lock(race.mutex);
+            if (result.ok && race.winner < 0) {
+                race.winner = r;
+                race.stop.store(true);
+            }
+            race.results[static_cast<size_t>(r)] = std::move(result);
+            ++race.finished;
+        }
+        race.finishedChanged.notify_all();
+    }
+public:
+    void setMaxIterations(int iters) override { maxIters_ = iters; }
+    void setTolerance(double tol) override { tol_ = tol; }
+    void setLinearMode(SolverLinearMode mode) override { linearMode_ = mode; }
+    void setSparseThreshold(int unknowns) override { sparseThreshold_ = unknowns; }
+    void setThreadCount(int threads) override { threadCount_ = threads; }
+    void setDiagnosticsLevel(SolverDiagnosticsLevel level) override { diagnosticsLevel_ = level; }
+    void setPresolve(bool enabled) override { presolve_ = enabled; }
+    void setCancellationFlag(const std::atomic<bool>* flag) override { cancel_ = flag; }
+
+    SolveResult solve(std::vector<ConstraintSpec>& constraints) override {
+        SolveResult r;
+        const auto report = validate_constraints(constraints, nullptr);
+        r.diagnostics = report.diagnostics;
+        r.redundancyGroups = report.redundancyGroups;
+        r.analysis = report.analysis;
+        r.ok = r.diagnostics.empty();
+        r.algorithm = SolverAlgorithm::Portfolio;
+        r.message = r.ok ? "Converged (no-op stub)" : "Constraint validation failed";
+        return r;
+    }
+
+    SolveResult solveWithBindings(std::vector<ConstraintSpec>& constraints, const GetVar& get, const SetVar& set) override {
+        SolveResult out;
+        out.algorithm = SolverAlgorithm::Portfolio;
+        const auto report = validate_constraints(constraints, &get);
+        out.diagnostics = report.diagnostics;
+        out.redundancyGroups = report.redundancyGroups;
+        out.analysis = report.analysis;
+        if (!out.diagnostics.empty()) {
+            out.ok = false; out.message = "Constraint validation failed"; return out;
+        }
 
-        // Initialize inverse Hessian approximation as identity
-        Eigen::MatrixXd H = Eigen::MatrixXd::Identity(n, n);
-        double fx = eval_F(x);
-        Eigen::VectorXd grad = eval_grad(x, fx);
-        int it = 0;
-
-        for (; it < maxIters_; ++it) {
-            if (std::sqrt(2.0 * fx) <= tol_) break;
-
-            // Search direction
-            Eigen::VectorXd p = -H * grad;
-
-            // Backtracking line search (Armijo condition)
-            double alpha = 1.0;
-            const double c1 = 1e-4;
-            double gp = grad.dot(p);
-            for (int ls = 0; ls < 20; ++ls) {
-                Eigen::VectorXd x_new = x + alpha * p;
-                double fx_new = eval_F(x_new);
-                if (fx_new <= fx + c1 * alpha * gp) break;
-                alpha *= 0.5;
+        // Snapshot the bindings once; read-only ones stay read-only in the
+        // copies so every racer sees the same system.
+        PortfolioRace race;
+        race.constraints = constraints;
+        const std::vector<VarRef> vars = collect_unique_vars(constraints);
+        const std::vector<char> read_only = read_only_vars(vars, get, set);
+        std::unordered_map<std::string, double> start;
+        start.reserve(vars.size());
+        for (size_t j = 0; j < vars.size(); ++j) {
+            bool ok = false;
+            const double value = get(vars[j], ok);
+            if (ok) start.emplace(format_var_ref(vars[j]), value);
+            if (read_only[j]) race.readOnly.insert(format_var_ref(vars[j]));
+        }
+        race.values.assign(PortfolioRace::kRacers, start);
+        race.results.resize(PortfolioRace::kRacers);
+        configure(race.lm, &race.stop);
+        configure(race.dogleg, &race.stop);
+        configure(race.bfgs, &race.stop);
+        std::vector<std::thread> racers;
+        racers.reserve(PortfolioRace::kRacers);
+        for (int r = 0; r < PortfolioRace::kRacers; ++r) {
+            racers.emplace_back(run_racer, std::ref(race), r);
+        }
+
+        auto phase_start = std::chrono::steady_clock::now();
+        analyze_structure(expand_xy_constraints(constraints), get, set, diagnosticsLevel_, out);
+        out.analysisTimeMs = elapsed_ms(phase_start);
+
+        // Wait for a winner, or for every racer once there cannot be one,
+        // then stop and join the rest.
+        {
+            std::unique_lock<std::mutex> lock(race.mutex);
+            race.finishedChanged.wait(lock, [&] {
+                return race.winner >= 0 || race.finished == PortfolioRace::kRacers;
+            });
+        }
+        race.stop.store(true);
+        for (auto& t : racers) t.join();
+
+        int best = race.winner;
+        if (best < 0) {
+            best = 0;
+            for (int r = 1; r < PortfolioRace::kRacers; ++r) {
+                if (race.results[static_cast<size_t>(r)].finalError < race.results[static_cast<size_t>(best)].finalError) best = r;
             }
+        }
+        const SolveResult& won = race.results[static_cast<size_t>(best)];
+        const std::unordered_map<std::string, double>& solution = race.values[static_cast<size_t>(best)];
+
+        out.ok = won.ok;
+        out.iterations = won.iterations;
+        out.finalError = won.finalError;
+        out.message = won.message;
+        out.sparseLinearAlgebra = won.sparseLinearAlgebra;
+        out.componentCount = won.componentCount;
+        out.componentsSolved = won.componentsSolved;
+        out.presolvedConstraints = won.presolvedConstraints;
+        out.presolveTimeMs = won.presolveTimeMs;
+        out.iterationTimeMs = won.iterationTimeMs;
+        out.algorithm = won.algorithm;
+        if (!out.ok && cancelled()) out.message = "Cancelled";
+        for (size_t j = 0; j < vars.size(); ++j) {
+            if (read_only[j]) continue;
+            const auto it = solution.find(format_var_ref(vars[j]));
+            if (it != solution.end()) set(vars[j], it->second);
+        }
+        return out;
+    }
+};
 
-            Eigen::VectorXd x_new = x + alpha * p;
-            double fx_new = eval_F(x_new);
-            Eigen::VectorXd grad_new = eval_grad(x_new, fx_new);
-
-            // BFGS update
-            Eigen::VectorXd s = x_new - x;
-            Eigen::VectorXd y = grad_new - grad;
-            double ys = y.dot(s);
-
-            if (ys > 1e-10) {
-                // Sherman-Morrison-Woodbury formula for H update
-                Eigen::MatrixXd I = Eigen::MatrixXd::Identity(n, n);
-                Eigen::MatrixXd rho_sy = (s * y.transpose()) / ys;
-                H = (I - rho_sy) * H * (I - rho_sy.transpose()) + (s * s.transpose()) / ys;
+// Drag sessions run partitioned LM with warm starts; see ISolverSession.
+class LMSolverSession : public ISolverSession {
+    int maxIters_ = 10;
+    double tol_ = 1e-6;
+    SolverLinearMode linearMode_ = SolverLinearMode::Auto;
+    int sparseThreshold_ = kDefaultSparseSolverThreshold;
+
+    bool prepared_ = false;
+    ISolver::GetVar get_;
+    ISolver::SetVar set_;
+    std::unordered_map<std::string, std::string> redirect_;
+    std::vector<VarRef> vars_;
+    std::unordered_map<std::string, int> varIndex_;
+    std::vector<int> componentOf_; // per var
+    std::vector<int> columnOf_;    // per var, within its component
+    CompiledComponents compiled_;
+    std::vector<LmWarmStart> warm_;          // per component
+    std::vector<std::vector<char>> pinned_;  // per component column
+    std::vector<int> held_;                  // vars pinned by the last update()
+    std::vector<char> changed_;              // components update() wrote into
+
+public:
+    void setMaxIterations(int iters) override { maxIters_ = iters; }
+    void setTolerance(double tol) override { tol_ = tol; }
+    void setLinearMode(SolverLinearMode mode) override { linearMode_ = mode; }
+    void setSparseThreshold(int unknowns) override { sparseThreshold_ = unknowns; }
+
+    SolveResult prepare(std::vector<ConstraintSpec>& constraints, const ISolver::GetVar& get,
+                        const ISolver::SetVar& set) override {
+        prepared_ = false;
+        held_.clear();
+        SolveResult out;
+        const auto report = validate_constraints(constraints, &get);
+        out.diagnostics = report.diagnostics;
+        out.redundancyGroups = report.redundancyGroups;
+        out.analysis = report.analysis;
+        if (!out.diagnostics.empty()) {
+            out.message = "Constraint validation failed";
+            return out;
+        }
+
+        const SubstitutionResult substitutions = build_substitutions(expand_xy_constraints(constraints));
+        get_ = get;
+        set_ = set;
+        redirect_ = substitutions.redirect;
+        const ISolver::GetVar redirected_get = [this](const VarRef& v, bool& ok) -> double {
+            const auto it = redirect_.find(format_var_ref(v));
+            if (it == redirect_.end()) {
+                return get_(v, ok);
             }
+            return get_(parse_var_ref(it->second), ok);
+        };
+        vars_ = collect_unique_vars(substitutions.reduced);
+        compiled_ = compile_components(substitutions.reduced, vars_, redirected_get, set_);
+
+        const size_t count = compiled_.components.size();
+        varIndex_.clear();
+        componentOf_.assign(vars_.size(), -1);
+        columnOf_.assign(vars_.size(), -1);
+        for (size_t j = 0; j < vars_.size(); ++j) varIndex_.emplace(format_var_ref(vars_[j]), static_cast<int>(j));
+        pinned_.assign(count, {});
+        for (size_t k = 0; k < count; ++k) {
+            const std::vector<int>& cols = compiled_.components[k].cols;
+            pinned_[k].assign(cols.size(), 0);
+            for (size_t c = 0; c < cols.size(); ++c) {
+                componentOf_[static_cast<size_t>(cols[c])] = static_cast<int>(k);
+                columnOf_[static_cast<size_t>(cols[c])] = static_cast<int>(c);
+            }
+        }
+        warm_ = std::vector<LmWarmStart>(count);
+        changed_.assign(count, 0);
+
+        double squared = 0.0;
+        for (size_t k = 0; k < count; ++k) squared += compiled_.programs[k].squaredNorm(compiled_.xs[k]);
+        prepared_ = true;
+        out.ok = true;
+        out.finalError = std::sqrt(squared);
+        out.componentCount = static_cast<int>(count);
+        out.message = "Prepared";
+        return out;
+    }
 
-            x = x_new;
-            fx = fx_new;
-            grad = grad_new;
+    bool update(const std::vector<FixedVar>& fixedVars) override {
+        if (!prepared_) return false;
+        std::vector<char> touched(compiled_.components.size(), 0);
+        for (int j : held_) {
+            const size_t k = static_cast<size_t>(componentOf_[static_cast<size_t>(j)]);
+            pinned_[k][static_cast<size_t>(columnOf_[static_cast<size_t>(j)])] = 0;
+            touched[k] = 1;
+        }
+        held_.clear();
+
+        bool all_known = true;
+        for (const FixedVar& fixed : fixedVars) {
+            std::string key = format_var_ref(fixed.var);
+            const auto redirected = redirect_.find(key);
+            if (redirected != redirect_.end()) key = redirected->second;
+            const auto it = varIndex_.find(key);
+            if (it == varIndex_.end() || componentOf_[static_cast<size_t>(it->second)] < 0) {
+                all_known = false;
+                continue;
+            }
+            const size_t k = static_cast<size_t>(componentOf_[static_cast<size_t>(it->second)]);
+            const int col = columnOf_[static_cast<size_t>(it->second)];
+            compiled_.xs[k][col] = fixed.value;
+            pinned_[k][static_cast<size_t>(col)] = 1;
+            touched[k] = 1;
+            changed_[k] = 1;
+            held_.push_back(it->second);
+        }
+        for (size_t k = 0; k < touched.size(); ++k) {
+            if (touched[k]) compiled_.programs[k].setPinnedColumns(pinned_[k]);
         }
+        return all_known;
+    }
 
-        write_x(x);
-        sync_redirected_aliases(substitutions.redirect, get, set);
-        double finalErr = std::sqrt(2.0 * fx);
+    SolveResult step() override {
+        SolveResult out;
+        if (!prepared_) {
+            out.message = "Session not prepared";
+            return out;
+        }
+        // One thread: a drag disturbs one component, and a frame is too
+        // short to amortize starting workers.
+        const ComponentSolveOptions options{tol_, linearMode_, sparseThreshold_, 1};
+        const double finalErr = iterate_components(compiled_, vars_, set_, options, out,
+            [&](size_t k, ConstraintProgram& program, Eigen::VectorXd& x, bool sparse, double tol) {
+                return lm_iterations(program, x, sparse, maxIters_, tol, &warm_[k]);
+            }, &changed_);
+        std::fill(changed_.begin(), changed_.end(), 0);
+        sync_redirected_aliases(redirect_, get_, set_);
         out.ok = (finalErr <= tol_);
-        out.iterations = it;
         out.finalError = finalErr;
-        out.message = out.ok ? "Converged (BFGS)" : "Stopped (BFGS max iters)";
+        out.message = out.ok ? "Converged (session LM)" : "Stopped (max iters)";
         return out;
     }
 };
 
 ISolver* createMinimalSolver() { return new MinimalSolver(); }
 
+ISolverSession* createSolverSession() { return new LMSolverSession(); }
+
 ISolver* createSolver(SolverAlgorithm algo) {
     switch (algo) {
         case SolverAlgorithm::LM: return new MinimalSolver();
         case SolverAlgorithm::DogLeg: return new DogLegSolver();
         case SolverAlgorithm::BFGS: return new BFGSSolver();
+        case SolverAlgorithm::Portfolio: return new PortfolioSolver();
         default: return new DogLegSolver();
     }
 }
@@ -0,0 +1,356 @@
+#include "core/spatial_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <tuple>
+
+namespace core {
+
+namespace {
+
+Box2 unite(const Box2& a, const Box2& b) {
+    return Box2{std::min(a.minX, b.minX), std::min(a.minY, b.minY),
+                std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+}
+
+double area(const Box2& b) {
+    return (b.maxX - b.minX) * (b.maxY - b.minY);
+}
+
+double box_distance(const Box2& b, const Vec2& p) {
+    const double dx = std::max({b.minX - p.x, 0.0, p.x - b.maxX});
+    const double dy = std::max({b.minY - p.y, 0.0, p.y - b.maxY});
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// Slab test of the segment a + t*d, t in [0, 1], against a box.
+bool segment_hits(const Box2& b, const Vec2& a, const Vec2& d, double* tEnter) {
+    double t0 = 0.0;
+    double t1 = 1.0;
+    const double origin[2] = {a.x, a.y};
+    const double dir[2] = {d.x, d.y};
+    const double lo[2] = {b.minX, b.minY};
+    const double hi[2] = {b.maxX, b.maxY};
+    for (int axis = 0; axis < 2; ++axis) {
+        if (dir[axis] == 0.0) {
+            if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) return false;
+            continue;
+        }
+        double ta = (lo[axis] - origin[axis]) / dir[axis];
+        double tb = (hi[axis] - origin[axis]) / dir[axis];
+        if (ta > tb) std::swap(ta, tb);
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        if (t0 > t1) return false;
+    }
+    if (tEnter) *tEnter = t0;
+    return true;
+}
+
+}  // namespace
+
+void SpatialIndex::clear() {
+    nodes_.clear();
+    free_nodes_.clear();
+    items_.clear();
+    free_items_.clear();
+    item_of_.clear();
+    root_ = -1;
+}
+
+int SpatialIndex::new_node(bool leaf) {
+    int index;
+    if (!free_nodes_.empty()) {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[index] = Node{};
+    } else {
+        index = static_cast<int>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[index].leaf = leaf;
+    return index;
+}
+
+void SpatialIndex::free_node(int node) {
+    nodes_[node] = Node{};
+    free_nodes_.push_back(node);
+}
+
+void SpatialIndex::recompute_box(int node) {
+    Node& n = nodes_[node];
+    bool first = true;
+    for (int child : n.children) {
+        const Box2& b = n.leaf ? items_[child].box : nodes_[child].box;
+        n.box = first ? b : unite(n.box, b);
+        first = false;
+    }
+}
+
+void SpatialIndex::refit_upwards(int node) {
+    for (; node >= 0; node = nodes_[node].parent) recompute_box(node);
+}
+
+bool SpatialIndex::bounds(Box2* out) const {
+    if (root_ < 0 || item_of_.empty()) return false;
+    if (out) *out = nodes_[root_].box;
+    return true;
+}
+
+// Sort-Tile-Recursive packing of one tree level: sort by x into vertical
+// slices, sort each slice by y and fill nodes of kMaxEntries in that order.
+int SpatialIndex::pack_level(std::vector<int>& level, bool leaves) {
+    auto boxOf = [&](int i) -> const Box2& { return leaves ? items_[i].box : nodes_[i].box; };
+    const size_t n = level.size();
+    const size_t pages = (n + kMaxEntries - 1) / kMaxEntries;
+    const size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(pages))));
+    const size_t perSlice = slices * kMaxEntries;
+    std::sort(level.begin(), level.end(), [&](int a, int b) {
+        return boxOf(a).minX + boxOf(a).maxX < boxOf(b).minX + boxOf(b).maxX;
+    });
+    for (size_t s = 0; s < n; s += perSlice) {
+        const auto begin = level.begin() + static_cast<std::ptrdiff_t>(s);
+        const auto end = level.begin() + static_cast<std::ptrdiff_t>(std::min(n, s + perSlice));
+        std::sort(begin, end, [&](int a, int b) {
+            return boxOf(a).minY + boxOf(a).maxY < boxOf(b).minY + boxOf(b).maxY;
+        });
+    }
+    std::vector<int> parents;
+    parents.reserve(pages);
+    for (size_t s = 0; s < n; s += perSlice) {
+        const size_t sliceEnd = std::min(n, s + perSlice);
+        for (size_t i = s; i < sliceEnd; i += kMaxEntries) {
+            const int node = new_node(leaves);
+            for (size_t j = i; j < std::min(sliceEnd, i + kMaxEntries); ++j) {
+                const int child = level[j];
+                nodes_[node].children.push_back(child);
+                if (leaves) {
+                    items_[child].leaf = node;
+                } else {
+                    nodes_[child].parent = node;
+                }
+            }
+            recompute_box(node);
+            parents.push_back(node);
+        }
+    }
+    level.swap(parents);
+    return static_cast<int>(level.size());
+}
+
+void SpatialIndex::build(std::vector<std::pair<EntityId, Box2>> entries) {
+    clear();
+    if (entries.empty()) return;
+    items_.reserve(entries.size());
+    item_of_.reserve(entries.size());
+    std::vector<int> level;
+    level.reserve(entries.size());
+    for (const auto& entry : entries) {
+        auto it = item_of_.find(entry.first);
+        if (it != item_of_.end()) {
+            items_[it->second].box = entry.second;
+            continue;
+        }
+        const int index = static_cast<int>(items_.size());
+        item_of_.emplace(entry.first, index);
+        items_.push_back(Item{entry.first, entry.second, -1});
+        level.push_back(index);
+    }
+    bool leaves = true;
+    while (pack_level(level, leaves) > 1) leaves = false;
+    root_ = level.front();
+}
+
+int SpatialIndex::choose_leaf(const Box2& box) const {
+    int node = root_;
+    while (!nodes_[node].leaf) {
+        int best = -1;
+        double bestGrowth = 0.0;
+        double bestArea = 0.0;
+        for (int child : nodes_[node].children) {
+            const Box2& b = nodes_[child].box;
+            const double a = area(b);
+            const double growth = area(unite(b, box)) - a;
+            if (best < 0 || growth < bestGrowth || (growth == bestGrowth && a < bestArea)) {
+                best = child;
+                bestGrowth = growth;
+                bestArea = a;
+            }
+        }
+        node = best;
+    }
+    return node;
+}
+
+// Splits overfull nodes bottom-up: children are sorted along the axis where
+// their centres spread most and divided in half.
+void SpatialIndex::split(int node) {
+    while (node >= 0 && nodes_[node].children.size() > kMaxEntries) {
+        const bool leaf = nodes_[node].leaf;
+        std::vector<int> kids = std::move(nodes_[node].children);
+        nodes_[node].children.clear();
+        auto boxOf = [&](int i) -> const Box2& { return leaf ? items_[i].box : nodes_[i].box; };
+        double minCx = boxOf(kids.front()).minX + boxOf(kids.front()).maxX;
+        double maxCx = minCx;
+        double minCy = boxOf(kids.front()).minY + boxOf(kids.front()).maxY;
+        double maxCy = minCy;
+        for (int k : kids) {
+            const double cx = boxOf(k).minX + boxOf(k).maxX;
+            const double cy = boxOf(k).minY + boxOf(k).maxY;
+            minCx = std::min(minCx, cx);
+            maxCx = std::max(maxCx, cx);
+            minCy = std::min(minCy, cy);
+            maxCy = std::max(maxCy, cy);
+        }
+        const bool byX = (maxCx - minCx) >= (maxCy - minCy);
+        std::sort(kids.begin(), kids.end(), [&](int a, int b) {
+            return byX ? boxOf(a).minX + boxOf(a).maxX < boxOf(b).minX + boxOf(b).maxX
+                       : boxOf(a).minY + boxOf(a).maxY < boxOf(b).minY + boxOf(b).maxY;
+        });
+        const size_t half = kids.size() / 2;
+        const int sibling = new_node(leaf);
+        nodes_[node].children.assign(kids.begin(), kids.begin() + static_cast<std::ptrdiff_t>(half));
+        nodes_[sibling].children.assign(kids.begin() + static_cast<std::ptrdiff_t>(half), kids.end());
+        for (int k : nodes_[sibling].children) {
+            if (leaf) {
+                items_[k].leaf = sibling;
+            } else {
+                nodes_[k].parent = sibling;
+            }
+        }
+        recompute_box(node);
+        recompute_box(sibling);
+
+        int parent = nodes_[node].parent;
+        if (parent < 0) {
+            parent = new_node(false);
+            nodes_[parent].children.push_back(node);
+            nodes_[node].parent = parent;
+            root_ = parent;
+        }
+        nodes_[parent].children.push_back(sibling);
+        nodes_[sibling].parent = parent;
+        recompute_box(parent);
+        node = parent;
+    }
+}
+
+void SpatialIndex::insert(EntityId id, const Box2& box) {
+    remove(id);
+    int index;
+    if (!free_items_.empty()) {
+        index = free_items_.back();
+        free_items_.pop_back();
+    } else {
+        index = static_cast<int>(items_.size());
+        items_.emplace_back();
+    }
+    items_[index] = Item{id, box, -1};
+    item_of_.emplace(id, index);
+    if (root_ < 0) root_ = new_node(true);
+    const int leaf = choose_leaf(box);
+    nodes_[leaf].children.push_back(index);
+    items_[index].leaf = leaf;
+    refit_upwards(leaf);
+    split(leaf);
+}
+
+bool SpatialIndex::remove(EntityId id) {
+    auto it = item_of_.find(id);
+    if (it == item_of_.end()) return false;
+    const int index = it->second;
+    item_of_.erase(it);
+    if (item_of_.empty()) {
+        clear();
+        return true;
+    }
+    const int leaf = items_[index].leaf;
+    auto& kids = nodes_[leaf].children;
+    kids.erase(std::find(kids.begin(), kids.end(), index));
+    items_[index] = Item{};
+    free_items_.push_back(index);
+
+    // Drop emptied nodes, then tighten the boxes above.
+    int node = leaf;
+    while (node != root_ && nodes_[node].children.empty()) {
+        const int parent = nodes_[node].parent;
+        auto& siblings = nodes_[parent].children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+        free_node(node);
+        node = parent;
+    }
+    refit_upwards(node);
+    while (!nodes_[root_].leaf && nodes_[root_].children.size() == 1) {
+        const int child = nodes_[root_].children.front();
+        free_node(root_);
+        root_ = child;
+        nodes_[child].parent = -1;
+    }
+    return true;
+}
+
+void SpatialIndex::query(const Box2& window, std::vector<EntityId>& out) const {
+    if (root_ < 0 || item_of_.empty()) return;
+    std::vector<int> stack{root_};
+    while (!stack.empty()) {
+        const Node& n = nodes_[stack.back()];
+        stack.pop_back();
+        if (!n.box.intersects(window)) continue;
+        for (int child : n.children) {
+            if (n.leaf) {
+                if (items_[child].box.intersects(window)) out.push_back(items_[child].id);
+            } else {
+                stack.push_back(child);
+            }
+        }
+    }
+}
+
+std::vector<std::pair<EntityId, double>> SpatialIndex::nearest(const Vec2& p, size_t k, double maxDistance) const {
+    std::vector<std::pair<EntityId, double>> out;
+    if (root_ < 0 || item_of_.empty() || k == 0) return out;
+    // Best-first search: (distance, is item, index), closest on top.
+    using Entry = std::tuple<double, bool, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    queue.emplace(box_distance(nodes_[root_].box, p), false, root_);
+    while (!queue.empty() && out.size() < k) {
+        const auto [dist, isItem, index] = queue.top();
+        queue.pop();
+        if (dist > maxDistance) break;
+        if (isItem) {
+            out.emplace_back(items_[index].id, dist);
+            continue;
+        }
+        const Node& n = nodes_[index];
+        for (int child : n.children) {
+            const Box2& b = n.leaf ? items_[child].box : nodes_[child].box;
+            queue.emplace(box_distance(b, p), n.leaf, child);
+        }
+    }
+    return out;
+}
+
+void SpatialIndex::query_segment(const Vec2& a, const Vec2& b, std::vector<EntityId>& out) const {
+    if (root_ < 0 || item_of_.empty()) return;
+    const Vec2 d{b.x - a.x, b.y - a.y};
+    std::vector<std::pair<double, EntityId>> hits;
+    std::vector<int> stack{root_};
+    while (!stack.empty()) {
+        const Node& n = nodes_[stack.back()];
+        stack.pop_back();
+        if (!segment_hits(n.box, a, d, nullptr)) continue;
+        for (int child : n.children) {
+            if (!n.leaf) {
+                stack.push_back(child);
+                continue;
+            }
+            double t = 0.0;
+            if (segment_hits(items_[child].box, a, d, &t)) hits.emplace_back(t, items_[child].id);
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    for (const auto& hit : hits) out.push_back(hit.second);
+}
+
+}  // namespace core
@@ -10,6 +10,7 @@
 #include <QPointF>
 #include <QList>
 #include <cmath>
+#include <utility>
 
 using EntityId = uint64_t;
 
@@ -159,4 +160,28 @@ struct UngroupEntitiesCommand : Command {
     QString name() const override { return "Ungroup Entities"; }
 };
 
+// ─── Constraint solve ───
+// `after` comes from a background solve; the entities' current payloads are
+// captured as `before` when the command is created.
+struct ApplyConstraintSolutionCommand : Command {
+    core::Document* doc;
+    core::ConstraintSolution before;
+    core::ConstraintSolution after;
+
+    ApplyConstraintSolutionCommand(core::Document* d, core::ConstraintSolution solved)
+        : doc(d), after(std::move(solved)) {
+        const core::Document& cdoc = *doc;
+        before.revision = cdoc.revision();
+        for (EntityId eid : after.ids) {
+            if (const auto* e = cdoc.get_entity(eid)) {
+                before.ids.push_back(eid);
+                before.payloads.push_back(e->payload);
+            }
+        }
+    }
+    void execute() override { doc->apply_constraint_solution(after); }
+    void undo() override { doc->apply_constraint_solution(before); }
+    QString name() const override { return "Solve Constraints"; }
+};
+
 } // namespace editor_commands
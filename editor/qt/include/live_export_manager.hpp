@@ -4,6 +4,7 @@
 #include <QString>
 #include "core/document.hpp"
 
+class QThreadPool;
 class QTimer;
 
 class LiveExportManager : public QObject, public core::DocumentObserver {
@@ -24,6 +25,7 @@ signals:
 
 private:
     void on_document_changed(const core::Document& doc, const core::DocumentChangeEvent& event) override;
+    void on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) override;
     void scheduleExport();
     void doExport();
 
@@ -31,4 +33,5 @@ private:
     QString m_exportDir;
     bool m_enabled{false};
     QTimer* m_debounce{nullptr};
+    QThreadPool* m_pool{nullptr};
 };
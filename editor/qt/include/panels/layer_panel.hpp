@@ -25,6 +25,7 @@ private:
     void onAddLayer();
     void scheduleRefresh();
     void on_document_changed(const core::Document& doc, const core::DocumentChangeEvent& event) override;
+    void on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) override;
     
     QTreeWidget* m_tree{nullptr};
     core::Document* m_doc{nullptr};
@@ -26,6 +26,7 @@ private:
     Qt::CheckState computeVisibleCheckState() const;
     void refreshVisibleCheckState();
     void on_document_changed(const core::Document& doc, const core::DocumentChangeEvent& event) override;
+    void on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) override;
 
     QTreeWidget* m_tree{nullptr};
     QList<qulonglong> m_currentSelection;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "core/document.hpp"
+#include "core/solver.hpp"
+
+class QThreadPool;
+class CommandManager;
+
+// Solves the document's constraint table off the GUI thread. Each request
+// solves a snapshot on a single worker and supersedes every earlier one: the
+// running solve is cancelled and queued ones return without solving. The
+// latest result is pushed to the CommandManager as one undoable command.
+// A result whose inputs changed while it was solving is solved again, up to
+// kMaxResolves times per request.
+class SolverJobQueue : public QObject {
+    Q_OBJECT
+public:
+    explicit SolverJobQueue(QObject* parent = nullptr);
+    ~SolverJobQueue() override;
+
+    void setDocument(core::Document* doc);
+    void setCommandManager(CommandManager* cmdMgr);
+    void setAlgorithm(core::SolverAlgorithm algorithm) { m_algorithm = algorithm; }
+
+    void requestSolve();
+    void cancel();
+    bool isBusy() const { return m_pending > 0; }
+
+signals:
+    void progress(int componentsDone, int componentCount);
+    // `moved` entities were updated; 0 when the document already satisfied
+    // every constraint the solver could reach.
+    void solveFinished(bool ok, int moved, const QString& message);
+    void solveCancelled();
+
+private:
+    struct Job {
+        uint64_t generation{0};
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    void startJob();
+    void finishJob(uint64_t generation, bool cancelled, const core::SolveResult& result,
+                   std::shared_ptr<core::ConstraintSolution> solution);
+
+    core::Document* m_doc{nullptr};
+    CommandManager* m_cmdMgr{nullptr};
+    core::SolverAlgorithm m_algorithm{core::SolverAlgorithm::LM};
+    QThreadPool* m_pool{nullptr};
+    Job m_latest;
+    uint64_t m_generation{0};
+    int m_pending{0};
+    // Automatic re-solves since the last requestSolve().
+    static constexpr int kMaxResolves = 3;
+    int m_resolves{0};
+};
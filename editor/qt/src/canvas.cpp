@@ -14,9 +14,11 @@
 #include <QKeyEvent>
 #include <QDebug>
 #include <QMetaObject>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <string>
+#include <utility>
 
 CanvasWidget::CanvasWidget(QWidget* parent) : QWidget(parent) {
     setMouseTracking(true);
@@ -55,6 +57,7 @@ void CanvasWidget::setDocument(core::Document* doc) {
         reloadFromDocument();
     } else {
         polylines_.clear();
+        polyline_index_.clear();
         selected_entities_.clear();
         triSelected_ = false;
         m_currentSnap.active = false;
@@ -101,14 +104,36 @@ QPointF CanvasWidget::computePivot() const {
     return QPointF(cx / totalPts, cy / totalPts); // Centroid
 }
 
+// The canvas only reads the document.
 const core::Entity* CanvasWidget::entityFor(EntityId id) const {
     if (!m_doc || id == 0) return nullptr;
-    return m_doc->get_entity(id);
+    return std::as_const(*m_doc).get_entity(id);
 }
 
 const core::Layer* CanvasWidget::layerFor(int layerId) const {
     if (!m_doc) return nullptr;
-    return m_doc->get_layer(layerId);
+    return std::as_const(*m_doc).get_layer(layerId);
+}
+
+QVector<int> CanvasWidget::polylinesInWorldRect(const QRectF& worldRect) const {
+    QVector<int> out;
+    if (!m_doc) {
+        out.reserve(polylines_.size());
+        for (int i = 0; i < polylines_.size(); ++i) {
+            if (polylines_[i].aabb.intersects(worldRect)) out.append(i);
+        }
+        return out;
+    }
+    const core::Box2 window{worldRect.left(), worldRect.top(), worldRect.right(), worldRect.bottom()};
+    std::vector<EntityId> ids;
+    m_doc->spatial_index().query(window, ids);
+    out.reserve(static_cast<int>(ids.size()));
+    for (EntityId id : ids) {
+        const auto it = polyline_index_.constFind(id);
+        if (it != polyline_index_.constEnd()) out.append(it.value());
+    }
+    std::sort(out.begin(), out.end()); // keep document (draw) order
+    return out;
 }
 
 bool CanvasWidget::isEntityVisible(const core::Entity& entity) const {
@@ -130,6 +155,7 @@ void CanvasWidget::updatePolyCache(PolyVis& pv) {
 
 void CanvasWidget::clear() {
     polylines_.clear();
+    polyline_index_.clear();
     triVerts_.clear();
     triIndices_.clear();
     selected_entities_.clear();
@@ -163,7 +189,8 @@ QList<qulonglong> CanvasWidget::selectEntitiesInWorldRect(const QRectF& rect, bo
         return ids;
     }
 
-    for (const auto& pv : polylines_) {
+    for (int pi : polylinesInWorldRect(norm)) {
+        const auto& pv = polylines_[pi];
         const auto* entity = entityFor(pv.entityId);
         if (!entity) continue;
         if (!isEntityVisible(*entity)) continue;
@@ -206,9 +233,15 @@ SnapManager::SnapResult CanvasWidget::computeSnapAt(const QPointF& worldPos, boo
         snap_manager_.setSnapRadiusPixels(12.0);
         snap_manager_.setGridPixelSpacing(50.0);
     }
+    // SnapManager only considers polylines whose box meets the snap radius,
+    // so hand it just those.
+    const double snapWorld = snap_manager_.snapRadiusPixels() / (scale_ > 0.0 ? scale_ : 1.0);
+    const QRectF snapRect(worldPos.x() - snapWorld, worldPos.y() - snapWorld, snapWorld * 2.0, snapWorld * 2.0);
+    const QVector<int> candidates = polylinesInWorldRect(snapRect);
     snap_inputs_.clear();
-    snap_inputs_.reserve(polylines_.size());
-    for (const auto& pv : polylines_) {
+    snap_inputs_.reserve(candidates.size());
+    for (int pi : candidates) {
+        const auto& pv = polylines_[pi];
         if (excludeSelection && selected_entities_.contains(pv.entityId)) continue;
         const auto* entity = entityFor(pv.entityId);
         const bool visible = entity && isEntityVisible(*entity);
@@ -297,7 +330,7 @@ void CanvasWidget::scheduleSelectionChanged() {
 
 bool CanvasWidget::syncPolylineFromDocument(EntityId id) {
     if (!m_doc || id == 0) return false;
-    const auto* entity = m_doc->get_entity(id);
+    const auto* entity = entityFor(id);
     if (!entity || entity->type != core::EntityType::Polyline) {
         return removePolyline(id);
     }
@@ -312,8 +345,9 @@ bool CanvasWidget::syncPolylineFromDocument(EntityId id) {
         pts.append(QPointF(pt.x, pt.y));
     }
 
-    for (auto& pv : polylines_) {
-        if (pv.entityId != id) continue;
+    const auto existing = polyline_index_.constFind(id);
+    if (existing != polyline_index_.constEnd()) {
+        auto& pv = polylines_[existing.value()];
         pv.pts = pts;
         updatePolyCache(pv);
         scheduleUpdate();
@@ -324,6 +358,7 @@ bool CanvasWidget::syncPolylineFromDocument(EntityId id) {
     pv.entityId = id;
     pv.pts = pts;
     updatePolyCache(pv);
+    polyline_index_.insert(id, polylines_.size());
     polylines_.append(pv);
     scheduleUpdate();
     return true;
@@ -331,12 +366,13 @@ bool CanvasWidget::syncPolylineFromDocument(EntityId id) {
 
 bool CanvasWidget::removePolyline(EntityId id) {
     bool removed = false;
-    for (int i = 0; i < polylines_.size(); ++i) {
-        if (polylines_[i].entityId == id) {
-            polylines_.removeAt(i);
-            removed = true;
-            break;
-        }
+    const auto it = polyline_index_.find(id);
+    if (it != polyline_index_.end()) {
+        const int index = it.value();
+        polyline_index_.erase(it);
+        polylines_.removeAt(index);
+        for (int i = index; i < polylines_.size(); ++i) polyline_index_[polylines_[i].entityId] = i;
+        removed = true;
     }
     const bool selectionUpdated = selected_entities_.remove(id) > 0;
     if (removed || selectionUpdated) scheduleUpdate();
@@ -384,13 +420,38 @@ void CanvasWidget::on_document_changed(const core::Document& doc, const core::Do
     }
 }
 
+void CanvasWidget::on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) {
+    if (&doc != m_doc) return;
+    if (changes.fullReload) {
+        reloadFromDocument();
+        return;
+    }
+    // Removals shift polylines_, so batches touching a large share of the
+    // scene (bulk imports) are cheaper to rebuild in one pass.
+    const qsizetype touched = static_cast<qsizetype>(
+        changes.added.size() + changes.removed.size() + changes.geometryChanged.size());
+    if (touched > 64 && touched * 4 > polylines_.size()) {
+        reloadFromDocument();
+        return;
+    }
+    for (EntityId id : changes.removed) removePolyline(id);
+    for (EntityId id : changes.added) syncPolylineFromDocument(id);
+    for (EntityId id : changes.geometryChanged) syncPolylineFromDocument(id);
+    if (!changes.metaChanged.empty() || !changes.layersChanged.empty() ||
+        changes.documentMetaChanged || changes.settingsChanged) {
+        scheduleUpdate();
+    }
+}
+
 EntityId CanvasWidget::hitEntityAtWorld(const QPointF& worldPos) const {
     const double thPx = 12.0;
     const double thWorld = thPx / scale_;
     const double thWorldSq = thWorld * thWorld;
 
-    for (int pi = polylines_.size() - 1; pi >= 0; --pi) {
-        const auto& pv = polylines_[pi];
+    const QRectF probe(worldPos.x() - thWorld, worldPos.y() - thWorld, thWorld * 2.0, thWorld * 2.0);
+    const QVector<int> candidates = polylinesInWorldRect(probe);
+    for (int ci = candidates.size() - 1; ci >= 0; --ci) {
+        const auto& pv = polylines_[candidates[ci]];
         const auto* entity = entityFor(pv.entityId);
         if (!entity) continue;
         if (!isEntityVisible(*entity)) continue;
@@ -518,7 +579,9 @@ void CanvasWidget::paintEvent(QPaintEvent*) {
     view.hasClip = m_hasClip;
     view.clipMinX = m_clipMinX; view.clipMinY = m_clipMinY;
     view.clipMaxX = m_clipMaxX; view.clipMaxY = m_clipMaxY;
-    scene_render::renderScene(pr, m_doc, polylines_, view, m_linetypes, &selected_entities_);
+    view.lodPixels = 1.0; // sub-pixel polylines/ellipses read as a dot anyway
+    scene_render::renderScene(pr, m_doc, polylines_, view, m_linetypes, &selected_entities_,
+                              false, &m_lastRenderStats);
 
     // 3. Draw Triangle Wireframe
     if (!triVerts_.isEmpty() && !triIndices_.isEmpty()) {
@@ -1171,6 +1234,7 @@ void CanvasWidget::reloadFromDocument() {
 
     const QSet<EntityId> prevSelection = selected_entities_;
     polylines_.clear();
+    polyline_index_.clear();
     selected_entities_.clear();
     QSet<EntityId> validIds;
 
@@ -1190,6 +1254,7 @@ void CanvasWidget::reloadFromDocument() {
         pv.entityId = e.id;
 
         updatePolyCache(pv);
+        polyline_index_.insert(e.id, polylines_.size());
         polylines_.append(pv);
         validIds.insert(e.id);
     }
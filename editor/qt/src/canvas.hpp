@@ -2,6 +2,7 @@
 
 #include <QWidget>
 #include <QVector>
+#include <QHash>
 #include <QPointF>
 #include <QColor>
 #include <QList>
@@ -79,6 +80,8 @@ public:
     // Sync selection from SelectionModel; Canvas is a view cache, not the source of truth.
     void setSelectionFromModel(const QList<qulonglong>& entityIds);
     QList<qulonglong> selectEntitiesInWorldRect(const QRectF& rect, bool crossing);
+    // Drawn/collapsed/culled entity counts from the most recent paint.
+    const scene_render::RenderStats& lastRenderStats() const { return m_lastRenderStats; }
 
 signals:
     // Emitted on user-driven selection changes; SelectionModel should be updated by the owner.
@@ -127,9 +130,12 @@ private:
     bool removePolyline(EntityId id);
     QList<qulonglong> selectionList() const;
     void on_document_changed(const core::Document& doc, const core::DocumentChangeEvent& event) override;
+    void on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) override;
     void selectGroupAtWorld(const QPointF& worldPos);  // Alt+Click to select entire group
     void selectAtPoint(const QPointF& worldPos);
     EntityId hitEntityAtWorld(const QPointF& worldPos) const;
+    // Indices into polylines_ (ascending) whose entity box meets worldRect.
+    QVector<int> polylinesInWorldRect(const QRectF& worldRect) const;
     const core::Entity* entityFor(EntityId id) const;
     const core::Layer* layerFor(int layerId) const;
     bool isEntityVisible(const core::Entity& entity) const;
@@ -153,7 +159,9 @@ private:
     SnapManager::SnapResult m_currentSnap;
     // Render cache derived from Document (do not mutate externally).
     QVector<PolyVis> polylines_;
+    QHash<EntityId, int> polyline_index_; // entityId -> index in polylines_
     QVector<SnapManager::PolylineView> snap_inputs_;
+    scene_render::RenderStats m_lastRenderStats;
     QSet<EntityId> selected_entities_;
     bool triSelected_ { false };
     QVector<QPointF> triVerts_;
@@ -8,14 +8,8 @@
 namespace export_helpers {
 
 namespace {
-uint32_t effectiveEntityColor(const core::Document& doc, const core::Entity& e) {
-    if (e.color != 0) return e.color;
-    const auto* layer = doc.get_layer(e.layerId);
-    return layer ? layer->color : 0xDCDCE6u;
-}
-
-void appendExportEntity(const core::Document& doc,
-                        const core::Entity& entity,
+void appendExportEntity(const core::Entity& entity,
+                        const core::Layer* layer,
                         QMap<int, ExportItem>& groupMap) {
     if (entity.type != core::EntityType::Polyline) return;
     const auto* pl = std::get_if<core::Polyline>(&entity.payload);
@@ -30,7 +24,6 @@ void appendExportEntity(const core::Document& doc,
     item.rings.append(ring);
 
     if (item.layerName.isEmpty()) {
-        const auto* layer = doc.get_layer(entity.layerId);
         if (layer) {
             item.layerName = QString::fromStdString(layer->name);
             item.layerColor = layer->color;
@@ -40,20 +33,34 @@ void appendExportEntity(const core::Document& doc,
         }
     }
 }
+
+QVector<ExportItem> toItems(const QMap<int, ExportItem>& groupMap) {
+    QVector<ExportItem> items;
+    items.reserve(groupMap.size());
+    for (auto it = groupMap.begin(); it != groupMap.end(); ++it) {
+        items.append(it.value());
+    }
+    return items;
+}
 } // namespace
 
 QVector<ExportItem> collectExportItems(const core::Document& doc, int groupIdFilter) {
     QMap<int, ExportItem> groupMap;
     for (const auto& entity : doc.entities()) {
+        if (entity.id == 0) continue; // removed
         if (groupIdFilter != -1 && entity.groupId != groupIdFilter) continue;
-        appendExportEntity(doc, entity, groupMap);
+        appendExportEntity(entity, doc.get_layer(entity.layerId), groupMap);
     }
-    QVector<ExportItem> items;
-    items.reserve(groupMap.size());
-    for (auto it = groupMap.begin(); it != groupMap.end(); ++it) {
-        items.append(it.value());
+    return toItems(groupMap);
+}
+
+QVector<ExportItem> collectExportItems(const core::DocumentSnapshot& snapshot, int groupIdFilter) {
+    QMap<int, ExportItem> groupMap;
+    for (const auto& entity : snapshot.entities()) {
+        if (groupIdFilter != -1 && entity->groupId != groupIdFilter) continue;
+        appendExportEntity(*entity, snapshot.get_layer(entity->layerId), groupMap);
     }
-    return items;
+    return toItems(groupMap);
 }
 
 int selectionGroupId(const core::Document& doc, const QList<qulonglong>& selection) {
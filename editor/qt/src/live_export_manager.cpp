@@ -3,6 +3,8 @@
 #include "exporter.hpp"
 
 #include <QDir>
+#include <QMetaObject>
+#include <QThreadPool>
 #include <QTimer>
 
 LiveExportManager::LiveExportManager(QObject* parent) : QObject(parent) {
@@ -10,10 +12,13 @@ LiveExportManager::LiveExportManager(QObject* parent) : QObject(parent) {
     m_debounce->setSingleShot(true);
     m_debounce->setInterval(300);
     connect(m_debounce, &QTimer::timeout, this, &LiveExportManager::doExport);
+    m_pool = new QThreadPool(this);
+    m_pool->setMaxThreadCount(1);
 }
 
 LiveExportManager::~LiveExportManager() {
     if (m_doc) m_doc->remove_observer(this);
+    m_pool->waitForDone();
 }
 
 void LiveExportManager::setDocument(core::Document* doc) {
@@ -39,6 +44,17 @@ void LiveExportManager::on_document_changed(const core::Document& doc, const cor
     scheduleExport();
 }
 
+void LiveExportManager::on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) {
+    if (&doc != m_doc) return;
+    if (!m_enabled) return;
+    // Export items are built from entities, layers and unit scale only.
+    const bool onlyDocumentMeta = changes.documentMetaChanged && changes.added.empty() &&
+        changes.removed.empty() && changes.geometryChanged.empty() && changes.metaChanged.empty() &&
+        changes.layersChanged.empty() && !changes.settingsChanged && !changes.fullReload;
+    if (onlyDocumentMeta) return;
+    scheduleExport();
+}
+
 void LiveExportManager::scheduleExport() {
     if (!m_enabled || m_exportDir.isEmpty()) return;
     m_debounce->start(); // restarts if already running (debounce)
@@ -47,21 +63,28 @@ void LiveExportManager::scheduleExport() {
 void LiveExportManager::doExport() {
     if (!m_doc || m_exportDir.isEmpty()) return;
 
-    auto items = export_helpers::collectExportItems(*m_doc);
-    if (items.isEmpty()) return;
-
-    QDir baseDir(m_exportDir);
-    if (!baseDir.exists()) {
-        emit exportFailed("Export directory does not exist: " + m_exportDir);
-        return;
-    }
+    // Collect and write from an immutable snapshot on the worker so editing
+    // continues meanwhile; the single-thread pool keeps exports in order.
+    std::shared_ptr<const core::DocumentSnapshot> snapshot = m_doc->snapshot();
+    const QString exportDir = m_exportDir;
+    m_pool->start([this, snapshot, exportDir] {
+        auto items = export_helpers::collectExportItems(*snapshot);
+        if (items.isEmpty()) return;
 
-    double unitScale = m_doc->settings().unit_scale;
-    auto result = exportScene(items, baseDir, ExportJSON | ExportGLTF, unitScale);
+        QDir baseDir(exportDir);
+        if (!baseDir.exists()) {
+            const QString error = "Export directory does not exist: " + exportDir;
+            QMetaObject::invokeMethod(this, [this, error] { emit exportFailed(error); }, Qt::QueuedConnection);
+            return;
+        }
 
-    if (result.ok) {
-        emit exported(result.sceneDir);
-    } else {
-        emit exportFailed(result.error);
-    }
+        auto result = exportScene(items, baseDir, ExportJSON | ExportGLTF, snapshot->settings().unit_scale);
+        QMetaObject::invokeMethod(this, [this, result] {
+            if (result.ok) {
+                emit exported(result.sceneDir);
+            } else {
+                emit exportFailed(result.error);
+            }
+        }, Qt::QueuedConnection);
+    });
 }
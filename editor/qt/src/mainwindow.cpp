@@ -37,6 +37,7 @@
 #include "core/ops2d.hpp"
 #include "panels/transform_panel.hpp"
 #include "live_export_manager.hpp"
+#include "solver/solver_job_queue.hpp"
 #include "tools/measure_tool.hpp"
 #include "guide_manager.hpp"
 #include "panels/align_panel.hpp"
@@ -117,6 +118,22 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     m_liveExport = new LiveExportManager(this);
     m_liveExport->setDocument(&m_document);
 
+    // Background constraint solver; results land on the undo stack.
+    m_solverQueue = new SolverJobQueue(this);
+    m_solverQueue->setDocument(&m_document);
+    m_solverQueue->setCommandManager(m_cmdMgr);
+    connect(m_solverQueue, &SolverJobQueue::progress, this, [this](int done, int count){
+        statusBar()->showMessage(QString("Solving constraints: %1/%2 components").arg(done).arg(count));
+    });
+    connect(m_solverQueue, &SolverJobQueue::solveFinished, this, [this](bool ok, int moved, const QString& message){
+        if (moved > 0) markDirty();
+        statusBar()->showMessage(ok ? QString("Constraints solved, %1 entities updated").arg(moved)
+                                    : QString("Constraint solve failed: %1").arg(message), 3000);
+    });
+    connect(m_solverQueue, &SolverJobQueue::solveCancelled, this, [this]{
+        statusBar()->showMessage("Constraint solve cancelled", 1500);
+    });
+
     m_selectionModel = new SelectionModel(this);
     m_snapSettings = new SnapSettings(this);
     canvas->setSnapSettings(m_snapSettings);
@@ -591,6 +608,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
                 if (!doc) return;
                 removed.clear();
                 removed.reserve(ids.size());
+                // One batch: storage is compacted once, not per removal.
+                core::DocumentChangeGuard batch(*doc);
                 for (core::EntityId id : ids) {
                     if (const auto* e = doc->get_entity(id)) {
                         removed.push_back(*e);
@@ -984,6 +1003,17 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
         statusBar()->showMessage("Guides cleared", 1000);
     });
 
+    toolsMenu->addSeparator();
+    auto* actSolve = toolsMenu->addAction("Solve Constraints");
+    connect(actSolve, &QAction::triggered, this, [this]{
+        if (m_document.constraints().empty()) { statusBar()->showMessage("No constraints to solve", 1500); return; }
+        m_solverQueue->requestSolve();
+    });
+    auto* actCancelSolve = toolsMenu->addAction("Cancel Constraint Solve");
+    connect(actCancelSolve, &QAction::triggered, this, [this]{
+        if (m_solverQueue->isBusy()) m_solverQueue->cancel();
+    });
+
     toolsMenu->addSeparator();
     auto* actExtrude = toolsMenu->addAction("Extrude Selection...");
     actExtrude->setShortcut(QKeySequence("E"));
@@ -1388,7 +1418,7 @@ static QVector<core::EntityId> buildRemovalSet(const core::Document& doc,
     if (sel->groupId != -1) {
         const int gid = sel->groupId;
         for (const auto& e : doc.entities()) {
-            if (e.type != core::EntityType::Polyline) continue;
+            if (e.id == 0 || e.type != core::EntityType::Polyline) continue;
             if (e.groupId == gid) addId(e.id);
         }
         return ids;
@@ -1396,7 +1426,7 @@ static QVector<core::EntityId> buildRemovalSet(const core::Document& doc,
 
     const uint32_t targetColor = effectiveEntityColor(doc, *sel);
     for (const auto& e : doc.entities()) {
-        if (e.type != core::EntityType::Polyline) continue;
+        if (e.id == 0 || e.type != core::EntityType::Polyline) continue;
         if (effectiveEntityColor(doc, e) == targetColor) addId(e.id);
     }
     return ids;
@@ -1733,8 +1763,8 @@ DxfImportResult parseDxfDwg(QString path) {
 
 void MainWindow::importFileFromPath(const QString& path) {
     // Dispatch parsing to a worker thread so the UI stays interactive on
-    // multi-MB files. Entity copy / zoom / status updates run on the UI
-    // thread in the finished handler — same logic as before, just relocated.
+    // multi-MB files. The finished handler splices the parsed document into
+    // m_document on the UI thread, then updates zoom / status.
     if (m_actImportDxf) m_actImportDxf->setEnabled(false);
     statusBar()->showMessage(QString("Importing %1...").arg(QFileInfo(path).fileName()));
 
@@ -1751,52 +1781,10 @@ void MainWindow::importFileFromPath(const QString& path) {
             return;
         }
 
+        // Move entities, layers and metadata across in one step; ids are
+        // remapped and the canvas syncs once from a single batched change.
         core::Document* srcDoc = reinterpret_cast<core::Document*>(r.tmpDoc);
-        std::map<int, int> layerMap;
-        cadgf_document* dstDoc = reinterpret_cast<cadgf_document*>(&m_document);
-        for (int lid = 0; lid < 1000; ++lid) {
-            auto* layer = srcDoc->get_layer(lid);
-            if (!layer) continue;
-            int newLid = 0;
-            cadgf_document_add_layer(dstDoc, layer->name.c_str(), layer->color, &newLid);
-            if (layer->line_weight > 0.0)
-                if (auto* dstLayer = m_document.get_layer(newLid))
-                    dstLayer->line_weight = layer->line_weight;
-            layerMap[lid] = newLid;
-        }
-
-        for (const auto& e : srcDoc->entities()) {
-            int dstLayer = layerMap.count(e.layerId) ? layerMap[e.layerId] : 0;
-            core::EntityId newId = 0;
-
-            if (auto* pl = std::get_if<core::Polyline>(&e.payload)) {
-                std::vector<cadgf_vec2> pts;
-                pts.reserve(pl->points.size());
-                for (auto& p : pl->points) pts.push_back({p.x, p.y});
-                newId = cadgf_document_add_polyline_ex(dstDoc, pts.data(),
-                    static_cast<int>(pts.size()), e.name.c_str(), dstLayer);
-            } else if (auto* t = std::get_if<core::Text>(&e.payload)) {
-                cadgf_vec2 pos = {t->pos.x, t->pos.y};
-                newId = cadgf_document_add_text(dstDoc, &pos, t->height,
-                    t->rotation, t->text.c_str(), e.name.c_str(), dstLayer);
-            } else if (auto* ell = std::get_if<core::Ellipse>(&e.payload)) {
-                cadgf_ellipse ce;
-                ce.center = {ell->center.x, ell->center.y};
-                ce.rx = ell->rx; ce.ry = ell->ry;
-                ce.rotation = ell->rotation;
-                ce.start_angle = ell->start_angle; ce.end_angle = ell->end_angle;
-                newId = cadgf_document_add_ellipse(dstDoc, &ce, e.name.c_str(), dstLayer);
-            }
-
-            if (newId > 0) {
-                if (e.color != 0)
-                    cadgf_document_set_entity_color(dstDoc, newId, e.color);
-                if (!e.line_type.empty())
-                    cadgf_document_set_entity_line_type(dstDoc, newId, e.line_type.c_str());
-                if (e.line_weight > 0)
-                    cadgf_document_set_entity_line_weight(dstDoc, newId, e.line_weight);
-            }
-        }
+        m_document.splice_from(std::move(*srcDoc));
         cadgf_document_destroy(r.tmpDoc);
         markDirty();
 
@@ -19,6 +19,7 @@ class QLabel;
 class QListWidget;
 class TransformPanel;
 class LiveExportManager;
+class SolverJobQueue;
 class MeasureTool;
 class GuideManager;
 class AlignPanel;
@@ -99,6 +100,7 @@ private:
 
     TransformPanel* m_transformPanel{nullptr};
     LiveExportManager* m_liveExport{nullptr};
+    SolverJobQueue* m_solverQueue{nullptr};
     MeasureTool* m_measureTool{nullptr};
     GuideManager* m_guideManager{nullptr};
     AlignPanel* m_alignPanel{nullptr};
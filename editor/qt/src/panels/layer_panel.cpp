@@ -66,6 +66,11 @@ void LayerPanel::on_document_changed(const core::Document& doc, const core::Docu
     }
 }
 
+void LayerPanel::on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) {
+    if (&doc != m_doc) return;
+    if (changes.fullReload || !changes.layersChanged.empty()) scheduleRefresh();
+}
+
 void LayerPanel::refresh() {
     m_tree->clear();
     if (!m_doc) return;
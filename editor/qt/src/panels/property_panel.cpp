@@ -89,6 +89,21 @@ void PropertyPanel::on_document_changed(const core::Document& doc, const core::D
     }
 }
 
+void PropertyPanel::on_document_batch_changed(const core::Document& doc, const core::DocumentChangeSet& changes) {
+    if (&doc != m_doc) return;
+    if (m_currentSelection.isEmpty()) return;
+    if (changes.fullReload) {
+        refreshVisibleCheckState();
+        return;
+    }
+    for (core::EntityId changed : changes.metaChanged) {
+        if (m_currentSelection.contains(static_cast<qulonglong>(changed))) {
+            refreshVisibleCheckState();
+            return;
+        }
+    }
+}
+
 void PropertyPanel::updateFromSelection(const QList<qulonglong>& entityIds) {
     qDebug() << "PropertyPanel::updateFromSelection - entityIds:" << entityIds;
     m_currentSelection = entityIds;
@@ -96,7 +96,7 @@ bool Project::save(const QString& path, const core::Document& doc, CanvasWidget*
     docMetaJson.insert("modifiedAt", QString::fromStdString(docMeta.modified_at));
     docMetaJson.insert("unitName", QString::fromStdString(docMeta.unit_name));
     QJsonObject metaMap;
-    for (const auto& kv : docMeta.meta) {
+    for (const auto& kv : doc.meta_entries()) {
         metaMap.insert(QString::fromStdString(kv.first), QString::fromStdString(kv.second));
     }
     docMetaJson.insert("meta", metaMap);
@@ -196,6 +196,7 @@ bool Project::load(const QString& path, core::Document& doc, CanvasWidget* canva
                 auto* layer0 = doc.get_layer(0);
                 if (layer0) {
                     layer0->name = name.toStdString();
+                    doc.mark_modified();
                     doc.set_layer_color(0, color);
                     doc.set_layer_visible(0, visible);
                     doc.set_layer_locked(0, locked);
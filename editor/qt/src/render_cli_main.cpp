@@ -159,11 +159,9 @@ TextNameParts textNameParts(const core::Entity& e) {
 std::string lookupEntityMeta(const core::Document& doc, core::EntityId id,
                              const char* suffix) {
     if (!suffix || !*suffix) return {};
-    const std::string key = "dxf.entity." +
-        std::to_string(static_cast<unsigned long long>(id)) + "." + suffix;
-    const auto it = doc.metadata().meta.find(key);
-    if (it == doc.metadata().meta.end()) return {};
-    return it->second;
+    core::EntityAttrField field{};
+    if (!doc.find_entity_attr_field(suffix, &field)) return {};
+    return doc.entity_attr_text(id, field);
 }
 
 // Counts only the text entities renderScene will actually draw — same
@@ -234,7 +232,7 @@ bool isRequestedCjkSerifFamily(const QString& family) {
 QJsonArray fontRecords(const core::Document& doc) {
     QSet<QString> requested;
     for (const auto& e : doc.entities()) {
-        if (!willDrawText(doc, e)) continue;
+        if (e.id == 0 || !willDrawText(doc, e)) continue;
         requested.insert(familyOf(e));
     }
     QJsonArray arr;
@@ -261,7 +259,7 @@ QJsonArray fontRecords(const core::Document& doc) {
 int textEntityCount(const core::Document& doc) {
     int n = 0;
     for (const auto& e : doc.entities())
-        if (willDrawText(doc, e)) ++n;
+        if (e.id != 0 && willDrawText(doc, e)) ++n;
     return n;
 }
 
@@ -277,7 +275,7 @@ QJsonObject textPlacementReport(const core::Document& doc,
     double maxWidthWorld = 0.0;
     double maxHeightWorld = 0.0;
     for (const auto& e : doc.entities()) {
-        if (!willDrawText(doc, e)) continue;
+        if (e.id == 0 || !willDrawText(doc, e)) continue;
         const auto* txt = std::get_if<core::Text>(&e.payload);
         if (!txt) continue;
 
@@ -411,7 +409,7 @@ QJsonObject semanticClassCounts(const core::Document& doc) {
         counts[QString::fromStdString(name)] = 0;
     }
     for (const auto& e : doc.entities()) {
-        if (!willDrawEntity(doc, e)) continue;
+        if (e.id == 0 || !willDrawEntity(doc, e)) continue;
         const QString name = QString::fromStdString(scene_render::semanticClassName(&doc, e));
         counts[name] = counts.value(name).toInt() + 1;
     }
@@ -504,6 +502,7 @@ int main(int argc, char** argv) {
     parser.addOption({"window", "Frame a specific world rect 'x1,y1,x2,y2' (with the standard margin) instead of the drawing extents — e.g. the sheet frame for a garbage-extents drawing.", "rect"});
     parser.addOption({"font-dir", "Directory of font files (ttf/ttc/otf) to load before rendering.", "dir"});
     parser.addOption({"report",  "Write a render report JSON (params, view, counts, font records) to this path.", "file"});
+    parser.addOption({"lod-px", "Draw polylines/ellipses smaller than this many pixels as a dot (default 0 = full detail).", "px", "0"});
     parser.addOption({"class-mask-out", "Write a semantic class-buffer PNG using the exact same view as --out. Background is black; class colors are listed in the report.", "file"});
     parser.process(app);
 
@@ -539,6 +538,12 @@ int main(int argc, char** argv) {
         std::fprintf(stderr, "error: bad --width/--height\n");
         return 2;
     }
+    bool lodOk = false;
+    const double lodPixels = parser.value("lod-px").toDouble(&lodOk);
+    if (!lodOk || lodPixels < 0.0) {
+        std::fprintf(stderr, "error: bad --lod-px\n");
+        return 2;
+    }
     QColor bg;
     if (!parseBackground(parser.value("bg"), &bg)) {
         std::fprintf(stderr, "error: bad --bg value: %s\n", qPrintable(parser.value("bg")));
@@ -617,12 +622,15 @@ int main(int argc, char** argv) {
     view.lightBackground =
         (0.299 * bg.red() + 0.587 * bg.green() + 0.114 * bg.blue()) / 255.0 > 0.5;
 
+    view.lodPixels = lodPixels;
+
     scene_render::LinetypeTable linetypes;
     linetypes.patterns = imp.adapter->linetypes();
     linetypes.ltScale = imp.adapter->ltScale();
 
     const QVector<scene_render::PolyVis> polylines = scene_render::buildPolyCache(*doc);
 
+    scene_render::RenderStats renderStats;
     bool written = false;
     if (outSuffix == "svg") {
         QSvgGenerator svg;
@@ -632,14 +640,14 @@ int main(int argc, char** argv) {
         svg.setTitle(QFileInfo(inPath).fileName());
         QPainter pr(&svg);
         pr.fillRect(QRect(0, 0, width, height), bg);
-        scene_render::renderScene(pr, doc, polylines, view, linetypes);
+        scene_render::renderScene(pr, doc, polylines, view, linetypes, nullptr, false, &renderStats);
         pr.end();
         written = QFile::exists(outPath);
     } else {
         QImage img(viewport, QImage::Format_ARGB32_Premultiplied);
         img.fill(bg);
         QPainter pr(&img);
-        scene_render::renderScene(pr, doc, polylines, view, linetypes);
+        scene_render::renderScene(pr, doc, polylines, view, linetypes, nullptr, false, &renderStats);
         pr.end();
         written = img.save(outPath);
     }
@@ -672,6 +680,7 @@ int main(int argc, char** argv) {
         params["bg"] = parser.value("bg");
         params["format"] = outSuffix;
         params["view"] = haveWindow ? "window" : (hasExtents ? "extents" : "content");
+        params["lod_px"] = lodPixels;
         rep["params"] = params;
         QJsonObject v;
         v["scale"] = view.scale;
@@ -706,6 +715,10 @@ int main(int argc, char** argv) {
         counts["entities"] = entityCount;
         counts["polylines"] = polylines.size();
         counts["text_entities"] = textEntityCount(*doc);
+        // Color-pass renderScene counts (texts, ellipses, polylines).
+        counts["drawn"] = renderStats.drawn;
+        counts["collapsed"] = renderStats.collapsed;
+        counts["culled"] = renderStats.culled;
         rep["counts"] = counts;
         QJsonObject classes;
         classes["schema"] = "vemcad.render_semantic_classes";
@@ -6,11 +6,14 @@
 #include <QFontInfo>
 #include <QFontMetricsF>
 #include <QPainter>
+#include <QHash>
 #include <QPen>
+#include <QStaticText>
 #include <QStringList>
 #include <QTransform>
 #include <QtGlobal>
 
+#include <algorithm>
 #include <cmath>
 #include <cctype>
 #include <cstdlib>
@@ -300,40 +303,34 @@ bool parse_int(const std::string& s, int* out) {
     return true;
 }
 
-std::string lookup_entity_meta(const core::Document* doc, EntityId id, const char* suffix) {
-    if (!doc || id == 0 || !suffix || !*suffix) return {};
-    const auto& meta = doc->metadata().meta;
-    const std::string key = "dxf.entity." +
-        std::to_string(static_cast<unsigned long long>(id)) + "." + suffix;
-    const auto it = meta.find(key);
-    if (it == meta.end()) return {};
-    return it->second;
+std::string lookup_entity_meta(const core::Document* doc, EntityId id, core::EntityAttrField field) {
+    if (!doc || id == 0) return {};
+    return doc->entity_attr_text(id, field);
 }
 
-bool isHgcadShxTextStyle(const core::Document* doc, EntityId id) {
-    auto hasHgcad = [](std::string value) {
-        for (char& c : value)
-            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-        return value.find("hgcad") != std::string::npos;
-    };
-    return hasHgcad(lookup_entity_meta(doc, id, "text_font_file")) ||
-           hasHgcad(lookup_entity_meta(doc, id, "text_bigfont_file"));
-}
+// SHX provenance of a text entity, from its font/bigfont file attributes.
+struct ShxTextStyle {
+    bool hgcad{false};        // HGCAD.SHX / HGCADHZ.SHX
+    bool romansHzdx{false};   // romans.shx + hzdx.shx
+};
 
-bool isRomansHzdxShxTextStyle(const core::Document* doc, EntityId id) {
+ShxTextStyle shxTextStyle(const core::Document* doc, EntityId id) {
     auto fold = [](std::string value) {
         for (char& c : value)
             c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
         return value;
     };
-    const std::string font = fold(lookup_entity_meta(doc, id, "text_font_file"));
-    const std::string bigfont = fold(lookup_entity_meta(doc, id, "text_bigfont_file"));
-    return font.find("romans") != std::string::npos &&
-           bigfont.find("hzdx") != std::string::npos;
+    const std::string font = fold(lookup_entity_meta(doc, id, core::EntityAttrField::TextFontFile));
+    const std::string bigfont = fold(lookup_entity_meta(doc, id, core::EntityAttrField::TextBigfontFile));
+    ShxTextStyle style;
+    style.hgcad = font.find("hgcad") != std::string::npos || bigfont.find("hgcad") != std::string::npos;
+    style.romansHzdx = font.find("romans") != std::string::npos &&
+                       bigfont.find("hzdx") != std::string::npos;
+    return style;
 }
 
-double romansHzdxBaselineAdjustPx(const core::Document* doc, EntityId id, double targetPx) {
-    if (!isRomansHzdxShxTextStyle(doc, id)) return 0.0;
+double romansHzdxBaselineAdjustPx(const ShxTextStyle& style, double targetPx) {
+    if (!style.romansHzdx) return 0.0;
     // The romans.shx + hzdx.shx pair uses the normal serif CJK fallback for
     // glyph coverage, but AutoCAD positions this SHX stack slightly closer to
     // the cap/top line. A small screen-space upward baseline adjustment reduced
@@ -360,6 +357,136 @@ QColor color_from_rgb(uint32_t rgb) {
     return QColor((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
 }
 
+// World rect that can receive ink: the painter's viewport mapped back through
+// the view, narrowed to the EXTMIN/EXTMAX clip (same 10-unit margin) if set.
+QRectF visibleWorldRect(const QPainter& pr, const View& view) {
+    const QRectF vp(pr.viewport());
+    const double s = view.scale > 0.0 ? view.scale : 1.0;
+    QRectF world(QPointF((vp.left() - view.pan.x()) / s, (view.pan.y() - vp.bottom()) / s),
+                 QPointF((vp.right() - view.pan.x()) / s, (view.pan.y() - vp.top()) / s));
+    if (view.hasClip) {
+        const double margin = 10.0;
+        world = world.intersected(QRectF(QPointF(view.clipMinX - margin, view.clipMinY - margin),
+                                         QPointF(view.clipMaxX + margin, view.clipMaxY + margin)));
+    }
+    return world;
+}
+
+// Bounds padded by padPx screen pixels (pen half-width, antialiasing) still
+// reach the visible rect. The pad also keeps zero-height/width boxes testable.
+bool reachesView(const QRectF& bounds, double padPx, const QRectF& visible, const View& view) {
+    const double pad = padPx / (view.scale > 0.0 ? view.scale : 1.0);
+    return bounds.adjusted(-pad, -pad, pad, pad).intersects(visible);
+}
+
+// Upper bound on the half-width in pixels of a stroke whose pen is picked
+// from entity/layer line weights (or the <= 3px layer-name fallbacks).
+double maxHalfPenPx(const core::Entity& e, const core::Layer* layer, double scale) {
+    double px = 3.0;
+    px = std::max(px, e.line_weight * scale);
+    if (layer) px = std::max(px, layer->line_weight * scale);
+    return px * 0.5 + 1.0;
+}
+
+// Text caches for renderScene. Drawings repeat a few families and sizes and
+// many identical strings (dimension values, labels, title-block fields), so
+// family resolution, the glyph-height probe, QFont setup and text layout are
+// done once per distinct key instead of on every paint. Each map is simply
+// dropped when it grows past its cap. Allocated once and never freed: QFont
+// and QStaticText must not be destroyed after the font database at exit.
+// Like any QFont use, renderScene runs on one thread at a time.
+struct TextFamily {
+    QString family;          // resolveTextFamily() result
+    double widthFactor{1.0}; // from "family\x1f<widthFactor>"
+    bool songLike{false};    // isSongLikeCjkRequest(family)
+};
+struct SizedFont {
+    QFont font;
+    qreal ascent{0.0};       // QStaticText draws from the top, drawText from the baseline
+};
+struct TextCache {
+    QHash<QString, TextFamily> families; // raw Entity::name
+    QHash<QString, double> ratios;       // family \x1f sample -> glyph px per pixelSize
+    QHash<QString, SizedFont> fonts;     // family \x1f pixelSize
+    QHash<QString, QStaticText> runs;    // family \x1f pixelSize \x1f line
+};
+
+TextCache& textCache() {
+    static TextCache* cache = new TextCache;
+    return *cache;
+}
+
+template <typename Map>
+void capCache(Map& map, int cap) {
+    if (map.size() >= cap) map.clear();
+}
+
+const TextFamily& cachedTextFamily(const std::string& rawName) {
+    auto& families = textCache().families;
+    const QString key = QString::fromStdString(rawName);
+    auto it = families.constFind(key);
+    if (it != families.constEnd()) return it.value();
+    // Importer carries "family" or "family\x1f<widthFactor>" on Entity::name
+    // (no core::Text change). Split it out.
+    TextFamily tf;
+    QString fam;
+    const int sep = key.indexOf(QChar(0x1f));
+    if (sep >= 0) {
+        fam = key.left(sep);
+        bool ok = false; double w = key.mid(sep + 1).toDouble(&ok);
+        if (ok && w > 0.05 && w < 20.0) tf.widthFactor = w;
+    } else {
+        fam = key;
+    }
+    tf.family = resolveTextFamily(fam); // best-available 仿宋/song family (was STFangsong)
+    tf.songLike = isSongLikeCjkRequest(tf.family);
+    capCache(families, 1024);
+    return families.insert(key, tf).value();
+}
+
+// Glyph px per pixelSize for `sample` in `family`, measured on the actual
+// string so sizing is unchanged from an uncached probe.
+double cachedGlyphRatio(const QString& family, const QString& sample) {
+    auto& ratios = textCache().ratios;
+    const QString key = family + QChar(0x1f) + sample;
+    auto it = ratios.constFind(key);
+    if (it != ratios.constEnd()) return it.value();
+    constexpr double kProbe = 256.0;
+    QFont mfont; mfont.setFamily(family); mfont.setPixelSize(static_cast<int>(kProbe));
+    double gh = QFontMetricsF(mfont).tightBoundingRect(sample).height();
+    double ratio = (gh > 1.0) ? gh / kProbe : 0.72;
+    capCache(ratios, 16384);
+    ratios.insert(key, ratio);
+    return ratio;
+}
+
+const SizedFont& cachedFont(const QString& family, int pixelSize) {
+    auto& fonts = textCache().fonts;
+    const QString key = family + QChar(0x1f) + QString::number(pixelSize);
+    auto it = fonts.constFind(key);
+    if (it != fonts.constEnd()) return it.value();
+    SizedFont sf;
+    sf.font.setFamily(family);
+    sf.font.setPixelSize(pixelSize);
+    sf.ascent = QFontMetricsF(sf.font).ascent();
+    capCache(fonts, 512);
+    return fonts.insert(key, sf).value();
+}
+
+// Laid-out line for reuse across paints; QStaticText re-lays out only when the
+// painter transform changes by more than a translation.
+const QStaticText& cachedRun(const QString& family, int pixelSize, const QString& line) {
+    auto& runs = textCache().runs;
+    const QString key = family + QChar(0x1f) + QString::number(pixelSize) + QChar(0x1f) + line;
+    auto it = runs.constFind(key);
+    if (it != runs.constEnd()) return it.value();
+    QStaticText st(line);
+    st.setTextFormat(Qt::PlainText);
+    st.setPerformanceHint(QStaticText::AggressiveCaching);
+    capCache(runs, 8192);
+    return runs.insert(key, st).value();
+}
+
 } // namespace
 
 QPointF worldToScreen(const View& view, const QPointF& p) {
@@ -448,14 +575,14 @@ QColor resolveEntityColor(const core::Document* doc, const core::Entity& entity,
     if (color != 0 && color != 0xDCDCE6u)
         return finalize_color(color, flipWhiteOnLight && !layerTrueWhiteAci);
 
-    const std::string source = lookup_entity_meta(doc, entity.id, "color_source");
+    const std::string source = lookup_entity_meta(doc, entity.id, core::EntityAttrField::ColorSource);
     if (!source.empty()) {
         if (source == "BYLAYER") {
             color = layer_color;
         } else if (source == "BYBLOCK") {
             if (color == 0) {
                 int aci = 0;
-                const std::string aci_text = lookup_entity_meta(doc, entity.id, "color_aci");
+                const std::string aci_text = lookup_entity_meta(doc, entity.id, core::EntityAttrField::ColorAci);
                 if (parse_int(aci_text, &aci) && aci > 0) {
                     color = aci_to_rgb(aci);
                 } else {
@@ -465,7 +592,7 @@ QColor resolveEntityColor(const core::Document* doc, const core::Entity& entity,
         } else if (source == "INDEX") {
             if (color == 0) {
                 int aci = 0;
-                const std::string aci_text = lookup_entity_meta(doc, entity.id, "color_aci");
+                const std::string aci_text = lookup_entity_meta(doc, entity.id, core::EntityAttrField::ColorAci);
                 if (parse_int(aci_text, &aci) && aci > 0) {
                     color = aci_to_rgb(aci);
                 } else {
@@ -475,7 +602,7 @@ QColor resolveEntityColor(const core::Document* doc, const core::Entity& entity,
         } else if (source == "TRUECOLOR") {
             if (color == 0) {
                 int aci = 0;
-                const std::string aci_text = lookup_entity_meta(doc, entity.id, "color_aci");
+                const std::string aci_text = lookup_entity_meta(doc, entity.id, core::EntityAttrField::ColorAci);
                 if (parse_int(aci_text, &aci) && aci > 0) {
                     color = aci_to_rgb(aci);
                 } else {
@@ -510,9 +637,9 @@ uint32_t semanticClassRgb(const std::string& name) {
 }
 
 std::string semanticClassName(const core::Document* doc, const core::Entity& entity) {
-    const std::string source = lookup_entity_meta(doc, entity.id, "source_type");
-    const std::string textKind = lookup_entity_meta(doc, entity.id, "text_kind");
-    const std::string attributeTag = lookup_entity_meta(doc, entity.id, "attribute_tag");
+    const std::string source = lookup_entity_meta(doc, entity.id, core::EntityAttrField::SourceType);
+    const std::string textKind = lookup_entity_meta(doc, entity.id, core::EntityAttrField::TextKind);
+    const std::string attributeTag = lookup_entity_meta(doc, entity.id, core::EntityAttrField::AttributeTag);
 
     if (source == "DIMENSION" || textKind == "dimension") return "dimension";
     if (source == "HATCH" || entity.line_type == "__HATCH_FILL__") return "hatch";
@@ -665,8 +792,11 @@ void renderScene(QPainter& pr, const core::Document* doc,
                  const QVector<PolyVis>& polylines, const View& view,
                  const LinetypeTable& linetypes,
                  const QSet<EntityId>* selection,
-                 bool semanticClassMask) {
+                 bool semanticClassMask,
+                 RenderStats* stats) {
     if (!doc) return;
+    RenderStats counts;
+    const QRectF visible = visibleWorldRect(pr, view);
 
     QTransform transform;
     transform.translate(view.pan.x(), view.pan.y());
@@ -700,27 +830,15 @@ void renderScene(QPainter& pr, const core::Document* doc,
                 : resolveEntityColor(doc, e, view.lightBackground);
             pr.setPen(col);
             QPointF screenPos = worldToScreen(view, QPointF(txt->pos.x, txt->pos.y));
-            // Importer carries "family" or "family\x1f<widthFactor>" on
-            // Entity::name (no core::Text change). Split it out.
-            QString fam; double widthFactor = 1.0;
-            {
-                QString nm = QString::fromStdString(e.name);
-                int sep = nm.indexOf(QChar(0x1f));
-                if (sep >= 0) {
-                    fam = nm.left(sep);
-                    bool ok = false; double w = nm.mid(sep + 1).toDouble(&ok);
-                    if (ok && w > 0.05 && w < 20.0) widthFactor = w;
-                } else {
-                    fam = nm;
-                }
-                fam = resolveTextFamily(fam); // best-available 仿宋/song family (was STFangsong)
-            }
+            const TextFamily& textFamily = cachedTextFamily(e.name);
+            const QString& fam = textFamily.family;
+            const double widthFactor = textFamily.widthFactor;
             // AutoCAD model: a DXF text of world-height H is drawn so the
             // glyphs are H units tall → on screen H*scale px. Size the font so
             // the ACTUAL string's tight bounding box height == H*scale (works
             // for any font/script: Latin digits, CJK — capHeight() is
-            // unreliable for CJK fonts). Cache the glyph-px-per-pixelSize ratio
-            // per (family, line) class to keep paintEvent cheap.
+            // unreliable for CJK fonts). The glyph-px-per-pixelSize ratio is
+            // cached per (family, sample) to keep paintEvent cheap.
             double targetPx = txt->height * view.scale;
             // Do NOT skip sub-pixel text: AutoCAD/ezdxf still draw it (clamped
             // to ~1px). Skipping made dense annotation vanish when a large
@@ -731,27 +849,35 @@ void renderScene(QPainter& pr, const core::Document* doc,
             QString sample;
             for (const QString& ln : lines) if (!ln.isEmpty()) { sample = ln; break; }
             if (sample.isEmpty()) continue;
-            constexpr double kProbe = 256.0;
-            QFont mfont; mfont.setFamily(fam); mfont.setPixelSize(static_cast<int>(kProbe));
-            double gh = QFontMetricsF(mfont).tightBoundingRect(sample).height();
-            double ratio = (gh > 1.0) ? gh / kProbe : 0.72; // glyph px per pixelSize
+            // Conservative reach of the laid-out text around its insertion
+            // point (any rotation): font px run ~1.4x the glyph height, lines
+            // step 1.4x that, CJK advances ~1 em. Cull before the font metric
+            // probe below, which dominates the cost of off-screen text.
+            {
+                int longest = 0;
+                for (const QString& ln : lines) longest = std::max(longest, static_cast<int>(ln.size()));
+                const double reach = txt->height * (2.0 * widthFactor * longest + 2.0 * lines.size() + 2.0);
+                const QRectF around(txt->pos.x - reach, txt->pos.y - reach, 2.0 * reach, 2.0 * reach);
+                if (!reachesView(around, 4.0, visible, view)) { ++counts.culled; continue; }
+            }
+            ++counts.drawn;
+            const double ratio = cachedGlyphRatio(fam, sample); // glyph px per pixelSize
             double fontSize = targetPx / ratio;
             // No fixed minimum: text must scale with zoom like AutoCAD (a px
             // floor makes zoomed-out text oversized vs geometry). Only guard
             // against zero/degenerate sizes.
             if (fontSize < 1.0) fontSize = 1.0;
             if (fontSize > 4000.0) fontSize = 4000.0;
-            QFont font;
-            font.setFamily(fam);
-            font.setPixelSize(static_cast<int>(fontSize));
+            const int pixelSize = static_cast<int>(fontSize);
+            const SizedFont& sized = cachedFont(fam, pixelSize);
             // HGCAD.SHX/HGCADHZ.SHX behaves closer to AutoCAD's single-stroke
             // engineering SHX text than to regular CJK song/仿宋 outlines.
             // Keep the heavier fallback overdraw for normal song-like defaults,
             // but avoid it for this provenance-confirmed SHX style.
-            const bool hgcadShxTextStyle = isHgcadShxTextStyle(doc, e.id);
+            const ShxTextStyle shx = shxTextStyle(doc, e.id);
             const bool cjkSerifTextOverdraw =
-                !semanticClassMask && !hgcadShxTextStyle && isSongLikeCjkRequest(fam);
-            pr.setFont(font);
+                !semanticClassMask && !shx.hgcad && textFamily.songLike;
+            pr.setFont(sized.font);
             pr.save();
             pr.translate(screenPos);
             if (std::abs(txt->rotation) > 0.01)
@@ -761,11 +887,13 @@ void renderScene(QPainter& pr, const core::Document* doc,
             if (std::abs(widthFactor - 1.0) > 0.01)
                 pr.scale(widthFactor, 1.0);
             double lineH = fontSize * 1.4;
-            const double baselineAdjustPx = romansHzdxBaselineAdjustPx(doc, e.id, targetPx);
+            const double baselineAdjustPx = romansHzdxBaselineAdjustPx(shx, targetPx);
             for (int li = 0; li < lines.size(); ++li) {
                 if (lines[li].isEmpty()) continue;
-                const QPointF origin(0, li * lineH + baselineAdjustPx);
-                pr.drawText(origin, lines[li]);
+                const QStaticText& run = cachedRun(fam, pixelSize, lines[li]);
+                // Top-left of the run whose baseline sits where drawText put it.
+                const QPointF origin(0, li * lineH + baselineAdjustPx - sized.ascent);
+                pr.drawStaticText(origin, run);
                 if (cjkSerifTextOverdraw) {
                     // AutoCAD's mechanical plots render default SHX/CJK 仿宋
                     // text with a slightly heavier stroke than headless Qt's
@@ -777,10 +905,10 @@ void renderScene(QPainter& pr, const core::Document* doc,
                     // class masks unmodified so diagnostics still report entity
                     // coverage rather than display-weight inflation.
                     constexpr qreal kCjkSerifOverdrawPx = 1.0;
-                    pr.drawText(origin + QPointF(kCjkSerifOverdrawPx, 0), lines[li]);
-                    pr.drawText(origin + QPointF(-kCjkSerifOverdrawPx, 0), lines[li]);
-                    pr.drawText(origin + QPointF(0, kCjkSerifOverdrawPx), lines[li]);
-                    pr.drawText(origin + QPointF(0, -kCjkSerifOverdrawPx), lines[li]);
+                    pr.drawStaticText(origin + QPointF(kCjkSerifOverdrawPx, 0), run);
+                    pr.drawStaticText(origin + QPointF(-kCjkSerifOverdrawPx, 0), run);
+                    pr.drawStaticText(origin + QPointF(0, kCjkSerifOverdrawPx), run);
+                    pr.drawStaticText(origin + QPointF(0, -kCjkSerifOverdrawPx), run);
                 }
             }
             pr.restore();
@@ -794,6 +922,12 @@ void renderScene(QPainter& pr, const core::Document* doc,
         if (!isEntityVisible(doc, e)) continue;
         const auto* ell = std::get_if<core::Ellipse>(&e.payload);
         if (!ell) continue;
+        const double reach = std::max(std::abs(ell->rx), std::abs(ell->ry));
+        const QRectF ellBounds(ell->center.x - reach, ell->center.y - reach, 2.0 * reach, 2.0 * reach);
+        if (!reachesView(ellBounds, maxHalfPenPx(e, layer_for(doc, e.layerId), view.scale), visible, view)) {
+            ++counts.culled;
+            continue;
+        }
         QColor color = semanticClassMask
             ? color_from_rgb(semanticClassRgb(semanticClassName(doc, e)))
             : resolveEntityColor(doc, e, view.lightBackground);
@@ -822,6 +956,14 @@ void renderScene(QPainter& pr, const core::Document* doc,
             }
             pen.setWidthF(lwPx > 0.0 ? lwPx : 1.0);
         }
+        if (view.lodPixels > 0.0 && 2.0 * reach * view.scale < view.lodPixels) {
+            pen.setStyle(Qt::SolidLine);
+            pr.setPen(pen);
+            pr.drawPoint(QPointF(ell->center.x, ell->center.y));
+            ++counts.collapsed;
+            continue;
+        }
+        ++counts.drawn;
         pr.setPen(pen);
         double sa = ell->start_angle, ea = ell->end_angle;
         if (std::abs(ea - sa) < 1e-10) { sa = 0; ea = 2.0 * M_PI; }
@@ -848,6 +990,11 @@ void renderScene(QPainter& pr, const core::Document* doc,
         const core::Entity* entity = (pv.entityId != 0) ? doc->get_entity(pv.entityId) : nullptr;
         if (!entity) continue;
         if (!isEntityVisible(doc, *entity)) continue;
+        const auto* layer = layer_for(doc, entity->layerId);
+        if (!reachesView(pv.aabb, maxHalfPenPx(*entity, layer, view.scale), visible, view)) {
+            ++counts.culled;
+            continue;
+        }
 
         QColor color = semanticClassMask
             ? color_from_rgb(semanticClassRgb(semanticClassName(doc, *entity)))
@@ -857,7 +1004,6 @@ void renderScene(QPainter& pr, const core::Document* doc,
 
         // Line weight: entity → layer → layer-name fallback
         double lwPx = 0.0;
-        const auto* layer = layer_for(doc, entity->layerId);
         std::string ln = layer ? layer->name : "";
 
         // Pattern-fill hatch lines: marked by the importer with linetype
@@ -906,6 +1052,15 @@ void renderScene(QPainter& pr, const core::Document* doc,
             pen.setStyle(Qt::SolidLine);
             pen.setWidthF(2.5);
         }
+        if (view.lodPixels > 0.0 &&
+            std::max(pv.aabb.width(), pv.aabb.height()) * view.scale < view.lodPixels) {
+            pen.setStyle(Qt::SolidLine);
+            pr.setPen(pen);
+            pr.drawPoint(pv.aabb.center());
+            ++counts.collapsed;
+            continue;
+        }
+        ++counts.drawn;
         pr.setPen(pen);
         // SOLID/TRACE entities: filled polygon (drawn in world coords via transform)
         if (entity->name == "__SOLID__" && pv.pts.size() >= 3) {
@@ -919,6 +1074,7 @@ void renderScene(QPainter& pr, const core::Document* doc,
     }
 
     pr.restore();
+    if (stats) *stats = counts;
 }
 
 } // namespace scene_render
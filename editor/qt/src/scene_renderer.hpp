@@ -49,6 +49,18 @@ struct View {
     // color-7 / background-relative convention. Editor (dark canvas) leaves
     // this false; render_cli sets it when --bg is light.
     bool lightBackground{false};
+    // Level of detail: polylines and ellipses whose on-screen extent is below
+    // this many pixels are drawn as a single dot. 0 keeps full geometry (the
+    // render_cli default, so reference comparisons are unaffected). Text is
+    // never collapsed; see renderScene.
+    double lodPixels{0.0};
+};
+
+// Per-call entity counts from renderScene (texts, ellipses, polylines).
+struct RenderStats {
+    int drawn{0};     // drawn with full geometry
+    int collapsed{0}; // below View::lodPixels, drawn as a dot
+    int culled{0};    // entirely outside the visible area, skipped
 };
 
 // Real DXF linetype patterns from the importer (dash/gap lengths in drawing
@@ -106,11 +118,13 @@ bool fitToContent(const core::Document& doc, const QSize& viewport, View* out);
 // and __HATCH_FILL__ hairlines) into `pr`. The painter must be passed in its
 // default (identity-transform) state; all transform/clip state is restored
 // before returning. `selection` draws the editor highlight; pass nullptr for
-// headless rendering.
+// headless rendering. Entities whose (pen-padded) bounds miss the painter's
+// viewport, or the clip rect when set, are skipped; `stats` receives counts.
 void renderScene(QPainter& pr, const core::Document* doc,
                  const QVector<PolyVis>& polylines, const View& view,
                  const LinetypeTable& linetypes,
                  const QSet<EntityId>* selection = nullptr,
-                 bool semanticClassMask = false);
+                 bool semanticClassMask = false,
+                 RenderStats* stats = nullptr);
 
 } // namespace scene_render
@@ -0,0 +1,104 @@
+#include "solver/solver_job_queue.hpp"
+#include "command/command_manager.hpp"
+#include "command/commands.hpp"
+
+#include <QMetaObject>
+#include <QThreadPool>
+
+SolverJobQueue::SolverJobQueue(QObject* parent) : QObject(parent) {
+    m_pool = new QThreadPool(this);
+    m_pool->setMaxThreadCount(1);
+}
+
+SolverJobQueue::~SolverJobQueue() {
+    cancel();
+    m_pool->waitForDone();
+}
+
+void SolverJobQueue::setDocument(core::Document* doc) {
+    cancel();
+    m_doc = doc;
+}
+
+void SolverJobQueue::setCommandManager(CommandManager* cmdMgr) {
+    m_cmdMgr = cmdMgr;
+}
+
+void SolverJobQueue::cancel() {
+    if (m_latest.cancel) m_latest.cancel->store(true);
+}
+
+void SolverJobQueue::requestSolve() {
+    m_resolves = 0;
+    startJob();
+}
+
+void SolverJobQueue::startJob() {
+    if (!m_doc) return;
+    cancel();
+
+    Job job;
+    job.generation = ++m_generation;
+    job.cancel = std::make_shared<std::atomic<bool>>(false);
+    m_latest = job;
+    ++m_pending;
+
+    std::shared_ptr<const core::DocumentSnapshot> snapshot = m_doc->snapshot();
+    const core::SolverAlgorithm algorithm = m_algorithm;
+    m_pool->start([this, job, snapshot, algorithm] {
+        const uint64_t generation = job.generation;
+        auto solution = std::make_shared<core::ConstraintSolution>();
+        core::SolveResult result;
+        // Superseded while still queued: nothing to solve.
+        if (!job.cancel->load()) {
+            std::unique_ptr<core::ISolver> solver(core::createSolver(algorithm));
+            solver->setCancellationFlag(job.cancel.get());
+            // Forward whole-percent steps only so large sketches do not flood
+            // the event loop.
+            int lastPercent = -1;
+            solver->setProgressCallback([this, generation, &lastPercent](int done, int count) {
+                const int percent = count > 0 ? done * 100 / count : 100;
+                if (percent == lastPercent) return;
+                lastPercent = percent;
+                QMetaObject::invokeMethod(this, [this, generation, done, count] {
+                    if (generation == m_generation) emit progress(done, count);
+                }, Qt::QueuedConnection);
+            });
+            result = snapshot->solve_constraints(*solver, solution.get());
+        }
+        const bool cancelled = job.cancel->load();
+        QMetaObject::invokeMethod(this, [this, generation, cancelled, result, solution] {
+            finishJob(generation, cancelled, result, solution);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SolverJobQueue::finishJob(uint64_t generation, bool cancelled, const core::SolveResult& result,
+                               std::shared_ptr<core::ConstraintSolution> solution) {
+    --m_pending;
+    if (generation != m_generation) return; // a newer request owns the outcome
+    m_latest = Job{};
+    if (cancelled) {
+        emit solveCancelled();
+        return;
+    }
+    if (!m_doc) return;
+    // Something the solve read changed while it ran (no newer request was
+    // made): solve again rather than apply stale geometry, but only a few
+    // times in a row so that a document that keeps changing cannot keep the
+    // worker busy.
+    if (!m_doc->constraint_solution_current(*solution)) {
+        if (m_resolves < kMaxResolves) {
+            ++m_resolves;
+            startJob();
+            return;
+        }
+        emit solveFinished(false, 0, tr("Constraints changed during solve"));
+        return;
+    }
+    const int moved = static_cast<int>(solution->ids.size());
+    if (moved > 0 && m_cmdMgr) {
+        m_cmdMgr->push(std::make_unique<editor_commands::ApplyConstraintSolutionCommand>(m_doc, std::move(*solution)));
+    }
+    emit solveFinished(result.ok, moved, QString::fromStdString(result.message));
+}
@@ -181,14 +181,14 @@ static void write_entities_section(FILE* f, const cadgf_document* doc) {
     emit(f, 2, "ENTITIES");
 
     int entity_count = 0;
-    cadgf_document_get_entity_count(doc, &entity_count);
-
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
+    std::vector<cadgf_entity_record_v1> records;
+    if (cadgf_document_get_entities_v1(doc, nullptr, 0, &entity_count) && entity_count > 0) {
+        records.resize(static_cast<size_t>(entity_count));
+        if (!cadgf_document_get_entities_v1(doc, records.data(), entity_count, &entity_count)) records.clear();
+    }
 
-        cadgf_entity_info info{};
-        if (!cadgf_document_get_entity_info(doc, eid, &info)) continue;
+    for (const auto& info : records) {
+        const cadgf_entity_id eid = info.id;
 
         std::string layer = resolve_layer_name(doc, info.layer_id);
 
@@ -113,11 +113,8 @@ static int first_mtext_inline_color_aci(const std::string& raw) {
 
 static void write_entity_index_color_metadata(cadgf_document* doc, cadgf_entity_id id, int aci) {
     if (!doc || id == 0 || aci <= 0 || aci > 255) return;
-    const std::string base = "dxf.entity." +
-        std::to_string(static_cast<unsigned long long>(id));
-    const std::string aciValue = std::to_string(aci);
-    (void)cadgf_document_set_meta_value(doc, (base + ".color_source").c_str(), "INDEX");
-    (void)cadgf_document_set_meta_value(doc, (base + ".color_aci").c_str(), aciValue.c_str());
+    (void)cadgf_document_set_entity_attr_string(doc, id, CADGF_ENTITY_ATTR_COLOR_SOURCE, "INDEX");
+    (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_COLOR_ACI, aci);
 }
 
 static void write_entity_double_metadata(cadgf_document* doc,
@@ -461,11 +458,8 @@ void CadgfDrwAdapter::setEntitySourceType(cadgf_entity_id id, const std::string&
     if (id == 0 || originType.empty()) return;
     // Mirror the plugin import path's provenance contract so render_cli's
     // semantic class buffer (scene_renderer::semanticClassName) can classify
-    // expanded primitives by DXF origin. The key format MUST match
-    // scene_renderer::lookup_entity_meta: "dxf.entity." + <id> + ".source_type".
-    const std::string key = "dxf.entity." +
-        std::to_string(static_cast<unsigned long long>(id)) + ".source_type";
-    cadgf_document_set_meta_value(m_doc, key.c_str(), originType.c_str());
+    // expanded primitives by DXF origin (typed source_type attribute).
+    cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_SOURCE_TYPE, originType.c_str());
 }
 
 void CadgfDrwAdapter::writeTextStyleMetadata(cadgf_entity_id id,
@@ -474,24 +468,24 @@ void CadgfDrwAdapter::writeTextStyleMetadata(cadgf_entity_id id,
     if (!m_doc || id == 0) return;
     const std::string base = "dxf.entity." +
         std::to_string(static_cast<unsigned long long>(id));
-    (void)cadgf_document_set_meta_value(m_doc, (base + ".text_style").c_str(), styleName.c_str());
+    (void)cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_TEXT_STYLE, styleName.c_str());
 
     const auto sit = m_textStyles.find(styleName);
     const bool knownStyle = sit != m_textStyles.end();
     (void)cadgf_document_set_meta_value(m_doc, (base + ".text_style_known").c_str(),
                                         knownStyle ? "1" : "0");
     if (knownStyle) {
-        (void)cadgf_document_set_meta_value(m_doc, (base + ".text_font_file").c_str(),
-                                            sit->second.fontFile.c_str());
-        (void)cadgf_document_set_meta_value(m_doc, (base + ".text_bigfont_file").c_str(),
-                                            sit->second.bigFontFile.c_str());
+        (void)cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_TEXT_FONT_FILE,
+                                                    sit->second.fontFile.c_str());
+        (void)cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_TEXT_BIGFONT_FILE,
+                                                    sit->second.bigFontFile.c_str());
         write_entity_double_metadata(m_doc, id, "text_style_width_factor",
                                      sit->second.widthFactor);
         write_entity_double_metadata(m_doc, id, "text_style_char_ratio",
                                      sit->second.charRatio);
     } else {
-        (void)cadgf_document_set_meta_value(m_doc, (base + ".text_font_file").c_str(), "");
-        (void)cadgf_document_set_meta_value(m_doc, (base + ".text_bigfont_file").c_str(), "");
+        (void)cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_TEXT_FONT_FILE, "");
+        (void)cadgf_document_set_entity_attr_string(m_doc, id, CADGF_ENTITY_ATTR_TEXT_BIGFONT_FILE, "");
         write_entity_double_metadata(m_doc, id, "text_style_width_factor", 1.0);
         write_entity_double_metadata(m_doc, id, "text_style_char_ratio", 0.0);
     }
@@ -811,8 +805,10 @@ void CadgfDrwAdapter::addLayer(const DRW_Layer& data) {
         m_layerLineWeight[data.name] = lw;
         // Set directly on document layer struct
         auto* doc = reinterpret_cast<core::Document*>(m_doc);
-        if (auto* layer = doc->get_layer(id))
+        if (auto* layer = doc->get_layer(id)) {
             layer->line_weight = lw;
+            doc->mark_modified();
+        }
     }
 }
 
@@ -14,9 +14,9 @@ void write_entity_string_metadata(cadgf_document* doc,
                                   const char* suffix,
                                   const std::string& value) {
     if (!doc || id == 0 || !suffix || !*suffix || value.empty()) return;
-    const std::string key =
-        "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + "." + suffix;
-    (void)cadgf_document_set_meta_value(doc, key.c_str(), value.c_str());
+    int field = 0;
+    if (!cadgf_document_register_entity_attr_field(doc, suffix, &field)) return;
+    (void)cadgf_document_set_entity_attr_string(doc, id, field, value.c_str());
 }
 
 void write_entity_int_metadata(cadgf_document* doc,
@@ -24,10 +24,9 @@ void write_entity_int_metadata(cadgf_document* doc,
                                const char* suffix,
                                int value) {
     if (!doc || id == 0 || !suffix || !*suffix) return;
-    const std::string key =
-        "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + "." + suffix;
-    const std::string encoded = std::to_string(value);
-    (void)cadgf_document_set_meta_value(doc, key.c_str(), encoded.c_str());
+    int field = 0;
+    if (!cadgf_document_register_entity_attr_field(doc, suffix, &field)) return;
+    (void)cadgf_document_set_entity_attr_int(doc, id, field, value);
 }
 
 void write_entity_vec2_metadata(cadgf_document* doc,
@@ -171,28 +170,21 @@ void write_color_metadata(cadgf_document* doc, cadgf_entity_id id, const DxfColo
     const char* label = color_source_label(meta.source);
     if (!label || !*label) return;
 
-    const std::string base = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id));
-    const std::string source_key = base + ".color_source";
-    (void)cadgf_document_set_meta_value(doc, source_key.c_str(), label);
+    (void)cadgf_document_set_entity_attr_string(doc, id, CADGF_ENTITY_ATTR_COLOR_SOURCE, label);
 
     if (!meta.has_aci) return;
-    const std::string aci_key = base + ".color_aci";
-    const std::string aci_value = std::to_string(meta.aci);
-    (void)cadgf_document_set_meta_value(doc, aci_key.c_str(), aci_value.c_str());
+    (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_COLOR_ACI, meta.aci);
 }
 
 void write_space_metadata(cadgf_document* doc, cadgf_entity_id id, int space) {
     if (!doc || id == 0) return;
     if (space != 0 && space != 1) return;
-    const std::string key = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + ".space";
-    const std::string value = std::to_string(space);
-    (void)cadgf_document_set_meta_value(doc, key.c_str(), value.c_str());
+    (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_SPACE, space);
 }
 
 void write_layout_metadata(cadgf_document* doc, cadgf_entity_id id, const std::string& layout) {
     if (!doc || id == 0 || layout.empty()) return;
-    const std::string key = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + ".layout";
-    (void)cadgf_document_set_meta_value(doc, key.c_str(), layout.c_str());
+    (void)cadgf_document_set_entity_attr_string(doc, id, CADGF_ENTITY_ATTR_LAYOUT, layout.c_str());
 }
 
 void write_entity_origin_metadata(cadgf_document* doc,
@@ -246,8 +238,7 @@ void write_text_metadata(cadgf_document* doc, cadgf_entity_id id, const DxfText&
     if (!doc || id == 0) return;
     const std::string base = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id));
     if (!text.kind.empty()) {
-        const std::string key = base + ".text_kind";
-        (void)cadgf_document_set_meta_value(doc, key.c_str(), text.kind.c_str());
+        (void)cadgf_document_set_entity_attr_string(doc, id, CADGF_ENTITY_ATTR_TEXT_KIND, text.kind.c_str());
     }
     if (text.has_width) {
         const std::string key = base + ".text_width";
@@ -262,23 +253,17 @@ void write_text_metadata(cadgf_document* doc, cadgf_entity_id id, const DxfText&
         (void)cadgf_document_set_meta_value(doc, key.c_str(), buf);
     }
     if (text.has_attachment) {
-        const std::string key = base + ".text_attachment";
-        const std::string value = std::to_string(text.attachment);
-        (void)cadgf_document_set_meta_value(doc, key.c_str(), value.c_str());
+        (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_TEXT_ATTACHMENT, text.attachment);
     }
     if (text.has_halign) {
-        const std::string key = base + ".text_halign";
-        const std::string value = std::to_string(text.halign);
-        (void)cadgf_document_set_meta_value(doc, key.c_str(), value.c_str());
+        (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_TEXT_HALIGN, text.halign);
     }
     if (text.has_valign) {
-        const std::string key = base + ".text_valign";
-        const std::string value = std::to_string(text.valign);
-        (void)cadgf_document_set_meta_value(doc, key.c_str(), value.c_str());
+        (void)cadgf_document_set_entity_attr_int(doc, id, CADGF_ENTITY_ATTR_TEXT_VALIGN, text.valign);
     }
     if (text.has_attribute_tag) {
-        const std::string key = base + ".attribute_tag";
-        (void)cadgf_document_set_meta_value(doc, key.c_str(), text.attribute_tag.c_str());
+        (void)cadgf_document_set_entity_attr_string(doc, id, CADGF_ENTITY_ATTR_ATTRIBUTE_TAG,
+                                                    text.attribute_tag.c_str());
     }
     if (text.has_attribute_default) {
         const std::string key = base + ".attribute_default";
@@ -9,6 +9,7 @@
 #include <cstdio>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace {
 
@@ -133,6 +134,14 @@ bool commit_dxf_top_level_entities(
         return text_height;
     };
 
+    // Polylines go in with one bulk call; metadata is applied afterwards in the
+    // same order, so ids, layer ids and group ids match per-entity insertion.
+    std::vector<const DxfPolyline*> committed_polylines;
+    std::vector<cadgf_vec2> polyline_points;
+    std::vector<int> polyline_counts;
+    std::vector<int> polyline_layers;
+    std::vector<const char*> polyline_names;
+    committed_polylines.reserve(polylines.size());
     for (const auto& pl : polylines) {
         if (!include_space(pl.space)) continue;
         int layer_id = 0;
@@ -140,9 +149,22 @@ bool commit_dxf_top_level_entities(
             return false;
         }
         if (pl.points.size() < 2) continue;
-        cadgf_entity_id id = cadgf_document_add_polyline_ex(doc, pl.points.data(),
-                                                            static_cast<int>(pl.points.size()),
-                                                            pl.name.empty() ? "" : pl.name.c_str(), layer_id);
+        committed_polylines.push_back(&pl);
+        polyline_points.insert(polyline_points.end(), pl.points.begin(), pl.points.end());
+        polyline_counts.push_back(static_cast<int>(pl.points.size()));
+        polyline_layers.push_back(layer_id);
+        polyline_names.push_back(pl.name.c_str());
+    }
+    cadgf_entity_id first_polyline_id = 0;
+    if (!committed_polylines.empty() &&
+        !cadgf_document_add_polylines_v1(doc, polyline_points.data(), polyline_counts.data(),
+                                         static_cast<int>(polyline_counts.size()), polyline_layers.data(),
+                                         polyline_names.data(), &first_polyline_id)) {
+        return false;
+    }
+    for (size_t i = 0; i < committed_polylines.size(); ++i) {
+        const DxfPolyline& pl = *committed_polylines[i];
+        const cadgf_entity_id id = first_polyline_id + static_cast<cadgf_entity_id>(i);
         apply_group(id, resolve_local_group_id(doc, top_level_local_groups, pl.local_group_tag, -1));
         write_space_metadata(doc, id, pl.space);
         maybe_write_layout_metadata(id, pl.space, pl.layout_name);
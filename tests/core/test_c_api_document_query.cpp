@@ -390,6 +390,176 @@ int main() {
     assert(ok == CADGF_SUCCESS);
     assert(spline_out[1].x == 1.0 && spline_out[1].y == 1.0);
 
+    // Bulk snapshot matches per-id enumeration.
+    int entity_total = 0;
+    ok = cadgf_document_get_entity_count(doc, &entity_total);
+    assert(ok == CADGF_SUCCESS);
+    int records_required = 0;
+    ok = cadgf_document_get_entities_v1(doc, nullptr, 0, &records_required);
+    assert(ok == CADGF_SUCCESS);
+    assert(records_required == entity_total);
+    std::vector<cadgf_entity_record_v1> records(static_cast<size_t>(records_required));
+    ok = cadgf_document_get_entities_v1(doc, records.data(), records_required - 1, &records_required);
+    assert(ok == CADGF_FAILURE);
+    ok = cadgf_document_get_entities_v1(doc, records.data(), records_required, &records_required);
+    assert(ok == CADGF_SUCCESS);
+    for (int i = 0; i < entity_total; ++i) {
+        cadgf_entity_id eid = 0;
+        ok = cadgf_document_get_entity_id_at(doc, i, &eid);
+        assert(ok == CADGF_SUCCESS);
+        cadgf_entity_info_v2 info{};
+        ok = cadgf_document_get_entity_info_v2(doc, eid, &info);
+        assert(ok == CADGF_SUCCESS);
+        const auto& rec = records[static_cast<size_t>(i)];
+        assert(rec.id == eid);
+        assert(rec.type == info.type);
+        assert(rec.layer_id == info.layer_id);
+        assert(rec.color == info.color);
+        assert(rec.group_id == info.group_id);
+        assert(((rec.flags & CADGF_ENTITY_FLAG_VISIBLE) != 0) == (info.visible != 0));
+        assert(rec.space == -1);
+    }
+    assert(records.back().id == sid);
+    assert(records.back().point_count == 3);
+
+    // Cursor enumeration with filters, in small chunks.
+    ok = cadgf_document_set_meta_value(doc, ("dxf.entity." + std::to_string(sid) + ".space").c_str(), "1");
+    assert(ok == CADGF_SUCCESS);
+    cadgf_entity_filter_v1 filter{};
+    filter.fields = CADGF_ENTITY_FILTER_LAYER;
+    filter.layer_id = layer_id;
+    int expected_on_layer = 0;
+    for (const auto& rec : records) {
+        if (rec.layer_id == layer_id) ++expected_on_layer;
+    }
+    int cursor = 0;
+    int seen = 0;
+    cadgf_entity_record_v1 chunk[2];
+    for (;;) {
+        int n = 0;
+        ok = cadgf_document_query_entities_v1(doc, &filter, &cursor, chunk, 2, &n);
+        assert(ok == CADGF_SUCCESS);
+        if (n == 0) break;
+        for (int i = 0; i < n; ++i) assert(chunk[i].layer_id == layer_id);
+        seen += n;
+    }
+    assert(seen == expected_on_layer);
+    assert(cursor == entity_total);
+
+    filter.fields = CADGF_ENTITY_FILTER_SPACE | CADGF_ENTITY_FILTER_TYPE;
+    filter.space = 1;
+    filter.type = CADGF_ENTITY_TYPE_SPLINE;
+    cursor = 0;
+    int n = 0;
+    ok = cadgf_document_query_entities_v1(doc, &filter, &cursor, chunk, 2, &n);
+    assert(ok == CADGF_SUCCESS);
+    assert(n == 1);
+    assert(chunk[0].id == sid && chunk[0].space == 1);
+
+    // Typed entity attributes: the string key above landed in the typed table.
+    ok = cadgf_document_set_entity_attr_int(doc, sid, CADGF_ENTITY_ATTR_COLOR_ACI, 3);
+    assert(ok == CADGF_SUCCESS);
+    ok = cadgf_document_set_entity_attr_string(doc, sid, CADGF_ENTITY_ATTR_SOURCE_TYPE, "INSERT");
+    assert(ok == CADGF_SUCCESS);
+    int aci = 0;
+    assert(cadgf_document_get_entity_color_aci(doc, sid, &aci) == CADGF_SUCCESS && aci == 3);
+    const std::string aci_key = "dxf.entity." + std::to_string(sid) + ".color_aci";
+    char attr_buf[32]{};
+    int attr_required = 0;
+    ok = cadgf_document_get_meta_value(doc, aci_key.c_str(), attr_buf, sizeof(attr_buf), &attr_required);
+    assert(ok == CADGF_SUCCESS && std::string(attr_buf) == "3");
+
+    const cadgf_entity_id attr_ids[2] = {sid, sid + 1000};
+    long long spaces[2]{};
+    unsigned char present[2]{};
+    ok = cadgf_document_get_entity_attr_ints_v1(doc, CADGF_ENTITY_ATTR_SPACE, attr_ids, 2, spaces, present);
+    assert(ok == CADGF_SUCCESS);
+    assert(present[0] == 1 && spaces[0] == 1 && present[1] == 0);
+    int string_ids[2]{};
+    ok = cadgf_document_get_entity_attr_string_ids_v1(doc, CADGF_ENTITY_ATTR_SOURCE_TYPE, attr_ids, 2, string_ids);
+    assert(ok == CADGF_SUCCESS);
+    assert(string_ids[0] >= 0 && string_ids[1] == -1);
+    ok = cadgf_document_get_attr_string(doc, string_ids[0], attr_buf, sizeof(attr_buf), &attr_required);
+    assert(ok == CADGF_SUCCESS && std::string(attr_buf) == "INSERT");
+    int field = -1;
+    assert(cadgf_document_get_entity_attr_field(doc, "source_type", &field) == CADGF_SUCCESS);
+    assert(field == CADGF_ENTITY_ATTR_SOURCE_TYPE);
+    assert(cadgf_document_get_entity_attr_field(doc, "no_such_field", &field) == CADGF_FAILURE);
+
     cadgf_document_destroy(doc);
+
+    // Bulk polyline insert with flattened arrays.
+    {
+        cadgf_document* cdoc = cadgf_document_create();
+        assert(cdoc);
+        int layer = -1;
+        assert(cadgf_document_add_layer(cdoc, "L1", 0xFFFFFFu, &layer) == CADGF_SUCCESS);
+        const cadgf_vec2 pts[] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}, {2, 2}};
+        const int counts[] = {2, 3};
+        const int layers[] = {0, layer};
+        const char* names[] = {"a", nullptr};
+        cadgf_entity_id first_id = 0;
+        assert(cadgf_document_add_polylines_v1(cdoc, pts, counts, 2, layers, names, &first_id) == CADGF_SUCCESS);
+        assert(first_id > 0);
+        cadgf_entity_info info{};
+        assert(cadgf_document_get_entity_info(cdoc, first_id + 1, &info) == CADGF_SUCCESS);
+        assert(info.layer_id == layer && info.type == CADGF_ENTITY_TYPE_POLYLINE);
+        int n = 0;
+        assert(cadgf_document_get_polyline_points(cdoc, first_id + 1, nullptr, 0, &n) == CADGF_SUCCESS && n == 3);
+
+        // Invalid counts reject the whole call.
+        const int bad_counts[] = {2, 1};
+        int entity_count = 0;
+        assert(cadgf_document_get_entity_count(cdoc, &entity_count) == CADGF_SUCCESS && entity_count == 2);
+        assert(cadgf_document_add_polylines_v1(cdoc, pts, bad_counts, 2, nullptr, nullptr, &first_id) == CADGF_FAILURE);
+        assert(cadgf_document_get_entity_count(cdoc, &entity_count) == CADGF_SUCCESS && entity_count == 2);
+        cadgf_document_destroy(cdoc);
+    }
+
+    // Spatial queries over entity boxes.
+    {
+        cadgf_document* sdoc = cadgf_document_create();
+        assert(sdoc);
+        cadgf_entity_id ids[3] = {};
+        for (int i = 0; i < 3; ++i) {
+            const cadgf_vec2 seg[] = {{10.0 * i, 0}, {10.0 * i + 1, 1}};
+            ids[i] = cadgf_document_add_polyline(sdoc, seg, 2);
+            assert(ids[i] != 0);
+        }
+        int required = 0;
+        assert(cadgf_document_query_rect_v1(sdoc, 5, -1, 25, 2, nullptr, 0, &required) == CADGF_SUCCESS);
+        assert(required == 2);
+        cadgf_entity_id hits[4] = {};
+        assert(cadgf_document_query_rect_v1(sdoc, 25, 2, 5, -1, hits, 1, &required) == CADGF_FAILURE);
+        assert(cadgf_document_query_rect_v1(sdoc, 25, 2, 5, -1, hits, 4, &required) == CADGF_SUCCESS);
+        assert(hits[0] == ids[1] && hits[1] == ids[2]);
+
+        double dist[4] = {};
+        int count = 0;
+        assert(cadgf_document_query_nearest_v1(sdoc, 12, 3, 2, hits, dist, &count) == CADGF_SUCCESS);
+        assert(count == 2 && hits[0] == ids[1] && dist[0] > 0.0 && dist[0] <= dist[1]);
+
+        assert(cadgf_document_query_segment_v1(sdoc, 30, 0.5, -5, 0.5, hits, 4, &required) == CADGF_SUCCESS);
+        assert(required == 3 && hits[0] == ids[2] && hits[2] == ids[0]);
+
+        // Edits are reflected in later queries.
+        assert(cadgf_document_remove_entity(sdoc, ids[1]) == CADGF_SUCCESS);
+        assert(cadgf_document_query_rect_v1(sdoc, 5, -1, 25, 2, hits, 4, &required) == CADGF_SUCCESS);
+        assert(required == 1 && hits[0] == ids[2]);
+
+        // The removed entity's storage slot is not enumerated.
+        int entity_count = 0;
+        assert(cadgf_document_get_entity_count(sdoc, &entity_count) == CADGF_SUCCESS && entity_count == 2);
+        cadgf_entity_id at = 0;
+        assert(cadgf_document_get_entity_id_at(sdoc, 1, &at) == CADGF_SUCCESS && at == ids[2]);
+        assert(cadgf_document_get_entity_id_at(sdoc, 2, &at) == CADGF_FAILURE);
+        cadgf_entity_record_v1 records[3] = {};
+        assert(cadgf_document_get_entities_v1(sdoc, records, 3, &required) == CADGF_SUCCESS && required == 2);
+        assert(records[0].id == ids[0] && records[1].id == ids[2]);
+        int cursor = 0;
+        assert(cadgf_document_query_entities_v1(sdoc, nullptr, &cursor, records, 3, &count) == CADGF_SUCCESS);
+        assert(count == 2 && records[0].id == ids[0] && records[1].id == ids[2]);
+        cadgf_document_destroy(sdoc);
+    }
     return 0;
 }
@@ -0,0 +1,62 @@
+#include "core/document.hpp"
+#include "core/geometry2d.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace {
+
+struct BatchObserver : core::DocumentObserver {
+    int events{0};
+    std::vector<core::DocumentChangeSet> batches;
+
+    void on_document_changed(const core::Document&, const core::DocumentChangeEvent&) override { ++events; }
+    void on_document_batch_changed(const core::Document&, const core::DocumentChangeSet& changes) override {
+        batches.push_back(changes);
+    }
+};
+
+} // namespace
+
+int main() {
+    core::Document doc;
+    const core::EntityId existing = doc.add_point({0, 0});
+    BatchObserver observer;
+    doc.add_observer(&observer);
+
+    std::vector<core::Entity> batch;
+    for (int i = 0; i < 1000; ++i) {
+        core::Entity e;
+        core::Polyline pl;
+        pl.points = {{double(i), 0}, {double(i), 1}};
+        e.payload = std::move(pl);
+        e.layerId = 0;
+        batch.push_back(std::move(e));
+    }
+    core::Entity circle;
+    circle.type = core::EntityType::Polyline; // overridden by the payload
+    circle.payload = core::Circle{{5, 5}, 2.0};
+    circle.name = "c";
+    batch.push_back(std::move(circle));
+
+    const core::EntityId first = doc.add_entities(std::move(batch));
+    assert(first == existing + 1);
+    assert(batch.empty());
+    assert(doc.entities().size() == 1002);
+
+    // One batched notification listing every new id in order.
+    assert(observer.events == 0);
+    assert(observer.batches.size() == 1);
+    assert(observer.batches[0].added.size() == 1001);
+    assert(observer.batches[0].added.front() == first);
+    assert(observer.batches[0].added.back() == first + 1000);
+
+    const auto* pl = std::get_if<core::Polyline>(&doc.get_entity(first + 7)->payload);
+    assert(pl && pl->points[0].x == 7.0);
+    const auto* c = doc.get_entity(first + 1000);
+    assert(c && c->type == core::EntityType::Circle && c->name == "c");
+    assert(doc.add_entities({}) == 0);
+    doc.remove_observer(&observer);
+
+    return 0;
+}
@@ -16,6 +16,19 @@ struct TestObserver : core::DocumentObserver {
     void clear() { events.clear(); }
 };
 
+// Opts in to the batch change set instead of the Reset fallback.
+struct BatchObserver : core::DocumentObserver {
+    std::vector<core::DocumentChangeEvent> events;
+    std::vector<core::DocumentChangeSet> batches;
+
+    void on_document_changed(const core::Document&, const core::DocumentChangeEvent& event) override {
+        events.push_back(event);
+    }
+    void on_document_batch_changed(const core::Document&, const core::DocumentChangeSet& changes) override {
+        batches.push_back(changes);
+    }
+};
+
 } // namespace
 
 int main() {
@@ -54,6 +67,59 @@ int main() {
     doc.end_change_batch();
     assert(observer.events.size() == 1);
     assert(observer.events[0].type == core::DocumentChangeType::Reset);
+    doc.remove_observer(&observer);
+
+    BatchObserver batch;
+    doc.add_observer(&batch);
+    core::EntityId kept = doc.add_polyline(pl, "kept", layer_id);
+    core::EntityId doomed = doc.add_polyline(pl, "doomed");
+    batch.events.clear();
+
+    doc.begin_change_batch();
+    core::EntityId fresh = doc.add_polyline(pl, "fresh");
+    doc.set_entity_color(fresh, 0xFF0000u);          // folded into "added"
+    core::EntityId transient = doc.add_polyline(pl); // added and removed: dropped
+    assert(doc.remove_entity(transient));
+    assert(doc.remove_entity(doomed));
+    core::Polyline moved = pl;
+    moved.points[0] = {5, 5};
+    assert(doc.set_polyline_points(kept, moved));
+    assert(doc.set_entity_visible(kept, false));
+    assert(doc.set_entity_visible(eid, true));
+    doc.set_layer_color(layer_id, 0x00FF00u);
+    doc.set_layer_color(layer_id, 0x0000FFu);
+    doc.set_label("batched");
+    doc.end_change_batch();
+
+    assert(batch.events.empty());
+    assert(batch.batches.size() == 1);
+    const auto& changes = batch.batches[0];
+    assert(!changes.fullReload);
+    assert(changes.added == std::vector<core::EntityId>{fresh});
+    assert(changes.removed == std::vector<core::EntityId>{doomed});
+    assert(changes.geometryChanged == std::vector<core::EntityId>{kept});
+    assert((changes.metaChanged == std::vector<core::EntityId>{kept, eid}));
+    assert(changes.layersChanged == std::vector<int>{layer_id});
+    assert(changes.documentMetaChanged);
+    assert(!changes.settingsChanged);
+
+    // A clear inside the batch supersedes earlier changes and asks for a rebuild.
+    batch.batches.clear();
+    doc.begin_change_batch();
+    doc.set_entity_visible(kept, true);
+    doc.clear();
+    core::EntityId after = doc.add_polyline(pl);
+    doc.end_change_batch();
+    assert(batch.batches.size() == 1);
+    assert(batch.batches[0].fullReload);
+    assert(batch.batches[0].added == std::vector<core::EntityId>{after});
+    assert(batch.batches[0].metaChanged.empty());
+
+    // Unbatched changes keep using per-event notifications.
+    batch.batches.clear();
+    doc.add_polyline(pl);
+    assert(batch.batches.empty());
+    assert(!batch.events.empty());
 
     return 0;
 }
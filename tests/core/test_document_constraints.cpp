@@ -0,0 +1,198 @@
+#include "core/document.hpp"
+#include "core/solver.hpp"
+
+#include <cassert>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BatchObserver : core::DocumentObserver {
+    std::vector<core::DocumentChangeEvent> events;
+    std::vector<core::DocumentChangeSet> batches;
+
+    void on_document_changed(const core::Document&, const core::DocumentChangeEvent& event) override {
+        events.push_back(event);
+    }
+    void on_document_batch_changed(const core::Document&, const core::DocumentChangeSet& changes) override {
+        batches.push_back(changes);
+    }
+    void clear() {
+        events.clear();
+        batches.clear();
+    }
+};
+
+core::ConstraintParam param(core::EntityId id, core::PointRole role, core::ParamField field, int index = -1) {
+    core::ConstraintParam p;
+    p.ref.id = id;
+    p.ref.role = role;
+    p.ref.index = index;
+    p.field = field;
+    return p;
+}
+
+core::ConstraintParam px(core::EntityId id, core::PointRole role) { return param(id, role, core::ParamField::X); }
+core::ConstraintParam py(core::EntityId id, core::PointRole role) { return param(id, role, core::ParamField::Y); }
+
+std::unique_ptr<core::ISolver> make_solver() {
+    std::unique_ptr<core::ISolver> solver(core::createSolver(core::SolverAlgorithm::LM));
+    solver->setTolerance(1e-10);
+    return solver;
+}
+
+} // namespace
+
+int main() {
+    using core::PointRole;
+    using core::ParamField;
+
+    // Keys name the point role and axis, or the shape field.
+    assert(core::constraint_param_key(px(1, PointRole::Start)) == "start_x");
+    assert(core::constraint_param_key(py(1, PointRole::None)) == "y");
+    assert(core::constraint_param_key(param(1, PointRole::ControlPoint, ParamField::Y, 2)) == "cp2_y");
+    assert(core::constraint_param_key(param(1, PointRole::Center, ParamField::Radius)) == "radius");
+
+    core::Document doc;
+    const core::EntityId line = doc.add_line(core::Line{{0.0, 0.0}, {4.5, 0.7}}, "L");
+    const core::EntityId circle = doc.add_circle(core::Circle{{10.0, 0.0}, 2.0}, "C");
+    const core::EntityId point = doc.add_point({13.0, 1.0}, "P");
+    const core::EntityId bystander = doc.add_point({-5.0, -5.0}, "Q");
+
+    // Fields resolve straight into the payloads.
+    const core::Entity* line_entity = doc.get_entity(line);
+    assert(core::constraint_param_field(*line_entity, py(line, PointRole::End)) == &doc.get_line(line)->b.y);
+    assert(!core::constraint_param_field(*line_entity, px(line, PointRole::Mid)));
+    assert(!core::constraint_param_field(*line_entity, param(line, PointRole::None, ParamField::Radius)));
+
+    // Line L: start pinned at the origin, horizontal, 5 long. Circle C pinned;
+    // P on it.
+    doc.add_constraint("fixed_point", {px(line, PointRole::Start), py(line, PointRole::Start)}, 0.0);
+    doc.add_constraint("fixed_point", {py(line, PointRole::Start), px(line, PointRole::Start)}, 0.0);
+    doc.add_constraint("horizontal", {py(line, PointRole::Start), py(line, PointRole::End)});
+    doc.add_constraint("distance", {px(line, PointRole::Start), py(line, PointRole::Start),
+                                    px(line, PointRole::End), py(line, PointRole::End)}, 5.0);
+    doc.add_constraint("fixed_point", {px(circle, PointRole::Center), py(circle, PointRole::Center)}, 10.0);
+    doc.add_constraint("fixed_point", {py(circle, PointRole::Center), px(circle, PointRole::Center)}, 0.0);
+    doc.add_constraint("fixed_point", {param(circle, PointRole::None, ParamField::Radius),
+                                       px(circle, PointRole::Center)}, 2.0);
+    const core::ConstraintId on_circle = doc.add_constraint(
+        "point_on_circle", {px(point, PointRole::None), py(point, PointRole::None),
+                            px(circle, PointRole::Center), py(circle, PointRole::Center),
+                            param(circle, PointRole::None, ParamField::Radius)});
+    assert(doc.constraints().size() == 8);
+    assert(doc.get_constraint(on_circle) && doc.get_constraint(on_circle)->type == "point_on_circle");
+
+    BatchObserver observer;
+    doc.add_observer(&observer);
+
+    // One undoable batch naming only the entities that moved.
+    doc.begin_transaction("solve");
+    const core::SolveResult solved = doc.solve_constraints(*make_solver());
+    doc.commit_transaction();
+    assert(solved.ok);
+    assert(observer.events.empty());
+    assert(observer.batches.size() == 1);
+    assert((observer.batches[0].geometryChanged == std::vector<core::EntityId>{line, point}));
+    const core::Line* l = doc.get_line(line);
+    assert(l->a.x == 0.0 && l->a.y == 0.0);
+    assert(std::abs(l->b.y) < 1e-9 && std::abs(l->b.x - 5.0) < 1e-9);
+    const core::Point* p = doc.get_point(point);
+    assert(std::abs(std::hypot(p->p.x - 10.0, p->p.y) - 2.0) < 1e-9);
+    assert(doc.get_circle(circle)->radius == 2.0);
+    assert(doc.get_point(bystander)->p.x == -5.0);
+
+    // Solving again moves nothing and reports nothing.
+    observer.clear();
+    const uint64_t revision = doc.revision();
+    const core::SolveResult again = doc.solve_constraints(*make_solver());
+    assert(again.ok && again.iterations == 0);
+    assert(observer.batches.empty() && observer.events.empty());
+    assert(doc.revision() == revision);
+
+    // Undo restores the pre-solve payloads.
+    assert(doc.undo());
+    assert(doc.get_line(line)->b.x == 4.5 && doc.get_line(line)->b.y == 0.7);
+    assert(doc.get_point(point)->p.x == 13.0);
+    assert(doc.redo());
+    assert(std::abs(doc.get_line(line)->b.x - 5.0) < 1e-9);
+
+    // Params on missing points are unbound variables, named by entity id and key.
+    const core::ConstraintId mid = doc.add_constraint(
+        "horizontal", {py(line, PointRole::Mid), py(point, PointRole::None)});
+    observer.clear();
+    const core::SolveResult unbound = doc.solve_constraints(*make_solver());
+    assert(!unbound.ok && !unbound.diagnostics.empty());
+    assert(unbound.diagnostics[0].code == core::ConstraintDiagnosticCode::UnboundVariable);
+    assert(unbound.diagnostics[0].constraintIndex == 8);
+    assert(unbound.diagnostics[0].detail.find(std::to_string(line) + ".mid_y") != std::string::npos);
+    assert(observer.batches.empty());
+    assert(doc.remove_constraint(mid) && !doc.remove_constraint(mid));
+    assert(doc.constraints().size() == 8);
+
+    // Snapshots carry the table and solve on another thread without touching
+    // the document; the solution lands later as one batch.
+    assert(doc.undo());
+    std::shared_ptr<const core::DocumentSnapshot> snapshot = doc.snapshot();
+    assert(snapshot->constraints().size() == 8);
+    core::ConstraintSolution solution;
+    core::SolveResult background;
+    int progress_calls = 0, last_done = -1, last_count = -1;
+    std::thread worker([&] {
+        std::unique_ptr<core::ISolver> solver = make_solver();
+        solver->setProgressCallback([&](int done, int count) {
+            ++progress_calls;
+            last_done = done;
+            last_count = count;
+        });
+        background = snapshot->solve_constraints(*solver, &solution);
+    });
+    worker.join();
+    assert(background.ok);
+    assert(progress_calls > 0 && last_count > 0 && last_done == last_count);
+    assert(solution.revision == snapshot->revision());
+    assert((solution.ids == std::vector<core::EntityId>{line, point}));
+    assert(doc.get_line(line)->b.x == 4.5 && doc.get_point(point)->p.x == 13.0);
+    assert(std::get<core::Line>(snapshot->get_entity(line)->payload).b.x == 4.5);
+
+    // The solution stays current through edits to entities it did not read,
+    // and through a read entity moved away and back; a table change ends it.
+    assert(doc.constraint_solution_current(solution));
+    assert(doc.set_point(bystander, {50.0, 50.0}));
+    assert(doc.revision() != solution.revision && doc.constraint_solution_current(solution));
+    const core::Vec2 at = doc.get_point(point)->p;
+    assert(doc.set_point(point, {at.x + 1.0, at.y}) && !doc.constraint_solution_current(solution));
+    assert(doc.set_point(point, at) && doc.constraint_solution_current(solution));
+    const core::ConstraintId extra = doc.add_constraint("horizontal", {py(bystander, PointRole::None)});
+    assert(doc.remove_constraint(extra) && !doc.constraint_solution_current(solution));
+
+    observer.clear();
+    doc.begin_transaction("apply solve");
+    assert(doc.apply_constraint_solution(solution) == 2);
+    doc.commit_transaction();
+    assert(observer.batches.size() == 1 && observer.events.empty());
+    assert((observer.batches[0].geometryChanged == std::vector<core::EntityId>{line, point}));
+    assert(std::abs(doc.get_line(line)->b.x - 5.0) < 1e-9);
+    assert(doc.undo() && doc.get_line(line)->b.x == 4.5);
+
+    // A raised cancellation flag stops the solve before it iterates.
+    std::atomic<bool> cancel{true};
+    std::unique_ptr<core::ISolver> cancelled_solver = make_solver();
+    cancelled_solver->setCancellationFlag(&cancel);
+    core::ConstraintSolution cancelled_solution;
+    const core::SolveResult cancelled = doc.snapshot()->solve_constraints(*cancelled_solver, &cancelled_solution);
+    assert(!cancelled.ok && cancelled.message == "Cancelled");
+
+    // Entities removed since the snapshot are skipped.
+    assert(doc.remove_entity(point));
+    assert(doc.apply_constraint_solution(solution) == 1);
+
+    doc.remove_observer(&observer);
+    doc.clear();
+    assert(doc.constraints().empty());
+    return 0;
+}
@@ -78,7 +78,7 @@ int main() {
 
     auto id3 = doc.add_polyline(pl, "third");
     assert(id3 == id2 + 1);
-    assert(doc.entities().size() == 2);
+    assert(doc.entity_count() == 2);
     const auto* e2_again = doc.get_entity(id2);
     assert(e2_again);
     assert(e2_again->name == "second");
@@ -0,0 +1,93 @@
+#include "core/document.hpp"
+
+#include <cassert>
+#include <string>
+
+namespace {
+
+struct CountingObserver : core::DocumentObserver {
+    int meta_changes{0};
+    void on_document_changed(const core::Document&, const core::DocumentChangeEvent& event) override {
+        if (event.type == core::DocumentChangeType::DocumentMetaChanged) ++meta_changes;
+    }
+};
+
+std::string meta(const core::Document& doc, const std::string& key) {
+    std::string value;
+    return doc.get_meta_value(key, &value) ? value : std::string("<missing>");
+}
+
+} // namespace
+
+int main() {
+    core::Document doc;
+    CountingObserver observer;
+    doc.add_observer(&observer);
+
+    core::Line line;
+    line.a = {0, 0};
+    line.b = {1, 0};
+    const core::EntityId a = doc.add_line(line);
+    const core::EntityId b = doc.add_line(line);
+
+    // Legacy string keys are routed into the typed table.
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(a) + ".color_source", "INDEX"));
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(a) + ".color_aci", "7"));
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(a) + ".text_width", "2.500000"));
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(a) + ".custom_note", "hello"));
+    assert(doc.metadata().meta.empty());
+
+    const auto* aci = doc.get_entity_attr(a, core::EntityAttrField::ColorAci);
+    assert(aci && aci->kind == core::EntityAttrValue::Kind::Int && aci->i == 7);
+    const auto* source = doc.get_entity_attr(a, core::EntityAttrField::ColorSource);
+    assert(source && source->kind == core::EntityAttrValue::Kind::String);
+    assert(doc.attr_string(source->str) == "INDEX");
+    core::EntityAttrField width{};
+    assert(doc.find_entity_attr_field("text_width", &width));
+    assert(static_cast<size_t>(width) >= static_cast<size_t>(core::EntityAttrField::Count));
+    assert(doc.get_entity_attr(a, width)->kind == core::EntityAttrValue::Kind::Double);
+
+    // Values that would not round-trip stay strings and read back verbatim.
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(b) + ".color_aci", "007"));
+    assert(doc.get_entity_attr(b, core::EntityAttrField::ColorAci)->kind == core::EntityAttrValue::Kind::String);
+    assert(meta(doc, "dxf.entity." + std::to_string(b) + ".color_aci") == "007");
+    assert(doc.set_meta_value("dxf.entity." + std::to_string(b) + ".block_name", "42"));
+    assert(doc.entity_attr_text(b, core::EntityAttrField::BlockName) == "42");
+
+    // Typed setters are visible through the string view; unchanged writes do not notify.
+    assert(doc.set_entity_attr_int(b, core::EntityAttrField::Space, 1));
+    const int before = observer.meta_changes;
+    assert(doc.set_entity_attr_int(b, core::EntityAttrField::Space, 1));
+    assert(observer.meta_changes == before);
+    assert(meta(doc, "dxf.entity." + std::to_string(b) + ".space") == "1");
+    assert(meta(doc, "dxf.entity." + std::to_string(a) + ".text_width") == "2.500000");
+    assert(meta(doc, "dxf.entity." + std::to_string(a) + ".missing") == "<missing>");
+
+    // Interned strings are shared.
+    assert(doc.set_entity_attr_string(b, core::EntityAttrField::ColorSource, "INDEX"));
+    assert(doc.get_entity_attr(b, core::EntityAttrField::ColorSource)->str == source->str);
+
+    // Non-entity keys and non-canonical ids stay in the string map.
+    assert(doc.set_meta_value("dxf.layer.0.name", "0"));
+    assert(doc.set_meta_value("dxf.entity.01.space", "1"));
+    assert(doc.metadata().meta.size() == 2);
+
+    // The merged view is sorted by key, like the original std::map.
+    const auto& entries = doc.meta_entries();
+    assert(entries.size() == 10);
+    for (size_t i = 1; i < entries.size(); ++i) {
+        assert(entries[i - 1].first < entries[i].first);
+    }
+    assert(meta(doc, "dxf.entity.01.space") == "1");
+
+    assert(doc.remove_meta_value("dxf.entity." + std::to_string(a) + ".color_aci"));
+    assert(!doc.get_entity_attr(a, core::EntityAttrField::ColorAci));
+    assert(doc.meta_entries().size() == 9);
+
+    doc.clear();
+    assert(doc.meta_entries().empty());
+    assert(!doc.get_entity_attr(a, core::EntityAttrField::ColorSource));
+    assert(!doc.find_entity_attr_field("text_width", nullptr));
+    doc.remove_observer(&observer);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "core/document.hpp"
+#include "core/geometry2d.hpp"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+int main() {
+    core::Document doc;
+    core::Polyline pl;
+    pl.points = {{0, 0}, {1, 0}, {1, 1}, {0, 0}};
+
+    std::vector<core::EntityId> ids;
+    for (int i = 0; i < 1000; ++i) {
+        ids.push_back(doc.add_polyline(pl, "p" + std::to_string(i)));
+    }
+    assert(doc.entities().size() == 1000);
+
+    // Lookups resolve through the id index.
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto* e = doc.get_entity(ids[i]);
+        assert(e);
+        assert(e->id == ids[i]);
+        assert(e->name == "p" + std::to_string(i));
+    }
+    assert(doc.get_entity(0) == nullptr);
+    assert(doc.get_entity(ids.back() + 1) == nullptr);
+
+    // Remove every third entity; remaining order must be preserved.
+    for (size_t i = 0; i < ids.size(); i += 3) {
+        assert(doc.remove_entity(ids[i]));
+        assert(!doc.remove_entity(ids[i]));
+        assert(doc.get_entity(ids[i]) == nullptr);
+    }
+    // Lookups still work with tombstones pending.
+    assert(doc.get_entity(ids[1]) && doc.get_entity(ids[1])->id == ids[1]);
+    assert(doc.set_entity_color(ids[2], 0x00FF00u));
+
+    // Removal leaves tombstones in place instead of shifting storage; the
+    // live entities keep their order.
+    std::vector<core::EntityId> expected;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (i % 3 != 0) expected.push_back(ids[i]);
+    }
+    auto live_ids = [&doc] {
+        std::vector<core::EntityId> out;
+        for (const auto& e : doc.entities()) {
+            if (e.id != 0) out.push_back(e.id);
+        }
+        return out;
+    };
+    assert(doc.entities().size() == ids.size());
+    assert(doc.entity_count() == expected.size());
+    assert(live_ids() == expected);
+
+    // Index stays valid with tombstones present.
+    for (core::EntityId id : expected) {
+        const auto* e = doc.get_entity(id);
+        assert(e && e->id == id);
+    }
+    assert(doc.get_entity(ids[2])->color == 0x00FF00u);
+
+    // New entities append after survivors.
+    core::EntityId tail = doc.add_polyline(pl, "tail");
+    assert(doc.entities().back().id == tail);
+    assert(doc.get_entity(tail)->name == "tail");
+
+    // Reads never move storage, so earlier pointers stay valid.
+    const core::Entity* held = doc.get_entity(expected[1]);
+    assert(doc.entity_count() == expected.size() + 1);
+    assert(doc.snapshot()->entities().size() == expected.size() + 1);
+    assert(doc.get_entity(expected[1]) == held && held->id == expected[1]);
+
+    // Removals inside a batch never compact; snapshots leave them out.
+    {
+        core::DocumentChangeGuard batch(doc);
+        assert(doc.remove_entity(expected[3]) && doc.remove_entity(expected[4]));
+        assert(doc.entity_count() == expected.size() - 1);
+        assert(doc.snapshot()->entities().size() == expected.size() - 1);
+        assert(!doc.snapshot()->get_entity(expected[3]));
+    }
+    expected.erase(expected.begin() + 3, expected.begin() + 5);
+    expected.push_back(tail);
+    assert(live_ids() == expected);
+
+    // Storage is compacted once tombstones are half of it.
+    const size_t slots = doc.entities().size();
+    while (doc.entities().size() == slots) {
+        assert(doc.remove_entity(expected.back()));
+        expected.pop_back();
+    }
+    assert(doc.entities().size() == expected.size() && doc.entity_count() == expected.size());
+    for (const auto& e : doc.entities()) assert(e.id != 0 && doc.get_entity(e.id) == &e);
+    assert(live_ids() == expected);
+
+    // Undo/redo of geometry edits resolves through the index.
+    core::Polyline moved;
+    moved.points = {{5, 5}, {6, 5}, {6, 6}, {5, 5}};
+    doc.begin_transaction("move");
+    assert(doc.set_polyline_points(expected[0], moved));
+    doc.commit_transaction();
+    assert(doc.undo());
+    const auto* restored = std::get_if<core::Polyline>(&doc.get_entity(expected[0])->payload);
+    assert(restored && restored->points[0].x == 0.0);
+    assert(doc.redo());
+    restored = std::get_if<core::Polyline>(&doc.get_entity(expected[0])->payload);
+    assert(restored && restored->points[0].x == 5.0);
+
+    doc.clear();
+    assert(doc.entities().empty());
+    assert(doc.get_entity(tail) == nullptr);
+    return 0;
+}
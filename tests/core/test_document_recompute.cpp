@@ -0,0 +1,236 @@
+#include "core/document.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using core::EntityId;
+
+// Each dependent point's x is the sum of its sources' x.
+double sum_of_sources(const core::Document& doc, EntityId id) {
+    double x = 0.0;
+    for (EntityId src : doc.dependency_graph().sourcesOf(id)) x += doc.get_point(src)->p.x;
+    return x;
+}
+
+size_t position(const std::vector<EntityId>& order, EntityId id) {
+    return static_cast<size_t>(std::find(order.begin(), order.end(), id) - order.begin());
+}
+
+void check_graph() {
+    core::DependencyGraph g;
+    g.addDependency(1, 2);
+    g.addDependency(1, 2); // duplicate edges collapse
+    // 3 enters after 1 and 2 but must come first.
+    g.addDependency(3, 1);
+    g.addDependency(3, 4);
+    g.addDependency(4, 2);
+    assert(g.edgeCount() == 4 && g.acyclic());
+    assert((g.dependentsOf(3) == std::vector<EntityId>{1, 4}));
+    assert((g.sourcesOf(2) == std::vector<EntityId>{1, 4}));
+
+    bool cycle = true;
+    const auto order = g.topologicalOrder({3}, &cycle);
+    assert(!cycle && order.size() == 4 && order[0] == 3 && order[3] == 2);
+    assert(g.topologicalOrder({2}) == std::vector<EntityId>{2});
+    // Roots outside the graph are passed through.
+    assert((g.topologicalOrder({99, 1}) == std::vector<EntityId>{99, 1, 2}));
+
+    assert(g.wouldCycle(2, 3) && g.wouldCycle(4, 3) && g.wouldCycle(5, 5));
+    assert(!g.wouldCycle(3, 2) && !g.wouldCycle(1, 4) && !g.wouldCycle(7, 8));
+
+    // A closed cycle leaves its nodes out of the order until it is broken.
+    g.addDependency(2, 3);
+    assert(!g.acyclic());
+    const auto partial = g.topologicalOrder({3}, &cycle);
+    assert(cycle && partial.size() < 4);
+    g.removeDependency(2, 3);
+    assert(g.acyclic());
+    const auto restored = g.topologicalOrder({3}, &cycle);
+    assert(!cycle && restored.size() == 4);
+    assert(position(restored, 3) < position(restored, 1) && position(restored, 4) < position(restored, 2));
+
+    // Nodes go when their last edge does; their slots are reused.
+    g.removeEntity(1);
+    assert(g.edgeCount() == 2);
+    assert((g.allEntities() == std::vector<EntityId>{2, 3, 4}));
+    g.removeDependency(4, 2);
+    assert((g.allEntities() == std::vector<EntityId>{3, 4}));
+    g.addDependency(10, 3);
+    assert(g.topologicalOrder({10}) == (std::vector<EntityId>{10, 3, 4}));
+    g.clear();
+    assert(g.empty() && g.allEntities().empty());
+}
+
+// a, b roots; c = a + b; d = a + c; e = b; f = d + e.
+void check_serial() {
+    core::Document doc;
+    const EntityId a = doc.add_point({1.0, 0.0});
+    const EntityId b = doc.add_point({2.0, 0.0});
+    const EntityId c = doc.add_point({0.0, 0.0});
+    const EntityId d = doc.add_point({0.0, 0.0});
+    const EntityId e = doc.add_point({0.0, 0.0});
+    const EntityId f = doc.add_point({0.0, 0.0});
+    auto& g = doc.dependency_graph();
+    g.addDependency(d, f);
+    g.addDependency(e, f);
+    g.addDependency(c, d);
+    g.addDependency(a, d);
+    g.addDependency(a, c);
+    g.addDependency(b, c);
+    g.addDependency(b, e);
+
+    std::map<EntityId, int> calls;
+    doc.set_recompute_callback([&](core::Document& target, EntityId id) {
+        ++calls[id];
+        target.get_point(id)->p.x = sum_of_sources(target, id);
+    });
+    // Both roots changed: every dependent still recomputes exactly once.
+    assert(doc.recompute({a, b, a}) == 4);
+    assert(calls.size() == 4 && calls[c] == 1 && calls[d] == 1 && calls[e] == 1 && calls[f] == 1);
+    assert(doc.get_point(f)->p.x == 6.0);
+
+    calls.clear();
+    doc.get_point(b)->p.x = 5.0;
+    assert(doc.recompute({e}) == 1 && calls[f] == 1 && doc.get_point(f)->p.x == 6.0);
+    assert(doc.recompute({b}) == 4 && doc.get_point(f)->p.x == 12.0);
+    assert(doc.recompute({12345}) == 0);
+    calls.clear();
+    assert(doc.recompute_all() == 6 && calls[a] == 1 && calls[f] == 1);
+}
+
+// One root, a wide first level, a second level that reads pairs of the
+// first, and a sink over all of the second.
+constexpr int kWidth = 200;
+
+struct Wide {
+    EntityId root{0};
+    std::vector<EntityId> first, second;
+    EntityId sink{0};
+};
+
+Wide build_wide(core::Document& doc) {
+    Wide w;
+    w.root = doc.add_point({1.0, 0.0});
+    auto& g = doc.dependency_graph();
+    for (int i = 0; i < kWidth; ++i) {
+        w.first.push_back(doc.add_point({0.0, 0.0}));
+        g.addDependency(w.root, w.first.back());
+    }
+    for (int i = 0; i < kWidth; ++i) {
+        w.second.push_back(doc.add_point({0.0, 0.0}));
+        g.addDependency(w.first[i], w.second.back());
+        g.addDependency(w.first[(i + 1) % kWidth], w.second.back());
+    }
+    w.sink = doc.add_point({0.0, 0.0});
+    for (EntityId id : w.second) g.addDependency(id, w.sink);
+    return w;
+}
+
+void check_parallel() {
+    core::Document serial_doc;
+    const Wide serial = build_wide(serial_doc);
+    serial_doc.set_recompute_callback([](core::Document& target, EntityId id) {
+        target.get_point(id)->p.x = sum_of_sources(target, id);
+    });
+    assert(serial_doc.recompute({serial.root}) == 2 * kWidth + 1);
+
+    core::Document doc;
+    const Wide wide = build_wide(doc);
+    std::mutex mutex;
+    std::map<EntityId, int> calls;
+    std::set<std::thread::id> threads;
+    doc.set_recompute_threads(4);
+    doc.set_parallel_recompute_callback([&](const core::Document& reader, EntityId id) -> core::Document::RecomputeWrite {
+        const double x = sum_of_sources(reader, id);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++calls[id];
+            threads.insert(std::this_thread::get_id());
+        }
+        return [id, x](core::Document& target) { target.get_point(id)->p.x = x; };
+    });
+    assert(doc.recompute({wide.root}) == 2 * kWidth + 1);
+    assert(calls.size() == 2 * kWidth + 1);
+    for (const auto& entry : calls) assert(entry.second == 1);
+    // Each level saw the previous level's writes.
+    assert(doc.get_point(wide.sink)->p.x == 2.0 * kWidth);
+    assert(doc.get_point(wide.sink)->p.x == serial_doc.get_point(serial.sink)->p.x);
+    assert(!threads.empty() && threads.size() <= 4);
+
+    // Recomputing everything includes the root; an exception in a worker
+    // reaches the caller.
+    calls.clear();
+    assert(doc.recompute_all() == 2 * kWidth + 2 && calls[wide.root] == 1);
+    doc.set_parallel_recompute_callback([&](const core::Document&, EntityId id) -> core::Document::RecomputeWrite {
+        if (id == wide.first[kWidth / 2]) throw 42;
+        return {};
+    });
+    bool thrown = false;
+    try {
+        doc.recompute({wide.root});
+    } catch (int value) {
+        thrown = value == 42;
+    }
+    assert(thrown);
+    doc.set_recompute_threads(1);
+    assert(doc.recompute({wide.second[0]}) == 1);
+}
+
+// Workers read the entity list and the spatial index while the document
+// has tombstones (removals inside an open change batch) and entities the
+// index has not seen move; each level's writes move more of them.
+void check_concurrent_reads() {
+    core::Document doc;
+    const Wide wide = build_wide(doc);
+    std::vector<EntityId> clutter;
+    for (int i = 0; i < 64; ++i) clutter.push_back(doc.add_point({0.5 * i, 10.0}));
+    assert(!doc.spatial_index().empty());
+
+    core::DocumentChangeGuard batch(doc);
+    for (int i = 0; i < 16; ++i) doc.remove_entity(clutter[static_cast<size_t>(i)]);
+    for (int i = 16; i < 32; ++i) doc.set_point(clutter[static_cast<size_t>(i)], {0.5 * i, 20.0});
+    doc.set_point(wide.root, {1.0, 1.0});
+    size_t live = 0;
+    for (const auto& e : doc.entities()) live += e.id != 0;
+    assert(live < doc.entities().size());
+
+    std::atomic<int> misses{0};
+    doc.set_recompute_threads(4);
+    doc.set_parallel_recompute_callback([&](const core::Document& reader, EntityId id) -> core::Document::RecomputeWrite {
+        size_t seen = 0;
+        for (const auto& e : reader.entities()) seen += e.id != 0;
+        if (seen != live) ++misses;
+        // Every source is indexed where the previous level put it.
+        double x = 0.0;
+        std::vector<EntityId> hits;
+        for (EntityId src : reader.dependency_graph().sourcesOf(id)) {
+            const core::Vec2 p = reader.get_point(src)->p;
+            x += p.x;
+            hits.clear();
+            reader.spatial_index().query(core::Box2{p.x - 1e-9, p.y - 1e-9, p.x + 1e-9, p.y + 1e-9}, hits);
+            if (std::find(hits.begin(), hits.end(), src) == hits.end()) ++misses;
+        }
+        return [id, x](core::Document& target) { target.set_point(id, {x, 1.0}); };
+    });
+    assert(doc.recompute({wide.root}) == 2 * kWidth + 1);
+    assert(misses.load() == 0);
+    assert(doc.get_point(wide.sink)->p.x == 2.0 * kWidth);
+}
+
+} // namespace
+
+int main() {
+    check_graph();
+    check_serial();
+    check_parallel();
+    check_concurrent_reads();
+    return 0;
+}
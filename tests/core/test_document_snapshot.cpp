@@ -0,0 +1,107 @@
+#include "core/document.hpp"
+#include "core/spatial_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+int main() {
+    core::Document doc;
+    const int layer = doc.add_layer("walls", 0x00FF00);
+    core::Polyline pl;
+    pl.points = {{0, 0}, {1, 0}, {1, 1}};
+    std::vector<core::EntityId> ids;
+    for (int i = 0; i < 100; ++i) ids.push_back(doc.add_polyline(pl, "pl", layer));
+
+    // Unchanged document: the same snapshot is handed out again.
+    auto s1 = doc.snapshot();
+    assert(s1->entities().size() == 100);
+    assert(doc.snapshot() == s1);
+    assert(s1->get_layer(layer) && s1->get_layer(layer)->name == "walls");
+
+    // Edits leave the old snapshot intact and share untouched entities.
+    core::Polyline moved = pl;
+    moved.points[0] = {5, 5};
+    doc.set_polyline_points(ids[3], moved);
+    doc.set_entity_color(ids[4], 0xFF0000);
+    doc.remove_entity(ids[5]);
+    const core::EntityId added = doc.add_point({2, 2});
+    doc.set_layer_color(layer, 0x0000FF);
+    auto s2 = doc.snapshot();
+    assert(s2 != s1 && s2->revision() > s1->revision());
+    assert(std::get<core::Polyline>(s1->get_entity(ids[3])->payload).points[0].x == 0);
+    assert(std::get<core::Polyline>(s2->get_entity(ids[3])->payload).points[0].x == 5);
+    assert(s1->get_entity(ids[5]) && !s2->get_entity(ids[5]));
+    assert(s1->get_entity(ids[0]) == s2->get_entity(ids[0]));
+    assert(s1->get_entity(ids[3]) != s2->get_entity(ids[3]));
+    assert(s1->get_layer(layer)->color == 0x00FF00);
+
+    // Diff between versions.
+    const core::DocumentChangeSet changes = s2->diff(*s1);
+    assert(changes.added == std::vector<core::EntityId>{added});
+    assert(changes.removed == std::vector<core::EntityId>{ids[5]});
+    assert(changes.geometryChanged == std::vector<core::EntityId>{ids[3]});
+    assert(changes.metaChanged == std::vector<core::EntityId>{ids[4]});
+    assert(changes.layersChanged == std::vector<int>{layer});
+    assert(!changes.settingsChanged && !changes.documentMetaChanged);
+
+    // Writes through a mutable pointer are picked up once reported.
+    doc.get_entity(ids[6])->name = "renamed";
+    doc.mark_modified(ids[6]);
+    auto s3 = doc.snapshot();
+    assert(s3->get_entity(ids[6])->name == "renamed" && s2->get_entity(ids[6])->name == "pl");
+    // Looking up through the mutable overloads changes nothing.
+    const uint64_t revision = doc.revision();
+    assert(doc.get_entity(ids[7]) && doc.get_layer(layer));
+    doc.settings();
+    doc.metadata();
+    assert(doc.revision() == revision && doc.snapshot() == s3);
+    // The same holds for layers, and for the spatial index.
+    doc.get_layer(layer)->line_weight = 0.5;
+    doc.mark_modified();
+    auto s3b = doc.snapshot();
+    assert(s3b != s3 && s3b->get_layer(layer)->line_weight == 0.5 && s3->get_layer(layer)->line_weight == 0.0);
+    std::vector<core::EntityId> hits;
+    doc.spatial_index().query(core::Box2{1, 1, 3, 3}, hits);
+    assert(std::find(hits.begin(), hits.end(), added) != hits.end());
+    doc.get_point(added)->p = {50, 50};
+    doc.mark_modified(added);
+    hits.clear();
+    doc.spatial_index().query(core::Box2{1, 1, 3, 3}, hits);
+    assert(std::find(hits.begin(), hits.end(), added) == hits.end());
+    hits.clear();
+    doc.spatial_index().query(core::Box2{49, 49, 51, 51}, hits);
+    assert(hits == std::vector<core::EntityId>{added});
+    assert(doc.snapshot()->get_entity(added) != s3b->get_entity(added));
+
+    // A clear restarts ids; nothing is shared with the older snapshot.
+    doc.clear();
+    const core::EntityId fresh = doc.add_point({7, 7});
+    auto s4 = doc.snapshot();
+    assert(s4->entities().size() == 1 && s4->get_entity(fresh)->type == core::EntityType::Point);
+    assert(s3->entities().size() == 100);
+
+    // A worker can read a snapshot while the document keeps changing.
+    for (int i = 0; i < 1000; ++i) doc.add_polyline(pl);
+    auto shared = doc.snapshot();
+    std::atomic<size_t> points{0};
+    std::thread reader([&shared, &points] {
+        size_t total = 0;
+        for (int pass = 0; pass < 20; ++pass) {
+            for (const auto& e : shared->entities()) {
+                if (const auto* p = std::get_if<core::Polyline>(&e->payload)) total += p->points.size();
+            }
+        }
+        points = total;
+    });
+    for (int i = 0; i < 1000; ++i) {
+        doc.add_polyline(pl);
+        doc.remove_entity(fresh + 1 + static_cast<core::EntityId>(i));
+    }
+    reader.join();
+    assert(points == 20u * 1000u * 3u);
+    assert(shared->entities().size() == 1001);
+    return 0;
+}
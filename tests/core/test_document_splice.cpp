@@ -0,0 +1,119 @@
+#include "core/document.hpp"
+
+#include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BatchObserver : core::DocumentObserver {
+    int events{0};
+    std::vector<core::DocumentChangeSet> batches;
+
+    void on_document_changed(const core::Document&, const core::DocumentChangeEvent&) override { ++events; }
+    void on_document_batch_changed(const core::Document&, const core::DocumentChangeSet& changes) override {
+        batches.push_back(changes);
+    }
+};
+
+} // namespace
+
+int main() {
+    core::Document dst;
+    const int dstWalls = dst.add_layer("walls", 0x00FF00);
+    const core::EntityId existing = dst.add_point({0, 0}, "p", dstWalls);
+    const int dstGroup = dst.alloc_group_id();
+    dst.set_entity_group_id(existing, dstGroup);
+    dst.set_meta_value("source", "dst");
+
+    core::Document src;
+    const int srcWalls = src.add_layer("walls", 0xFF0000);
+    const int srcDoors = src.add_layer("doors", 0x0000FF);
+    src.get_layer(srcDoors)->line_weight = 0.35;
+    core::Line line;
+    line.a = {0, 0};
+    line.b = {1, 0};
+    const core::EntityId a = src.add_line(line, "a", srcWalls);
+    const core::EntityId gone = src.add_line(line, "gone", srcDoors);
+    core::Polyline pl;
+    pl.points = {{0, 0}, {1, 1}, {2, 0}};
+    const core::EntityId b = src.add_polyline(pl, "b", srcDoors);
+    src.remove_entity(gone);
+    const int srcGroup = src.alloc_group_id();
+    src.set_entity_group_id(a, srcGroup);
+    src.set_entity_group_id(b, srcGroup);
+    src.set_entity_attr_string(b, core::EntityAttrField::Layout, "Layout1");
+    src.set_entity_attr_int(b, core::EntityAttrField::Space, 1);
+    src.set_meta_value("dxf.entity." + std::to_string(b) + ".custom_note", "hello");
+    src.set_meta_value("dxf.entity." + std::to_string(gone) + ".custom_note", "dropped");
+    src.set_meta_value("dxf.layer." + std::to_string(srcDoors) + ".color_aci", "5");
+    src.set_meta_value("source", "src");
+    src.set_meta_value("dxf.codepage", "ANSI_1252");
+    const int block = src.add_block_definition("BLK");
+    src.add_entity_to_block(block, b);
+    src.dependency_graph().addDependency(a, b);
+
+    BatchObserver observer;
+    dst.add_observer(&observer);
+
+    core::Document::LayerRemap remap{{srcWalls, dstWalls}};
+    core::Document::LayerRemap applied;
+    const core::EntityId first = dst.splice_from(std::move(src), remap, &applied);
+
+    // Source is left empty.
+    assert(src.entities().empty());
+    assert(src.layers().size() == 1);
+
+    // Contiguous ids after the existing ones, insertion order preserved.
+    assert(first == existing + 1);
+    const auto* na = dst.get_entity(first);
+    const auto* nb = dst.get_entity(first + 1);
+    assert(na && na->name == "a" && na->type == core::EntityType::Line);
+    assert(nb && nb->name == "b" && nb->type == core::EntityType::Polyline);
+    assert(dst.entities().size() == 3);
+
+    // Layers: explicit remap honoured, unmapped layers appended with properties.
+    assert(applied.at(srcWalls) == dstWalls);
+    assert(applied.at(0) == 0);
+    assert(na->layerId == dstWalls);
+    const auto* doors = dst.get_layer(applied.at(srcDoors));
+    assert(doors && doors->name == "doors" && doors->line_weight == 0.35 && doors->id != dstWalls);
+    assert(nb->layerId == doors->id);
+    assert(dst.layers().size() == 3);
+
+    // Groups move to fresh ids, shared members stay together.
+    assert(na->groupId == nb->groupId && na->groupId != dstGroup && na->groupId >= 1);
+
+    // Typed attributes and id-bearing keys follow the new ids.
+    std::string value;
+    assert(dst.entity_attr_text(first + 1, core::EntityAttrField::Layout) == "Layout1");
+    assert(dst.entity_attr_text(first + 1, core::EntityAttrField::Space) == "1");
+    assert(dst.get_meta_value("dxf.entity." + std::to_string(first + 1) + ".custom_note", &value) &&
+           value == "hello");
+    assert(dst.get_meta_value("dxf.layer." + std::to_string(doors->id) + ".color_aci", &value) && value == "5");
+    assert(dst.get_meta_value("dxf.codepage", &value) && value == "ANSI_1252");
+    assert(dst.get_meta_value("source", &value) && value == "dst");
+    for (const auto& kv : dst.meta_entries()) assert(kv.second != "dropped");
+
+    // Blocks and dependencies are remapped.
+    assert(dst.block_definitions().size() == 1);
+    assert(dst.block_definitions()[0].memberIds == std::vector<core::EntityId>{first + 1});
+    assert(dst.dependency_graph().dependentsOf(first) == std::vector<core::EntityId>{first + 1});
+
+    // One batched notification.
+    assert(observer.events == 0);
+    assert(observer.batches.size() == 1);
+    const auto& changes = observer.batches[0];
+    assert((changes.added == std::vector<core::EntityId>{first, first + 1}));
+    assert(changes.layersChanged == std::vector<int>{doors->id});
+    assert(changes.documentMetaChanged);
+
+    // Splicing an empty document adds nothing; ids keep counting afterwards.
+    core::Document empty;
+    assert(dst.splice_from(std::move(empty)) == 0);
+    assert(dst.add_point({1, 1}) == first + 2);
+
+    dst.remove_observer(&observer);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "core/document.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace {
+
+std::vector<core::EntityId> ids(const core::Document& doc) {
+    std::vector<core::EntityId> out;
+    for (const auto& e : doc.entities()) {
+        if (e.id != 0) out.push_back(e.id);
+    }
+    return out;
+}
+
+} // namespace
+
+int main() {
+    core::Document doc;
+    const core::EntityId a = doc.add_point({0, 0}, "a");
+    const core::EntityId b = doc.add_point({1, 0}, "b");
+    const core::EntityId c = doc.add_point({2, 0}, "c");
+
+    // Adds are undoable and redo brings back the same id.
+    doc.begin_transaction("add");
+    const core::EntityId d = doc.add_point({3, 0}, "d");
+    doc.commit_transaction();
+    assert(doc.undo());
+    assert(!doc.get_entity(d));
+    assert(doc.redo());
+    assert(doc.get_entity(d) && doc.get_entity(d)->name == "d");
+
+    // Removes restore the entity with its properties at its original position,
+    // whether or not storage was compacted in between.
+    doc.set_entity_color(b, 0x123456);
+    doc.begin_transaction("remove");
+    doc.remove_entity(b);
+    doc.remove_entity(c);
+    doc.commit_transaction();
+    assert((ids(doc) == std::vector<core::EntityId>{a, d}));
+    assert(doc.undo());
+    assert((ids(doc) == std::vector<core::EntityId>{a, b, c, d}));
+    assert(doc.get_entity(b)->color == 0x123456 && doc.get_entity(b)->name == "b");
+    assert(doc.redo());
+    assert((ids(doc) == std::vector<core::EntityId>{a, d}));
+    assert(doc.undo());
+    assert((ids(doc) == std::vector<core::EntityId>{a, b, c, d}));
+
+    // Bulk adds inside a transaction are recorded too.
+    doc.begin_transaction("bulk");
+    std::vector<core::Entity> batch(3);
+    for (auto& e : batch) e.payload = core::Point{{5, 5}};
+    const core::EntityId first = doc.add_entities(std::move(batch));
+    doc.commit_transaction();
+    assert(doc.undo());
+    assert(!doc.get_entity(first) && !doc.get_entity(first + 2));
+    assert(doc.redo());
+    assert(doc.get_entity(first + 2));
+
+    // Rollback reverts structural changes as well.
+    doc.begin_transaction("discard");
+    doc.remove_entity(a);
+    const core::EntityId e = doc.add_point({9, 9});
+    doc.rollback_transaction();
+    assert(doc.get_entity(a) && !doc.get_entity(e));
+    assert(ids(doc).front() == a);
+
+    // Editing one vertex of a large polyline stores only that vertex.
+    core::Polyline big;
+    for (int i = 0; i < 50000; ++i) big.points.push_back({double(i), 0});
+    const core::EntityId pl = doc.add_polyline(big);
+    const size_t before = doc.undo_bytes();
+    for (int step = 1; step <= 10; ++step) {
+        big.points[100].y = step;
+        doc.begin_transaction("drag");
+        doc.set_polyline_points(pl, big);
+        doc.commit_transaction();
+    }
+    assert(doc.undo_bytes() - before < 50000 * sizeof(core::Vec2));
+    for (int step = 0; step < 10; ++step) assert(doc.undo());
+    assert(std::get<core::Polyline>(doc.get_entity(pl)->payload).points[100].y == 0);
+    assert(doc.redo());
+    assert(std::get<core::Polyline>(doc.get_entity(pl)->payload).points[100].y == 1);
+
+    // Changing the vertex count falls back to a full copy and still round-trips.
+    core::Polyline shorter;
+    shorter.points = {{0, 0}, {1, 1}};
+    doc.begin_transaction("replace");
+    doc.set_polyline_points(pl, shorter);
+    doc.commit_transaction();
+    assert(doc.undo());
+    assert(std::get<core::Polyline>(doc.get_entity(pl)->payload).points.size() == 50000);
+
+    // A byte budget evicts the oldest steps but keeps the newest.
+    const size_t steps = doc.undo_stack_size();
+    assert(steps > 2);
+    doc.set_undo_byte_budget(1);
+    assert(doc.undo_stack_size() == 1);
+    assert(doc.undo_bytes() > 0);
+    assert(doc.undo());
+    assert(!doc.can_undo());
+    doc.set_undo_byte_budget(0);
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -614,6 +615,90 @@ int main() {
     assert(tradeoff_result.redundancySubsets[0].witnessConstraintCount == 4);
     assert(tradeoff_result.redundancySubsets[1].anchorConstraintIndex == 0);
     assert(tradeoff_result.redundancySubsets[1].witnessConstraintCount == 2);
+
+    // Large overconstrained chain: a horizontal chain pinned at p0, with every
+    // 100th point's y pinned again. Each extra pin is the redundant row of
+    // one subset-sized witness, found without densifying the Jacobian.
+    const int chain_links = 2000;
+    std::unordered_map<std::string, double> chain_vars;
+    std::vector<ConstraintSpec> chain;
+    auto chain_id = [](int i) { return "c" + std::to_string(i); };
+    for (int i = 0; i <= chain_links; ++i) {
+        chain_vars[chain_id(i) + ".x"] = static_cast<double>(i);
+        chain_vars[chain_id(i) + ".y"] = 0.0;
+    }
+    ConstraintSpec chain_fx; chain_fx.type = "fixed_point"; chain_fx.value = 0.0;
+    chain_fx.vars = {VarRef{"c0", "x"}, VarRef{"c0", "y"}};
+    ConstraintSpec chain_fy = chain_fx;
+    chain_fy.vars = {VarRef{"c0", "y"}, VarRef{"c0", "x"}};
+    chain.push_back(chain_fx);
+    chain.push_back(chain_fy);
+    std::vector<int> extra_pins;
+    for (int i = 1; i <= chain_links; ++i) {
+        ConstraintSpec link; link.type = "distance"; link.value = 1.0;
+        link.vars = {VarRef{chain_id(i - 1), "x"}, VarRef{chain_id(i - 1), "y"},
+                     VarRef{chain_id(i), "x"}, VarRef{chain_id(i), "y"}};
+        ConstraintSpec level; level.type = "horizontal";
+        level.vars = {VarRef{chain_id(i - 1), "y"}, VarRef{chain_id(i), "y"}};
+        chain.push_back(link);
+        chain.push_back(level);
+        if (i % 100 == 0) {
+            ConstraintSpec pin; pin.type = "fixed_point"; pin.value = 0.0;
+            pin.vars = {VarRef{chain_id(i), "y"}, VarRef{chain_id(i), "x"}};
+            extra_pins.push_back(static_cast<int>(chain.size()));
+            chain.push_back(pin);
+        }
+    }
+    auto chain_get = [&](const VarRef& v, bool& ok) {
+        const auto it = chain_vars.find(v.id + "." + v.key);
+        ok = it != chain_vars.end();
+        return ok ? it->second : 0.0;
+    };
+    auto chain_set = [&](const VarRef& v, double value) { chain_vars[v.id + "." + v.key] = value; };
+    SolveResult chain_result = solver->solveWithBindings(chain, chain_get, chain_set);
+    assert(chain_result.ok);
+    assert(chain_result.analysis.jacobianRowCount == static_cast<int>(chain.size()));
+    assert(chain_result.analysis.jacobianRank == 2 * (chain_links + 1));
+    assert(chain_result.analysis.redundantConstraintEstimate == static_cast<int>(extra_pins.size()));
+    assert(chain_result.analysis.dofEstimate == 0);
+    assert(chain_result.structuralGroups.size() == 1);
+    assert(chain_result.structuralGroups[0].freeVariableKeys.empty());
+    assert(chain_result.redundancySubsets.size() == 1);
+    assert(chain_result.primaryRedundantConstraintIndices == extra_pins);
+
+    // Diagnostics levels trade analysis depth for speed; the solve is the same.
+    solver->setDiagnosticsLevel(SolverDiagnosticsLevel::None);
+    const SolveResult none_result = solver->solveWithBindings(tradeoff_specs, get, set);
+    assert(none_result.ok == tradeoff_result.ok);
+    assert(none_result.analysis.constraintCount == tradeoff_result.analysis.constraintCount);
+    assert(none_result.analysis.jacobianRank == 0);
+    assert(none_result.structuralGroups.empty() && none_result.redundancySubsets.empty());
+
+    solver->setDiagnosticsLevel(SolverDiagnosticsLevel::Counts);
+    const SolveResult counts_result = solver->solveWithBindings(tradeoff_specs, get, set);
+    assert(counts_result.analysis.jacobianRank == tradeoff_result.analysis.jacobianRank);
+    assert(counts_result.analysis.dofEstimate == tradeoff_result.analysis.dofEstimate);
+    assert(counts_result.analysis.redundantConstraintEstimate
+           == tradeoff_result.analysis.redundantConstraintEstimate);
+    assert(counts_result.analysis.structuralState == tradeoff_result.analysis.structuralState);
+    assert(counts_result.structuralGroups.empty() && counts_result.conflictGroups.empty());
+    assert(counts_result.redundancySubsets.empty());
+
+    solver->setDiagnosticsLevel(SolverDiagnosticsLevel::Structural);
+    const SolveResult structural_result = solver->solveWithBindings(tradeoff_specs, get, set);
+    assert(structural_result.structuralGroups.size() == tradeoff_result.structuralGroups.size());
+    assert(structural_result.redundancySubsets.size() == tradeoff_result.redundancySubsets.size());
+    assert(structural_result.primaryConflictConstraintIndices
+           == tradeoff_result.primaryConflictConstraintIndices);
+    assert(structural_result.primaryRedundantConstraintIndices
+           == tradeoff_result.primaryRedundantConstraintIndices);
+    assert(structural_result.analysis.primaryRedundancyPriorityScore
+           == tradeoff_result.analysis.primaryRedundancyPriorityScore);
+    assert(structural_result.analysis.primaryRedundancySelectionExplanation.empty());
+    assert(structural_result.analysis.primaryConflictActionHint.empty());
+    assert(structural_result.analysis.smallestRedundancySelectionPolicy.empty());
+    solver->setDiagnosticsLevel(SolverDiagnosticsLevel::Full);
+
     delete solver;
     std::cout << "solver diagnostics smoke passed with "
               << result.diagnostics.size() << " diagnostics\n";
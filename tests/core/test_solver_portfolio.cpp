@@ -0,0 +1,185 @@
+// Portfolio solving: LM, DogLeg and BFGS race on private copies, the winner's
+// values are the only ones written back, the result names the winner, every
+// racer solves 2D constraints as x/y pairs, and a raised cancellation flag
+// stops any solver at its next iteration.
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../core/include/core/solver.hpp"
+
+using namespace core;
+
+namespace {
+
+using VarMap = std::unordered_map<std::string, double>;
+
+std::string point_id(int i) { return "p" + std::to_string(i); }
+
+// A chain of unit links hanging off a pinned p0, started bent and stretched.
+// Past a few dozen links BFGS cannot finish it in its default iterations.
+std::vector<ConstraintSpec> build_chain(int links, VarMap& vars) {
+    std::vector<ConstraintSpec> constraints;
+    for (int i = 0; i <= links; ++i) {
+        vars[point_id(i) + ".x"] = 1.3 * i;
+        vars[point_id(i) + ".y"] = 0.4 * std::sin(0.7 * i);
+    }
+    ConstraintSpec fx; fx.type = "fixed_point"; fx.value = 0.0;
+    fx.vars = {VarRef{"p0", "x"}, VarRef{"p0", "y"}};
+    ConstraintSpec fy = fx;
+    fy.vars = {VarRef{"p0", "y"}, VarRef{"p0", "x"}};
+    constraints.push_back(fx);
+    constraints.push_back(fy);
+    for (int i = 1; i <= links; ++i) {
+        ConstraintSpec d; d.type = "distance"; d.value = 1.0;
+        d.vars = {VarRef{point_id(i - 1), "x"}, VarRef{point_id(i - 1), "y"},
+                  VarRef{point_id(i), "x"}, VarRef{point_id(i), "y"}};
+        constraints.push_back(d);
+    }
+    return constraints;
+}
+
+double worst_link(const VarMap& vars, int links) {
+    double worst = 0.0;
+    for (int i = 1; i <= links; ++i) {
+        const double dx = vars.at(point_id(i) + ".x") - vars.at(point_id(i - 1) + ".x");
+        const double dy = vars.at(point_id(i) + ".y") - vars.at(point_id(i - 1) + ".y");
+        worst = std::max(worst, std::abs(std::sqrt(dx * dx + dy * dy) - 1.0));
+    }
+    return worst;
+}
+
+struct Bindings {
+    VarMap& vars;
+    std::string readOnly; // a key whose writes are ignored
+    int writes{0};
+
+    ISolver::GetVar get() {
+        return [this](const VarRef& v, bool& ok) {
+            const auto it = vars.find(v.id + "." + v.key);
+            ok = it != vars.end();
+            return ok ? it->second : 0.0;
+        };
+    }
+    ISolver::SetVar set() {
+        return [this](const VarRef& v, double value) {
+            const std::string key = v.id + "." + v.key;
+            if (key == readOnly) return;
+            ++writes;
+            vars[key] = value;
+        };
+    }
+};
+
+} // namespace
+
+int main() {
+    assert(std::string(solverAlgorithmName(SolverAlgorithm::Portfolio)) == "portfolio");
+    assert(std::string(solverAlgorithmName(SolverAlgorithm::DogLeg)) == "dogleg");
+
+    // A short chain: any racer may win, and the winner is named.
+    {
+        VarMap vars;
+        auto constraints = build_chain(5, vars);
+        Bindings b{vars, "", 0};
+        std::unique_ptr<ISolver> solver(createSolver(SolverAlgorithm::Portfolio));
+        solver->setTolerance(1e-10);
+        const SolveResult r = solver->solveWithBindings(constraints, b.get(), b.set());
+        std::printf("short chain: ok=%d winner=%s iters=%d err=%.3g\n", r.ok,
+                    solverAlgorithmName(r.algorithm), r.iterations, r.finalError);
+        assert(r.ok && r.finalError <= 1e-10);
+        assert(r.algorithm != SolverAlgorithm::Portfolio);
+        assert(r.analysis.jacobianRank > 0); // analysis ran alongside the race
+        assert(worst_link(vars, 5) < 1e-9);
+        assert(vars.at("p0.x") == 0.0 && vars.at("p0.y") == 0.0);
+    }
+
+    // A long chain BFGS cannot finish: a Newton-type racer wins and BFGS is
+    // stopped instead of running out its iterations.
+    {
+        const int links = 200;
+        VarMap vars;
+        auto constraints = build_chain(links, vars);
+        Bindings b{vars, "", 0};
+        std::unique_ptr<ISolver> solver(createSolver(SolverAlgorithm::Portfolio));
+        solver->setTolerance(1e-8);
+        solver->setDiagnosticsLevel(SolverDiagnosticsLevel::None);
+        const SolveResult r = solver->solveWithBindings(constraints, b.get(), b.set());
+        std::printf("long chain: ok=%d winner=%s iters=%d err=%.3g\n", r.ok,
+                    solverAlgorithmName(r.algorithm), r.iterations, r.finalError);
+        assert(r.ok);
+        assert(r.algorithm == SolverAlgorithm::LM || r.algorithm == SolverAlgorithm::DogLeg);
+        assert(worst_link(vars, links) < 1e-7);
+    }
+
+    // Read-only bindings stay put in every racer and are never written back.
+    {
+        VarMap vars;
+        auto constraints = build_chain(3, vars);
+        vars["p3.x"] = 2.0;
+        vars["p3.y"] = 0.0;
+        Bindings b{vars, "p3.x", 0};
+        std::unique_ptr<ISolver> solver(createSolver(SolverAlgorithm::Portfolio));
+        solver->setTolerance(1e-10);
+        const SolveResult r = solver->solveWithBindings(constraints, b.get(), b.set());
+        std::printf("read-only end: ok=%d winner=%s\n", r.ok, solverAlgorithmName(r.algorithm));
+        assert(r.ok && vars.at("p3.x") == 2.0);
+        assert(worst_link(vars, 3) < 1e-9);
+    }
+
+    // A coincident pair already level in x but apart in y: every racer
+    // solves the expanded x/y rows, so a quick "converged" from a racer that
+    // only saw the x row cannot win with y still apart.
+    const SolverAlgorithm coincident_algorithms[] = {SolverAlgorithm::DogLeg, SolverAlgorithm::Portfolio};
+    for (SolverAlgorithm algo : coincident_algorithms) {
+        VarMap vars;
+        vars["p0.x"] = 1.0; vars["p0.y"] = 2.0;
+        vars["p1.x"] = 1.0; vars["p1.y"] = 5.0;
+        std::vector<ConstraintSpec> constraints{
+            ConstraintSpec{"coincident",
+                           {VarRef{"p0", "x"}, VarRef{"p0", "y"}, VarRef{"p1", "x"}, VarRef{"p1", "y"}},
+                           std::nullopt}};
+        Bindings b{vars, "", 0};
+        std::unique_ptr<ISolver> solver(createSolver(algo));
+        solver->setTolerance(1e-10);
+        const SolveResult r = solver->solveWithBindings(constraints, b.get(), b.set());
+        std::printf("coincident %s: ok=%d winner=%s err=%.3g\n", solverAlgorithmName(algo), r.ok,
+                    solverAlgorithmName(r.algorithm), r.finalError);
+        assert(r.ok && r.finalError <= 1e-10);
+        assert(std::abs(vars.at("p1.x") - vars.at("p0.x")) < 1e-9);
+        assert(std::abs(vars.at("p1.y") - vars.at("p0.y")) < 1e-9);
+    }
+
+    // A raised flag stops each algorithm, and the whole portfolio, before its
+    // first iteration.
+    const SolverAlgorithm algorithms[] = {SolverAlgorithm::LM, SolverAlgorithm::DogLeg,
+                                          SolverAlgorithm::BFGS, SolverAlgorithm::Portfolio};
+    for (SolverAlgorithm algo : algorithms) {
+        VarMap vars;
+        auto constraints = build_chain(20, vars);
+        const VarMap start = vars;
+        Bindings b{vars, "", 0};
+        std::atomic<bool> cancel{true};
+        std::unique_ptr<ISolver> solver(createSolver(algo));
+        solver->setCancellationFlag(&cancel);
+        const SolveResult r = solver->solveWithBindings(constraints, b.get(), b.set());
+        std::printf("cancelled %s: ok=%d iters=%d msg=%s\n", solverAlgorithmName(algo), r.ok,
+                    r.iterations, r.message.c_str());
+        assert(!r.ok && r.iterations == 0 && r.message == "Cancelled");
+        assert(worst_link(vars, 20) == worst_link(start, 20));
+
+        // Lowering the flag lets the same solver iterate again.
+        cancel.store(false);
+        const SolveResult resumed = solver->solveWithBindings(constraints, b.get(), b.set());
+        assert(resumed.iterations > 0 && resumed.message != "Cancelled");
+    }
+
+    std::printf("solver portfolio: ok\n");
+    return 0;
+}
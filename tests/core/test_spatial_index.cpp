@@ -0,0 +1,128 @@
+#include "core/document.hpp"
+#include "core/spatial_index.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+double box_distance(const core::Box2& b, const core::Vec2& p) {
+    const double dx = std::max({b.minX - p.x, 0.0, p.x - b.maxX});
+    const double dy = std::max({b.minY - p.y, 0.0, p.y - b.maxY});
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+std::vector<core::EntityId> brute_query(const std::vector<std::pair<core::EntityId, core::Box2>>& items,
+                                        const core::Box2& window) {
+    std::vector<core::EntityId> out;
+    for (const auto& it : items) {
+        if (it.second.intersects(window)) out.push_back(it.first);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::vector<core::EntityId> sorted_query(const core::SpatialIndex& index, const core::Box2& window) {
+    std::vector<core::EntityId> out;
+    index.query(window, out);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> pos(0.0, 1000.0);
+    std::uniform_real_distribution<double> ext(0.0, 20.0);
+    auto random_box = [&] {
+        const double x = pos(rng), y = pos(rng);
+        return core::Box2{x, y, x + ext(rng), y + ext(rng)};
+    };
+
+    // Bulk load, then mixed inserts/removes, always matching a brute-force scan.
+    std::vector<std::pair<core::EntityId, core::Box2>> items;
+    for (core::EntityId id = 1; id <= 2000; ++id) items.push_back({id, random_box()});
+    core::SpatialIndex index;
+    index.build(items);
+    assert(index.size() == 2000);
+    for (int round = 0; round < 500; ++round) {
+        const size_t victim = rng() % items.size();
+        assert(index.remove(items[victim].first));
+        items.erase(items.begin() + static_cast<std::ptrdiff_t>(victim));
+        const core::EntityId id = 2001 + static_cast<core::EntityId>(round);
+        items.push_back({id, random_box()});
+        index.insert(id, items.back().second);
+        if (round % 50 == 0) {
+            const core::Box2 window = {pos(rng), pos(rng), 0, 0};
+            const core::Box2 w{window.minX, window.minY, window.minX + 150, window.minY + 150};
+            assert(sorted_query(index, w) == brute_query(items, w));
+        }
+    }
+    assert(index.size() == items.size());
+    assert(!index.remove(999999));
+
+    // Re-inserting an id replaces its box.
+    index.insert(items[0].first, core::Box2{5000, 5000, 5001, 5001});
+    items[0].second = core::Box2{5000, 5000, 5001, 5001};
+    assert(index.size() == items.size());
+    assert(sorted_query(index, core::Box2{4999, 4999, 5002, 5002}) ==
+           std::vector<core::EntityId>{items[0].first});
+    core::Box2 all{};
+    assert(index.bounds(&all) && all.maxX >= 5001);
+
+    // k-nearest agrees with sorted brute-force distances.
+    const core::Vec2 probe{400, 600};
+    const auto nearest = index.nearest(probe, 10);
+    std::vector<double> dists;
+    for (const auto& it : items) dists.push_back(box_distance(it.second, probe));
+    std::sort(dists.begin(), dists.end());
+    assert(nearest.size() == 10);
+    for (size_t i = 0; i < nearest.size(); ++i) assert(std::abs(nearest[i].second - dists[i]) < 1e-12);
+    assert(index.nearest(probe, 5, 0.0).size() <= 5);
+
+    // Segment query is ordered along the segment.
+    core::SpatialIndex row;
+    for (core::EntityId id = 1; id <= 5; ++id) {
+        const double x = 10.0 * static_cast<double>(id);
+        row.insert(id, core::Box2{x, 0, x + 1, 1});
+    }
+    std::vector<core::EntityId> hits;
+    row.query_segment({100, 0.5}, {0, 0.5}, hits);
+    assert((hits == std::vector<core::EntityId>{5, 4, 3, 2, 1}));
+    hits.clear();
+    row.query_segment({0, 5}, {100, 5}, hits);
+    assert(hits.empty());
+
+    // Removing everything leaves an empty, reusable tree.
+    for (core::EntityId id = 1; id <= 5; ++id) assert(row.remove(id));
+    assert(row.empty() && !row.bounds(&all));
+    row.insert(9, core::Box2{0, 0, 1, 1});
+    assert(sorted_query(row, core::Box2{0, 0, 2, 2}) == std::vector<core::EntityId>{9});
+
+    // The document keeps its index in step with edits.
+    core::Document doc;
+    core::Polyline pl;
+    pl.points = {{0, 0}, {1, 1}};
+    const core::EntityId a = doc.add_polyline(pl);
+    const core::EntityId p = doc.add_point({50, 50});
+    assert(sorted_query(doc.spatial_index(), core::Box2{-1, -1, 2, 2}) == std::vector<core::EntityId>{a});
+    pl.points = {{100, 100}, {101, 101}};
+    doc.set_polyline_points(a, pl);
+    assert(sorted_query(doc.spatial_index(), core::Box2{-1, -1, 2, 2}).empty());
+    assert(sorted_query(doc.spatial_index(), core::Box2{99, 99, 102, 102}) == std::vector<core::EntityId>{a});
+    doc.remove_entity(p);
+    assert(doc.spatial_index().size() == 1);
+    doc.begin_transaction("remove");
+    doc.remove_entity(a);
+    doc.commit_transaction();
+    assert(doc.spatial_index().empty());
+    assert(doc.undo());
+    assert(doc.spatial_index().contains(a));
+    doc.clear();
+    assert(doc.spatial_index().empty());
+    return 0;
+}
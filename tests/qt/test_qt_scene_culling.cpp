@@ -0,0 +1,106 @@
+#include <QtGui/QGuiApplication>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <QtCore/QByteArray>
+
+#include <cassert>
+#include <string>
+
+#include "core/document.hpp"
+#include "core/geometry2d.hpp"
+#include "scene_renderer.hpp"
+
+static core::Polyline makeSegment(double x0, double y0, double x1, double y1) {
+    core::Polyline pl;
+    pl.points = {{x0, y0}, {x1, y1}};
+    return pl;
+}
+
+static core::Text makeText(double x, double y, const std::string& value) {
+    core::Text t;
+    t.pos = {x, y};
+    t.height = 8.0;
+    t.text = value;
+    return t;
+}
+
+static int countInkPixels(const QImage& img) {
+    int count = 0;
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            const QColor c(img.pixelColor(x, y));
+            if (c.red() > 24 || c.green() > 24 || c.blue() > 24) ++count;
+        }
+    }
+    return count;
+}
+
+static QImage render(const core::Document& doc, const scene_render::View& view,
+                     scene_render::RenderStats* stats) {
+    QImage img(200, 200, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    QPainter pr(&img);
+    const auto polylines = scene_render::buildPolyCache(doc);
+    scene_render::renderScene(pr, &doc, polylines, view, scene_render::LinetypeTable{},
+                              nullptr, false, stats);
+    pr.end();
+    return img;
+}
+
+int main(int argc, char** argv) {
+    qputenv("QT_QPA_PLATFORM", QByteArray("offscreen"));
+    QGuiApplication app(argc, argv);
+
+    // View maps world [0,200]x[0,200] onto the 200x200 image.
+    scene_render::View view;
+    view.scale = 1.0;
+    view.pan = QPointF(0.0, 200.0);
+
+    core::Document doc;
+    doc.add_polyline(makeSegment(20, 100, 180, 100), "visible");
+    doc.add_polyline(makeSegment(5000, 5000, 5100, 5000), "far");
+    // Horizontal line just below the view: only its pen can reach the edge.
+    doc.add_polyline(makeSegment(20, -0.5, 180, -0.5), "edge");
+    doc.add_polyline(makeSegment(50, 50, 50.2, 50.2), "tiny");
+    // Text anchored left of the view still spills into it and must be drawn.
+    doc.add_text(makeText(-10, 150, "SPILL"), "");
+    doc.add_text(makeText(9000, 9000, "GONE"), "");
+    core::Ellipse ell;
+    ell.center = {-4000, 100};
+    ell.rx = 10;
+    ell.ry = 5;
+    doc.add_ellipse(ell, "far ellipse");
+
+    scene_render::RenderStats full;
+    const QImage fullImg = render(doc, view, &full);
+    assert(full.culled == 3);
+    assert(full.drawn == 4);
+    assert(full.collapsed == 0);
+    assert(countInkPixels(fullImg) > 0);
+
+    // A second paint is served from the text caches and must be identical.
+    scene_render::RenderStats cached;
+    assert(render(doc, view, &cached) == fullImg);
+    assert(cached.drawn == full.drawn);
+
+    // LOD collapses the sub-pixel polyline to a dot.
+    scene_render::View lod = view;
+    lod.lodPixels = 2.0;
+    scene_render::RenderStats lodStats;
+    const QImage lodImg = render(doc, lod, &lodStats);
+    assert(lodStats.collapsed == 1);
+    assert(lodStats.drawn == 3);
+    assert(lodStats.culled == 3);
+    assert(countInkPixels(lodImg) > 0);
+
+    // Clip extents narrow the visible area.
+    scene_render::View clipped = view;
+    clipped.hasClip = true;
+    clipped.clipMinX = 0; clipped.clipMinY = 90;
+    clipped.clipMaxX = 200; clipped.clipMaxY = 110;
+    scene_render::RenderStats clipStats;
+    render(doc, clipped, &clipStats);
+    assert(clipStats.culled > full.culled);
+
+    return 0;
+}
@@ -896,9 +896,21 @@ static bool query_entity_meta_value(const cadgf_document* doc,
                                     cadgf_entity_id id,
                                     const char* suffix,
                                     std::string* out) {
-    if (!suffix || !*suffix) return false;
-    const std::string key = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + "." + suffix;
-    return query_doc_meta_value(doc, key, out);
+    if (!doc || !out || !suffix || !*suffix) return false;
+    int field = 0;
+    if (!cadgf_document_get_entity_attr_field(doc, suffix, &field)) return false;
+    int required = 0;
+    if (!cadgf_document_get_entity_attr_text(doc, id, field, nullptr, 0, &required) || required <= 0) {
+        return false;
+    }
+    std::vector<char> buf(static_cast<size_t>(required));
+    int required2 = 0;
+    if (!cadgf_document_get_entity_attr_text(doc, id, field, buf.data(), static_cast<int>(buf.size()), &required2)) {
+        return false;
+    }
+    if (!buf.empty() && buf.back() == 0) buf.pop_back();
+    *out = sanitize_utf8(std::string(buf.begin(), buf.end()));
+    return !out->empty();
 }
 
 static bool parse_meta_int(const std::string& value, int* out) {
@@ -937,15 +949,14 @@ static bool query_doc_meta_double(const cadgf_document* doc, const std::string&
     return query_doc_meta_value(doc, key, &value) && parse_meta_double(value, out);
 }
 
-static int query_entity_space(const cadgf_document* doc, cadgf_entity_id id) {
-    std::string value;
-    const std::string key = "dxf.entity." + std::to_string(static_cast<unsigned long long>(id)) + ".space";
-    if (!query_doc_meta_value(doc, key, &value)) return -1;
-    char* end = nullptr;
-    const long parsed = std::strtol(value.c_str(), &end, 10);
-    if (!end || end == value.c_str()) return -1;
-    if (parsed != 0 && parsed != 1) return -1;
-    return static_cast<int>(parsed);
+// Snapshot of every entity's core info in one call (linear time).
+static std::vector<cadgf_entity_record_v1> query_entity_records(const cadgf_document* doc) {
+    std::vector<cadgf_entity_record_v1> records;
+    int count = 0;
+    if (!cadgf_document_get_entities_v1(doc, nullptr, 0, &count) || count <= 0) return records;
+    records.resize(static_cast<size_t>(count));
+    if (!cadgf_document_get_entities_v1(doc, records.data(), count, &count)) records.clear();
+    return records;
 }
 
 static std::string query_entity_layout_name(const cadgf_document* doc, cadgf_entity_id id) {
@@ -958,29 +969,16 @@ static std::string query_entity_layout_name(const cadgf_document* doc, cadgf_ent
 
 static std::map<int, int> count_document_entities_by_space(const cadgf_document* doc) {
     std::map<int, int> counts;
-    int entity_count = 0;
-    if (!cadgf_document_get_entity_count(doc, &entity_count) || entity_count <= 0) {
-        return counts;
-    }
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        const int space = query_entity_space(doc, eid);
-        counts[space] += 1;
+    for (const auto& rec : query_entity_records(doc)) {
+        counts[rec.space] += 1;
     }
     return counts;
 }
 
 static std::map<std::string, int> count_document_entities_by_layout(const cadgf_document* doc) {
     std::map<std::string, int> counts;
-    int entity_count = 0;
-    if (!cadgf_document_get_entity_count(doc, &entity_count) || entity_count <= 0) {
-        return counts;
-    }
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        const std::string layout_name = query_entity_layout_name(doc, eid);
+    for (const auto& rec : query_entity_records(doc)) {
+        const std::string layout_name = query_entity_layout_name(doc, rec.id);
         if (layout_name.empty()) continue;
         counts[layout_name] += 1;
     }
@@ -1433,14 +1431,9 @@ static std::vector<InstanceMetadata> build_instance_metadata(const cadgf_documen
         if (acc.value.layoutName.empty()) acc.value.layoutName = layout_name;
     };
 
-    int entity_count = 0;
-    (void)cadgf_document_get_entity_count(doc, &entity_count);
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        cadgf_entity_info_v2 info_v2{};
-        if (!cadgf_document_get_entity_info_v2(doc, eid, &info_v2)) continue;
-        if (info_v2.group_id < 0) continue;
+    for (const auto& rec : query_entity_records(doc)) {
+        const cadgf_entity_id eid = rec.id;
+        if (rec.group_id < 0) continue;
         std::string block_name;
         if (!query_entity_meta_value(doc, eid, "block_name", &block_name) || block_name.empty()) continue;
         std::string source_type;
@@ -1450,9 +1443,8 @@ static std::vector<InstanceMetadata> build_instance_metadata(const cadgf_documen
         (void)query_entity_meta_value(doc, eid, "source_type", &source_type);
         (void)query_entity_meta_value(doc, eid, "edit_mode", &edit_mode);
         (void)query_entity_meta_value(doc, eid, "proxy_kind", &proxy_kind);
-        const int space = query_entity_space(doc, eid);
-        auto& acc = by_group[info_v2.group_id];
-        seed_from_values(acc, info_v2.group_id, block_name, source_type, edit_mode, proxy_kind, space, layout_name);
+        auto& acc = by_group[rec.group_id];
+        seed_from_values(acc, rec.group_id, block_name, source_type, edit_mode, proxy_kind, rec.space, layout_name);
         acc.value.documentEntityCount += 1;
         acc.value.entityIds.push_back(eid);
     }
@@ -1728,22 +1720,19 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
     }
     std::fprintf(f, "  ],\n");
 
-    int entity_count = 0;
-    (void)cadgf_document_get_entity_count(doc, &entity_count);
+    const std::vector<cadgf_entity_record_v1> records = query_entity_records(doc);
     std::unordered_map<std::string, int> derived_dimension_bundle_ids;
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        cadgf_entity_info_v2 info_v2{};
-        if (!cadgf_document_get_entity_info_v2(doc, eid, &info_v2) || info_v2.group_id < 0) continue;
+    for (const auto& rec : records) {
+        const cadgf_entity_id eid = rec.id;
+        if (rec.group_id < 0) continue;
         std::string source_type;
         if (!query_entity_meta_value(doc, eid, "source_type", &source_type) || source_type != "DIMENSION") continue;
         std::string block_name;
         if (!query_entity_meta_value(doc, eid, "block_name", &block_name) || block_name.empty()) continue;
-        const int entity_space = query_entity_space(doc, eid);
+        const int entity_space = rec.space;
         const std::string layout_name = query_entity_layout_name(doc, eid);
         std::string source_bundle_meta;
-        int source_bundle_id = info_v2.group_id;
+        int source_bundle_id = rec.group_id;
         if (query_entity_meta_value(doc, eid, "source_bundle_id", &source_bundle_meta)) {
             int parsed_source_bundle = 0;
             if (parse_meta_int(source_bundle_meta, &parsed_source_bundle)) {
@@ -1757,22 +1746,16 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
         }
     }
     std::vector<GuideExportEntity> guide_entities;
-    guide_entities.reserve(static_cast<size_t>(std::max(0, entity_count)));
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        cadgf_entity_info_v2 info_v2{};
-        cadgf_entity_info info{};
-        const bool got_info_v2 = cadgf_document_get_entity_info_v2(doc, eid, &info_v2) != 0;
-        const bool got_info = got_info_v2 || cadgf_document_get_entity_info(doc, eid, &info);
-        if (!got_info) continue;
+    guide_entities.reserve(records.size());
+    for (const auto& rec : records) {
+        const cadgf_entity_id eid = rec.id;
         std::string source_type;
         if (!query_entity_meta_value(doc, eid, "source_type", &source_type) || source_type.empty()) continue;
         GuideExportEntity entry{};
         entry.id = eid;
-        entry.type = got_info_v2 ? info_v2.type : info.type;
-        entry.groupId = got_info_v2 ? info_v2.group_id : -1;
-        entry.space = query_entity_space(doc, eid);
+        entry.type = rec.type;
+        entry.groupId = rec.group_id;
+        entry.space = rec.space;
         entry.layoutName = query_entity_layout_name(doc, eid);
         entry.sourceType = source_type;
         (void)query_entity_meta_value(doc, eid, "edit_mode", &entry.editMode);
@@ -1848,27 +1831,12 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
     }
 
     std::fprintf(f, "  \"entities\": [\n");
-    for (int i = 0; i < entity_count; ++i) {
-        cadgf_entity_id eid = 0;
-        if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-        cadgf_entity_info_v2 info_v2{};
-        cadgf_entity_info info{};
-        int entity_type = 0;
-        int layer_id = 0;
-        unsigned int entity_color = 0;
-        const bool got_info_v2 = cadgf_document_get_entity_info_v2(doc, eid, &info_v2) != 0;
-        if (got_info_v2) {
-            entity_type = info_v2.type;
-            layer_id = info_v2.layer_id;
-            entity_color = info_v2.color;
-        } else if (cadgf_document_get_entity_info(doc, eid, &info)) {
-            entity_type = info.type;
-            layer_id = info.layer_id;
-        }
-        cadgf_entity_info info_basic{};
-        info_basic.id = eid;
-        info_basic.type = entity_type;
-        info_basic.layer_id = layer_id;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const cadgf_entity_record_v1& rec = records[i];
+        const cadgf_entity_id eid = rec.id;
+        const int entity_type = rec.type;
+        const int layer_id = rec.layer_id;
+        const unsigned int entity_color = rec.color;
         const std::string name = query_entity_name_utf8(doc, eid);
         const std::string line_type = query_entity_line_type_utf8(doc, eid);
         const std::string color_source = query_entity_color_source_utf8(doc, eid);
@@ -1880,7 +1848,7 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
         const bool has_line_type = !line_type.empty();
         const bool has_color_aci = query_entity_color_aci(doc, eid, &color_aci);
         const bool has_color = entity_color != 0;
-        const int entity_space = query_entity_space(doc, eid);
+        const int entity_space = rec.space;
 
         std::fprintf(f, "    {\"id\": %llu, \"type\": %d, \"layer_id\": %d, \"name\": ",
                      static_cast<unsigned long long>(eid), entity_type, layer_id);
@@ -1898,8 +1866,8 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
         if (has_color) {
             std::fprintf(f, ", \"color\": %u", entity_color);
         }
-        if (got_info_v2 && info_v2.group_id >= 0) {
-            std::fprintf(f, ", \"group_id\": %d", info_v2.group_id);
+        if (rec.group_id >= 0) {
+            std::fprintf(f, ", \"group_id\": %d", rec.group_id);
         }
         if (!color_source.empty()) {
             std::fprintf(f, ", \"color_source\": ");
@@ -1960,7 +1928,7 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
             if (parse_meta_int(meta_value, &source_bundle_id)) {
                 std::fprintf(f, ", \"source_bundle_id\": %d", source_bundle_id);
             }
-        } else if (got_info_v2 && info_v2.group_id >= 0 &&
+        } else if (rec.group_id >= 0 &&
                    source_type_value == "DIMENSION" && !block_name_value.empty()) {
             const std::string bundle_key =
                 std::to_string(entity_space) + "|" + entity_layout + "|" + block_name_value;
@@ -2199,7 +2167,7 @@ static bool write_document_json(const cadgf_document* doc, const std::string& pa
             }
         }
 
-        std::fprintf(f, "}%s\n", (i + 1 < entity_count) ? "," : "");
+        std::fprintf(f, "}%s\n", (i + 1 < records.size()) ? "," : "");
     }
     std::fprintf(f, "  ]\n");
     std::fprintf(f, "}\n");
@@ -2515,9 +2483,9 @@ static void append_spline_lines(std::vector<float>& positions,
 }
 
 static void populate_slice_metadata(const cadgf_document* doc,
-                                    cadgf_entity_id id,
-                                    const cadgf_entity_info& info,
+                                    const cadgf_entity_record_v1& info,
                                     MeshSlice& slice) {
+    const cadgf_entity_id id = info.id;
     slice.id = id;
     slice.layerId = info.layer_id;
     slice.layerName = query_layer_name_utf8(doc, info.layer_id);
@@ -2550,14 +2518,11 @@ static void populate_slice_metadata(const cadgf_document* doc,
     slice.lineType = query_entity_line_type_utf8(doc, id);
     slice.colorSource = query_entity_color_source_utf8(doc, id);
     slice.hasColorAci = query_entity_color_aci(doc, id, &slice.colorAci);
-    cadgf_entity_info_v2 info_v2{};
-    if (cadgf_document_get_entity_info_v2(doc, id, &info_v2)) {
-        slice.groupId = info_v2.group_id;
-        slice.color = info_v2.color;
-    }
+    slice.groupId = info.group_id;
+    slice.color = info.color;
     (void)cadgf_document_get_entity_line_weight(doc, id, &slice.lineWeight);
     (void)cadgf_document_get_entity_line_type_scale(doc, id, &slice.lineTypeScale);
-    slice.space = query_entity_space(doc, id);
+    slice.space = info.space;
 }
 
 #if defined(CADGF_HAS_TINYGLTF)
@@ -3146,20 +3111,15 @@ int main(int argc, char** argv) {
         struct HatchGroup {
             std::vector<std::vector<cadgf_vec2>> rings;
             cadgf_entity_id owner_id = 0;
-            cadgf_entity_info owner_info{};
+            cadgf_entity_record_v1 owner_info{};
             bool has_owner = false;
         };
         std::unordered_map<std::string, HatchGroup> hatch_groups;
         const char* hatch_prefix = "__cadgf_hatch:";
         const bool line_only = opts.lineOnly;
-        int entity_count = 0;
-        (void)cadgf_document_get_entity_count(doc, &entity_count);
-        for (int i = 0; i < entity_count; ++i) {
-            cadgf_entity_id eid = 0;
-            if (!cadgf_document_get_entity_id_at(doc, i, &eid)) continue;
-            cadgf_entity_info info{};
-            (void)cadgf_document_get_entity_info(doc, eid, &info);
-            const cadgf_entity_info info_basic = info;
+        const std::vector<cadgf_entity_record_v1> records = query_entity_records(doc);
+        for (const auto& info : records) {
+            const cadgf_entity_id eid = info.id;
             const std::string name = query_entity_name_utf8(doc, eid);
 
             switch (info.type) {
@@ -3181,7 +3141,7 @@ int main(int argc, char** argv) {
                         static_cast<uint32_t>(line_indices.size()) - line_offset;
                     if (line_index_count > 0) {
                         MeshSlice line_slice{};
-                        populate_slice_metadata(doc, eid, info_basic, line_slice);
+                        populate_slice_metadata(doc, info, line_slice);
                         line_slice.baseVertex = line_base;
                         line_slice.vertexCount = line_vertex_count;
                         line_slice.indexOffset = line_offset;
@@ -3194,7 +3154,7 @@ int main(int argc, char** argv) {
                         auto& group = hatch_groups[name];
                         if (!group.has_owner) {
                             group.owner_id = eid;
-                            group.owner_info = info_basic;
+                            group.owner_info = info;
                             group.has_owner = true;
                         }
                         group.rings.push_back(pts);
@@ -3240,7 +3200,7 @@ int main(int argc, char** argv) {
                         }
 
                         MeshSlice slice;
-                        populate_slice_metadata(doc, eid, info_basic, slice);
+                        populate_slice_metadata(doc, info, slice);
                         slice.baseVertex = base;
                         slice.vertexCount = static_cast<uint32_t>(mesh_pts.size());
                         slice.indexOffset = index_offset;
@@ -3263,7 +3223,7 @@ int main(int argc, char** argv) {
                             static_cast<uint32_t>(line_indices.size()) - line_offset;
                         if (line_index_count > 0) {
                             MeshSlice line_slice{};
-                            populate_slice_metadata(doc, eid, info_basic, line_slice);
+                            populate_slice_metadata(doc, info, line_slice);
                             line_slice.baseVertex = line_base;
                             line_slice.vertexCount = line_vertex_count;
                             line_slice.indexOffset = line_offset;
@@ -3285,7 +3245,7 @@ int main(int argc, char** argv) {
                             static_cast<uint32_t>(line_indices.size()) - line_offset;
                         if (line_index_count > 0) {
                             MeshSlice line_slice{};
-                            populate_slice_metadata(doc, eid, info_basic, line_slice);
+                            populate_slice_metadata(doc, info, line_slice);
                             line_slice.baseVertex = line_base;
                             line_slice.vertexCount = line_vertex_count;
                             line_slice.indexOffset = line_offset;
@@ -3307,7 +3267,7 @@ int main(int argc, char** argv) {
                             static_cast<uint32_t>(line_indices.size()) - line_offset;
                         if (line_index_count > 0) {
                             MeshSlice line_slice{};
-                            populate_slice_metadata(doc, eid, info_basic, line_slice);
+                            populate_slice_metadata(doc, info, line_slice);
                             line_slice.baseVertex = line_base;
                             line_slice.vertexCount = line_vertex_count;
                             line_slice.indexOffset = line_offset;
@@ -3329,7 +3289,7 @@ int main(int argc, char** argv) {
                             static_cast<uint32_t>(line_indices.size()) - line_offset;
                         if (line_index_count > 0) {
                             MeshSlice line_slice{};
-                            populate_slice_metadata(doc, eid, info_basic, line_slice);
+                            populate_slice_metadata(doc, info, line_slice);
                             line_slice.baseVertex = line_base;
                             line_slice.vertexCount = line_vertex_count;
                             line_slice.indexOffset = line_offset;
@@ -3351,7 +3311,7 @@ int main(int argc, char** argv) {
                             static_cast<uint32_t>(line_indices.size()) - line_offset;
                         if (line_index_count > 0) {
                             MeshSlice line_slice{};
-                            populate_slice_metadata(doc, eid, info_basic, line_slice);
+                            populate_slice_metadata(doc, info, line_slice);
                             line_slice.baseVertex = line_base;
                             line_slice.vertexCount = line_vertex_count;
                             line_slice.indexOffset = line_offset;
@@ -3446,7 +3406,7 @@ int main(int argc, char** argv) {
                 }
 
                 MeshSlice slice;
-                populate_slice_metadata(doc, group.owner_id, group.owner_info, slice);
+                populate_slice_metadata(doc, group.owner_info, slice);
                 slice.baseVertex = base;
                 slice.vertexCount = static_cast<uint32_t>(flat.size());
                 slice.indexOffset = index_offset;
@@ -4,6 +4,14 @@
 #include <unordered_map>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "third_party/json.hpp"
 #include "core/solver.hpp"
@@ -16,7 +24,20 @@ struct VarStore {
     static std::string key(const VarRef& v){ return v.id + "." + v.key; }
 };
 
-static void usage(){ std::cerr << "Usage: solve_from_project [--json] <project.json>\n"; }
+static void usage(){
+    std::cerr << "Usage: solve_from_project [--json] [--diagnostics none|counts|structural|full] <project.json>\n"
+                 "       solve_from_project --batch <manifest|dir> [--jobs N] [--json] [--diagnostics ...]\n"
+                 "  --batch streams one NDJSON record per project (with --json: the full result).\n";
+}
+
+static bool parse_diagnostics_level(const std::string& name, SolverDiagnosticsLevel& level) {
+    if (name == "none") level = SolverDiagnosticsLevel::None;
+    else if (name == "counts") level = SolverDiagnosticsLevel::Counts;
+    else if (name == "structural") level = SolverDiagnosticsLevel::Structural;
+    else if (name == "full") level = SolverDiagnosticsLevel::Full;
+    else return false;
+    return true;
+}
 
 static json make_action_panel_json(const std::string& label,
                                    const std::string& hint,
@@ -109,26 +130,391 @@ static json make_action_panel_item_json(const std::string& id,
     return item;
 }
 
-int main(int argc, char** argv){
-    bool emit_json = false;
-    std::string input_path;
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
-        if (arg == "--json") {
-            emit_json = true;
-            continue;
+static json solve_result_json(const SolveResult& res, const VarStore& store) {
+    const json primary_conflict_action = make_action_panel_json(
+        res.analysis.primaryConflictActionLabel,
+        res.analysis.primaryConflictActionHint,
+        res.analysis.primaryConflictSelectionTag,
+        res.analysis.primaryConflictSelectionSummary,
+        res.analysis.primaryConflictSelectionExplanation,
+        res.analysis.primaryConflictAnchorConstraintIndex,
+        res.analysis.primaryConflictPriorityScore,
+        res.analysis.primaryConflictVariableKeys,
+        res.analysis.primaryConflictFreeVariableKeys,
+        res.analysis.primaryConflictSelectionPolicy);
+    const json smallest_conflict_action = make_action_panel_json(
+        res.analysis.smallestConflictActionLabel,
+        res.analysis.smallestConflictActionHint,
+        res.analysis.smallestConflictSelectionTag,
+        res.analysis.smallestConflictSelectionSummary,
+        res.analysis.smallestConflictSelectionExplanation,
+        res.analysis.smallestConflictGroupAnchorConstraintIndex,
+        conflict_priority_total(res.analysis.smallestConflictPriorityBreakdown),
+        res.analysis.smallestConflictVariableKeys,
+        res.analysis.smallestConflictFreeVariableKeys,
+        res.analysis.smallestConflictSelectionPolicy);
+    const json primary_redundancy_action = make_action_panel_json(
+        res.analysis.primaryRedundancyActionLabel,
+        res.analysis.primaryRedundancyActionHint,
+        res.analysis.primaryRedundancySelectionTag,
+        res.analysis.primaryRedundancySelectionSummary,
+        res.analysis.primaryRedundancySelectionExplanation,
+        res.analysis.primaryRedundancySubsetAnchorConstraintIndex,
+        res.analysis.primaryRedundancyPriorityScore,
+        res.analysis.primaryRedundancyVariableKeys,
+        {},
+        res.analysis.primaryRedundancySelectionPolicy);
+    const json smallest_redundancy_action = make_action_panel_json(
+        res.analysis.smallestRedundancyActionLabel,
+        res.analysis.smallestRedundancyActionHint,
+        res.analysis.smallestRedundancySelectionTag,
+        res.analysis.smallestRedundancySelectionSummary,
+        res.analysis.smallestRedundancySelectionExplanation,
+        res.analysis.smallestRedundancySubsetAnchorConstraintIndex,
+        redundancy_priority_total(res.analysis.smallestRedundancyPriorityBreakdown),
+        res.analysis.smallestRedundancyVariableKeys,
+        {},
+        res.analysis.smallestRedundancySelectionPolicy);
+    json action_panels = json::array({
+        make_action_panel_item_json(
+            "primary_conflict",
+            "conflict",
+            "primary",
+            primary_conflict_action,
+            res.primaryConflictConstraintIndices,
+            {},
+            {}),
+        make_action_panel_item_json(
+            "smallest_conflict",
+            "conflict",
+            "smallest",
+            smallest_conflict_action,
+            res.smallestConflictConstraintIndices,
+            {},
+            {}),
+        make_action_panel_item_json(
+            "primary_redundancy",
+            "redundancy",
+            "primary",
+            primary_redundancy_action,
+            concat_constraint_indices(
+                res.primaryRedundancyBasisConstraintIndices,
+                res.primaryRedundantConstraintIndices),
+            res.primaryRedundancyBasisConstraintIndices,
+            res.primaryRedundantConstraintIndices),
+        make_action_panel_item_json(
+            "smallest_redundancy",
+            "redundancy",
+            "smallest",
+            smallest_redundancy_action,
+            concat_constraint_indices(
+                res.smallestRedundancyBasisConstraintIndices,
+                res.smallestRedundantConstraintIndices),
+            res.smallestRedundancyBasisConstraintIndices,
+            res.smallestRedundantConstraintIndices),
+    });
+    json out = {
+        {"ok", res.ok},
+        {"iterations", res.iterations},
+        {"final_error", res.finalError},
+        {"message", res.message},
+    };
+    out["analysis"] = {
+        {"constraint_count", res.analysis.constraintCount},
+        {"referenced_variable_count", res.analysis.referencedVariableCount},
+        {"bound_variable_count", res.analysis.boundVariableCount},
+        {"well_formed_constraint_count", res.analysis.wellFormedConstraintCount},
+        {"unique_constraint_count", res.analysis.uniqueConstraintCount},
+        {"duplicate_constraint_count", res.analysis.duplicateConstraintCount},
+        {"duplicate_constraint_group_count", res.analysis.duplicateConstraintGroupCount},
+        {"largest_duplicate_constraint_group_size", res.analysis.largestDuplicateConstraintGroupSize},
+        {"structural_diagnostic_count", res.analysis.structuralDiagnosticCount},
+        {"binding_diagnostic_count", res.analysis.bindingDiagnosticCount},
+        {"evaluable_constraint_count", res.analysis.evaluableConstraintCount},
+        {"jacobian_row_count", res.analysis.jacobianRowCount},
+        {"jacobian_column_count", res.analysis.jacobianColumnCount},
+        {"jacobian_rank", res.analysis.jacobianRank},
+        {"dof_estimate", res.analysis.dofEstimate},
+        {"redundant_constraint_estimate", res.analysis.redundantConstraintEstimate},
+        {"structural_state", constraintStructuralStateName(res.analysis.structuralState)},
+        {"structural_group_count", res.analysis.structuralGroupCount},
+        {"unknown_group_count", res.analysis.unknownGroupCount},
+        {"underconstrained_group_count", res.analysis.underconstrainedGroupCount},
+        {"well_constrained_group_count", res.analysis.wellConstrainedGroupCount},
+        {"overconstrained_group_count", res.analysis.overconstrainedGroupCount},
+        {"mixed_group_count", res.analysis.mixedGroupCount},
+        {"conflict_group_count", res.analysis.conflictGroupCount},
+        {"largest_conflict_group_size", res.analysis.largestConflictGroupSize},
+        {"redundancy_subset_count", res.analysis.redundancySubsetCount},
+        {"redundant_constraint_candidate_count", res.analysis.redundantConstraintCandidateCount},
+        {"free_variable_candidate_count", res.analysis.freeVariableCandidateCount},
+        {"problematic_constraint_count", res.analysis.problematicConstraintCount},
+        {"primary_conflict_anchor_constraint_index", res.analysis.primaryConflictAnchorConstraintIndex},
+        {"primary_conflict_priority_score", res.analysis.primaryConflictPriorityScore},
+        {"primary_conflict_priority_breakdown", {
+            {"state_bias", res.analysis.primaryConflictPriorityBreakdown.stateBias},
+            {"redundant_constraint_contribution", res.analysis.primaryConflictPriorityBreakdown.redundantConstraintContribution},
+            {"constraint_count_contribution", res.analysis.primaryConflictPriorityBreakdown.constraintCountContribution},
+            {"free_variable_contribution", res.analysis.primaryConflictPriorityBreakdown.freeVariableContribution},
+            {"dof_contribution", res.analysis.primaryConflictPriorityBreakdown.dofContribution}
+        }},
+        {"primary_conflict_selection_explanation", res.analysis.primaryConflictSelectionExplanation},
+        {"primary_conflict_selection_tag", res.analysis.primaryConflictSelectionTag},
+        {"primary_conflict_selection_summary", res.analysis.primaryConflictSelectionSummary},
+        {"primary_conflict_action_label", res.analysis.primaryConflictActionLabel},
+        {"primary_conflict_action_hint", res.analysis.primaryConflictActionHint},
+        {"primary_conflict_action", primary_conflict_action},
+        {"primary_conflict_variable_keys", res.analysis.primaryConflictVariableKeys},
+        {"primary_conflict_free_variable_keys", res.analysis.primaryConflictFreeVariableKeys},
+        {"primary_conflict_selection_policy", res.analysis.primaryConflictSelectionPolicy},
+        {"smallest_conflict_group_anchor_constraint_index", res.analysis.smallestConflictGroupAnchorConstraintIndex},
+        {"smallest_conflict_group_size", res.analysis.smallestConflictGroupSize},
+        {"smallest_conflict_priority_breakdown", {
+            {"state_bias", res.analysis.smallestConflictPriorityBreakdown.stateBias},
+            {"redundant_constraint_contribution", res.analysis.smallestConflictPriorityBreakdown.redundantConstraintContribution},
+            {"constraint_count_contribution", res.analysis.smallestConflictPriorityBreakdown.constraintCountContribution},
+            {"free_variable_contribution", res.analysis.smallestConflictPriorityBreakdown.freeVariableContribution},
+            {"dof_contribution", res.analysis.smallestConflictPriorityBreakdown.dofContribution}
+        }},
+        {"smallest_conflict_selection_explanation", res.analysis.smallestConflictSelectionExplanation},
+        {"smallest_conflict_selection_tag", res.analysis.smallestConflictSelectionTag},
+        {"smallest_conflict_selection_summary", res.analysis.smallestConflictSelectionSummary},
+        {"smallest_conflict_action_label", res.analysis.smallestConflictActionLabel},
+        {"smallest_conflict_action_hint", res.analysis.smallestConflictActionHint},
+        {"smallest_conflict_action", smallest_conflict_action},
+        {"smallest_conflict_variable_keys", res.analysis.smallestConflictVariableKeys},
+        {"smallest_conflict_free_variable_keys", res.analysis.smallestConflictFreeVariableKeys},
+        {"smallest_conflict_selection_policy", res.analysis.smallestConflictSelectionPolicy},
+        {"primary_redundancy_subset_anchor_constraint_index", res.analysis.primaryRedundancySubsetAnchorConstraintIndex},
+        {"primary_redundancy_priority_score", res.analysis.primaryRedundancyPriorityScore},
+        {"primary_redundancy_priority_breakdown", {
+            {"redundant_constraint_contribution", res.analysis.primaryRedundancyPriorityBreakdown.redundantConstraintContribution},
+            {"witness_penalty", res.analysis.primaryRedundancyPriorityBreakdown.witnessPenalty}
+        }},
+        {"primary_redundancy_selection_explanation", res.analysis.primaryRedundancySelectionExplanation},
+        {"primary_redundancy_selection_tag", res.analysis.primaryRedundancySelectionTag},
+        {"primary_redundancy_selection_summary", res.analysis.primaryRedundancySelectionSummary},
+        {"primary_redundancy_action_label", res.analysis.primaryRedundancyActionLabel},
+        {"primary_redundancy_action_hint", res.analysis.primaryRedundancyActionHint},
+        {"primary_redundancy_action", primary_redundancy_action},
+        {"primary_redundancy_variable_keys", res.analysis.primaryRedundancyVariableKeys},
+        {"primary_redundancy_selection_policy", res.analysis.primaryRedundancySelectionPolicy},
+        {"smallest_redundancy_subset_anchor_constraint_index", res.analysis.smallestRedundancySubsetAnchorConstraintIndex},
+        {"smallest_redundancy_witness_constraint_count", res.analysis.smallestRedundancyWitnessConstraintCount},
+        {"smallest_redundancy_priority_breakdown", {
+            {"redundant_constraint_contribution", res.analysis.smallestRedundancyPriorityBreakdown.redundantConstraintContribution},
+            {"witness_penalty", res.analysis.smallestRedundancyPriorityBreakdown.witnessPenalty}
+        }},
+        {"smallest_redundancy_selection_explanation", res.analysis.smallestRedundancySelectionExplanation},
+        {"smallest_redundancy_selection_tag", res.analysis.smallestRedundancySelectionTag},
+        {"smallest_redundancy_selection_summary", res.analysis.smallestRedundancySelectionSummary},
+        {"smallest_redundancy_action_label", res.analysis.smallestRedundancyActionLabel},
+        {"smallest_redundancy_action_hint", res.analysis.smallestRedundancyActionHint},
+        {"smallest_redundancy_action", smallest_redundancy_action},
+        {"smallest_redundancy_variable_keys", res.analysis.smallestRedundancyVariableKeys},
+        {"smallest_redundancy_selection_policy", res.analysis.smallestRedundancySelectionPolicy},
+        {"action_panel_count", static_cast<int>(action_panels.size())},
+        {"action_panels", action_panels},
+    };
+    out["structural_summary"] = {
+        {"state", constraintStructuralStateName(res.analysis.structuralState)},
+        {"dof_estimate", res.analysis.dofEstimate},
+        {"redundant_constraint_estimate", res.analysis.redundantConstraintEstimate},
+        {"duplicate_constraint_group_count", res.analysis.duplicateConstraintGroupCount},
+        {"largest_duplicate_constraint_group_size", res.analysis.largestDuplicateConstraintGroupSize},
+        {"structural_group_count", res.analysis.structuralGroupCount},
+        {"underconstrained_group_count", res.analysis.underconstrainedGroupCount},
+        {"well_constrained_group_count", res.analysis.wellConstrainedGroupCount},
+        {"overconstrained_group_count", res.analysis.overconstrainedGroupCount},
+        {"mixed_group_count", res.analysis.mixedGroupCount},
+        {"conflict_group_count", res.analysis.conflictGroupCount},
+        {"largest_conflict_group_size", res.analysis.largestConflictGroupSize},
+        {"redundancy_subset_count", res.analysis.redundancySubsetCount},
+        {"redundant_constraint_candidate_count", res.analysis.redundantConstraintCandidateCount},
+        {"free_variable_candidate_count", res.analysis.freeVariableCandidateCount},
+        {"problematic_constraint_count", res.analysis.problematicConstraintCount},
+        {"primary_conflict_anchor_constraint_index", res.analysis.primaryConflictAnchorConstraintIndex},
+        {"primary_conflict_priority_score", res.analysis.primaryConflictPriorityScore},
+        {"primary_conflict_priority_breakdown", {
+            {"state_bias", res.analysis.primaryConflictPriorityBreakdown.stateBias},
+            {"redundant_constraint_contribution", res.analysis.primaryConflictPriorityBreakdown.redundantConstraintContribution},
+            {"constraint_count_contribution", res.analysis.primaryConflictPriorityBreakdown.constraintCountContribution},
+            {"free_variable_contribution", res.analysis.primaryConflictPriorityBreakdown.freeVariableContribution},
+            {"dof_contribution", res.analysis.primaryConflictPriorityBreakdown.dofContribution}
+        }},
+        {"primary_conflict_selection_explanation", res.analysis.primaryConflictSelectionExplanation},
+        {"primary_conflict_selection_tag", res.analysis.primaryConflictSelectionTag},
+        {"primary_conflict_selection_summary", res.analysis.primaryConflictSelectionSummary},
+        {"primary_conflict_action_label", res.analysis.primaryConflictActionLabel},
+        {"primary_conflict_action_hint", res.analysis.primaryConflictActionHint},
+        {"primary_conflict_action", primary_conflict_action},
+        {"primary_conflict_variable_keys", res.analysis.primaryConflictVariableKeys},
+        {"primary_conflict_free_variable_keys", res.analysis.primaryConflictFreeVariableKeys},
+        {"primary_conflict_selection_policy", res.analysis.primaryConflictSelectionPolicy},
+        {"smallest_conflict_group_anchor_constraint_index", res.analysis.smallestConflictGroupAnchorConstraintIndex},
+        {"smallest_conflict_group_size", res.analysis.smallestConflictGroupSize},
+        {"smallest_conflict_priority_breakdown", {
+            {"state_bias", res.analysis.smallestConflictPriorityBreakdown.stateBias},
+            {"redundant_constraint_contribution", res.analysis.smallestConflictPriorityBreakdown.redundantConstraintContribution},
+            {"constraint_count_contribution", res.analysis.smallestConflictPriorityBreakdown.constraintCountContribution},
+            {"free_variable_contribution", res.analysis.smallestConflictPriorityBreakdown.freeVariableContribution},
+            {"dof_contribution", res.analysis.smallestConflictPriorityBreakdown.dofContribution}
+        }},
+        {"smallest_conflict_selection_explanation", res.analysis.smallestConflictSelectionExplanation},
+        {"smallest_conflict_selection_tag", res.analysis.smallestConflictSelectionTag},
+        {"smallest_conflict_selection_summary", res.analysis.smallestConflictSelectionSummary},
+        {"smallest_conflict_action_label", res.analysis.smallestConflictActionLabel},
+        {"smallest_conflict_action_hint", res.analysis.smallestConflictActionHint},
+        {"smallest_conflict_action", smallest_conflict_action},
+        {"smallest_conflict_variable_keys", res.analysis.smallestConflictVariableKeys},
+        {"smallest_conflict_free_variable_keys", res.analysis.smallestConflictFreeVariableKeys},
+        {"smallest_conflict_selection_policy", res.analysis.smallestConflictSelectionPolicy},
+        {"primary_redundancy_subset_anchor_constraint_index", res.analysis.primaryRedundancySubsetAnchorConstraintIndex},
+        {"primary_redundancy_priority_score", res.analysis.primaryRedundancyPriorityScore},
+        {"primary_redundancy_priority_breakdown", {
+            {"redundant_constraint_contribution", res.analysis.primaryRedundancyPriorityBreakdown.redundantConstraintContribution},
+            {"witness_penalty", res.analysis.primaryRedundancyPriorityBreakdown.witnessPenalty}
+        }},
+        {"primary_redundancy_selection_explanation", res.analysis.primaryRedundancySelectionExplanation},
+        {"primary_redundancy_selection_tag", res.analysis.primaryRedundancySelectionTag},
+        {"primary_redundancy_selection_summary", res.analysis.primaryRedundancySelectionSummary},
+        {"primary_redundancy_action_label", res.analysis.primaryRedundancyActionLabel},
+        {"primary_redundancy_action_hint", res.analysis.primaryRedundancyActionHint},
+        {"primary_redundancy_action", primary_redundancy_action},
+        {"primary_redundancy_variable_keys", res.analysis.primaryRedundancyVariableKeys},
+        {"primary_redundancy_selection_policy", res.analysis.primaryRedundancySelectionPolicy},
+        {"smallest_redundancy_subset_anchor_constraint_index", res.analysis.smallestRedundancySubsetAnchorConstraintIndex},
+        {"smallest_redundancy_witness_constraint_count", res.analysis.smallestRedundancyWitnessConstraintCount},
+        {"smallest_redundancy_priority_breakdown", {
+            {"redundant_constraint_contribution", res.analysis.smallestRedundancyPriorityBreakdown.redundantConstraintContribution},
+            {"witness_penalty", res.analysis.smallestRedundancyPriorityBreakdown.witnessPenalty}
+        }},
+        {"smallest_redundancy_selection_explanation", res.analysis.smallestRedundancySelectionExplanation},
+        {"smallest_redundancy_selection_tag", res.analysis.smallestRedundancySelectionTag},
+        {"smallest_redundancy_selection_summary", res.analysis.smallestRedundancySelectionSummary},
+        {"smallest_redundancy_action_label", res.analysis.smallestRedundancyActionLabel},
+        {"smallest_redundancy_action_hint", res.analysis.smallestRedundancyActionHint},
+        {"smallest_redundancy_action", smallest_redundancy_action},
+        {"smallest_redundancy_variable_keys", res.analysis.smallestRedundancyVariableKeys},
+        {"smallest_redundancy_selection_policy", res.analysis.smallestRedundancySelectionPolicy},
+        {"action_panel_count", static_cast<int>(action_panels.size())},
+        {"action_panels", action_panels},
+    };
+    out["problematic_constraint_indices"] = res.problematicConstraintIndices;
+    out["primary_conflict_constraint_indices"] = res.primaryConflictConstraintIndices;
+    out["smallest_conflict_constraint_indices"] = res.smallestConflictConstraintIndices;
+    out["primary_redundancy_basis_constraint_indices"] = res.primaryRedundancyBasisConstraintIndices;
+    out["primary_redundant_constraint_indices"] = res.primaryRedundantConstraintIndices;
+    out["smallest_redundancy_basis_constraint_indices"] = res.smallestRedundancyBasisConstraintIndices;
+    out["smallest_redundant_constraint_indices"] = res.smallestRedundantConstraintIndices;
+    out["redundancy_groups"] = json::array();
+    for (const auto& group : res.redundancyGroups) {
+        out["redundancy_groups"].push_back({
+            {"anchor_constraint_index", group.anchorConstraintIndex},
+            {"kind", constraintKindName(group.kind)},
+            {"type", group.type},
+            {"constraint_indices", group.constraintIndices},
+            {"group_size", static_cast<int>(group.constraintIndices.size())},
+            {"redundant_count", std::max(0, static_cast<int>(group.constraintIndices.size()) - 1)}
+        });
+    }
+    out["structural_groups"] = json::array();
+    for (const auto& group : res.structuralGroups) {
+        out["structural_groups"].push_back({
+            {"anchor_constraint_index", group.anchorConstraintIndex},
+            {"constraint_indices", group.constraintIndices},
+            {"variable_keys", group.variableKeys},
+            {"basis_variable_keys", group.basisVariableKeys},
+            {"free_variable_keys", group.freeVariableKeys},
+            {"jacobian_row_count", group.jacobianRowCount},
+            {"jacobian_column_count", group.jacobianColumnCount},
+            {"jacobian_rank", group.jacobianRank},
+            {"dof_estimate", group.dofEstimate},
+            {"redundant_constraint_estimate", group.redundantConstraintEstimate},
+            {"priority_score", group.priorityScore},
+            {"state", constraintStructuralStateName(group.structuralState)}
+        });
+    }
+    out["conflict_groups"] = json::array();
+    for (const auto& group : res.conflictGroups) {
+        out["conflict_groups"].push_back({
+            {"anchor_constraint_index", group.anchorConstraintIndex},
+            {"constraint_indices", group.constraintIndices},
+            {"variable_keys", group.variableKeys},
+            {"basis_variable_keys", group.basisVariableKeys},
+            {"free_variable_keys", group.freeVariableKeys},
+            {"jacobian_rank", group.jacobianRank},
+            {"dof_estimate", group.dofEstimate},
+            {"redundant_constraint_estimate", group.redundantConstraintEstimate},
+            {"priority_score", group.priorityScore},
+            {"priority_breakdown", {
+                {"state_bias", group.priorityStateBias},
+                {"redundant_constraint_contribution", group.priorityRedundantConstraintContribution},
+                {"constraint_count_contribution", group.priorityConstraintCountContribution},
+                {"free_variable_contribution", group.priorityFreeVariableContribution},
+                {"dof_contribution", group.priorityDofContribution}
+            }},
+            {"state", constraintStructuralStateName(group.structuralState)}
+        });
+    }
+    out["redundancy_subsets"] = json::array();
+    for (const auto& subset : res.redundancySubsets) {
+        out["redundancy_subsets"].push_back({
+            {"anchor_constraint_index", subset.anchorConstraintIndex},
+            {"basis_constraint_indices", subset.basisConstraintIndices},
+            {"redundant_constraint_indices", subset.redundantConstraintIndices},
+            {"variable_keys", subset.variableKeys},
+            {"jacobian_rank", subset.jacobianRank},
+            {"witness_constraint_count", subset.witnessConstraintCount},
+            {"priority_score", subset.priorityScore},
+            {"priority_breakdown", {
+                {"redundant_constraint_contribution", subset.priorityRedundantConstraintContribution},
+                {"witness_penalty", subset.priorityWitnessPenalty}
+            }},
+            {"state", constraintStructuralStateName(subset.structuralState)}
+        });
+    }
+    out["diagnostics"] = json::array();
+    for (const auto& diag : res.diagnostics) {
+        json item = {
+            {"constraint_index", diag.constraintIndex},
+            {"type", diag.type},
+            {"kind", constraintKindName(diag.kind)},
+            {"code", constraintDiagnosticCodeName(diag.code)},
+            {"detail", diag.detail},
+        };
+        if (diag.relatedConstraintIndex >= 0) {
+            item["related_constraint_index"] = diag.relatedConstraintIndex;
         }
-        if (!input_path.empty()) { usage(); return 2; }
-        input_path = arg;
+        out["diagnostics"].push_back(std::move(item));
     }
-    if (input_path.empty()) { usage(); return 2; }
-
-    std::ifstream f(input_path);
-    if (!f.is_open()) { std::cerr << "Open failed: " << input_path << "\n"; return 2; }
-    json proj; f >> proj;
+    out["presolved_constraints"] = json::array();
+    for (const auto& presolved : res.presolvedConstraints) {
+        out["presolved_constraints"].push_back({
+            {"constraint_index", presolved.constraintIndex},
+            {"action", presolveActionName(presolved.action)},
+            {"variable_key", presolved.variableKey}
+        });
+    }
+    json vars = json::object();
+    for (const auto& kv : store.vars) vars[kv.first] = kv.second;
+    out["vars"] = vars;
+    return out;
+}
 
-    VarStore store;
-    std::vector<ConstraintSpec> specs;
+// Reads the points and constraints of a project file. Returns false with
+// `error` set when the file cannot be opened or parsed.
+static bool load_project(const std::string& path, VarStore& store,
+                         std::vector<ConstraintSpec>& specs, std::string& error) {
+    std::ifstream f(path);
+    if (!f.is_open()) { error = "Open failed: " + path; return false; }
+    json proj;
+    try {
+        f >> proj;
+    } catch (const json::exception& e) {
+        error = "Parse failed: " + path + ": " + e.what();
+        return false;
+    }
 
     // Map points
     if (proj.contains("scene") && proj["scene"].contains("entities")){
@@ -163,379 +549,162 @@ int main(int argc, char** argv){
             specs.push_back(std::move(s));
         }
     }
+    return true;
+}
 
+static ISolver* create_project_solver(SolverDiagnosticsLevel diagnostics_level) {
+    ISolver* solver = createMinimalSolver();
+    solver->setMaxIterations(100);
+    solver->setTolerance(1e-6);
+    solver->setDiagnosticsLevel(diagnostics_level);
+    return solver;
+}
+
+static SolveResult solve_project(ISolver& solver, std::vector<ConstraintSpec>& specs, VarStore& store) {
     auto get = [&](const VarRef& v, bool& ok)->double{
         auto it = store.vars.find(VarStore::key(v));
         if (it == store.vars.end()) { ok=false; return 0.0; }
         ok=true; return it->second;
     };
     auto set = [&](const VarRef& v, double val){ store.vars[VarStore::key(v)] = val; };
+    return solver.solveWithBindings(specs, get, set);
+}
 
-    ISolver* solver = createMinimalSolver();
-    solver->setMaxIterations(100);
-    solver->setTolerance(1e-6);
-    SolveResult res = solver->solveWithBindings(specs, get, set);
-    if (emit_json) {
-        const json primary_conflict_action = make_action_panel_json(
-            res.analysis.primaryConflictActionLabel,
-            res.analysis.primaryConflictActionHint,
-            res.analysis.primaryConflictSelectionTag,
-            res.analysis.primaryConflictSelectionSummary,
-            res.analysis.primaryConflictSelectionExplanation,
-            res.analysis.primaryConflictAnchorConstraintIndex,
-            res.analysis.primaryConflictPriorityScore,
-            res.analysis.primaryConflictVariableKeys,
-            res.analysis.primaryConflictFreeVariableKeys,
-            res.analysis.primaryConflictSelectionPolicy);
-        const json smallest_conflict_action = make_action_panel_json(
-            res.analysis.smallestConflictActionLabel,
-            res.analysis.smallestConflictActionHint,
-            res.analysis.smallestConflictSelectionTag,
-            res.analysis.smallestConflictSelectionSummary,
-            res.analysis.smallestConflictSelectionExplanation,
-            res.analysis.smallestConflictGroupAnchorConstraintIndex,
-            conflict_priority_total(res.analysis.smallestConflictPriorityBreakdown),
-            res.analysis.smallestConflictVariableKeys,
-            res.analysis.smallestConflictFreeVariableKeys,
-            res.analysis.smallestConflictSelectionPolicy);
-        const json primary_redundancy_action = make_action_panel_json(
-            res.analysis.primaryRedundancyActionLabel,
-            res.analysis.primaryRedundancyActionHint,
-            res.analysis.primaryRedundancySelectionTag,
-            res.analysis.primaryRedundancySelectionSummary,
-            res.analysis.primaryRedundancySelectionExplanation,
-            res.analysis.primaryRedundancySubsetAnchorConstraintIndex,
-            res.analysis.primaryRedundancyPriorityScore,
-            res.analysis.primaryRedundancyVariableKeys,
-            {},
-            res.analysis.primaryRedundancySelectionPolicy);
-        const json smallest_redundancy_action = make_action_panel_json(
-            res.analysis.smallestRedundancyActionLabel,
-            res.analysis.smallestRedundancyActionHint,
-            res.analysis.smallestRedundancySelectionTag,
-            res.analysis.smallestRedundancySelectionSummary,
-            res.analysis.smallestRedundancySelectionExplanation,
-            res.analysis.smallestRedundancySubsetAnchorConstraintIndex,
-            redundancy_priority_total(res.analysis.smallestRedundancyPriorityBreakdown),
-            res.analysis.smallestRedundancyVariableKeys,
-            {},
-            res.analysis.smallestRedundancySelectionPolicy);
-        json action_panels = json::array({
-            make_action_panel_item_json(
-                "primary_conflict",
-                "conflict",
-                "primary",
-                primary_conflict_action,
-                res.primaryConflictConstraintIndices,
-                {},
-                {}),
-            make_action_panel_item_json(
-                "smallest_conflict",
-                "conflict",
-                "smallest",
-                smallest_conflict_action,
-                res.smallestConflictConstraintIndices,
-                {},
-                {}),
-            make_action_panel_item_json(
-                "primary_redundancy",
-                "redundancy",
-                "primary",
-                primary_redundancy_action,
-                concat_constraint_indices(
-                    res.primaryRedundancyBasisConstraintIndices,
-                    res.primaryRedundantConstraintIndices),
-                res.primaryRedundancyBasisConstraintIndices,
-                res.primaryRedundantConstraintIndices),
-            make_action_panel_item_json(
-                "smallest_redundancy",
-                "redundancy",
-                "smallest",
-                smallest_redundancy_action,
-                concat_constraint_indices(
-                    res.smallestRedundancyBasisConstraintIndices,
-                    res.smallestRedundantConstraintIndices),
-                res.smallestRedundancyBasisConstraintIndices,
-                res.smallestRedundantConstraintIndices),
-        });
-        json out = {
-            {"ok", res.ok},
-            {"iterations", res.iterations},
-            {"final_error", res.finalError},
-            {"message", res.message},
-        };
-        out["analysis"] = {
-            {"constraint_count", res.analysis.constraintCount},
-            {"referenced_variable_count", res.analysis.referencedVariableCount},
-            {"bound_variable_count", res.analysis.boundVariableCount},
-            {"well_formed_constraint_count", res.analysis.wellFormedConstraintCount},
-            {"unique_constraint_count", res.analysis.uniqueConstraintCount},
-            {"duplicate_constraint_count", res.analysis.duplicateConstraintCount},
-            {"duplicate_constraint_group_count", res.analysis.duplicateConstraintGroupCount},
-            {"largest_duplicate_constraint_group_size", res.analysis.largestDuplicateConstraintGroupSize},
-            {"structural_diagnostic_count", res.analysis.structuralDiagnosticCount},
-            {"binding_diagnostic_count", res.analysis.bindingDiagnosticCount},
-            {"evaluable_constraint_count", res.analysis.evaluableConstraintCount},
-            {"jacobian_row_count", res.analysis.jacobianRowCount},
-            {"jacobian_column_count", res.analysis.jacobianColumnCount},
-            {"jacobian_rank", res.analysis.jacobianRank},
-            {"dof_estimate", res.analysis.dofEstimate},
-            {"redundant_constraint_estimate", res.analysis.redundantConstraintEstimate},
-            {"structural_state", constraintStructuralStateName(res.analysis.structuralState)},
-            {"structural_group_count", res.analysis.structuralGroupCount},
-            {"unknown_group_count", res.analysis.unknownGroupCount},
-            {"underconstrained_group_count", res.analysis.underconstrainedGroupCount},
-            {"well_constrained_group_count", res.analysis.wellConstrainedGroupCount},
-            {"overconstrained_group_count", res.analysis.overconstrainedGroupCount},
-            {"mixed_group_count", res.analysis.mixedGroupCount},
-            {"conflict_group_count", res.analysis.conflictGroupCount},
-            {"largest_conflict_group_size", res.analysis.largestConflictGroupSize},
-            {"redundancy_subset_count", res.analysis.redundancySubsetCount},
-            {"redundant_constraint_candidate_count", res.analysis.redundantConstraintCandidateCount},
-            {"free_variable_candidate_count", res.analysis.freeVariableCandidateCount},
-            {"problematic_constraint_count", res.analysis.problematicConstraintCount},
-            {"primary_conflict_anchor_constraint_index", res.analysis.primaryConflictAnchorConstraintIndex},
-            {"primary_conflict_priority_score", res.analysis.primaryConflictPriorityScore},
-            {"primary_conflict_priority_breakdown", {
-                {"state_bias", res.analysis.primaryConflictPriorityBreakdown.stateBias},
-                {"redundant_constraint_contribution", res.analysis.primaryConflictPriorityBreakdown.redundantConstraintContribution},
-                {"constraint_count_contribution", res.analysis.primaryConflictPriorityBreakdown.constraintCountContribution},
-                {"free_variable_contribution", res.analysis.primaryConflictPriorityBreakdown.freeVariableContribution},
-                {"dof_contribution", res.analysis.primaryConflictPriorityBreakdown.dofContribution}
-            }},
-            {"primary_conflict_selection_explanation", res.analysis.primaryConflictSelectionExplanation},
-            {"primary_conflict_selection_tag", res.analysis.primaryConflictSelectionTag},
-            {"primary_conflict_selection_summary", res.analysis.primaryConflictSelectionSummary},
-            {"primary_conflict_action_label", res.analysis.primaryConflictActionLabel},
-            {"primary_conflict_action_hint", res.analysis.primaryConflictActionHint},
-            {"primary_conflict_action", primary_conflict_action},
-            {"primary_conflict_variable_keys", res.analysis.primaryConflictVariableKeys},
-            {"primary_conflict_free_variable_keys", res.analysis.primaryConflictFreeVariableKeys},
-            {"primary_conflict_selection_policy", res.analysis.primaryConflictSelectionPolicy},
-            {"smallest_conflict_group_anchor_constraint_index", res.analysis.smallestConflictGroupAnchorConstraintIndex},
-            {"smallest_conflict_group_size", res.analysis.smallestConflictGroupSize},
-            {"smallest_conflict_priority_breakdown", {
-                {"state_bias", res.analysis.smallestConflictPriorityBreakdown.stateBias},
-                {"redundant_constraint_contribution", res.analysis.smallestConflictPriorityBreakdown.redundantConstraintContribution},
-                {"constraint_count_contribution", res.analysis.smallestConflictPriorityBreakdown.constraintCountContribution},
-                {"free_variable_contribution", res.analysis.smallestConflictPriorityBreakdown.freeVariableContribution},
-                {"dof_contribution", res.analysis.smallestConflictPriorityBreakdown.dofContribution}
-            }},
-            {"smallest_conflict_selection_explanation", res.analysis.smallestConflictSelectionExplanation},
-            {"smallest_conflict_selection_tag", res.analysis.smallestConflictSelectionTag},
-            {"smallest_conflict_selection_summary", res.analysis.smallestConflictSelectionSummary},
-            {"smallest_conflict_action_label", res.analysis.smallestConflictActionLabel},
-            {"smallest_conflict_action_hint", res.analysis.smallestConflictActionHint},
-            {"smallest_conflict_action", smallest_conflict_action},
-            {"smallest_conflict_variable_keys", res.analysis.smallestConflictVariableKeys},
-            {"smallest_conflict_free_variable_keys", res.analysis.smallestConflictFreeVariableKeys},
-            {"smallest_conflict_selection_policy", res.analysis.smallestConflictSelectionPolicy},
-            {"primary_redundancy_subset_anchor_constraint_index", res.analysis.primaryRedundancySubsetAnchorConstraintIndex},
-            {"primary_redundancy_priority_score", res.analysis.primaryRedundancyPriorityScore},
-            {"primary_redundancy_priority_breakdown", {
-                {"redundant_constraint_contribution", res.analysis.primaryRedundancyPriorityBreakdown.redundantConstraintContribution},
-                {"witness_penalty", res.analysis.primaryRedundancyPriorityBreakdown.witnessPenalty}
-            }},
-            {"primary_redundancy_selection_explanation", res.analysis.primaryRedundancySelectionExplanation},
-            {"primary_redundancy_selection_tag", res.analysis.primaryRedundancySelectionTag},
-            {"primary_redundancy_selection_summary", res.analysis.primaryRedundancySelectionSummary},
-            {"primary_redundancy_action_label", res.analysis.primaryRedundancyActionLabel},
-            {"primary_redundancy_action_hint", res.analysis.primaryRedundancyActionHint},
-            {"primary_redundancy_action", primary_redundancy_action},
-            {"primary_redundancy_variable_keys", res.analysis.primaryRedundancyVariableKeys},
-            {"primary_redundancy_selection_policy", res.analysis.primaryRedundancySelectionPolicy},
-            {"smallest_redundancy_subset_anchor_constraint_index", res.analysis.smallestRedundancySubsetAnchorConstraintIndex},
-            {"smallest_redundancy_witness_constraint_count", res.analysis.smallestRedundancyWitnessConstraintCount},
-            {"smallest_redundancy_priority_breakdown", {
-                {"redundant_constraint_contribution", res.analysis.smallestRedundancyPriorityBreakdown.redundantConstraintContribution},
-                {"witness_penalty", res.analysis.smallestRedundancyPriorityBreakdown.witnessPenalty}
-            }},
-            {"smallest_redundancy_selection_explanation", res.analysis.smallestRedundancySelectionExplanation},
-            {"smallest_redundancy_selection_tag", res.analysis.smallestRedundancySelectionTag},
-            {"smallest_redundancy_selection_summary", res.analysis.smallestRedundancySelectionSummary},
-            {"smallest_redundancy_action_label", res.analysis.smallestRedundancyActionLabel},
-            {"smallest_redundancy_action_hint", res.analysis.smallestRedundancyActionHint},
-            {"smallest_redundancy_action", smallest_redundancy_action},
-            {"smallest_redundancy_variable_keys", res.analysis.smallestRedundancyVariableKeys},
-            {"smallest_redundancy_selection_policy", res.analysis.smallestRedundancySelectionPolicy},
-            {"action_panel_count", static_cast<int>(action_panels.size())},
-            {"action_panels", action_panels},
-        };
-        out["structural_summary"] = {
-            {"state", constraintStructuralStateName(res.analysis.structuralState)},
-            {"dof_estimate", res.analysis.dofEstimate},
-            {"redundant_constraint_estimate", res.analysis.redundantConstraintEstimate},
-            {"duplicate_constraint_group_count", res.analysis.duplicateConstraintGroupCount},
-            {"largest_duplicate_constraint_group_size", res.analysis.largestDuplicateConstraintGroupSize},
-            {"structural_group_count", res.analysis.structuralGroupCount},
-            {"underconstrained_group_count", res.analysis.underconstrainedGroupCount},
-            {"well_constrained_group_count", res.analysis.wellConstrainedGroupCount},
-            {"overconstrained_group_count", res.analysis.overconstrainedGroupCount},
-            {"mixed_group_count", res.analysis.mixedGroupCount},
-            {"conflict_group_count", res.analysis.conflictGroupCount},
-            {"largest_conflict_group_size", res.analysis.largestConflictGroupSize},
-            {"redundancy_subset_count", res.analysis.redundancySubsetCount},
-            {"redundant_constraint_candidate_count", res.analysis.redundantConstraintCandidateCount},
-            {"free_variable_candidate_count", res.analysis.freeVariableCandidateCount},
-            {"problematic_constraint_count", res.analysis.problematicConstraintCount},
-            {"primary_conflict_anchor_constraint_index", res.analysis.primaryConflictAnchorConstraintIndex},
-            {"primary_conflict_priority_score", res.analysis.primaryConflictPriorityScore},
-            {"primary_conflict_priority_breakdown", {
-                {"state_bias", res.analysis.primaryConflictPriorityBreakdown.stateBias},
-                {"redundant_constraint_contribution", res.analysis.primaryConflictPriorityBreakdown.redundantConstraintContribution},
-                {"constraint_count_contribution", res.analysis.primaryConflictPriorityBreakdown.constraintCountContribution},
-                {"free_variable_contribution", res.analysis.primaryConflictPriorityBreakdown.freeVariableContribution},
-                {"dof_contribution", res.analysis.primaryConflictPriorityBreakdown.dofContribution}
-            }},
-            {"primary_conflict_selection_explanation", res.analysis.primaryConflictSelectionExplanation},
-            {"primary_conflict_selection_tag", res.analysis.primaryConflictSelectionTag},
-            {"primary_conflict_selection_summary", res.analysis.primaryConflictSelectionSummary},
-            {"primary_conflict_action_label", res.analysis.primaryConflictActionLabel},
-            {"primary_conflict_action_hint", res.analysis.primaryConflictActionHint},
-            {"primary_conflict_action", primary_conflict_action},
-            {"primary_conflict_variable_keys", res.analysis.primaryConflictVariableKeys},
-            {"primary_conflict_free_variable_keys", res.analysis.primaryConflictFreeVariableKeys},
-            {"primary_conflict_selection_policy", res.analysis.primaryConflictSelectionPolicy},
-            {"smallest_conflict_group_anchor_constraint_index", res.analysis.smallestConflictGroupAnchorConstraintIndex},
-            {"smallest_conflict_group_size", res.analysis.smallestConflictGroupSize},
-            {"smallest_conflict_priority_breakdown", {
-                {"state_bias", res.analysis.smallestConflictPriorityBreakdown.stateBias},
-                {"redundant_constraint_contribution", res.analysis.smallestConflictPriorityBreakdown.redundantConstraintContribution},
-                {"constraint_count_contribution", res.analysis.smallestConflictPriorityBreakdown.constraintCountContribution},
-                {"free_variable_contribution", res.analysis.smallestConflictPriorityBreakdown.freeVariableContribution},
-                {"dof_contribution", res.analysis.smallestConflictPriorityBreakdown.dofContribution}
-            }},
-            {"smallest_conflict_selection_explanation", res.analysis.smallestConflictSelectionExplanation},
-            {"smallest_conflict_selection_tag", res.analysis.smallestConflictSelectionTag},
-            {"smallest_conflict_selection_summary", res.analysis.smallestConflictSelectionSummary},
-            {"smallest_conflict_action_label", res.analysis.smallestConflictActionLabel},
-            {"smallest_conflict_action_hint", res.analysis.smallestConflictActionHint},
-            {"smallest_conflict_action", smallest_conflict_action},
-            {"smallest_conflict_variable_keys", res.analysis.smallestConflictVariableKeys},
-            {"smallest_conflict_free_variable_keys", res.analysis.smallestConflictFreeVariableKeys},
-            {"smallest_conflict_selection_policy", res.analysis.smallestConflictSelectionPolicy},
-            {"primary_redundancy_subset_anchor_constraint_index", res.analysis.primaryRedundancySubsetAnchorConstraintIndex},
-            {"primary_redundancy_priority_score", res.analysis.primaryRedundancyPriorityScore},
-            {"primary_redundancy_priority_breakdown", {
-                {"redundant_constraint_contribution", res.analysis.primaryRedundancyPriorityBreakdown.redundantConstraintContribution},
-                {"witness_penalty", res.analysis.primaryRedundancyPriorityBreakdown.witnessPenalty}
-            }},
-            {"primary_redundancy_selection_explanation", res.analysis.primaryRedundancySelectionExplanation},
-            {"primary_redundancy_selection_tag", res.analysis.primaryRedundancySelectionTag},
-            {"primary_redundancy_selection_summary", res.analysis.primaryRedundancySelectionSummary},
-            {"primary_redundancy_action_label", res.analysis.primaryRedundancyActionLabel},
-            {"primary_redundancy_action_hint", res.analysis.primaryRedundancyActionHint},
-            {"primary_redundancy_action", primary_redundancy_action},
-            {"primary_redundancy_variable_keys", res.analysis.primaryRedundancyVariableKeys},
-            {"primary_redundancy_selection_policy", res.analysis.primaryRedundancySelectionPolicy},
-            {"smallest_redundancy_subset_anchor_constraint_index", res.analysis.smallestRedundancySubsetAnchorConstraintIndex},
-            {"smallest_redundancy_witness_constraint_count", res.analysis.smallestRedundancyWitnessConstraintCount},
-            {"smallest_redundancy_priority_breakdown", {
-                {"redundant_constraint_contribution", res.analysis.smallestRedundancyPriorityBreakdown.redundantConstraintContribution},
-                {"witness_penalty", res.analysis.smallestRedundancyPriorityBreakdown.witnessPenalty}
-            }},
-            {"smallest_redundancy_selection_explanation", res.analysis.smallestRedundancySelectionExplanation},
-            {"smallest_redundancy_selection_tag", res.analysis.smallestRedundancySelectionTag},
-            {"smallest_redundancy_selection_summary", res.analysis.smallestRedundancySelectionSummary},
-            {"smallest_redundancy_action_label", res.analysis.smallestRedundancyActionLabel},
-            {"smallest_redundancy_action_hint", res.analysis.smallestRedundancyActionHint},
-            {"smallest_redundancy_action", smallest_redundancy_action},
-            {"smallest_redundancy_variable_keys", res.analysis.smallestRedundancyVariableKeys},
-            {"smallest_redundancy_selection_policy", res.analysis.smallestRedundancySelectionPolicy},
-            {"action_panel_count", static_cast<int>(action_panels.size())},
-            {"action_panels", action_panels},
-        };
-        out["problematic_constraint_indices"] = res.problematicConstraintIndices;
-        out["primary_conflict_constraint_indices"] = res.primaryConflictConstraintIndices;
-        out["smallest_conflict_constraint_indices"] = res.smallestConflictConstraintIndices;
-        out["primary_redundancy_basis_constraint_indices"] = res.primaryRedundancyBasisConstraintIndices;
-        out["primary_redundant_constraint_indices"] = res.primaryRedundantConstraintIndices;
-        out["smallest_redundancy_basis_constraint_indices"] = res.smallestRedundancyBasisConstraintIndices;
-        out["smallest_redundant_constraint_indices"] = res.smallestRedundantConstraintIndices;
-        out["redundancy_groups"] = json::array();
-        for (const auto& group : res.redundancyGroups) {
-            out["redundancy_groups"].push_back({
-                {"anchor_constraint_index", group.anchorConstraintIndex},
-                {"kind", constraintKindName(group.kind)},
-                {"type", group.type},
-                {"constraint_indices", group.constraintIndices},
-                {"group_size", static_cast<int>(group.constraintIndices.size())},
-                {"redundant_count", std::max(0, static_cast<int>(group.constraintIndices.size()) - 1)}
-            });
+// Projects for --batch: every *.json in a directory (sorted by name), or the
+// lines of a manifest file (blank lines and '#' comments skipped; relative
+// paths resolve against the manifest's directory).
+static bool collect_batch_projects(const std::string& source, std::vector<std::string>& projects,
+                                   std::string& error) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        for (const auto& entry : fs::directory_iterator(source, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                projects.push_back(entry.path().string());
+            }
         }
-        out["structural_groups"] = json::array();
-        for (const auto& group : res.structuralGroups) {
-            out["structural_groups"].push_back({
-                {"anchor_constraint_index", group.anchorConstraintIndex},
-                {"constraint_indices", group.constraintIndices},
-                {"variable_keys", group.variableKeys},
-                {"basis_variable_keys", group.basisVariableKeys},
-                {"free_variable_keys", group.freeVariableKeys},
-                {"jacobian_row_count", group.jacobianRowCount},
-                {"jacobian_column_count", group.jacobianColumnCount},
-                {"jacobian_rank", group.jacobianRank},
-                {"dof_estimate", group.dofEstimate},
-                {"redundant_constraint_estimate", group.redundantConstraintEstimate},
-                {"priority_score", group.priorityScore},
-                {"state", constraintStructuralStateName(group.structuralState)}
-            });
+        if (ec) { error = "Read failed: " + source; return false; }
+        std::sort(projects.begin(), projects.end());
+        return true;
+    }
+    std::ifstream manifest(source);
+    if (!manifest.is_open()) { error = "Open failed: " + source; return false; }
+    const fs::path base = fs::path(source).parent_path();
+    std::string line;
+    while (std::getline(manifest, line)) {
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        const auto last = line.find_last_not_of(" \t\r");
+        const fs::path path(line.substr(first, last - first + 1));
+        projects.push_back(path.is_absolute() ? path.string() : (base / path).string());
+    }
+    return true;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Solves `projects` on `jobs` worker threads, each reusing one solver, and
+// streams one NDJSON record per project to stdout as it finishes (records
+// carry the manifest index; order follows completion). With `full_results`
+// each record embeds the --json document under "result".
+static int run_batch(const std::vector<std::string>& projects, int jobs,
+                     SolverDiagnosticsLevel diagnostics_level, bool full_results) {
+    const auto batch_start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::atomic<int> failed{0};
+    std::mutex output_mutex;
+    auto worker = [&]() {
+        std::unique_ptr<ISolver> solver(create_project_solver(diagnostics_level));
+        solver->setThreadCount(1); // projects are the unit of parallelism
+        for (size_t index = next++; index < projects.size(); index = next++) {
+            const auto start = std::chrono::steady_clock::now();
+            json record = {{"index", index}, {"project", projects[index]}};
+            VarStore store;
+            std::vector<ConstraintSpec> specs;
+            std::string load_error;
+            const bool loaded = load_project(projects[index], store, specs, load_error);
+            const double load_ms = elapsed_ms(start);
+            double solve_ms = 0.0;
+            bool ok = false;
+            if (loaded) {
+                const auto solve_start = std::chrono::steady_clock::now();
+                const SolveResult res = solve_project(*solver, specs, store);
+                solve_ms = elapsed_ms(solve_start);
+                ok = res.ok;
+                record["ok"] = res.ok;
+                record["iterations"] = res.iterations;
+                record["final_error"] = res.finalError;
+                record["message"] = res.message;
+                if (full_results) record["result"] = solve_result_json(res, store);
+            } else {
+                record["ok"] = false;
+                record["error"] = load_error;
+            }
+            record["timing_ms"] = {{"load", load_ms}, {"solve", solve_ms}, {"total", elapsed_ms(start)}};
+            if (!ok) ++failed;
+            const std::string line = record.dump();
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << line << "\n" << std::flush;
         }
-        out["conflict_groups"] = json::array();
-        for (const auto& group : res.conflictGroups) {
-            out["conflict_groups"].push_back({
-                {"anchor_constraint_index", group.anchorConstraintIndex},
-                {"constraint_indices", group.constraintIndices},
-                {"variable_keys", group.variableKeys},
-                {"basis_variable_keys", group.basisVariableKeys},
-                {"free_variable_keys", group.freeVariableKeys},
-                {"jacobian_rank", group.jacobianRank},
-                {"dof_estimate", group.dofEstimate},
-                {"redundant_constraint_estimate", group.redundantConstraintEstimate},
-                {"priority_score", group.priorityScore},
-                {"priority_breakdown", {
-                    {"state_bias", group.priorityStateBias},
-                    {"redundant_constraint_contribution", group.priorityRedundantConstraintContribution},
-                    {"constraint_count_contribution", group.priorityConstraintCountContribution},
-                    {"free_variable_contribution", group.priorityFreeVariableContribution},
-                    {"dof_contribution", group.priorityDofContribution}
-                }},
-                {"state", constraintStructuralStateName(group.structuralState)}
-            });
+    };
+    const int workers = std::max(1, std::min(jobs, static_cast<int>(projects.size())));
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(workers));
+    for (int t = 0; t < workers; ++t) threads.emplace_back(worker);
+    for (auto& thread : threads) thread.join();
+    std::cerr << "batch: " << projects.size() << " projects, " << failed.load() << " failed, "
+              << workers << " workers, " << elapsed_ms(batch_start) << " ms\n";
+    return failed.load() == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv){
+    bool emit_json = false;
+    SolverDiagnosticsLevel diagnostics_level = SolverDiagnosticsLevel::Full;
+    std::string batch_source;
+    int jobs = static_cast<int>(std::thread::hardware_concurrency());
+    std::string input_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            emit_json = true;
+            continue;
         }
-        out["redundancy_subsets"] = json::array();
-        for (const auto& subset : res.redundancySubsets) {
-            out["redundancy_subsets"].push_back({
-                {"anchor_constraint_index", subset.anchorConstraintIndex},
-                {"basis_constraint_indices", subset.basisConstraintIndices},
-                {"redundant_constraint_indices", subset.redundantConstraintIndices},
-                {"variable_keys", subset.variableKeys},
-                {"jacobian_rank", subset.jacobianRank},
-                {"witness_constraint_count", subset.witnessConstraintCount},
-                {"priority_score", subset.priorityScore},
-                {"priority_breakdown", {
-                    {"redundant_constraint_contribution", subset.priorityRedundantConstraintContribution},
-                    {"witness_penalty", subset.priorityWitnessPenalty}
-                }},
-                {"state", constraintStructuralStateName(subset.structuralState)}
-            });
+        if (arg == "--diagnostics") {
+            if (i + 1 >= argc || !parse_diagnostics_level(argv[++i], diagnostics_level)) { usage(); return 2; }
+            continue;
         }
-        out["diagnostics"] = json::array();
-        for (const auto& diag : res.diagnostics) {
-            json item = {
-                {"constraint_index", diag.constraintIndex},
-                {"type", diag.type},
-                {"kind", constraintKindName(diag.kind)},
-                {"code", constraintDiagnosticCodeName(diag.code)},
-                {"detail", diag.detail},
-            };
-            if (diag.relatedConstraintIndex >= 0) {
-                item["related_constraint_index"] = diag.relatedConstraintIndex;
-            }
-            out["diagnostics"].push_back(std::move(item));
+        if (arg == "--batch") {
+            if (i + 1 >= argc) { usage(); return 2; }
+            batch_source = argv[++i];
+            continue;
+        }
+        if (arg == "--jobs") {
+            if (i + 1 >= argc || (jobs = std::atoi(argv[++i])) <= 0) { usage(); return 2; }
+            continue;
         }
-        json vars = json::object();
-        for (const auto& kv : store.vars) vars[kv.first] = kv.second;
-        out["vars"] = vars;
+        if (!input_path.empty()) { usage(); return 2; }
+        input_path = arg;
+    }
+    if (!batch_source.empty()) {
+        if (!input_path.empty()) { usage(); return 2; }
+        std::vector<std::string> projects;
+        std::string batch_error;
+        if (!collect_batch_projects(batch_source, projects, batch_error)) { std::cerr << batch_error << "\n"; return 2; }
+        return run_batch(projects, std::max(1, jobs), diagnostics_level, emit_json);
+    }
+    if (input_path.empty()) { usage(); return 2; }
+
+    VarStore store;
+    std::vector<ConstraintSpec> specs;
+    std::string load_error;
+    if (!load_project(input_path, store, specs, load_error)) { std::cerr << load_error << "\n"; return 2; }
+
+    ISolver* solver = create_project_solver(diagnostics_level);
+    SolveResult res = solve_project(*solver, specs, store);
+    if (emit_json) {
+        const json out = solve_result_json(res, store);
         std::cout << out.dump(2) << "\n";
     } else {
         std::cout << "SolveResult: ok=" << res.ok << ", iters=" << res.iterations << ", err=" << res.finalError << "\n";
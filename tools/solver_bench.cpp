@@ -0,0 +1,473 @@
+// solver_bench: throughput and scaling of the constraint solvers on generated
+// sketches. Every (generator, size, algorithm) case is generated from a fixed
+// seed, solved --repeat times from the same perturbed start, and reported as
+// one JSON record: time per solve, iterations, the analysis / presolve /
+// iteration split and peak memory.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "third_party/json.hpp"
+#include "core/solver.hpp"
+
+using json = nlohmann::json;
+using namespace core;
+
+namespace {
+
+using VarMap = std::unordered_map<std::string, double>;
+
+struct Sketch {
+    VarMap vars;
+    std::vector<ConstraintSpec> constraints;
+};
+
+void usage() {
+    std::cerr << "Usage: solver_bench [--sizes 10,100,1000] [--algorithms lm,dogleg,bfgs,portfolio]\n"
+                 "                    [--generators chain,grid,lattice,random] [--repeat N] [--seed S]\n"
+                 "                    [--diagnostics none|counts|structural|full] [--no-presolve]\n"
+                 "                    [--out report.json]\n"
+                 "  Sizes are target constraint counts (e.g. --sizes 10,100,1000,10000,100000\n"
+                 "  --algorithms lm for a scaling run); the report goes to stdout unless --out.\n";
+}
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// --- Generators ---
+// Each builds a consistent target configuration, writes its constraints with
+// values measured on the target, and starts every free point off target.
+
+class Builder {
+public:
+    Builder(Sketch& sketch, unsigned seed) : sketch_(sketch), rng_(seed) {}
+
+    void point(const std::string& id, double x, double y, double jitter) {
+        std::normal_distribution<double> noise(0.0, jitter);
+        sketch_.vars[id + ".x"] = x + (jitter > 0.0 ? noise(rng_) : 0.0);
+        sketch_.vars[id + ".y"] = y + (jitter > 0.0 ? noise(rng_) : 0.0);
+    }
+
+    void pin(const std::string& id, double x, double y) {
+        add("fixed_point", {{id, "x"}, {id, "y"}}, x);
+        add("fixed_point", {{id, "y"}, {id, "x"}}, y);
+    }
+
+    void add(const char* type, std::vector<VarRef> vars, std::optional<double> value = std::nullopt) {
+        ConstraintSpec spec;
+        spec.type = type;
+        spec.vars = std::move(vars);
+        spec.value = value;
+        sketch_.constraints.push_back(std::move(spec));
+    }
+
+    static std::vector<VarRef> xy(const std::string& id) { return {{id, "x"}, {id, "y"}}; }
+
+    static std::vector<VarRef> xy(const std::string& a, const std::string& b) {
+        return {{a, "x"}, {a, "y"}, {b, "x"}, {b, "y"}};
+    }
+
+    static std::vector<VarRef> xy(const std::string& a0, const std::string& a1,
+                                  const std::string& b0, const std::string& b1) {
+        std::vector<VarRef> refs = xy(a0, a1);
+        const std::vector<VarRef> rest = xy(b0, b1);
+        refs.insert(refs.end(), rest.begin(), rest.end());
+        return refs;
+    }
+
+    std::mt19937& rng() { return rng_; }
+
+private:
+    Sketch& sketch_;
+    std::mt19937 rng_;
+};
+
+// Polyline of separate line segments, each end coincident with the next
+// start and each length fixed; the first start is pinned. ~2 per line.
+Sketch generate_chain(int target, unsigned seed) {
+    Sketch sketch;
+    Builder b(sketch, seed);
+    const int lines = std::max(1, (target - 2) / 2);
+    double x = 0.0, y = 0.0;
+    for (int i = 0; i < lines; ++i) {
+        const std::string a = "l" + std::to_string(i) + "a";
+        const std::string e = "l" + std::to_string(i) + "b";
+        const double angle = 0.6 * std::sin(0.37 * i);
+        const double length = 1.0 + 0.25 * std::cos(0.11 * i);
+        const double nx = x + length * std::cos(angle);
+        const double ny = y + length * std::sin(angle);
+        b.point(a, x, y, i == 0 ? 0.0 : 0.05);
+        b.point(e, nx, ny, 0.05);
+        if (i == 0) b.pin(a, x, y);
+        else b.add("coincident", Builder::xy("l" + std::to_string(i - 1) + "b", a));
+        b.add("distance", Builder::xy(a, e), length);
+        x = nx;
+        y = ny;
+    }
+    return sketch;
+}
+
+// Grid of axis-aligned rectangles sharing corners with their right and lower
+// neighbours, every rectangle as wide and tall as the reference one and its
+// top edge parallel to the reference bottom (redundant). ~9 per rectangle.
+Sketch generate_grid(int target, unsigned seed) {
+    Sketch sketch;
+    Builder b(sketch, seed);
+    const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(target / 9.0))));
+    const double w = 3.0, h = 2.0;
+    auto corner = [](int i, int j, char c) {
+        return "r" + std::to_string(i) + "_" + std::to_string(j) + c;
+    };
+    for (int i = 0; i < side; ++i) {
+        for (int j = 0; j < side; ++j) {
+            const double x = j * w, y = i * h;
+            const std::string a = corner(i, j, 'a'), bb = corner(i, j, 'b');
+            const std::string c = corner(i, j, 'c'), d = corner(i, j, 'd');
+            const bool reference = i == 0 && j == 0;
+            b.point(a, x, y, reference ? 0.0 : 0.05);
+            b.point(bb, x + w, y, 0.05);
+            b.point(c, x + w, y + h, 0.05);
+            b.point(d, x, y + h, 0.05);
+            b.add("horizontal", {{a, "y"}, {bb, "y"}});
+            b.add("horizontal", {{d, "y"}, {c, "y"}});
+            b.add("vertical", {{a, "x"}, {d, "x"}});
+            b.add("vertical", {{bb, "x"}, {c, "x"}});
+            if (reference) {
+                b.pin(a, x, y);
+                b.add("distance", Builder::xy(a, bb), w);
+                b.add("distance", Builder::xy(a, d), h);
+            } else {
+                const std::string ra = corner(0, 0, 'a');
+                b.add("equal_length", Builder::xy(a, bb, ra, corner(0, 0, 'b')));
+                b.add("equal_length", Builder::xy(a, d, ra, corner(0, 0, 'd')));
+                b.add("parallel", Builder::xy(d, c, ra, corner(0, 0, 'b')));
+            }
+            if (j > 0) b.add("coincident", Builder::xy(corner(i, j - 1, 'b'), a));
+            if (i > 0 && j == 0) b.add("coincident", Builder::xy(corner(i - 1, j, 'd'), a));
+        }
+    }
+    return sketch;
+}
+
+// Square lattice braced with distances along rows, columns and both
+// diagonals: consistent but heavily overconstrained. ~4 per point.
+Sketch generate_lattice(int target, unsigned seed) {
+    Sketch sketch;
+    Builder b(sketch, seed);
+    const int side = std::max(2, static_cast<int>(std::ceil(std::sqrt(target / 4.0))));
+    auto id = [](int i, int j) { return "n" + std::to_string(i) + "_" + std::to_string(j); };
+    for (int i = 0; i < side; ++i) {
+        for (int j = 0; j < side; ++j) b.point(id(i, j), j, i, (i || j) ? 0.08 : 0.0);
+    }
+    b.pin(id(0, 0), 0.0, 0.0);
+    b.add("horizontal", {{id(0, 0), "y"}, {id(0, 1), "y"}});
+    for (int i = 0; i < side; ++i) {
+        for (int j = 0; j < side; ++j) {
+            if (j + 1 < side) b.add("distance", Builder::xy(id(i, j), id(i, j + 1)), 1.0);
+            if (i + 1 < side) b.add("distance", Builder::xy(id(i, j), id(i + 1, j)), 1.0);
+            if (i + 1 < side && j + 1 < side) {
+                b.add("distance", Builder::xy(id(i, j), id(i + 1, j + 1)), std::sqrt(2.0));
+                b.add("distance", Builder::xy(id(i, j + 1), id(i + 1, j)), std::sqrt(2.0));
+            }
+        }
+    }
+    return sketch;
+}
+
+// Random assembly: each new point hangs off two nearby earlier ones by a
+// distance plus a distance, horizontal or vertical, with the odd extra
+// (consistent, redundant) distance. ~2 per point.
+Sketch generate_random(int target, unsigned seed) {
+    Sketch sketch;
+    Builder b(sketch, seed);
+    const int points = std::max(2, target / 2);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    std::uniform_int_distribution<int> pick(0, 9);
+    std::vector<double> tx(static_cast<size_t>(points)), ty(static_cast<size_t>(points));
+    auto id = [](int i) { return "q" + std::to_string(i); };
+    // One of the (up to) 8 previous points, other than `avoid` when possible.
+    auto earlier = [&](int i, int avoid) {
+        std::uniform_int_distribution<int> back(1, std::min(i, 8));
+        int j = i - back(b.rng());
+        if (j == avoid && i > 1) j = j == i - 1 ? i - 2 : j + 1;
+        return j;
+    };
+    auto dist = [&](int i, int j) { return std::hypot(tx[i] - tx[j], ty[i] - ty[j]); };
+    tx[0] = coord(b.rng());
+    ty[0] = coord(b.rng());
+    b.point(id(0), tx[0], ty[0], 0.0);
+    b.pin(id(0), tx[0], ty[0]);
+    for (int i = 1; i < points; ++i) {
+        tx[i] = tx[i - 1] + coord(b.rng()) * 0.1 - 5.0;
+        ty[i] = ty[i - 1] + coord(b.rng()) * 0.1 - 5.0;
+        const int j1 = earlier(i, -1);
+        const int j2 = earlier(i, j1);
+        const int kind = pick(b.rng());
+        if (kind < 3) ty[i] = ty[j2];
+        else if (kind < 6) tx[i] = tx[j2];
+        // Keep the point clear of j1 along its free axis, so the circle
+        // around j1 crosses the horizontal/vertical through j2 transversally
+        // (a grazing intersection is a double root that LM creeps towards).
+        if (kind < 3 && std::abs(tx[i] - tx[j1]) < 0.5 * dist(i, j1) + 0.5) tx[i] += dist(i, j1) + 1.0;
+        else if (kind >= 3 && kind < 6 && std::abs(ty[i] - ty[j1]) < 0.5 * dist(i, j1) + 0.5) ty[i] += dist(i, j1) + 1.0;
+        else if (kind >= 6 && dist(i, j1) < 0.5) tx[i] += 1.0;
+        b.point(id(i), tx[i], ty[i], 0.05);
+        b.add("distance", Builder::xy(id(j1), id(i)), dist(i, j1));
+        if (kind < 3) b.add("horizontal", {{id(j2), "y"}, {id(i), "y"}});
+        else if (kind < 6) b.add("vertical", {{id(j2), "x"}, {id(i), "x"}});
+        else if (j2 != j1) b.add("distance", Builder::xy(id(j2), id(i)), dist(i, j2));
+        if (kind == 9 && i > 2) {
+            const int j3 = earlier(i, j1);
+            if (j3 != j1 && j3 != j2) b.add("distance", Builder::xy(id(j3), id(i)), dist(i, j3));
+        }
+    }
+    return sketch;
+}
+
+bool generate(const std::string& name, int target, unsigned seed, Sketch& sketch) {
+    if (name == "chain") sketch = generate_chain(target, seed);
+    else if (name == "grid") sketch = generate_grid(target, seed);
+    else if (name == "lattice") sketch = generate_lattice(target, seed);
+    else if (name == "random") sketch = generate_random(target, seed);
+    else return false;
+    return true;
+}
+
+bool parse_diagnostics_level(const std::string& name, SolverDiagnosticsLevel& level) {
+    if (name == "none") level = SolverDiagnosticsLevel::None;
+    else if (name == "counts") level = SolverDiagnosticsLevel::Counts;
+    else if (name == "structural") level = SolverDiagnosticsLevel::Structural;
+    else if (name == "full") level = SolverDiagnosticsLevel::Full;
+    else return false;
+    return true;
+}
+
+bool parse_algorithm(const std::string& name, SolverAlgorithm& algo) {
+    if (name == "lm") algo = SolverAlgorithm::LM;
+    else if (name == "dogleg") algo = SolverAlgorithm::DogLeg;
+    else if (name == "bfgs") algo = SolverAlgorithm::BFGS;
+    else if (name == "portfolio") algo = SolverAlgorithm::Portfolio;
+    else return false;
+    return true;
+}
+
+// --- Memory ---
+// Peak resident set size in KiB. On Linux the high-water mark is reset before
+// each case so the figure is per case; elsewhere it is the process peak so
+// far (cases run smallest first). -1 when unavailable.
+bool reset_peak_rss() {
+#if defined(__linux__)
+    std::ofstream clear("/proc/self/clear_refs");
+    if (!clear) return false;
+    clear << "5";
+    return static_cast<bool>(clear.flush());
+#else
+    return false;
+#endif
+}
+
+long peak_rss_kb() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::atol(line.c_str() + 6);
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#if defined(__APPLE__)
+    return static_cast<long>(usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    return static_cast<long>(usage.ru_maxrss);
+#endif
+#else
+    return -1;
+#endif
+}
+
+struct Run {
+    SolveResult result;
+    double totalMs{0.0};
+};
+
+json run_case(const std::string& generator, int target, const std::string& algorithm_name,
+              SolverAlgorithm algorithm, int repeat, unsigned seed,
+              SolverDiagnosticsLevel diagnostics, bool presolve) {
+    Sketch sketch;
+    generate(generator, target, seed, sketch);
+    const VarMap start = sketch.vars;
+    const bool bfgs = algorithm == SolverAlgorithm::BFGS;
+    const bool per_case_peak = reset_peak_rss();
+
+    std::vector<Run> runs;
+    for (int r = 0; r < repeat; ++r) {
+        sketch.vars = start;
+        std::unique_ptr<ISolver> solver(createSolver(algorithm));
+        solver->setMaxIterations(bfgs ? 500 : 100);
+        solver->setTolerance(1e-8);
+        solver->setDiagnosticsLevel(diagnostics);
+        solver->setPresolve(presolve);
+        VarMap& vars = sketch.vars;
+        auto get = [&](const VarRef& v, bool& ok) {
+            const auto it = vars.find(v.id + "." + v.key);
+            ok = it != vars.end();
+            return ok ? it->second : 0.0;
+        };
+        auto set = [&](const VarRef& v, double value) { vars[v.id + "." + v.key] = value; };
+        std::vector<ConstraintSpec> constraints = sketch.constraints;
+        const auto t0 = std::chrono::steady_clock::now();
+        Run run;
+        run.result = solver->solveWithBindings(constraints, get, set);
+        run.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        runs.push_back(std::move(run));
+    }
+    std::sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.totalMs < b.totalMs; });
+    const Run& median = runs[runs.size() / 2];
+    const SolveResult& res = median.result;
+
+    return json{
+        {"generator", generator},
+        {"algorithm", algorithm_name},
+        {"winner", solverAlgorithmName(res.algorithm)},
+        {"target_constraints", target},
+        {"constraints", sketch.constraints.size()},
+        {"variables", start.size()},
+        {"ok", res.ok},
+        {"message", res.message},
+        {"iterations", res.iterations},
+        {"final_error", res.finalError},
+        {"components", res.componentCount},
+        {"presolved_constraints", res.presolvedConstraints.size()},
+        {"sparse", res.sparseLinearAlgebra},
+        {"jacobian_rank", res.analysis.jacobianRank},
+        {"time_ms", {
+            {"median", median.totalMs},
+            {"min", runs.front().totalMs},
+            {"max", runs.back().totalMs},
+            {"analysis", res.analysisTimeMs},
+            {"presolve", res.presolveTimeMs},
+            {"iteration", res.iterationTimeMs},
+            // validation, bindings and result assembly
+            {"other", median.totalMs - res.analysisTimeMs - res.presolveTimeMs - res.iterationTimeMs}
+        }},
+        {"peak_rss_kb", peak_rss_kb()},
+        {"peak_rss_scope", per_case_peak ? "case" : "process"},
+        {"repeat", repeat}
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes{10, 100, 1000};
+    std::vector<std::string> algorithms{"lm", "dogleg", "bfgs"};
+    std::vector<std::string> generators{"chain", "grid", "lattice", "random"};
+    int repeat = 3;
+    unsigned seed = 12345;
+    std::string diagnostics_name = "full";
+    SolverDiagnosticsLevel diagnostics = SolverDiagnosticsLevel::Full;
+    bool presolve = true;
+    std::string out_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--sizes" && has_value) {
+            sizes.clear();
+            for (const std::string& item : split_list(argv[++i])) sizes.push_back(std::atoi(item.c_str()));
+        } else if (arg == "--algorithms" && has_value) {
+            algorithms = split_list(argv[++i]);
+        } else if (arg == "--generators" && has_value) {
+            generators = split_list(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--diagnostics" && has_value) {
+            diagnostics_name = argv[++i];
+            if (!parse_diagnostics_level(diagnostics_name, diagnostics)) { usage(); return 2; }
+        } else if (arg == "--no-presolve") {
+            presolve = false;
+        } else if (arg == "--out" && has_value) {
+            out_path = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    Sketch probe;
+    SolverAlgorithm algo{};
+    bool valid = repeat > 0 && !sizes.empty() && !algorithms.empty() && !generators.empty();
+    for (int size : sizes) valid = valid && size >= 1 && size <= 1000000;
+    for (const std::string& name : algorithms) valid = valid && parse_algorithm(name, algo);
+    for (const std::string& name : generators) valid = valid && generate(name, 1, seed, probe);
+    if (!valid) { usage(); return 2; }
+    std::sort(sizes.begin(), sizes.end());
+
+    json report{
+        {"schema", "cadgf.solver_bench.v1"},
+        {"config", {
+            {"sizes", sizes},
+            {"algorithms", algorithms},
+            {"generators", generators},
+            {"repeat", repeat},
+            {"seed", seed},
+            {"diagnostics", diagnostics_name},
+            {"presolve", presolve}
+        }},
+        {"results", json::array()}
+    };
+    for (int size : sizes) {
+        for (const std::string& generator : generators) {
+            for (const std::string& name : algorithms) {
+                parse_algorithm(name, algo);
+                json record = run_case(generator, size, name, algo, repeat, seed, diagnostics, presolve);
+                std::fprintf(stderr, "%-8s %7d %-7s ok=%d iters=%-4d %10.3f ms\n", generator.c_str(),
+                             record["constraints"].get<int>(), name.c_str(), record["ok"].get<bool>() ? 1 : 0,
+                             record["iterations"].get<int>(), record["time_ms"]["median"].get<double>());
+                report["results"].push_back(std::move(record));
+            }
+        }
+    }
+
+    if (out_path.empty()) {
+        std::cout << report.dump(2) << "\n";
+        return 0;
+    }
+    const std::filesystem::path parent = std::filesystem::path(out_path).parent_path();
+    std::error_code ec;
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "Cannot write " << out_path << "\n";
+        return 1;
+    }
+    out << report.dump(2) << "\n";
+    return out ? 0 : 1;
+}